@@ -0,0 +1,569 @@
+#include <json/json.h>
+#include <json/binary.h>
+#include <json/ndjson.h>
+#include <json/config.h>
+
+#include "corpus.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <new>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+using namespace Json;
+
+/*
+ * Allocations of the whole program are counted by replacing the global
+ * operators new and delete, which the heap memory resource of the library
+ * goes through as well.
+ */
+
+namespace
+{
+
+  std::atomic< size_t > allocations(0);
+  std::atomic< size_t > allocated_bytes(0);
+
+  inline void *counted_allocate(size_t size, const std::nothrow_t &) noexcept
+  {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+
+    return malloc(size ? size : 1);
+  }
+
+  inline void *counted_allocate(size_t size)
+  {
+    if (void *p = counted_allocate(size, std::nothrow))
+      return p;
+
+    throw std::bad_alloc();
+  }
+
+  inline void *counted_allocate(size_t size, std::align_val_t align)
+  {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+
+    void *p = NULL;
+
+    if (posix_memalign(&p, std::max((size_t)align, sizeof(void *)), size ? size : 1))
+      throw std::bad_alloc();
+
+    return p;
+  }
+
+} // namespace
+
+void *operator new(size_t size)
+{ return counted_allocate(size); }
+
+void *operator new[](size_t size)
+{ return counted_allocate(size); }
+
+void *operator new(size_t size, const std::nothrow_t &nothrow) noexcept
+{ return counted_allocate(size, nothrow); }
+
+void *operator new[](size_t size, const std::nothrow_t &nothrow) noexcept
+{ return counted_allocate(size, nothrow); }
+
+void *operator new(size_t size, std::align_val_t align)
+{ return counted_allocate(size, align); }
+
+void *operator new[](size_t size, std::align_val_t align)
+{ return counted_allocate(size, align); }
+
+void operator delete(void *p) noexcept
+{ free(p); }
+
+void operator delete[](void *p) noexcept
+{ free(p); }
+
+void operator delete(void *p, size_t) noexcept
+{ free(p); }
+
+void operator delete[](void *p, size_t) noexcept
+{ free(p); }
+
+void operator delete(void *p, std::align_val_t) noexcept
+{ free(p); }
+
+void operator delete[](void *p, std::align_val_t) noexcept
+{ free(p); }
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept
+{ free(p); }
+
+void operator delete[](void *p, size_t, std::align_val_t) noexcept
+{ free(p); }
+
+namespace
+{
+
+  typedef std::chrono::steady_clock Clock;
+
+  struct Options
+  {
+    Options()
+      : runs(15), min_time(20), warmup(100), scale(1), json(false), list(false)
+    {
+    }
+
+    // Number of timed samples
+    unsigned runs;
+    // Minimum duration of a sample, in milliseconds
+    double min_time;
+    // Duration of the warmup, in milliseconds
+    double warmup;
+    double scale;
+    bool json;
+    bool list;
+    std::vector< std::string > filters;
+    std::vector< std::string > files;
+  };
+
+  struct Result
+  {
+    std::string corpus;
+    std::string operation;
+    size_t bytes;
+    size_t iterations;
+    // Nanoseconds per iteration
+    double min;
+    double median;
+    double p90;
+    double max;
+    double allocations;
+    double allocated_bytes;
+    // Peak resident set size of the process, and its growth over the size
+    // before the benchmark, in kB
+    long peak_rss;
+    long rss_growth;
+  };
+
+  /**
+   * Operation measured on a corpus. What it reads is prepared beforehand,
+   * so that only the operation itself is timed.
+   */
+  struct Benchmark
+  {
+    std::string corpus;
+    std::string operation;
+    size_t bytes;
+    std::function< void () > run;
+  };
+
+  // Reset the peak resident set size, where Linux supports it. The memory
+  // freed by the previous benchmarks is given back first, so that the peak
+  // reflects what the next one uses.
+  bool reset_peak_rss()
+  {
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+
+    FILE *file = fopen("/proc/self/clear_refs", "w");
+
+    if (!file)
+      return false;
+
+    bool done = fputs("5", file) >= 0;
+    return fclose(file) == 0 && done;
+  }
+
+  // Read a field of /proc/self/status, in kB, -1 if it is missing
+  long get_status(const char *field)
+  {
+    FILE *file = fopen("/proc/self/status", "r");
+    size_t length = strlen(field);
+    char line[256];
+    long result = -1;
+
+    if (!file)
+      return -1;
+
+    while (fgets(line, sizeof(line), file))
+      if (!strncmp(line, field, length) && line[length] == ':')
+        result = atol(line + length + 1);
+
+    fclose(file);
+    return result;
+  }
+
+  long get_peak_rss()
+  {
+    long peak = get_status("VmHWM");
+
+    if (peak < 0)
+      {
+        struct rusage usage;
+
+        if (!getrusage(RUSAGE_SELF, &usage))
+          peak = usage.ru_maxrss;
+      }
+
+    return peak;
+  }
+
+  // Value at a fraction of the sorted samples, interpolated
+  double percentile(const std::vector< double > &sorted, double fraction)
+  {
+    double pos = fraction * (sorted.size() - 1);
+    size_t low = (size_t)pos;
+
+    if (low + 1 >= sorted.size())
+      return sorted.back();
+
+    return sorted[low] + (sorted[low + 1] - sorted[low]) * (pos - low);
+  }
+
+  inline double elapsed(Clock::time_point start)
+  {
+    return std::chrono::duration< double, std::nano >(Clock::now() - start).count();
+  }
+
+  Result measure(const Benchmark &benchmark, const Options &options, bool rss)
+  {
+    Result result;
+
+    result.corpus = benchmark.corpus;
+    result.operation = benchmark.operation;
+    result.bytes = benchmark.bytes;
+
+    if (rss)
+      reset_peak_rss();
+
+    long rss_before = get_status("VmRSS");
+
+    // Warmup, which also gives the number of iterations of a sample
+    size_t count = 0;
+    Clock::time_point start = Clock::now();
+
+    do
+      {
+        benchmark.run();
+        ++count;
+      }
+    while (elapsed(start) < options.warmup * 1e6);
+
+    double per_iteration = elapsed(start) / count;
+
+    result.iterations = std::max(1.0, ceil(options.min_time * 1e6 / per_iteration));
+
+    // Allocations of a single iteration
+    size_t before = allocations.load();
+    size_t before_bytes = allocated_bytes.load();
+
+    benchmark.run();
+
+    result.allocations = allocations.load() - before;
+    result.allocated_bytes = allocated_bytes.load() - before_bytes;
+
+    std::vector< double > samples;
+
+    for (unsigned i = 0; i < options.runs; ++i)
+      {
+        start = Clock::now();
+
+        for (size_t j = 0; j < result.iterations; ++j)
+          benchmark.run();
+
+        samples.push_back(elapsed(start) / result.iterations);
+      }
+
+    std::sort(samples.begin(), samples.end());
+
+    result.min = samples.front();
+    result.median = percentile(samples, 0.5);
+    result.p90 = percentile(samples, 0.9);
+    result.max = samples.back();
+    result.peak_rss = get_peak_rss();
+    result.rss_growth = (rss && rss_before >= 0 ? result.peak_rss - rss_before : -1);
+
+    return result;
+  }
+
+  // Add the benchmarks of a corpus
+  void add_benchmarks(std::vector< Benchmark > &benchmarks, const Corpus &input)
+  {
+    // Shared by the operations, which outlive this function
+    std::shared_ptr< const Corpus > corpus(new Corpus(input));
+    std::shared_ptr< std::vector< Value > > values(new std::vector< Value >);
+    std::shared_ptr< std::vector< std::string > > binaries(new std::vector< std::string >);
+
+    JsonHandler handler;
+    BinaryHandler binary;
+
+    for (size_t i = 0; i < corpus->records.size(); ++i)
+      {
+        values->push_back(handler.decode(corpus->records[i]));
+        binaries->push_back(std::string());
+        binary.encode(binaries->back(), values->back());
+      }
+
+    size_t bytes = corpus->get_size();
+    const std::string &name = corpus->name;
+
+    benchmarks.push_back(Benchmark { name, "parse", bytes, [corpus] ()
+      {
+        JsonHandler handler;
+        Handler events;
+
+        for (size_t i = 0; i < corpus->records.size(); ++i)
+          handler.parse(corpus->records[i], events);
+      } });
+
+    benchmarks.push_back(Benchmark { name, "decode-value", bytes, [corpus] ()
+      {
+        JsonHandler handler;
+
+        for (size_t i = 0; i < corpus->records.size(); ++i)
+          handler.decode(corpus->records[i].data(), corpus->records[i].size());
+      } });
+
+    benchmarks.push_back(Benchmark { name, "decode-document", bytes, [corpus] ()
+      {
+        JsonHandler handler;
+        Document doc;
+
+        for (size_t i = 0; i < corpus->records.size(); ++i)
+          handler.decode(doc, corpus->records[i].data(), corpus->records[i].size());
+      } });
+
+    benchmarks.push_back(Benchmark { name, "decode-borrow", bytes, [corpus] ()
+      {
+        JsonHandler handler;
+        Document doc;
+
+        for (size_t i = 0; i < corpus->records.size(); ++i)
+          handler.decode(doc, corpus->records[i].data(), corpus->records[i].size(),
+                         JsonHandler::BORROW_STRINGS | JsonHandler::RAW_NUMBERS);
+      } });
+
+    benchmarks.push_back(Benchmark { name, "decode-tape", bytes, [corpus] ()
+      {
+        JsonHandler handler;
+        Tape tape;
+
+        for (size_t i = 0; i < corpus->records.size(); ++i)
+          handler.decode(tape, corpus->records[i].data(), corpus->records[i].size());
+      } });
+
+    benchmarks.push_back(Benchmark { name, "decode-binary", bytes, [binaries] ()
+      {
+        BinaryHandler binary;
+        Document doc;
+
+        for (size_t i = 0; i < binaries->size(); ++i)
+          binary.decode(doc, (*binaries)[i].data(), (*binaries)[i].size());
+      } });
+
+    benchmarks.push_back(Benchmark { name, "encode", bytes, [values] ()
+      {
+        JsonHandler handler;
+        std::string output;
+
+        for (size_t i = 0; i < values->size(); ++i)
+          handler.encode(output, (*values)[i]);
+      } });
+
+    benchmarks.push_back(Benchmark { name, "encode-binary", bytes, [values] ()
+      {
+        BinaryHandler binary;
+        std::string output;
+
+        for (size_t i = 0; i < values->size(); ++i)
+          binary.encode(output, (*values)[i]);
+      } });
+
+    if (corpus->lines)
+      {
+        std::shared_ptr< const std::string > text(new std::string(corpus->get_text()));
+
+        benchmarks.push_back(Benchmark { name, "ndjson", bytes, [text] ()
+          {
+            NdjsonReader reader("UTF-8", 1);
+            std::vector< Value > records;
+
+            reader.decode(records, text->data(), text->size());
+          } });
+      }
+  }
+
+  bool selected(const Benchmark &benchmark, const Options &options)
+  {
+    if (options.filters.empty())
+      return true;
+
+    std::string name = benchmark.corpus + "/" + benchmark.operation;
+
+    for (size_t i = 0; i < options.filters.size(); ++i)
+      if (name.find(options.filters[i]) != std::string::npos)
+        return true;
+
+    return false;
+  }
+
+  void print_text(const Result &result)
+  {
+    std::string name = result.corpus + "/" + result.operation;
+    double mb_per_s = result.bytes / result.median * 1e3;
+
+    printf("%-28s %10zu %9.1f %11.3f %11.3f %11.3f %11.0f %13.0f %10ld %9ld\n",
+           name.c_str(), result.bytes, mb_per_s, result.median / 1e3, result.p90 / 1e3,
+           result.min / 1e3, result.allocations, result.allocated_bytes, result.peak_rss,
+           result.rss_growth);
+    fflush(stdout);
+  }
+
+  void print_json(const Result &result, bool first)
+  {
+    printf("%s\n    { \"name\" : \"%s/%s\", \"corpus\" : \"%s\", \"operation\" : \"%s\","
+           " \"bytes\" : %zu, \"iterations\" : %zu, \"min_ns\" : %.0f, \"median_ns\" : %.0f,"
+           " \"p90_ns\" : %.0f, \"max_ns\" : %.0f, \"mb_per_s\" : %.2f, \"allocations\" : %.0f,"
+           " \"allocated_bytes\" : %.0f, \"peak_rss_kb\" : %ld, \"rss_growth_kb\" : %ld }",
+           first ? "" : ",", result.corpus.c_str(), result.operation.c_str(), result.corpus.c_str(),
+           result.operation.c_str(), result.bytes, result.iterations, result.min, result.median,
+           result.p90, result.max, result.bytes / result.median * 1e3, result.allocations,
+           result.allocated_bytes, result.peak_rss, result.rss_growth);
+    fflush(stdout);
+  }
+
+  void usage(const char *program)
+  {
+    fprintf(stderr,
+            "Usage: %s [options] [filter...]\n"
+            "\n"
+            "Run the benchmarks whose corpus/operation name contains one of the filters.\n"
+            "\n"
+            "  --runs N        number of timed samples (default 15)\n"
+            "  --min-time MS   minimum duration of a sample (default 20)\n"
+            "  --warmup MS     duration of the warmup (default 100)\n"
+            "  --scale F       size factor of the generated corpora (default 1)\n"
+            "  --file PATH     add a corpus read from a file, .ndjson or .jsonl as lines\n"
+            "  --json          write the results as JSON\n"
+            "  --list          list the benchmarks without running them\n",
+            program);
+  }
+
+  bool parse_options(Options &options, int argc, char **argv)
+  {
+    for (int i = 1; i < argc; ++i)
+      {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--runs" && has_value)
+          options.runs = std::max(1, atoi(argv[++i]));
+        else if (arg == "--min-time" && has_value)
+          options.min_time = atof(argv[++i]);
+        else if (arg == "--warmup" && has_value)
+          options.warmup = atof(argv[++i]);
+        else if (arg == "--scale" && has_value)
+          options.scale = atof(argv[++i]);
+        else if (arg == "--file" && has_value)
+          options.files.push_back(argv[++i]);
+        else if (arg == "--json")
+          options.json = true;
+        else if (arg == "--list")
+          options.list = true;
+        else if (arg.compare(0, 1, "-") == 0)
+          return false;
+        else
+          options.filters.push_back(arg);
+      }
+
+    return options.scale > 0;
+  }
+
+} // namespace
+
+int
+main(int argc, char **argv)
+{
+  Options options;
+
+  if (!parse_options(options, argc, argv))
+    {
+      usage(argv[0]);
+      return 2;
+    }
+
+  std::vector< Corpus > corpora = make_corpora(options.scale);
+
+  for (size_t i = 0; i < options.files.size(); ++i)
+    {
+      corpora.push_back(Corpus());
+
+      if (!load_corpus(corpora.back(), options.files[i].c_str()))
+        {
+          fprintf(stderr, "Can not read %s\n", options.files[i].c_str());
+          return 1;
+        }
+    }
+
+  std::vector< Benchmark > benchmarks;
+
+  for (size_t i = 0; i < corpora.size(); ++i)
+    {
+      std::vector< Benchmark > added;
+
+      add_benchmarks(added, corpora[i]);
+
+      for (size_t j = 0; j < added.size(); ++j)
+        if (selected(added[j], options))
+          benchmarks.push_back(added[j]);
+    }
+
+  corpora.clear();
+
+  if (options.list)
+    {
+      for (size_t i = 0; i < benchmarks.size(); ++i)
+        printf("%s/%s\n", benchmarks[i].corpus.c_str(), benchmarks[i].operation.c_str());
+
+      return 0;
+    }
+
+  bool rss = reset_peak_rss();
+
+  if (options.json)
+    {
+      printf("{ \"library\" : \"%s\", \"version\" : \"%s\",", PACKAGE, VERSION);
+#ifdef GIT_COMMIT
+      printf(" \"commit\" : \"%s\",", GIT_COMMIT);
+#endif
+      printf(" \"scale\" : %g, \"runs\" : %u, \"min_time_ms\" : %g, \"peak_rss_reset\" : %s,"
+             " \"results\" : [", options.scale, options.runs, options.min_time, rss ? "true" : "false");
+    }
+  else
+    printf("%-28s %10s %9s %11s %11s %11s %11s %13s %10s %9s\n", "benchmark", "bytes", "MB/s",
+           "median us", "p90 us", "min us", "allocs/op", "alloc B/op", "peak kB", "+kB");
+
+  for (size_t i = 0; i < benchmarks.size(); ++i)
+    {
+      Result result = measure(benchmarks[i], options, rss);
+
+      if (options.json)
+        print_json(result, i == 0);
+      else
+        print_text(result);
+    }
+
+  if (options.json)
+    printf("\n  ] }\n");
+
+  return 0;
+}
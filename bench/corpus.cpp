@@ -0,0 +1,563 @@
+#include "corpus.h"
+
+#include <fstream>
+#include <sstream>
+
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+
+  const char *words[] = {
+    "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "service", "request",
+    "latency", "cache", "miss", "user", "session", "timeout", "retry", "upstream", "json",
+    "value", "\xe6\x9d\xb1\xe4\xba\xac", "\xe3\x81\x82\xe3\x82\x8a\xe3\x81\x8c\xe3\x81\xa8\xe3\x81\x86",
+    "caf\xc3\xa9", "na\xc3\xafve", "\xd0\xbf\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82",
+  };
+
+  const size_t word_count = sizeof(words) / sizeof(words[0]);
+
+  // Count of items for a scale, at least one
+  inline unsigned count(double base, double scale)
+  {
+    unsigned result = (unsigned)(base * scale);
+    return result ? result : 1;
+  }
+
+  void append_number(std::string &dest, int64_t value)
+  {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%lld", (long long)value);
+    dest += buffer;
+  }
+
+  void append_double(std::string &dest, double value)
+  {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.17g", value);
+    dest += buffer;
+  }
+
+  // Append a string literal of random words, with an escape once in a
+  // while if escapes is set
+  void append_text(std::string &dest, Random &random, unsigned words_count, bool escapes)
+  {
+    dest += '"';
+
+    for (unsigned i = 0; i < words_count; ++i)
+      {
+        if (i)
+          dest += ' ';
+
+        dest += words[random.below(word_count)];
+
+        if (escapes)
+          switch (random.below(12))
+            {
+            case 0:
+              dest += "\\n";
+              break;
+
+            case 1:
+              dest += "\\\"quoted\\\"";
+              break;
+
+            case 2:
+              dest += "\\u00e9\\u20ac";
+              break;
+
+            case 3:
+              // An emoji as a surrogate pair and as UTF-8
+              dest += "\\ud83d\\ude00 \xf0\x9f\x98\x80";
+              break;
+            }
+      }
+
+    dest += '"';
+  }
+
+  void append_key(std::string &dest, const char *key)
+  {
+    dest += '"';
+    dest += key;
+    dest += "\":";
+  }
+
+  Corpus make_twitter(double scale)
+  {
+    Random random(1);
+    Corpus corpus = { "twitter", std::vector< std::string >(1), false };
+    std::string &json = corpus.records[0];
+    unsigned statuses = count(350, scale);
+
+    json += "{\"statuses\":[";
+
+    for (unsigned i = 0; i < statuses; ++i)
+      {
+        uint64_t id = 505874924095815681ULL + random.below(1000000000);
+
+        if (i)
+          json += ',';
+
+        json += "{\"metadata\":{\"result_type\":\"recent\",\"iso_language_code\":\"ja\"},";
+        append_key(json, "created_at");
+        json += "\"Sun Aug 31 00:29:15 +0000 2014\",";
+        append_key(json, "id");
+        append_number(json, id);
+        json += ',';
+        append_key(json, "id_str");
+        json += '"';
+        append_number(json, id);
+        json += "\",";
+        append_key(json, "text");
+        append_text(json, random, 8 + random.below(16), true);
+        json += ',';
+        append_key(json, "source");
+        json += "\"<a href=\\\"http://twitter.com/download/iphone\\\" rel=\\\"nofollow\\\">Twitter for iPhone</a>\",";
+        json += "\"truncated\":false,\"in_reply_to_status_id\":null,\"in_reply_to_user_id\":null,";
+        append_key(json, "user");
+        json += "{\"id\":";
+        append_number(json, 1186275104 + random.below(100000000));
+        json += ",\"name\":";
+        append_text(json, random, 2, false);
+        json += ",\"screen_name\":\"user";
+        append_number(json, random.below(100000));
+        json += "\",\"location\":";
+        append_text(json, random, 1, false);
+        json += ",\"description\":";
+        append_text(json, random, 4 + random.below(12), true);
+        json += ",\"url\":null,\"protected\":false,\"followers_count\":";
+        append_number(json, random.below(100000));
+        json += ",\"friends_count\":";
+        append_number(json, random.below(5000));
+        json += ",\"listed_count\":";
+        append_number(json, random.below(100));
+        json += ",\"utc_offset\":null,\"verified\":false,\"lang\":\"ja\",";
+        json += "\"profile_image_url\":\"http://pbs.twimg.com/profile_images/";
+        append_number(json, random.next() >> 20);
+        json += "/normal.jpeg\"},";
+        json += "\"geo\":null,\"coordinates\":null,\"place\":null,\"retweet_count\":";
+        append_number(json, random.below(1000));
+        json += ",\"favorite_count\":";
+        append_number(json, random.below(1000));
+        json += ",\"entities\":{\"hashtags\":[";
+
+        for (unsigned j = random.below(3); j > 0; --j)
+          {
+            unsigned start = random.below(100);
+
+            json += "{\"text\":";
+            append_text(json, random, 1, false);
+            json += ",\"indices\":[";
+            append_number(json, start);
+            json += ',';
+            append_number(json, start + 5);
+            json += "]}";
+            if (j > 1)
+              json += ',';
+          }
+
+        json += "],\"symbols\":[],\"urls\":[],\"user_mentions\":[]},";
+        json += "\"favorited\":false,\"retweeted\":false,\"lang\":\"ja\"}";
+      }
+
+    json += "],\"search_metadata\":{\"completed_in\":0.087,\"max_id\":505874924095815681,";
+    json += "\"query\":\"%E4%B8%80\",\"count\":100,\"since_id\":0}}";
+
+    return corpus;
+  }
+
+  Corpus make_citm(double scale)
+  {
+    Random random(2);
+    Corpus corpus = { "citm", std::vector< std::string >(1), false };
+    std::string &json = corpus.records[0];
+    unsigned events = count(900, scale);
+
+    json += "{\"areaNames\":{";
+
+    for (unsigned i = 0; i < 100; ++i)
+      {
+        if (i)
+          json += ',';
+
+        json += '"';
+        append_number(json, 205705993 + i);
+        json += "\":";
+        append_text(json, random, 2, false);
+      }
+
+    json += "},\"events\":{";
+
+    for (unsigned i = 0; i < events; ++i)
+      {
+        int64_t id = 138586341 + i * 7;
+
+        if (i)
+          json += ',';
+
+        json += '"';
+        append_number(json, id);
+        json += "\":{\"description\":null,\"id\":";
+        append_number(json, id);
+        json += ",\"logo\":\"/images/UE0AAAAACEKo6QAAAAZDSVRN\",\"name\":";
+        append_text(json, random, 3, false);
+        json += ",\"subTopicIds\":[337184269,337184283],\"subjectCode\":null,\"subtitle\":null,";
+        json += "\"topicIds\":[324846099,107888604]}";
+      }
+
+    json += "},\"performances\":[";
+
+    for (unsigned i = 0; i < events; ++i)
+      {
+        if (i)
+          json += ',';
+
+        json += "{\"eventId\":";
+        append_number(json, 138586341 + random.below(events) * 7);
+        json += ",\"id\":";
+        append_number(json, 339887544 + i);
+        json += ",\"logo\":null,\"name\":null,\"prices\":[";
+
+        for (unsigned j = 0; j < 3; ++j)
+          {
+            if (j)
+              json += ',';
+
+            json += "{\"amount\":";
+            append_number(json, 9000 + random.below(90000));
+            json += ",\"audienceSubCategoryId\":337100890,\"seatCategoryId\":";
+            append_number(json, 338937295 + j);
+            json += '}';
+          }
+
+        json += "],\"seatCategories\":[{\"areas\":[{\"areaId\":205705999,\"blockIds\":[]},"
+                "{\"areaId\":205705998,\"blockIds\":[]}],\"seatCategoryId\":338937295}],";
+        json += "\"seatMapImage\":null,\"start\":";
+        append_number(json, 1372701600000LL + random.below(100000000));
+        json += ",\"venueCode\":\"PLEYEL_PLEYEL\"}";
+      }
+
+    json += "]}";
+
+    return corpus;
+  }
+
+  Corpus make_canada(double scale)
+  {
+    Random random(3);
+    Corpus corpus = { "canada", std::vector< std::string >(1), false };
+    std::string &json = corpus.records[0];
+    unsigned rings = count(40, scale);
+
+    json += "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\","
+            "\"properties\":{\"name\":\"Canada\"},\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[";
+
+    for (unsigned i = 0; i < rings; ++i)
+      {
+        double x = -140 + random.real() * 80;
+        double y = 42 + random.real() * 40;
+
+        if (i)
+          json += ',';
+
+        json += '[';
+
+        for (unsigned j = 0; j < 600; ++j)
+          {
+            if (j)
+              json += ',';
+
+            x += random.real() * 0.02 - 0.01;
+            y += random.real() * 0.02 - 0.01;
+
+            json += '[';
+            append_double(json, x);
+            json += ',';
+            append_double(json, y);
+            json += ']';
+          }
+
+        json += ']';
+      }
+
+    json += "]}}]}";
+
+    return corpus;
+  }
+
+  Corpus make_logs(double scale)
+  {
+    static const char *levels[] = { "debug", "info", "info", "info", "warn", "error" };
+    static const char *paths[] = { "/v1/users", "/v1/orders", "/health", "/v2/search" };
+
+    Random random(4);
+    Corpus corpus = { "logs", std::vector< std::string >(), true };
+    unsigned lines = count(5000, scale);
+    char buffer[512];
+
+    for (unsigned i = 0; i < lines; ++i)
+      {
+        std::string line;
+
+        snprintf(buffer, sizeof(buffer),
+                 "{\"ts\":\"2026-10-15T%02u:%02u:%02u.%03uZ\",\"level\":\"%s\",\"host\":\"web-%u\","
+                 "\"service\":\"api\",\"method\":\"GET\",\"path\":\"%s/%u\",\"status\":%u,"
+                 "\"latency_ms\":%.3f,\"bytes\":%u,\"trace_id\":\"%016llx\",",
+                 i / 3600 % 24, i / 60 % 60, i % 60, random.below(1000), levels[random.below(6)],
+                 random.below(64), paths[random.below(4)], random.below(100000),
+                 random.below(8) ? 200 : 500, random.real() * 250, random.below(65536),
+                 (unsigned long long)random.next());
+
+        line = buffer;
+        line += "\"msg\":";
+        append_text(line, random, 3 + random.below(8), random.below(4) == 0);
+        line += ",\"tags\":[\"prod\",\"eu-west-1\"]}";
+
+        corpus.records.push_back(line);
+      }
+
+    return corpus;
+  }
+
+  Corpus make_integers(double scale)
+  {
+    Random random(5);
+    Corpus corpus = { "integers", std::vector< std::string >(1), false };
+    std::string &json = corpus.records[0];
+    unsigned values = count(100000, scale);
+
+    json += '[';
+
+    for (unsigned i = 0; i < values; ++i)
+      {
+        if (i)
+          json += ',';
+
+        // Mostly small values, some 64-bit ones
+        switch (random.below(4))
+          {
+          case 0:
+            append_number(json, (int64_t)(random.next() >> 1) * (random.below(2) ? 1 : -1));
+            break;
+
+          default:
+            append_number(json, (int64_t)random.below(100000) - 50000);
+            break;
+          }
+      }
+
+    json += ']';
+
+    return corpus;
+  }
+
+  Corpus make_floats(double scale)
+  {
+    Random random(6);
+    Corpus corpus = { "floats", std::vector< std::string >(1), false };
+    std::string &json = corpus.records[0];
+    unsigned values = count(50000, scale);
+
+    json += '[';
+
+    for (unsigned i = 0; i < values; ++i)
+      {
+        if (i)
+          json += ',';
+
+        if (random.below(2))
+          append_double(json, (random.real() - 0.5) * 1e6);
+        else
+          {
+            // Short decimal values, as written by people
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "%.2f", random.real() * 1000);
+            json += buffer;
+          }
+      }
+
+    json += ']';
+
+    return corpus;
+  }
+
+  Corpus make_strings(const char *name, double scale, bool escapes)
+  {
+    Random random(7);
+    Corpus corpus = { name, std::vector< std::string >(1), false };
+    std::string &json = corpus.records[0];
+    unsigned values = count(10000, scale);
+
+    json += '[';
+
+    for (unsigned i = 0; i < values; ++i)
+      {
+        if (i)
+          json += ',';
+
+        append_text(json, random, 2 + random.below(30), escapes);
+      }
+
+    json += ']';
+
+    return corpus;
+  }
+
+  Corpus make_nested(double scale)
+  {
+    Corpus corpus = { "nested", std::vector< std::string >(1), false };
+    std::string &json = corpus.records[0];
+    unsigned values = count(2000, scale);
+
+    json += '[';
+
+    for (unsigned i = 0; i < values; ++i)
+      {
+        if (i)
+          json += ',';
+
+        // 64 levels of alternating objects and lists
+        for (unsigned depth = 0; depth < 32; ++depth)
+          json += "{\"child\":[";
+
+        append_number(json, i);
+
+        for (unsigned depth = 0; depth < 32; ++depth)
+          json += "]}";
+      }
+
+    json += ']';
+
+    return corpus;
+  }
+
+  Corpus make_keys(double scale)
+  {
+    Random random(8);
+    Corpus corpus = { "keys", std::vector< std::string >(1), false };
+    std::string &json = corpus.records[0];
+    unsigned values = count(5000, scale);
+
+    // Many small objects sharing the same keys, then one large object
+    json += "{\"records\":[";
+
+    for (unsigned i = 0; i < values; ++i)
+      {
+        if (i)
+          json += ',';
+
+        json += "{\"id\":";
+        append_number(json, i);
+        json += ",\"first_name\":\"a\",\"last_name\":\"b\",\"email_address\":null,"
+                "\"created\":1,\"updated\":2,\"active\":true,\"score\":3}";
+      }
+
+    json += "],\"index\":{";
+
+    for (unsigned i = 0; i < values * 4; ++i)
+      {
+        if (i)
+          json += ',';
+
+        json += "\"key_";
+        append_number(json, random.next() >> 24);
+        json += "\":";
+        append_number(json, i);
+      }
+
+    json += "}}";
+
+    return corpus;
+  }
+
+} // namespace
+
+size_t
+Corpus::get_size() const
+{
+  size_t size = 0;
+
+  for (size_t i = 0; i < records.size(); ++i)
+    size += records[i].size();
+
+  return size;
+}
+
+std::string
+Corpus::get_text() const
+{
+  std::string text;
+
+  for (size_t i = 0; i < records.size(); ++i)
+    {
+      text += records[i];
+      text += '\n';
+    }
+
+  return text;
+}
+
+std::vector< Corpus >
+make_corpora(double scale)
+{
+  std::vector< Corpus > corpora;
+
+  corpora.push_back(make_twitter(scale));
+  corpora.push_back(make_citm(scale));
+  corpora.push_back(make_canada(scale));
+  corpora.push_back(make_logs(scale));
+  corpora.push_back(make_integers(scale));
+  corpora.push_back(make_floats(scale));
+  corpora.push_back(make_strings("strings", scale, false));
+  corpora.push_back(make_strings("escapes", scale, true));
+  corpora.push_back(make_nested(scale));
+  corpora.push_back(make_keys(scale));
+
+  return corpora;
+}
+
+bool
+load_corpus(Corpus &dest, const char *path)
+{
+  std::ifstream file(path, std::ios::binary);
+
+  if (!file)
+    return false;
+
+  std::stringstream str;
+  str << file.rdbuf();
+
+  std::string text = str.str();
+  const char *name = strrchr(path, '/');
+  size_t length = strlen(path);
+
+  dest.name = (name ? name + 1 : path);
+  dest.records.clear();
+  dest.lines = (length > 6 && !strcmp(path + length - 6, ".jsonl"))
+    || (length > 7 && !strcmp(path + length - 7, ".ndjson"));
+
+  if (!dest.lines)
+    {
+      dest.records.push_back(text);
+      return true;
+    }
+
+  size_t start = 0;
+
+  while (start < text.size())
+    {
+      size_t end = text.find('\n', start);
+
+      if (end == std::string::npos)
+        end = text.size();
+
+      if (end > start)
+        dest.records.push_back(text.substr(start, end - start));
+
+      start = end + 1;
+    }
+
+  return true;
+}
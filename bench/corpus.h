@@ -0,0 +1,82 @@
+#ifndef JSON_BENCH_CORPUS_H_INCLUDE
+#define JSON_BENCH_CORPUS_H_INCLUDE
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+/**
+ * Input of the benchmarks: JSON documents, or the records of a newline
+ * delimited file, held as separate texts.
+ */
+struct Corpus
+{
+  std::string name;
+  std::vector< std::string > records;
+  // Records are the lines of a newline delimited file
+  bool lines;
+
+  size_t get_size() const;
+
+  // Records joined by newlines
+  std::string get_text() const;
+};
+
+/**
+ * Deterministic pseudo random numbers, so that every run generates the same
+ * corpora.
+ */
+class Random
+{
+public:
+  Random(uint64_t seed)
+    : state(seed)
+  {
+  }
+
+  inline uint64_t next()
+  {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  }
+
+  // Number in [0, n)
+  inline unsigned below(unsigned n)
+  { return next() % n; }
+
+  // Number in [0, 1)
+  inline double real()
+  { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+  uint64_t state;
+};
+
+/**
+ * Build the generated corpora. They mimic the shapes of the usual JSON
+ * benchmark files and of our service logs:
+ *
+ * - twitter: API responses, with nested objects, identifiers above 2^53,
+ *   nulls and text mixing ASCII, non-ASCII UTF-8 and escapes;
+ * - citm: a catalogue of maps keyed by numbers and small integer lists;
+ * - canada: GeoJSON polygons, mostly floats of 17 significant digits;
+ * - logs: newline delimited log records;
+ * - integers, floats, strings, escapes, nested, keys: one feature each, to
+ *   track them separately.
+ *
+ * @param scale Size factor, 1 gives documents of about 1 MB.
+ */
+std::vector< Corpus > make_corpora(double scale);
+
+/**
+ * Load a corpus from a file, such as the original twitter.json, named after
+ * the file. Files ending in .ndjson or .jsonl are read as lines.
+ *
+ * @return false if the file can not be read.
+ */
+bool load_corpus(Corpus &dest, const char *path);
+
+#endif // JSON_BENCH_CORPUS_H_INCLUDE
@@ -0,0 +1,117 @@
+#include "json/arena.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+using namespace Json;
+
+namespace
+{
+
+  inline char *align_up(char *ptr, size_t align)
+  {
+    return (char *)(((uintptr_t)ptr + align - 1) & ~(uintptr_t)(align - 1));
+  }
+
+} // namespace
+
+Arena::Arena(size_t block_size, MemoryResource *upstream)
+  : upstream(upstream), block_size(block_size < 1024 ? 1024 : block_size), size(0), blocks(NULL),
+    current(NULL), end(NULL)
+{
+}
+
+Arena::~Arena()
+{
+  clear();
+}
+
+void
+Arena::clear()
+{
+  while (blocks)
+    {
+      Block *next = blocks->next;
+
+      if (upstream)
+        upstream->deallocate(blocks, blocks->size, alignof(std::max_align_t));
+      else
+        free(blocks);
+
+      blocks = next;
+    }
+
+  size = 0;
+  current = NULL;
+  end = NULL;
+}
+
+void *
+Arena::do_allocate(size_t size, size_t align)
+{
+  return allocate(size, align);
+}
+
+void
+Arena::do_deallocate(void *, size_t, size_t)
+{
+}
+
+bool
+Arena::do_is_equal(const MemoryResource &other) const noexcept
+{
+  return this == &other;
+}
+
+Arena::Block *
+Arena::new_block(size_t size)
+{
+  Block *block;
+
+  if (upstream)
+    block = (Block *)upstream->allocate(size, alignof(std::max_align_t));
+  else if (!(block = (Block *)malloc(size)))
+    throw std::bad_alloc();
+
+  block->size = size;
+  return block;
+}
+
+void *
+Arena::allocate_block(size_t size, size_t align)
+{
+  size_t header = sizeof(Block) + align;
+
+  // Large allocations get a block of their own, so that the remainder of
+  // the current block is not wasted
+  if (size > block_size / 4)
+    {
+      Block *block = new_block(header + size);
+
+      if (blocks)
+        {
+          block->next = blocks->next;
+          blocks->next = block;
+        }
+      else
+        {
+          block->next = NULL;
+          blocks = block;
+        }
+
+      return align_up((char *)(block + 1), align);
+    }
+
+  Block *block = new_block(block_size);
+
+  block->next = blocks;
+  blocks = block;
+
+  current = align_up((char *)(block + 1), align);
+  end = (char *)block + block_size;
+
+  char *ptr = current;
+  current += size;
+  return ptr;
+}
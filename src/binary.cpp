@@ -0,0 +1,535 @@
+#include "json/binary.h"
+#include "json/handler.h"
+#include "utf8.h"
+
+#include <sstream>
+#include <vector>
+
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+
+using namespace Json;
+
+namespace
+{
+
+  enum Tag
+  {
+    TAG_NULL,
+    TAG_FALSE,
+    TAG_TRUE,
+    TAG_INTEGER,
+    TAG_UNSIGNED,
+    TAG_FLOAT,
+    TAG_STRING,
+    TAG_LIST,
+    TAG_OBJECT,
+  };
+
+  inline uint64_t to_little_endian(uint64_t value)
+  {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return __builtin_bswap64(value);
+#else
+    return value;
+#endif
+  }
+
+  /**
+   * Writer of the binary form, through a buffer handed over to a sink
+   * whenever it is full, like Encoder.
+   */
+  class BinaryEncoder
+  {
+  public:
+    BinaryEncoder(Sink &sink)
+      : sink(sink), used(0)
+    {
+    }
+
+    void value(const Value &value);
+
+    void flush()
+    {
+      if (used)
+        {
+          sink.write(buffer, used);
+          used = 0;
+        }
+    }
+
+  private:
+    // Make room for count more bytes, count being at most the buffer size
+    inline void reserve(size_t count)
+    {
+      if (used + count > sizeof(buffer))
+        flush();
+    }
+
+    inline void put(unsigned char c)
+    {
+      reserve(1);
+      buffer[used++] = c;
+    }
+
+    inline void varint(uint64_t value)
+    {
+      reserve(10);
+
+      while (value >= 0x80)
+        {
+          buffer[used++] = (char)(value | 0x80);
+          value >>= 7;
+        }
+
+      buffer[used++] = (char)value;
+    }
+
+    inline void fixed(uint64_t value)
+    {
+      value = to_little_endian(value);
+      reserve(8);
+      memcpy(buffer + used, &value, 8);
+      used += 8;
+    }
+
+    void raw(const char *data, size_t length)
+    {
+      if (used + length <= sizeof(buffer))
+        {
+          memcpy(buffer + used, data, length);
+          used += length;
+          return;
+        }
+
+      flush();
+      sink.write(data, length);
+    }
+
+    void string(const char *data, size_t length)
+    {
+      varint(length);
+      raw(data, length);
+    }
+
+    void string(const wchar_t *data, size_t length);
+
+  private:
+    Sink &sink;
+    size_t used;
+    char buffer[16384];
+    // UTF-8 form of wide strings
+    std::string text;
+  };
+
+  void BinaryEncoder::value(const Value &value)
+  {
+    const char *text;
+    size_t length;
+
+    switch (value.get_type())
+      {
+      case Value::JSON_TYPE_NULL:
+        put(TAG_NULL);
+        break;
+
+      case Value::JSON_TYPE_BOOLEAN:
+        put((bool)value ? TAG_TRUE : TAG_FALSE);
+        break;
+
+      case Value::JSON_TYPE_INTEGER:
+        if (value.is_uint64())
+          {
+            put(TAG_UNSIGNED);
+            fixed((uint64_t)value);
+          }
+        else
+          {
+            int64_t integer = (int64_t)value;
+
+            put(TAG_INTEGER);
+            varint(((uint64_t)integer << 1) ^ (uint64_t)(integer >> 63));
+          }
+        break;
+
+      case Value::JSON_TYPE_FLOAT:
+        {
+          double number = (double)value;
+          uint64_t bits;
+
+          memcpy(&bits, &number, 8);
+          put(TAG_FLOAT);
+          fixed(bits);
+        }
+        break;
+
+      case Value::JSON_TYPE_STRING:
+        put(TAG_STRING);
+
+        if (value.get_utf8_string(text, length))
+          string(text, length);
+        else
+          {
+            const wchar_t *data;
+
+            value.get_string(data, length);
+            string(data, length);
+          }
+        break;
+
+      case Value::JSON_TYPE_LIST:
+        {
+          const Value::List &list = value;
+
+          put(TAG_LIST);
+          varint(list.size());
+
+          for (Value::List::const_iterator it = list.begin(); it != list.end(); ++it)
+            this->value(*it);
+        }
+        break;
+
+      case Value::JSON_TYPE_OBJECT:
+        {
+          const Value::Object &obj = value;
+
+          put(TAG_OBJECT);
+          varint(obj.size());
+
+          for (Value::Object::const_iterator it = obj.begin(); it != obj.end(); ++it)
+            {
+              string(it->first.data(), it->first.size());
+              this->value(it->second);
+            }
+        }
+        break;
+      }
+  }
+
+  void BinaryEncoder::string(const wchar_t *data, size_t length)
+  {
+    text.clear();
+    utf8_append(text, data, length);
+    string(text.data(), text.size());
+  }
+
+  /**
+   * Reader of the binary form, reporting the values to a ValueBuilder.
+   * Lists and objects are read with an explicit stack, like the parser does,
+   * so that nested data can not overflow the call stack.
+   */
+  class BinaryDecoder
+  {
+  public:
+    BinaryDecoder(const char *data, size_t length, size_t max_depth, bool borrow)
+      : data(data), length(length), pos(0), max_depth(max_depth ? max_depth : SIZE_MAX), borrow(borrow)
+    {
+    }
+
+    // Decode the whole data as a single value
+    void decode(ValueBuilder &builder);
+
+  private:
+    // Read a value, only opening lists and objects
+    void value(ValueBuilder &builder);
+
+  private:
+    inline unsigned char byte()
+    {
+      if (pos >= length)
+        raise_error< UnexpectedEof >("Unexpected end of input", pos);
+
+      return data[pos++];
+    }
+
+    inline uint64_t varint()
+    {
+      uint64_t value = 0;
+
+      for (unsigned shift = 0; shift < 64; shift += 7)
+        {
+          unsigned char c = byte();
+
+          value |= (uint64_t)(c & 0x7F) << shift;
+
+          if (!(c & 0x80))
+            return value;
+        }
+
+      raise_error< InvalidCharacter >("Invalid variable length integer", pos);
+    }
+
+    inline uint64_t fixed()
+    {
+      uint64_t value;
+
+      if (length - pos < 8)
+        raise_error< UnexpectedEof >("Unexpected end of input", length);
+
+      memcpy(&value, data + pos, 8);
+      pos += 8;
+      return to_little_endian(value);
+    }
+
+    // Get the UTF-8 contents of a string, checking the encoding, and
+    // decode them into buffer if wide is set
+    const char *string(size_t &size, bool wide);
+
+    template < class _Exception >
+      void raise_error(const char *message, size_t position) JSON_NORETURN;
+
+  private:
+    const char *data;
+    size_t length;
+    size_t pos;
+    size_t max_depth;
+    bool borrow;
+
+    // Open lists and objects, with the number of items left to read
+    struct Container
+    {
+      uint64_t count;
+      bool object;
+    };
+
+    std::vector< Container > stack;
+
+    // Scratch buffer of the wide strings and keys
+    std::wstring buffer;
+  };
+
+  const char *BinaryDecoder::string(size_t &size, bool wide)
+  {
+    uint64_t count = varint();
+
+    if (count > length - pos)
+      raise_error< UnexpectedEof >("Unexpected end of input", length);
+
+    const char *text = data + pos;
+    size_t end = pos + count;
+
+    if (wide)
+      buffer.clear();
+
+    while (pos < end)
+      {
+        // Runs of ASCII are checked 8 bytes at a time
+        uint64_t chunk;
+
+        if (end - pos >= 8 && (memcpy(&chunk, data + pos, 8), !(chunk & 0x8080808080808080ULL)))
+          {
+            if (wide)
+              buffer.append(data + pos, data + pos + 8);
+
+            pos += 8;
+            continue;
+          }
+
+        unsigned code;
+
+        if ((unsigned char)data[pos] < 0x80)
+          code = data[pos++];
+        else if (!utf8_decode(data, end, pos, code))
+          raise_error< InvalidCharacter >("Invalid UTF-8 sequence", pos);
+
+        if (wide)
+          append_code_point(buffer, code);
+      }
+
+    size = count;
+    return text;
+  }
+
+  void BinaryDecoder::decode(ValueBuilder &builder)
+  {
+    for (;;)
+      {
+        value(builder);
+
+        // Close the containers whose items have all been read
+        while (!stack.empty() && !stack.back().count)
+          {
+            if (stack.back().object)
+              builder.end_object();
+            else
+              builder.end_array();
+
+            stack.pop_back();
+          }
+
+        if (stack.empty())
+          break;
+
+        --stack.back().count;
+
+        if (stack.back().object)
+          {
+            size_t size;
+
+            string(size, true);
+            builder.key(buffer);
+          }
+      }
+
+    if (pos != length)
+      raise_error< InvalidCharacter >("Unexpected data after the value", pos);
+  }
+
+  void BinaryDecoder::value(ValueBuilder &builder)
+  {
+    size_t start = pos;
+    size_t size;
+
+    switch (byte())
+      {
+      case TAG_NULL:
+        return builder.null();
+
+      case TAG_FALSE:
+        return builder.boolean(false);
+
+      case TAG_TRUE:
+        return builder.boolean(true);
+
+      case TAG_INTEGER:
+        {
+          uint64_t zigzag = varint();
+          int64_t value = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+
+          if (value >= INT_MIN && value <= INT_MAX)
+            return builder.integer((int)value);
+
+          return builder.integer64(value);
+        }
+
+      case TAG_UNSIGNED:
+        {
+          uint64_t value = fixed();
+
+          if (value <= (uint64_t)INT64_MAX)
+            return builder.integer64((int64_t)value);
+
+          return builder.unsigned_integer64(value);
+        }
+
+      case TAG_FLOAT:
+        {
+          uint64_t bits = fixed();
+          double value;
+
+          memcpy(&value, &bits, 8);
+          return builder.number(value);
+        }
+
+      case TAG_STRING:
+        {
+          const char *text = string(size, !borrow);
+
+          if (borrow)
+            return builder.borrowed_string(text, size);
+
+          return builder.string(buffer);
+        }
+
+      case TAG_LIST:
+        {
+          uint64_t count = varint();
+
+          if (stack.size() >= max_depth)
+            raise_error< NestingTooDeep >("Maximum nesting depth exceeded", start);
+
+          builder.begin_array();
+
+          // Every item takes a byte at least, so that a bogus count cannot
+          // reserve more than the input size
+          builder.reserve(std::min(count, (uint64_t)(length - pos)));
+
+          Container list = { count, false };
+          stack.push_back(list);
+          return;
+        }
+
+      case TAG_OBJECT:
+        {
+          uint64_t count = varint();
+
+          if (stack.size() >= max_depth)
+            raise_error< NestingTooDeep >("Maximum nesting depth exceeded", start);
+
+          builder.begin_object();
+          builder.reserve(std::min(count, (uint64_t)(length - pos)));
+
+          Container object = { count, true };
+          stack.push_back(object);
+          return;
+        }
+
+      default:
+        raise_error< InvalidCharacter >("Invalid type", start);
+      }
+  }
+
+  template < class _Exception >
+    void BinaryDecoder::raise_error(const char *message, size_t position)
+    {
+      std::stringstream str;
+      str << message << " at " << position;
+
+      throw _Exception(str.str().c_str());
+    }
+
+} // namespace
+
+BinaryHandler::BinaryHandler()
+  : pool(NULL), max_depth(1024)
+{
+}
+
+bool
+BinaryHandler::is_binary(const char *data, size_t length)
+{
+  return length && (unsigned char)data[0] <= TAG_OBJECT;
+}
+
+Value
+BinaryHandler::decode(const char *data, size_t length)
+{
+  Value result;
+
+  decode(result, NULL, data, length);
+  return result;
+}
+
+void
+BinaryHandler::decode(Value &dest, MemoryResource *resource, const char *data, size_t length, int flags)
+{
+  ValueBuilder builder(dest, resource, pool, flags);
+
+  BinaryDecoder(data, length, max_depth, flags & JsonHandler::BORROW_STRINGS).decode(builder);
+}
+
+void
+BinaryHandler::decode(Document &dest, const char *data, size_t length, int flags)
+{
+  dest.clear();
+  decode(dest.get_root(), &dest.get_arena(), data, length, flags);
+}
+
+void
+BinaryHandler::encode(std::string &dest, const Value &value)
+{
+  dest.clear();
+
+  StringSink sink(dest);
+  encode(sink, value);
+}
+
+void
+BinaryHandler::encode(Sink &dest, const Value &value)
+{
+  BinaryEncoder encoder(dest);
+
+  encoder.value(value);
+  encoder.flush();
+}
@@ -0,0 +1,447 @@
+#include "json/binding.h"
+#include "json/codec.h"
+#include "parser.h"
+#include "utf8.h"
+
+#include <string.h>
+
+using namespace Json;
+
+namespace
+{
+
+  // Seeds tried for a table size before it is doubled
+  const uint32_t max_seeds = 64;
+
+  template < class _Char >
+    inline uint32_t hash_name(const _Char *name, size_t length, uint32_t seed)
+    {
+      uint32_t hash = 2166136261u ^ seed;
+
+      for (size_t i = 0; i < length; ++i)
+        hash = (hash ^ (uint32_t)name[i]) * 16777619u;
+
+      return hash ^ (hash >> 15);
+    }
+
+} // namespace
+
+Binding
+Binding::empty()
+{
+  Binding binding;
+
+  binding.reset = NULL;
+  binding.boolean = NULL;
+  binding.integer = NULL;
+  binding.unsigned_integer = NULL;
+  binding.number = NULL;
+  binding.string = NULL;
+  binding.utf8_string = NULL;
+  binding.append = NULL;
+  binding.item = NULL;
+  binding.write = NULL;
+  binding.any = false;
+  binding.seed = 0;
+
+  return binding;
+}
+
+Binding
+Binding::structure(const Field *fields, size_t count, void (*reset)(void *),
+                   void (*write)(Writer &, const void *))
+{
+  Binding binding = empty();
+
+  binding.reset = reset;
+  binding.write = write;
+  binding.fields.assign(fields, fields + count);
+
+  for (size_t i = 0; i < count; ++i)
+    for (size_t j = 0; j < i; ++j)
+      if (fields[i].length == fields[j].length && !memcmp(fields[i].name, fields[j].name, fields[i].length))
+        throw BindingError("Duplicate member name");
+
+  // Look for a seed giving every member its own slot, with twice as many
+  // slots as members to begin with
+  size_t size = 2;
+
+  while (size < 2 * count)
+    size *= 2;
+
+  for (;; size *= 2)
+    {
+      for (uint32_t seed = 0; seed < max_seeds; ++seed)
+        {
+          std::vector< uint32_t > slots(size);
+          size_t i = 0;
+
+          for (; i < count; ++i)
+            {
+              uint32_t &slot = slots[hash_name(fields[i].name, fields[i].length, seed) & (size - 1)];
+
+              if (slot)
+                break;
+
+              slot = i + 1;
+            }
+
+          if (i == count)
+            {
+              binding.slots.swap(slots);
+              binding.seed = seed;
+              return binding;
+            }
+        }
+    }
+}
+
+const Binding::Field *
+Binding::find(const wchar_t *key, size_t length) const
+{
+  if (slots.empty())
+    return NULL;
+
+  uint32_t slot = slots[hash_name(key, length, seed) & (slots.size() - 1)];
+
+  if (!slot)
+    return NULL;
+
+  const Field &field = fields[slot - 1];
+
+  if (field.length != length)
+    return NULL;
+
+  for (size_t i = 0; i < length; ++i)
+    if ((wchar_t)(unsigned char)field.name[i] != key[i])
+      return NULL;
+
+  return &field;
+}
+
+void
+Binding::assign(std::string &dest, const std::wstring &value)
+{
+  dest.clear();
+  Codec::get("UTF-8").encode(dest, value);
+}
+
+void
+Binding::assign(std::wstring &dest, const char *data, size_t length)
+{
+  // The parser already checked the encoding
+  dest.clear();
+  utf8_widen(dest, data, length);
+}
+
+BindingReader::BindingReader(void *dest, const Binding &type)
+  : pending(dest), pending_type(&type), skipping(0)
+{
+}
+
+BindingReader::~BindingReader()
+{
+}
+
+void
+BindingReader::parse(const char *json, size_t length, size_t max_depth)
+{
+  Parser< char > parser(json, length, max_depth);
+
+  parser.set_borrow(true);
+  parser.parse(*this);
+}
+
+void
+BindingReader::mismatch()
+{
+  throw BindingError("Invalid value type");
+}
+
+bool
+BindingReader::slot(void *&dest, const Binding *&type)
+{
+  if (skipping)
+    return false;
+
+  if (!stack.empty() && stack.back().type->append)
+    {
+      const Frame &frame = stack.back();
+
+      dest = frame.type->append(frame.object);
+      type = &frame.type->item();
+      return true;
+    }
+
+  // The value of an unknown key
+  if (!pending_type)
+    return false;
+
+  dest = pending;
+  type = pending_type;
+  pending_type = NULL;
+  return true;
+}
+
+void
+BindingReader::begin_value(void *dest)
+{
+  builder.reset(new ValueBuilder(*(Value *)dest));
+}
+
+void
+BindingReader::null()
+{
+  void *dest;
+  const Binding *type;
+
+  if (builder)
+    {
+      builder->null();
+      if (builder->is_complete())
+        builder.reset();
+    }
+  else if (slot(dest, type))
+    type->reset(dest);
+}
+
+void
+BindingReader::boolean(bool value)
+{
+  void *dest;
+  const Binding *type;
+
+  if (builder)
+    {
+      builder->boolean(value);
+      if (builder->is_complete())
+        builder.reset();
+    }
+  else if (slot(dest, type))
+    {
+      if (type->any)
+        *(Value *)dest = value;
+      else if (type->boolean)
+        type->boolean(dest, value);
+      else
+        mismatch();
+    }
+}
+
+void
+BindingReader::integer(int value)
+{
+  integer64(value);
+}
+
+void
+BindingReader::integer64(int64_t value)
+{
+  void *dest;
+  const Binding *type;
+
+  if (builder)
+    {
+      builder->integer64(value);
+      if (builder->is_complete())
+        builder.reset();
+    }
+  else if (slot(dest, type))
+    {
+      if (type->any)
+        {
+          if (value >= INT_MIN && value <= INT_MAX)
+            *(Value *)dest = (int)value;
+          else
+            *(Value *)dest = value;
+        }
+      else if (type->integer)
+        type->integer(dest, value);
+      else
+        mismatch();
+    }
+}
+
+void
+BindingReader::unsigned_integer64(uint64_t value)
+{
+  void *dest;
+  const Binding *type;
+
+  if (builder)
+    {
+      builder->unsigned_integer64(value);
+      if (builder->is_complete())
+        builder.reset();
+    }
+  else if (slot(dest, type))
+    {
+      if (type->any)
+        *(Value *)dest = value;
+      else if (type->unsigned_integer)
+        type->unsigned_integer(dest, value);
+      else
+        mismatch();
+    }
+}
+
+void
+BindingReader::number(double value)
+{
+  void *dest;
+  const Binding *type;
+
+  if (builder)
+    {
+      builder->number(value);
+      if (builder->is_complete())
+        builder.reset();
+    }
+  else if (slot(dest, type))
+    {
+      if (type->any)
+        *(Value *)dest = value;
+      else if (type->number)
+        type->number(dest, value);
+      else
+        mismatch();
+    }
+}
+
+void
+BindingReader::string(const std::wstring &value)
+{
+  void *dest;
+  const Binding *type;
+
+  if (builder)
+    {
+      builder->string(value);
+      if (builder->is_complete())
+        builder.reset();
+    }
+  else if (slot(dest, type))
+    {
+      if (type->any)
+        *(Value *)dest = value;
+      else if (type->string)
+        type->string(dest, value);
+      else
+        mismatch();
+    }
+}
+
+void
+BindingReader::borrowed_string(const char *data, size_t length)
+{
+  void *dest;
+  const Binding *type;
+
+  // Value members must not reference the input
+  if (builder)
+    Handler::borrowed_string(data, length);
+  else if (slot(dest, type))
+    {
+      if (type->any)
+        ((Value *)dest)->set(data, (int)length);
+      else if (type->utf8_string)
+        type->utf8_string(dest, data, length);
+      else
+        mismatch();
+    }
+}
+
+void
+BindingReader::key(const std::wstring &key)
+{
+  if (builder)
+    {
+      builder->key(key);
+      return;
+    }
+
+  if (skipping)
+    return;
+
+  const Frame &frame = stack.back();
+  const Binding::Field *field = frame.type->find(key.data(), key.size());
+
+  if (field)
+    {
+      pending = field->member(frame.object);
+      pending_type = &field->type();
+    }
+  else
+    pending_type = NULL;
+}
+
+void
+BindingReader::begin_object()
+{
+  void *dest;
+  const Binding *type;
+
+  if (builder)
+    builder->begin_object();
+  else if (!slot(dest, type))
+    ++skipping;
+  else if (type->any)
+    {
+      begin_value(dest);
+      builder->begin_object();
+    }
+  else if (!type->fields.empty())
+    {
+      Frame frame = { dest, type };
+      stack.push_back(frame);
+    }
+  else
+    mismatch();
+}
+
+void
+BindingReader::end_object()
+{
+  if (builder)
+    {
+      builder->end_object();
+      if (builder->is_complete())
+        builder.reset();
+    }
+  else if (skipping)
+    --skipping;
+  else
+    stack.pop_back();
+}
+
+void
+BindingReader::begin_array()
+{
+  void *dest;
+  const Binding *type;
+
+  if (builder)
+    builder->begin_array();
+  else if (!slot(dest, type))
+    ++skipping;
+  else if (type->any)
+    {
+      begin_value(dest);
+      builder->begin_array();
+    }
+  else if (type->append)
+    {
+      type->reset(dest);
+
+      Frame frame = { dest, type };
+      stack.push_back(frame);
+    }
+  else
+    mismatch();
+}
+
+void
+BindingReader::end_array()
+{
+  end_object();
+}
@@ -1,7 +1,17 @@
 #include "json/codec.h"
+#include "json/stats.h"
+#include "simd.h"
+#include "utf8.h"
+
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <vector>
 
 #include <iconv.h>
+#include <ctype.h>
 #include <errno.h>
+#include <stdint.h>
 
 #define BUFFER_SIZE 4096
 
@@ -10,13 +20,47 @@ using namespace Json;
 namespace
 {
 
+  // Adds the time of a conversion to the statistics of the calling thread
+  class TranscodeTimer
+  {
+  public:
+#if JSON_STATS
+    TranscodeTimer()
+      : stats(Stats::get_current())
+    {
+      if (stats)
+        start = std::chrono::steady_clock::now();
+    }
+
+    ~TranscodeTimer()
+    {
+      if (stats)
+        stats->transcode_ns += std::chrono::duration_cast< std::chrono::nanoseconds >(
+          std::chrono::steady_clock::now() - start).count();
+    }
+
+  private:
+    Stats *stats;
+    std::chrono::steady_clock::time_point start;
+#else
+    TranscodeTimer()
+    {
+    }
+#endif
+  };
+
   template < class _T_Char_Dest, class _T_Char_Src >
     void transcode(iconv_t handle, std::basic_string< _T_Char_Dest > &dest, const std::basic_string< _T_Char_Src > &src)
     {
       char outbuf_data[BUFFER_SIZE];
 
       char *inbuf = (char *)src.c_str();
-      size_t inremain = src.size();
+      size_t inremain = src.size() * sizeof(_T_Char_Src);
+
+      dest.reserve(dest.size() + src.size());
+
+      // Codecs are reused, drop the state a failed conversion left
+      iconv(handle, NULL, NULL, NULL, NULL);
 
       while (inremain > 0)
         {
@@ -24,7 +68,8 @@ namespace
           char *outbuf = outbuf_data;
           size_t res = iconv(handle, (char **)&inbuf, &inremain, &outbuf, &outremain);
 
-          if (res == (size_t)-1)
+          // A full output buffer is flushed and the conversion goes on
+          if (res == (size_t)-1 && errno != E2BIG)
             {
               switch (errno)
                 {
@@ -36,10 +81,6 @@ namespace
                   throw CodecException("Incomplete multibyte sequence");
                   break;
                   
-                case E2BIG:
-                  throw CodecException("No more room");
-                  break;
-                  
                 default:
                   throw CodecException("Unknown error");
                   break;
@@ -50,35 +91,423 @@ namespace
         }
     }
 
+  // Encoding name in upper case without separators, "UTF8" for "utf-8"
+  std::string normalize(const char *encoding)
+  {
+    std::string name;
+
+    for (; *encoding; ++encoding)
+      if (*encoding != '-' && *encoding != '_')
+        name.push_back(toupper(*encoding));
+
+    return name;
+  }
+
+  // Units of the native conversions
+  template < class _Unit >
+    inline _Unit load(const char *data, bool big_endian)
+    {
+      const unsigned char *bytes = (const unsigned char *)data;
+      _Unit unit = 0;
+
+      for (size_t i = 0; i < sizeof(_Unit); ++i)
+        unit |= (_Unit)bytes[big_endian ? i : sizeof(_Unit) - 1 - i] << (8 * (sizeof(_Unit) - 1 - i));
+
+      return unit;
+    }
+
+  template < class _Unit >
+    inline void store(char *data, _Unit unit, bool big_endian)
+    {
+      for (size_t i = 0; i < sizeof(_Unit); ++i)
+        data[big_endian ? i : sizeof(_Unit) - 1 - i] = (char)(unit >> (8 * (sizeof(_Unit) - 1 - i)));
+    }
+
+  inline size_t append_units(wchar_t *dest, unsigned code)
+  {
+    if (sizeof(wchar_t) == 2 && code >= 0x10000)
+      {
+        code -= 0x10000;
+        dest[0] = (wchar_t)(0xD800 + (code >> 10));
+        dest[1] = (wchar_t)(0xDC00 + (code & 0x3FF));
+        return 2;
+      }
+
+    dest[0] = (wchar_t)code;
+    return 1;
+  }
+
+  // Read the code point at src[i], combining surrogate pairs where wchar_t
+  // is 16 bits wide
+  inline unsigned next_code_point(const std::wstring &src, size_t &i)
+  {
+    unsigned code = (unsigned)src[i++];
+
+    if (sizeof(wchar_t) == 2 && code >= 0xD800 && code < 0xDC00 && i < src.size()
+        && (unsigned)src[i] >= 0xDC00 && (unsigned)src[i] <= 0xDFFF)
+      code = 0x10000 + ((code - 0xD800) << 10) + ((unsigned)src[i++] - 0xDC00);
+
+    if (code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF))
+      throw CodecException("Invalid multibyte sequence");
+
+    return code;
+  }
+
+  // An invalid sequence is incomplete if it is cut by the end of the input
+  void throw_utf8_error(const std::string &src, size_t pos)
+  {
+    unsigned lead = (unsigned char)src[pos];
+    size_t count = (lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : 2);
+
+    if (lead >= 0xC2 && lead <= 0xF4 && src.size() - pos < count)
+      {
+        size_t i = pos + 1;
+
+        while (i < src.size() && ((unsigned char)src[i] & 0xC0) == 0x80)
+          ++i;
+
+        if (i == src.size())
+          throw CodecException("Incomplete multibyte sequence");
+      }
+
+    throw CodecException("Invalid multibyte sequence");
+  }
+
+  void decode_utf8(std::wstring &dest, const std::string &src)
+  {
+    const char *data = src.data();
+    size_t length = src.size();
+    size_t start = dest.size();
+    size_t pos = 0;
+    size_t count = 0;
+
+    // A string never has more characters than bytes
+    dest.resize(start + length);
+    wchar_t *out = &dest[start];
+
+    while (pos < length)
+      {
+        size_t plain = Simd::widen_ascii(out + count, data + pos, length - pos);
+        pos += plain;
+        count += plain;
+
+        while (pos < length && (unsigned char)data[pos] >= 0x80)
+          {
+            unsigned code;
+
+            if (!utf8_decode(data, length, pos, code))
+              throw_utf8_error(src, pos);
+
+            count += append_units(out + count, code);
+          }
+      }
+
+    dest.resize(start + count);
+  }
+
+  void encode_utf8(std::string &dest, const std::wstring &src)
+  {
+    size_t start = dest.size();
+    size_t count = 0;
+    size_t i = 0;
+
+    // Room for ASCII, grown to the longest output on the first other
+    // character
+    dest.resize(start + src.size());
+
+    while (i < src.size())
+      {
+        size_t plain = Simd::narrow_ascii(&dest[start + count], src.data() + i, src.size() - i);
+        i += plain;
+        count += plain;
+
+        if (i < src.size() && dest.size() - start - count < 4 * (src.size() - i))
+          dest.resize(start + count + 4 * (src.size() - i));
+
+        while (i < src.size() && (unsigned)src[i] >= 0x80)
+          {
+            unsigned code = next_code_point(src, i);
+            unsigned char *out = (unsigned char *)&dest[start + count];
+
+            if (code < 0x800)
+              {
+                out[0] = 0xC0 | (code >> 6);
+                out[1] = 0x80 | (code & 0x3F);
+                count += 2;
+              }
+            else if (code < 0x10000)
+              {
+                out[0] = 0xE0 | (code >> 12);
+                out[1] = 0x80 | ((code >> 6) & 0x3F);
+                out[2] = 0x80 | (code & 0x3F);
+                count += 3;
+              }
+            else
+              {
+                out[0] = 0xF0 | (code >> 18);
+                out[1] = 0x80 | ((code >> 12) & 0x3F);
+                out[2] = 0x80 | ((code >> 6) & 0x3F);
+                out[3] = 0x80 | (code & 0x3F);
+                count += 4;
+              }
+          }
+      }
+
+    dest.resize(start + count);
+  }
+
+  void decode_utf16(std::wstring &dest, const std::string &src, bool big_endian)
+  {
+    size_t length = src.size() / 2 * 2;
+    size_t start = dest.size();
+    size_t count = 0;
+
+    dest.resize(start + length / 2);
+    wchar_t *out = &dest[start];
+
+    for (size_t pos = 0; pos < length; pos += 2)
+      {
+        unsigned code = load< uint16_t >(src.data() + pos, big_endian);
+
+        if (code >= 0xD800 && code <= 0xDFFF)
+          {
+            if (code >= 0xDC00)
+              throw CodecException("Invalid multibyte sequence");
+
+            if (pos + 2 >= length)
+              throw CodecException("Incomplete multibyte sequence");
+
+            unsigned low = load< uint16_t >(src.data() + pos + 2, big_endian);
+
+            if (low < 0xDC00 || low > 0xDFFF)
+              throw CodecException("Invalid multibyte sequence");
+
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            pos += 2;
+          }
+
+        count += append_units(out + count, code);
+      }
+
+    if (length != src.size())
+      throw CodecException("Incomplete multibyte sequence");
+
+    dest.resize(start + count);
+  }
+
+  void encode_utf16(std::string &dest, const std::wstring &src, bool big_endian)
+  {
+    size_t start = dest.size();
+    size_t count = 0;
+    size_t i = 0;
+
+    dest.resize(start + 4 * src.size());
+
+    while (i < src.size())
+      {
+        unsigned code = next_code_point(src, i);
+
+        if (code >= 0x10000)
+          {
+            code -= 0x10000;
+            store< uint16_t >(&dest[start + count], 0xD800 + (code >> 10), big_endian);
+            store< uint16_t >(&dest[start + count + 2], 0xDC00 + (code & 0x3FF), big_endian);
+            count += 4;
+          }
+        else
+          {
+            store< uint16_t >(&dest[start + count], code, big_endian);
+            count += 2;
+          }
+      }
+
+    dest.resize(start + count);
+  }
+
+  void decode_utf32(std::wstring &dest, const std::string &src, bool big_endian)
+  {
+    size_t length = src.size() / 4 * 4;
+    size_t start = dest.size();
+    size_t count = 0;
+
+    dest.resize(start + length / 4 * (sizeof(wchar_t) == 2 ? 2 : 1));
+    wchar_t *out = &dest[start];
+
+    for (size_t pos = 0; pos < length; pos += 4)
+      {
+        unsigned code = load< uint32_t >(src.data() + pos, big_endian);
+
+        if (code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF))
+          throw CodecException("Invalid multibyte sequence");
+
+        count += append_units(out + count, code);
+      }
+
+    if (length != src.size())
+      throw CodecException("Incomplete multibyte sequence");
+
+    dest.resize(start + count);
+  }
+
+  void encode_utf32(std::string &dest, const std::wstring &src, bool big_endian)
+  {
+    size_t start = dest.size();
+    size_t count = 0;
+    size_t i = 0;
+
+    dest.resize(start + 4 * src.size());
+
+    while (i < src.size())
+      {
+        store< uint32_t >(&dest[start + count], next_code_point(src, i), big_endian);
+        count += 4;
+      }
+
+    dest.resize(start + count);
+  }
+
+  typedef std::vector< std::pair< std::string, std::unique_ptr< Codec > > > CodecCache;
+
+  // Few encodings are used by a program, a linear search is enough
+  thread_local CodecCache codecs;
+
 } // namespace
 
 Codec::Codec(const char *encoding)
+  : encoding(ENCODING_ICONV), internal_decode(NULL), internal_encode(NULL)
 {
+  std::string name = normalize(encoding);
+
+  if (name == "UTF8")
+    this->encoding = ENCODING_UTF8;
+  else if (name == "UTF16LE")
+    this->encoding = ENCODING_UTF16LE;
+  else if (name == "UTF16BE")
+    this->encoding = ENCODING_UTF16BE;
+  else if (name == "UTF32LE")
+    this->encoding = ENCODING_UTF32LE;
+  else if (name == "UTF32BE")
+    this->encoding = ENCODING_UTF32BE;
+
+  if (this->encoding != ENCODING_ICONV)
+    return;
+
   internal_decode = iconv_open("WCHAR_T", encoding);
 
-  if (!internal_decode)
+  if (internal_decode == (iconv_t)-1)
     throw CodecException("Could not initialize iconv decoder");
 
   internal_encode = iconv_open(encoding, "WCHAR_T");
 
-  if (!internal_encode)
-    throw CodecException("Could not initialize iconv encoder");
+  if (internal_encode == (iconv_t)-1)
+    {
+      iconv_close(internal_decode);
+      throw CodecException("Could not initialize iconv encoder");
+    }
 }
 
 Codec::~Codec()
 {
+  if (encoding != ENCODING_ICONV)
+    return;
+
   iconv_close(internal_decode);
   iconv_close(internal_encode);
 }
 
+Codec &
+Codec::get(const char *encoding)
+{
+  for (CodecCache::iterator it = codecs.begin(); it != codecs.end(); ++it)
+    if (it->first == encoding)
+      return *it->second;
+
+  std::unique_ptr< Codec > codec(new Codec(encoding));
+  codecs.push_back(std::make_pair(std::string(encoding), std::move(codec)));
+  return *codecs.back().second;
+}
+
 void
 Codec::decode(std::wstring &dest, const std::string &src)
 {
-  transcode(internal_decode, dest, src);
+  TranscodeTimer timer;
+  size_t size = dest.size();
+
+  try
+    {
+      convert(dest, src);
+    }
+  catch (...)
+    {
+      // Drop the partial output
+      dest.resize(size);
+      throw;
+    }
 }
 
 void
 Codec::encode(std::string &dest, const std::wstring &src)
 {
-  transcode(internal_encode, dest, src);
+  TranscodeTimer timer;
+  size_t size = dest.size();
+
+  try
+    {
+      convert(dest, src);
+    }
+  catch (...)
+    {
+      dest.resize(size);
+      throw;
+    }
+}
+
+void
+Codec::convert(std::wstring &dest, const std::string &src)
+{
+  switch (encoding)
+    {
+    case ENCODING_UTF8:
+      decode_utf8(dest, src);
+      break;
+
+    case ENCODING_UTF16LE:
+    case ENCODING_UTF16BE:
+      decode_utf16(dest, src, encoding == ENCODING_UTF16BE);
+      break;
+
+    case ENCODING_UTF32LE:
+    case ENCODING_UTF32BE:
+      decode_utf32(dest, src, encoding == ENCODING_UTF32BE);
+      break;
+
+    default:
+      transcode(internal_decode, dest, src);
+      break;
+    }
+}
+
+void
+Codec::convert(std::string &dest, const std::wstring &src)
+{
+  switch (encoding)
+    {
+    case ENCODING_UTF8:
+      encode_utf8(dest, src);
+      break;
+
+    case ENCODING_UTF16LE:
+    case ENCODING_UTF16BE:
+      encode_utf16(dest, src, encoding == ENCODING_UTF16BE);
+      break;
+
+    case ENCODING_UTF32LE:
+    case ENCODING_UTF32BE:
+      encode_utf32(dest, src, encoding == ENCODING_UTF32BE);
+      break;
+
+    default:
+      transcode(internal_encode, dest, src);
+      break;
+    }
 }
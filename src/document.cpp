@@ -0,0 +1,43 @@
+#include "json/document.h"
+
+using namespace Json;
+
+Document::Document(size_t block_size, MemoryResource *upstream)
+  : arena(block_size, upstream), source(NULL)
+{
+}
+
+Document::~Document()
+{
+  clear();
+}
+
+void
+Document::clear()
+{
+  root.set();
+
+  for (size_t i = 0; i < arenas.size(); ++i)
+    delete arenas[i];
+
+  arenas.clear();
+  arena.clear();
+  set_source(NULL);
+}
+
+Arena &
+Document::add_arena()
+{
+  arenas.push_back(NULL);
+  arenas.back() = new Arena(arena.get_block_size(), arena.get_upstream());
+  return *arenas.back();
+}
+
+void
+Document::set_source(MappedFile *file)
+{
+  if (file != source)
+    delete source;
+
+  source = file;
+}
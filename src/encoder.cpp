@@ -0,0 +1,473 @@
+#include "encoder.h"
+#include "number.h"
+#include "simd.h"
+#include "utf8.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using namespace Json;
+
+namespace
+{
+
+  // Character following the backslash of the escape sequence of each ASCII
+  // character, 'u' for a \u escape and 0 if it is written as is. This has
+  // to agree with the scans of simd.cpp
+  const char escapes[128] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    0, 0, '"', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '/',
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '\\', 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 'u',
+  };
+
+  inline bool is_surrogate(unsigned code)
+  {
+    return code >= 0xD800 && code <= 0xDFFF;
+  }
+
+} // namespace
+
+Encoder::Encoder(Sink &sink, bool ascii)
+  : sink(sink), ascii(ascii), threads(1), range_items(0), written(0), used(0)
+{
+}
+
+void
+Encoder::set_parallel(unsigned threads, size_t range_items)
+{
+  this->threads = (threads ? threads : 1);
+  this->range_items = (range_items ? range_items : 1);
+}
+
+void
+Encoder::flush()
+{
+  if (used)
+    {
+      sink.write(buffer, used);
+      written += used;
+      used = 0;
+    }
+}
+
+void
+Encoder::raw_slow(const char *data, size_t length)
+{
+  flush();
+
+  // Large blocks are not worth going through the buffer
+  if (length >= sizeof(buffer))
+    {
+      sink.write(data, length);
+      written += length;
+      return;
+    }
+
+  memcpy(buffer, data, length);
+  used = length;
+}
+
+void
+Encoder::value(const Value &value)
+{
+  const char *text;
+  size_t length;
+
+  switch (value.get_type())
+    {
+    case Value::JSON_TYPE_NULL:
+      raw("null", 4);
+      break;
+
+    case Value::JSON_TYPE_BOOLEAN:
+      if ((bool)value)
+        raw("true", 4);
+      else
+        raw("false", 5);
+      break;
+
+    case Value::JSON_TYPE_INTEGER:
+    case Value::JSON_TYPE_FLOAT:
+      if (value.get_raw_number(text, length))
+        raw(text, length);
+      else if (value.get_type() == Value::JSON_TYPE_FLOAT)
+        number(value);
+      else if (value.is_uint64())
+        unsigned_integer(value);
+      else
+        integer(value);
+      break;
+
+    case Value::JSON_TYPE_STRING:
+      if (value.get_utf8_string(text, length))
+        utf8_string(text, length);
+      else
+        {
+          const wchar_t *data;
+
+          value.get_string(data, length);
+          string(data, length);
+        }
+      break;
+
+    case Value::JSON_TYPE_LIST:
+      {
+        const Value::List &list = value;
+
+        put('[');
+        if (!parallel_items(list))
+          items(list.begin(), list.end(), true);
+        put(']');
+      }
+      break;
+
+    case Value::JSON_TYPE_OBJECT:
+      {
+        const Value::Object &obj = value;
+
+        put('{');
+        if (!parallel_items(obj))
+          items(obj.begin(), obj.end(), true);
+        put('}');
+      }
+      break;
+    }
+}
+
+template < class _Iterator >
+  void
+  Encoder::items(_Iterator begin, _Iterator end, bool first)
+  {
+    for (; begin != end; ++begin)
+      {
+        if (first)
+          first = false;
+        else
+          raw(", ", 2);
+
+        item(*begin);
+      }
+  }
+
+template < class _Container >
+  bool
+  Encoder::parallel_items(const _Container &items)
+  {
+    size_t size = items.size();
+
+    if (threads < 2 || size < 2 * range_items)
+      return false;
+
+    // Enough ranges for every thread to get a few, so that a slow range
+    // does not hold the others back
+    size_t count = std::min(size / range_items, (size_t)threads * 4);
+    std::vector< typename _Container::const_iterator > bounds;
+    typename _Container::const_iterator it = items.begin();
+
+    for (size_t i = 0; i < count; ++i)
+      {
+        bounds.push_back(it);
+        std::advance(it, size / count + (i < size % count));
+      }
+
+    bounds.push_back(items.end());
+
+    std::vector< std::string > parts(count);
+    std::vector< std::exception_ptr > errors(count);
+    std::vector< bool > done(count);
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::atomic< size_t > next(0);
+
+    // The items of the worker encoders are encoded sequentially
+    auto encode = [&](size_t i)
+      {
+        try
+          {
+            StringSink sink(parts[i]);
+            Encoder encoder(sink, ascii);
+
+            encoder.items(bounds[i], bounds[i + 1], i == 0);
+            encoder.flush();
+          }
+        catch (...)
+          {
+            errors[i] = std::current_exception();
+          }
+
+        std::lock_guard< std::mutex > lock(mutex);
+        done[i] = true;
+        ready.notify_all();
+      };
+
+    auto work = [&]()
+      {
+        for (size_t i; (i = next++) < count; )
+          encode(i);
+      };
+
+    std::vector< std::thread > workers;
+
+    for (size_t i = 1; i < threads && i < count; ++i)
+      {
+        try
+          {
+            workers.push_back(std::thread(work));
+          }
+        catch (const std::system_error &)
+          {
+            // The ranges are shared out dynamically, the threads already
+            // running take over
+            break;
+          }
+      }
+
+    // The calling thread writes the ranges out in order, and encodes ranges
+    // itself while the next one to write is not ready
+    std::exception_ptr error;
+
+    try
+      {
+        for (size_t written = 0; written < count; ++written)
+          {
+            for (;;)
+              {
+                {
+                  std::unique_lock< std::mutex > lock(mutex);
+
+                  if (done[written])
+                    break;
+
+                  if (next >= count)
+                    {
+                      ready.wait(lock, [&]() { return done[written]; });
+                      break;
+                    }
+                }
+
+                size_t i = next++;
+
+                if (i < count)
+                  encode(i);
+              }
+
+            if (errors[written])
+              std::rethrow_exception(errors[written]);
+
+            raw(parts[written].data(), parts[written].size());
+            std::string().swap(parts[written]);
+          }
+      }
+    catch (...)
+      {
+        error = std::current_exception();
+        next = count;
+      }
+
+    for (size_t i = 0; i < workers.size(); ++i)
+      workers[i].join();
+
+    if (error)
+      std::rethrow_exception(error);
+
+    return true;
+  }
+
+inline void
+Encoder::ascii_escape(unsigned c)
+{
+  char escape = escapes[c];
+
+  if (escape == 'u')
+    this->escape(c);
+  else
+    {
+      reserve(2);
+      buffer[used++] = '\\';
+      buffer[used++] = escape;
+    }
+}
+
+void
+Encoder::string(const wchar_t *data, size_t length)
+{
+  size_t i = 0;
+
+  put('"');
+
+  while (i < length)
+    {
+      unsigned c = data[i];
+
+      // Plain characters are narrowed in bulk, as many as the buffer holds
+      if (c < 0x80 && !escapes[c])
+        {
+          if (used == sizeof(buffer))
+            flush();
+
+          size_t count = Simd::copy_plain(buffer + used, data + i,
+                                          std::min(length - i, sizeof(buffer) - used));
+          used += count;
+          i += count;
+          continue;
+        }
+
+      ++i;
+
+      if (c < 0x80)
+        {
+          ascii_escape(c);
+          continue;
+        }
+
+      // Surrogate pairs come from 16-bit wchar_t or from \u escapes
+      if (c >= 0xD800 && c <= 0xDBFF && i < length
+          && (unsigned)data[i] >= 0xDC00 && (unsigned)data[i] <= 0xDFFF)
+        {
+          c = 0x10000 + ((c - 0xD800) << 10) + ((unsigned)data[i] - 0xDC00);
+          ++i;
+        }
+
+      code_point(c);
+    }
+
+  put('"');
+}
+
+void
+Encoder::utf8_string(const char *data, size_t length)
+{
+  size_t start = 0;
+
+  put('"');
+
+  while (start < length)
+    {
+      unsigned char c = data[start];
+      size_t i = start;
+
+      // Runs without anything to escape are copied as is
+      if ((c >= 0x80 && !ascii) || (c < 0x80 && !escapes[c]))
+        {
+          i = Simd::scan_escape(data, start, length, ascii);
+          raw(data + start, i - start);
+
+          if (i == length)
+            break;
+
+          c = data[i];
+        }
+
+      if (c < 0x80)
+        {
+          ascii_escape(c);
+          ++i;
+        }
+      else
+        {
+          unsigned code;
+
+          if (!utf8_decode(data, length, i, code))
+            {
+              code = 0xFFFD;
+              ++i;
+            }
+
+          escape(code);
+        }
+
+      start = i;
+    }
+
+  put('"');
+}
+
+void
+Encoder::code_point(unsigned code)
+{
+  // Lone surrogates can only be written as escapes
+  if (code > 0x10FFFF)
+    code = 0xFFFD;
+
+  if (ascii || is_surrogate(code))
+    {
+      escape(code);
+      return;
+    }
+
+  reserve(4);
+
+  if (code < 0x800)
+    {
+      buffer[used++] = 0xC0 | (code >> 6);
+      buffer[used++] = 0x80 | (code & 0x3F);
+    }
+  else if (code < 0x10000)
+    {
+      buffer[used++] = 0xE0 | (code >> 12);
+      buffer[used++] = 0x80 | ((code >> 6) & 0x3F);
+      buffer[used++] = 0x80 | (code & 0x3F);
+    }
+  else
+    {
+      buffer[used++] = 0xF0 | (code >> 18);
+      buffer[used++] = 0x80 | ((code >> 12) & 0x3F);
+      buffer[used++] = 0x80 | ((code >> 6) & 0x3F);
+      buffer[used++] = 0x80 | (code & 0x3F);
+    }
+}
+
+void
+Encoder::escape(unsigned code)
+{
+  static const char hex[] = "0123456789abcdef";
+
+  if (code >= 0x10000)
+    {
+      code -= 0x10000;
+      escape(0xD800 + (code >> 10));
+      escape(0xDC00 + (code & 0x3FF));
+      return;
+    }
+
+  reserve(6);
+  buffer[used++] = '\\';
+  buffer[used++] = 'u';
+  buffer[used++] = hex[(code >> 12) & 0xF];
+  buffer[used++] = hex[(code >> 8) & 0xF];
+  buffer[used++] = hex[(code >> 4) & 0xF];
+  buffer[used++] = hex[code & 0xF];
+}
+
+void
+Encoder::integer(int64_t value)
+{
+  reserve(Number::max_length);
+  used += Number::format_integer(buffer + used, value);
+}
+
+void
+Encoder::unsigned_integer(uint64_t value)
+{
+  reserve(Number::max_length);
+  used += Number::format_unsigned(buffer + used, value);
+}
+
+void
+Encoder::number(double value)
+{
+  reserve(Number::max_length);
+  used += Number::format_double(buffer + used, value);
+}
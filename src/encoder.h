@@ -0,0 +1,155 @@
+#ifndef JSON_ENCODER_H_INCLUDE
+#define JSON_ENCODER_H_INCLUDE
+
+#include <string.h>
+
+#include "json/value.h"
+#include "json/sink.h"
+
+namespace Json
+{
+
+  /**
+   * JSON serializer writing into a fixed size buffer, which is handed over
+   * to a sink whenever it is full. Strings are written as UTF-8, or as pure
+   * ASCII with \\u escapes for everything else.
+   *
+   * The buffered output is only written to the sink by flush().
+   */
+  class Encoder
+  {
+  public:
+    /**
+     * Create an encoder.
+     *
+     * @param sink Destination of the output.
+     * @param ascii Escape all non-ASCII characters.
+     */
+    Encoder(Sink &sink, bool ascii);
+
+    /**
+     * Encode the lists and objects with many items on several threads.
+     * Ranges of items are encoded into separate buffers, which are written
+     * to the sink in order by the calling thread. The items within a range
+     * are encoded by a single thread.
+     *
+     * @param threads Number of threads, 1 to encode everything in the
+     *        calling thread.
+     * @param range_items Number of items of a range, lists and objects with
+     *        fewer than two ranges of items are encoded by the calling
+     *        thread.
+     */
+    void set_parallel(unsigned threads, size_t range_items);
+
+    /**
+     * Write a value and all of its children.
+     */
+    void value(const Value &value);
+
+    /**
+     * Write a quoted string of wide characters.
+     */
+    void string(const wchar_t *data, size_t length);
+
+    /**
+     * Write a quoted string of valid UTF-8.
+     */
+    void utf8_string(const char *data, size_t length);
+
+    /**
+     * Write an integer.
+     */
+    void integer(int64_t value);
+
+    /**
+     * Write an unsigned integer.
+     */
+    void unsigned_integer(uint64_t value);
+
+    /**
+     * Write a floating point number.
+     */
+    void number(double value);
+
+    /**
+     * Write data as is.
+     */
+    inline void raw(const char *data, size_t length)
+    {
+      if (used + length <= sizeof(buffer))
+        {
+          memcpy(buffer + used, data, length);
+          used += length;
+        }
+      else
+        raw_slow(data, length);
+    }
+
+    /**
+     * Write a single character.
+     */
+    inline void put(char c)
+    {
+      if (used == sizeof(buffer))
+        flush();
+
+      buffer[used++] = c;
+    }
+
+    /**
+     * Hand the buffered output over to the sink.
+     */
+    void flush();
+
+    /**
+     * Get the number of bytes handed over to the sink so far.
+     */
+    inline size_t get_written() const
+    { return written; }
+
+  private:
+    template < class _Iterator >
+      void items(_Iterator begin, _Iterator end, bool first);
+    template < class _Container >
+      bool parallel_items(const _Container &items);
+
+    inline void item(const Value &value)
+    { this->value(value); }
+
+    template < class _Member >
+      inline void item(const _Member &member)
+      {
+        string(member.first.data(), member.first.size());
+        put(':');
+        value(member.second);
+      }
+
+    void raw_slow(const char *data, size_t length);
+    void escape(unsigned code);
+    void ascii_escape(unsigned c);
+    void code_point(unsigned code);
+
+    // Make room for count more characters
+    inline void reserve(size_t count)
+    {
+      if (used + count > sizeof(buffer))
+        flush();
+    }
+
+  private:
+    Encoder(const Encoder &);
+    Encoder &operator=(const Encoder &);
+
+  private:
+    Sink &sink;
+    bool ascii;
+    unsigned threads;
+    size_t range_items;
+    size_t written;
+    size_t used;
+    char buffer[16384];
+  };
+
+} // namespace Json
+
+#endif // JSON_ENCODER_H_INCLUDE
@@ -0,0 +1,130 @@
+#include "json/file.h"
+
+#include <new>
+#include <string>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Json;
+
+namespace
+{
+
+  void raise_error(const char *message, const char *path, int error) JSON_NORETURN;
+
+  void raise_error(const char *message, const char *path, int error)
+  {
+    std::string str = std::string(message) + " " + path + ": " + strerror(error);
+    throw IOError(str.c_str());
+  }
+
+  // Close the descriptor when leaving the scope
+  class Descriptor
+  {
+  public:
+    Descriptor(int fd) : fd(fd) {}
+    ~Descriptor() { close(fd); }
+
+    int fd;
+  };
+
+} // namespace
+
+MappedFile::MappedFile(const char *path)
+  : data(NULL), size(0), mapped(false)
+{
+  int fd = open(path, O_RDONLY);
+
+  if (fd < 0)
+    raise_error("Cannot open", path, errno);
+
+  Descriptor guard(fd);
+  struct stat st;
+
+  if (fstat(fd, &st) < 0)
+    raise_error("Cannot stat", path, errno);
+
+  if (S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+      void *ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+      if (ptr != MAP_FAILED)
+        {
+          // The parser goes through the file once, front to back
+          madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+
+          data = (char *)ptr;
+          size = st.st_size;
+          mapped = true;
+          return;
+        }
+    }
+
+  int error;
+
+  try
+    {
+      error = read(fd);
+    }
+  catch (...)
+    {
+      free(data);
+      throw;
+    }
+
+  if (error)
+    {
+      free(data);
+      raise_error("Cannot read", path, error);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+  if (mapped)
+    munmap(data, size);
+  else
+    free(data);
+}
+
+int
+MappedFile::read(int fd)
+{
+  size_t capacity = 0;
+
+  for (;;)
+    {
+      if (size == capacity)
+        {
+          capacity = (capacity ? capacity * 2 : 65536);
+
+          char *ptr = (char *)realloc(data, capacity);
+
+          if (!ptr)
+            throw std::bad_alloc();
+
+          data = ptr;
+        }
+
+      ssize_t count = ::read(fd, data + size, capacity - size);
+
+      if (count < 0)
+        {
+          if (errno == EINTR)
+            continue;
+
+          return errno;
+        }
+
+      if (count == 0)
+        return 0;
+
+      size += count;
+    }
+}
@@ -0,0 +1,108 @@
+#include "json/handler.h"
+#include "utf8.h"
+#include "parser.h"
+
+using namespace Json;
+
+Handler::~Handler()
+{
+}
+
+void
+Handler::null()
+{
+}
+
+void
+Handler::boolean(bool)
+{
+}
+
+void
+Handler::integer(int)
+{
+}
+
+void
+Handler::integer64(int64_t value)
+{
+  number((double)value);
+}
+
+void
+Handler::unsigned_integer64(uint64_t value)
+{
+  number((double)value);
+}
+
+void
+Handler::number(double)
+{
+}
+
+void
+Handler::raw_number(const char *text, size_t length, Value::Type)
+{
+  Parser< char >(text, length).parse(*this);
+}
+
+void
+Handler::string(const std::wstring &)
+{
+}
+
+void
+Handler::borrowed_string(const char *data, size_t length)
+{
+  std::wstring value;
+  size_t pos = 0;
+  unsigned code;
+
+  // The parser already checked the encoding
+  while (pos < length)
+    {
+      if ((unsigned char)data[pos] < 0x80)
+        value.push_back(data[pos++]);
+      else if (utf8_decode(data, length, pos, code))
+        append_code_point(value, code);
+      else
+        ++pos;
+    }
+
+  string(value);
+}
+
+void
+Handler::lazy_container(const char *text, size_t length, Value::Type, size_t offset, size_t max_depth)
+{
+  // Parsed as part of the whole input, for the positions of the errors
+  Parser< char > parser(text - offset, offset + length, max_depth);
+
+  parser.set_position(offset);
+  parser.parse(*this);
+}
+
+void
+Handler::key(const std::wstring &)
+{
+}
+
+void
+Handler::begin_object()
+{
+}
+
+void
+Handler::end_object()
+{
+}
+
+void
+Handler::begin_array()
+{
+}
+
+void
+Handler::end_array()
+{
+}
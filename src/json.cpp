@@ -1,539 +1,637 @@
 #include "json/json.h"
+#include "parser.h"
+#include "encoder.h"
 
-#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
 
-#include <wctype.h>
-#include <math.h>
-#include <stdio.h>
+#include <ctype.h>
+#include <string.h>
 
 using namespace Json;
 
 namespace
 {
 
-  inline void hex(std::wstringstream &dest, unsigned value)
+  bool is_utf8(const char *encoding)
   {
-    std::wstringstream tmp;
-    tmp << std::hex << std::setw(4) << std::setfill(L'0') << value;
+    std::string name;
 
-    dest << tmp.str();
+    for (; *encoding; ++encoding)
+      if (*encoding != '-' && *encoding != '_')
+        name.push_back(toupper(*encoding));
+
+    return name == "UTF8";
   }
 
-  inline void skip_spaces(const wchar_t *data, int &pos)
+  // Collects the statistics of a handler call and reports them to the hook.
+  // The calls a handler makes to itself are part of the outer call.
+  class StatsScope
   {
-    while (data[pos] && iswspace(data[pos]))
-      pos++;
-  }
+  public:
+#if JSON_STATS
+    StatsScope(StatsHook *hook, bool encoding, size_t bytes_in)
+      : hook(Stats::get_current() ? NULL : hook), encoding(encoding),
+        exceptions(std::uncaught_exceptions())
+    {
+      if (!this->hook)
+        return;
+
+      (encoding ? stats.encodes : stats.decodes) = 1;
+      stats.bytes_in = bytes_in;
+      start = std::chrono::steady_clock::now();
+      Stats::set_current(&stats);
+    }
+
+    ~StatsScope()
+    {
+      if (!hook)
+        return;
+
+      Stats::set_current(NULL);
+
+      uint64_t total = std::chrono::duration_cast< std::chrono::nanoseconds >(
+        std::chrono::steady_clock::now() - start).count();
+
+      // The transcoding is timed on its own
+      (encoding ? stats.encode_ns : stats.parse_ns) = total - std::min(total, stats.transcode_ns);
+
+      if (std::uncaught_exceptions() > exceptions)
+        stats.errors = 1;
+
+      hook->report(stats);
+    }
+
+    inline void set_bytes_out(size_t size)
+    {
+      stats.bytes_out = size;
+    }
+
+    inline void set_failed()
+    {
+      stats.errors = 1;
+    }
+
+  private:
+    StatsHook *hook;
+    bool encoding;
+    int exceptions;
+    Stats stats;
+    std::chrono::steady_clock::time_point start;
+#else
+    StatsScope(StatsHook *, bool, size_t)
+    {
+    }
+
+    inline void set_bytes_out(size_t)
+    {
+    }
+
+    inline void set_failed()
+    {
+    }
+#endif
+  };
+
+  // Decode a root list by ranges of items on several threads
+  template < class _Char >
+    void decode_list(Document &dest, const _Char *json, size_t length, int flags, KeyPool *pool,
+                     size_t max_depth, unsigned threads, size_t range_size)
+    {
+      std::vector< std::pair< size_t, size_t > > ranges;
+
+      // Give every thread a few ranges, so that a slow range does not hold
+      // the others back
+      if (threads > 1)
+        range_size = std::max(range_size, length / (threads * 4));
+
+      if (threads < 2 || length < 2 * range_size
+          || !Parser< _Char >(json, length, max_depth).split_list(ranges, range_size) || ranges.size() < 2)
+        {
+          Parser< _Char >(json, length, max_depth).decode(dest.get_root(), &dest.get_arena(), flags, pool);
+          return;
+        }
+
+      size_t count = ranges.size();
+      std::vector< Value > parts(count);
+      std::vector< Value::List * > lists(count);
+      std::vector< std::exception_ptr > errors(count);
+      std::atomic< size_t > next(0);
+
+      auto work = [&](Arena *arena)
+        {
+          for (size_t i; (i = next++) < count; )
+            {
+              try
+                {
+                  lists[i] = &parts[i].set_list(arena);
+                  Parser< _Char >(json, length, max_depth).decode_items(*lists[i], ranges[i].first,
+                                                                        ranges[i].second, arena, flags);
+                }
+              catch (...)
+                {
+                  errors[i] = std::current_exception();
+                }
+            }
+        };
+
+      // The statistics of the other threads are added to those of the call
+      Stats *stats = Stats::get_current();
+      std::mutex stats_mutex;
+
+      auto thread_work = [&](Arena *arena)
+        {
+          Stats thread_stats;
+
+          if (stats)
+            Stats::set_current(&thread_stats);
+
+          work(arena);
+
+          if (stats)
+            {
+              Stats::set_current(NULL);
+
+              std::lock_guard< std::mutex > lock(stats_mutex);
+              *stats += thread_stats;
+            }
+        };
+
+      std::vector< std::thread > workers;
+
+      for (size_t i = 1; i < threads && i < count; ++i)
+        {
+          try
+            {
+              workers.push_back(std::thread(thread_work, &dest.add_arena()));
+            }
+          catch (const std::system_error &)
+            {
+              // The ranges are shared out dynamically, the threads already
+              // running take over
+              break;
+            }
+        }
+
+      work(&dest.get_arena());
+
+      for (size_t i = 0; i < workers.size(); ++i)
+        workers[i].join();
+
+      // The first error of the input is the one reported
+      size_t total = 0;
+
+      for (size_t i = 0; i < count; ++i)
+        {
+          if (errors[i])
+            std::rethrow_exception(errors[i]);
+
+          total += lists[i]->size();
+        }
+
+      // The items stay in the arenas of their threads
+      Value::List &list = dest.get_root().set_list(&dest.get_arena());
+      list.reserve(total);
+
+      for (size_t i = 0; i < count; ++i)
+        for (size_t j = 0; j < lists[i]->size(); ++j)
+          list.push_back(std::move((*lists[i])[j]));
+    }
 
 }
 
+const char *
+ParseResult::get_message() const
+{
+  switch (code)
+    {
+    case OK:
+      return "No error";
+    case UNEXPECTED_EOF:
+      return "Unexpected end of input";
+    case INVALID_TOKEN:
+      return "Invalid token found";
+    case INVALID_CHARACTER:
+      return "Invalid character found";
+    case INVALID_UTF8:
+      return "Invalid UTF-8 sequence";
+    case INVALID_DIGIT:
+      return "Invalid digit";
+    case INVALID_ESCAPE:
+      return "Invalid escape character found";
+    case INVALID_HEX:
+      return "Invalid hex code";
+    case EXPECTED_KEY:
+      return "Expected string for key";
+    case EXPECTED_COLON:
+      return "Expected ':'";
+    case INVALID_LIST_END:
+      return "List ended with an invalid character";
+    case INVALID_OBJECT_END:
+      return "Object ended with invalid character";
+    case TOO_DEEP:
+      return "Maximum nesting depth exceeded";
+    case INVALID_ENCODING:
+      return "Invalid encoding";
+    }
+
+  return "Unknown error";
+}
+
 JsonHandler::JsonHandler(const char *encoding)
-  : codec(encoding)
+  : encoding(encoding), utf8(is_utf8(encoding)), pool(NULL), threads(0), range_size(1 << 20),
+    range_items(4096), max_depth(1024), stats_hook(NULL)
 {
+  // UTF-8 is parsed natively, other encodings are checked up front
+  if (!utf8)
+    get_codec();
 }
 
 JsonHandler::~JsonHandler()
 {
 }
 
+void
+JsonHandler::set_parallel(unsigned threads, size_t range_size, size_t range_items)
+{
+  this->threads = threads;
+  this->range_size = (range_size ? range_size : 1);
+  this->range_items = (range_items ? range_items : 1);
+}
+
 Value
 JsonHandler::decode(const std::string &json)
 {
+  StatsScope scope(stats_hook, false, json.size());
+
+  if (utf8)
+    {
+      Value result;
+      Parser< char >(json.data(), json.size(), max_depth).decode(result, NULL, 0, pool);
+      return result;
+    }
+
   std::wstring data;
-  codec.decode(data, json);
+  get_codec().decode(data, json);
   return decode(data);
 }
 
+Value
+JsonHandler::decode(const char *json, int len)
+{
+  size_t length = (len < 0 ? strlen(json) : len);
+  StatsScope scope(stats_hook, false, length);
+
+  if (utf8)
+    {
+      Value result;
+      Parser< char >(json, length, max_depth).decode(result, NULL, 0, pool);
+      return result;
+    }
+
+  return decode(std::string(json, length));
+}
+
 Value
 JsonHandler::decode(const std::wstring &json)
 {
-  int pos = 0;
-  return decode_value(json.c_str(), pos);
+  StatsScope scope(stats_hook, false, json.size() * sizeof(wchar_t));
+  Value result;
+  Parser< wchar_t >(json.data(), json.size(), max_depth).decode(result, NULL, 0, pool);
+  return result;
 }
 
 void
-JsonHandler::encode(std::wstring &dest, const Value &value)
+JsonHandler::decode(Document &dest, const std::string &json)
 {
-  std::wstringstream str;
-  encode(str, value);
-  dest = str.str();
+  StatsScope scope(stats_hook, false, json.size());
+
+  dest.clear();
+
+  if (utf8)
+    {
+      Parser< char >(json.data(), json.size(), max_depth).decode(dest.get_root(), &dest.get_arena(), 0, pool);
+      return;
+    }
+
+  std::wstring data;
+  get_codec().decode(data, json);
+  decode(dest, data);
 }
 
 void
-JsonHandler::encode(std::string &dest, const Value &value)
+JsonHandler::decode(Document &dest, const std::wstring &json)
 {
-  std::wstring result;
-  encode(result, value);
-  codec.encode(dest, result);
+  StatsScope scope(stats_hook, false, json.size() * sizeof(wchar_t));
+
+  dest.clear();
+  Parser< wchar_t >(json.data(), json.size(), max_depth).decode(dest.get_root(), &dest.get_arena(), 0, pool);
 }
 
 Value
-JsonHandler::decode_value(const wchar_t *data, int &pos)
+JsonHandler::decode_file(const char *path)
 {
-  skip_spaces(data, pos);
+  MappedFile file(path);
+  StatsScope scope(stats_hook, false, file.get_size());
+  Value result;
 
-  switch (data[pos])
-    {
-    case L't':
-      if (compare_forward(data, pos, L"true"))
-        return Value(true);
-
-      raise_error< InvalidCharacter >("Invalid token found", pos);
-
-    case L'f':
-      if (compare_forward(data, pos, L"false"))
-        return Value(false);
+  decode(result, NULL, file.get_data(), file.get_size(), 0);
+  return result;
+}
 
-      raise_error< InvalidCharacter >("Invalid token found", pos);
+void
+JsonHandler::decode_file(Document &dest, const char *path, int flags)
+{
+  dest.clear();
 
-    case L'n':
-      if (compare_forward(data, pos, L"null"))
-        return Value();
+  // The document owns the file from here on, even if decoding fails
+  MappedFile *file = new MappedFile(path);
+  dest.set_source(file);
 
-      raise_error< InvalidCharacter >("Invalid token found", pos);
+  StatsScope scope(stats_hook, false, file->get_size());
 
-    case L'"':
-      return decode_string(data, pos);
+  if (flags & PARALLEL)
+    decode_parallel(dest, file->get_data(), file->get_size(), flags);
+  else
+    decode(dest.get_root(), &dest.get_arena(), file->get_data(), file->get_size(), flags);
 
-    case L'{':
-      return decode_object(data, pos);
+  if (!(flags & (BORROW_STRINGS | RAW_NUMBERS | LAZY_CONTAINERS)))
+    dest.set_source(NULL);
+}
 
-    case L'[':
-      return decode_array(data, pos);
+void
+JsonHandler::decode(Document &dest, const char *json, size_t length, int flags)
+{
+  StatsScope scope(stats_hook, false, length);
 
-    default:
-      if (iswdigit(data[pos]) || data[pos] == L'-')
-        return decode_number(data, pos);
+  dest.clear();
 
-      raise_error< InvalidCharacter >("Invalid character found", pos);
-    }
+  if (flags & PARALLEL)
+    decode_parallel(dest, json, length, flags);
+  else
+    decode(dest.get_root(), &dest.get_arena(), json, length, flags);
 }
 
-Value
-JsonHandler::decode_string(const wchar_t *data, int &pos)
+unsigned
+JsonHandler::get_threads() const
 {
-  std::wstring str;
-  bool escape = false;
+  return (threads ? threads : std::thread::hardware_concurrency());
+}
 
-  assert(data[pos] == L'"');
-  ++pos;
+void
+JsonHandler::decode_parallel(Document &dest, const char *json, size_t length, int flags)
+{
+  unsigned count = get_threads();
 
-  while (data[pos] && (escape || data[pos] != L'"'))
+  if (utf8)
     {
-      if (escape)
-        {
-          str.push_back(unescape(data, pos));
-          escape = false;
-          continue;
-        }
-
-      if (data[pos] == L'\\')
-        {
-          escape = true;
-          ++pos;
-          continue;
-        }
-
-      str.push_back(data[pos]);
-      ++pos;
+      decode_list(dest, json, length, flags, pool, max_depth, count, range_size);
+      return;
     }
 
-  if (!data[pos])
-    raise_error< UnexpectedEof >("Unexpected end of input", pos);
+  std::wstring data;
+  get_codec().decode(data, std::string(json, length));
+  decode_list(dest, data.data(), data.size(), 0, pool, max_depth, count, range_size);
+}
 
-  assert(data[pos] == L'"');
-  ++pos;
+void
+JsonHandler::decode(Value &dest, MemoryResource *resource, const char *json, size_t length, int flags)
+{
+  StatsScope scope(stats_hook, false, length);
 
-  return Value(str);
+  if (utf8)
+    {
+      Parser< char >(json, length, max_depth).decode(dest, resource, flags, pool);
+      return;
+    }
+
+  std::wstring data;
+  get_codec().decode(data, std::string(json, length));
+  Parser< wchar_t >(data.data(), data.size(), max_depth).decode(dest, resource, 0, pool);
 }
 
-Value
-JsonHandler::decode_number(const wchar_t *data, int &pos)
+ParseResult
+JsonHandler::try_decode(Document &dest, const char *json, size_t length, int flags)
 {
-  int integer = 0;
-  int remainder = 0;
-  int remainder_count = 0;
-  bool neg_mantissa = false;
+  StatsScope scope(stats_hook, false, length);
 
-  int exponent = 0;
-  bool neg_exponent = false;
+  dest.clear();
 
-  // See if there is a signature
-  if (data[pos] == L'-')
+  ParseResult result = try_decode(dest.get_root(), &dest.get_arena(), json, length, flags & ~PARALLEL);
+
+  if (!result)
     {
-      neg_mantissa = true;
-      ++pos;
+      dest.clear();
+      scope.set_failed();
     }
 
-  if (!iswdigit(data[pos]))
-    raise_error< InvalidCharacter >("Invalid digit", pos);
+  return result;
+}
 
-  // Zero is a separate case
-  if (data[pos] != L'0')
-    {
-      integer = decode_integer(data, pos);
-    }
-  else
-    {
-      ++pos;
-    }
+ParseResult
+JsonHandler::try_decode(Value &dest, MemoryResource *resource, const char *json, size_t length, int flags)
+{
+  StatsScope scope(stats_hook, false, length);
+  ParseResult result;
 
-  if (data[pos] == L'.')
+  if (utf8)
     {
-      ++pos;
+      Parser< char > parser(json, length, max_depth);
 
-      if (!iswdigit(data[pos]))
-        raise_error< InvalidCharacter >("Invalid digit", pos);
-
-      int oldpos = pos;
-      remainder = decode_integer(data, pos);
-      remainder_count = pos - oldpos;
+      if (!parser.try_decode(dest, resource, flags, pool))
+        result = parser.get_error();
     }
-
-  if (data[pos] == L'e' || data[pos] == L'E')
+  else
     {
-      ++pos;
+      std::wstring data;
 
-      if (data[pos] == L'+')
+      try
         {
-          ++pos;
+          get_codec().decode(data, std::string(json, length));
         }
-      else if (data[pos] == L'-')
+      catch (const CodecException &)
         {
-          neg_exponent = true;
-          ++pos;
+          result = ParseResult(ParseResult::INVALID_ENCODING, 0);
         }
 
-      if (!iswdigit(data[pos]))
-        raise_error< InvalidCharacter >("Invalid digit", pos);
+      if (result)
+        {
+          Parser< wchar_t > parser(data.data(), data.size(), max_depth);
 
-      exponent = decode_integer(data, pos);
+          if (!parser.try_decode(dest, resource, 0, pool))
+            result = parser.get_error();
+        }
     }
 
-  if (remainder_count == 0 && exponent == 0)
+  if (!result)
     {
-      if (neg_mantissa)
-        integer = -integer;
-
-      return Value(integer);
+      dest = Value();
+      scope.set_failed();
     }
 
-  double res = integer + (double)remainder / pow(10, (double)remainder_count);
-
-  if (neg_mantissa)
-    res = -res;
-
-  if (neg_exponent)
-    exponent = -exponent;
-
-  res = res * pow(10, (double)exponent);
-
-  return Value(res);
+  return result;
 }
 
-Value
-JsonHandler::decode_array(const wchar_t *data, int &pos)
+void
+JsonHandler::decode(Tape &dest, const char *json, size_t length)
 {
-  assert(data[pos] == L'[');
-  ++pos;
-
-  Value::List list;
-  bool last = false;
+  StatsScope scope(stats_hook, false, length);
+  TapeBuilder builder(dest);
 
-  skip_spaces(data, pos);
-  if (data[pos] != L']')
+  try
     {
-      while (data[pos] && !last && data[pos] != L']')
+      if (utf8)
         {
-          skip_spaces(data, pos);
-          list.push_back(decode_value(data, pos));
-
-          skip_spaces(data, pos);
-          if (data[pos] == L',')
-            {
-              ++pos;
-              last = false;
-            }
-          else
-            {
-              last = true;
-            }
+          Parser< char > parser(json, length, max_depth);
 
-          skip_spaces(data, pos);
+          parser.set_borrow(true);
+          parser.parse(builder);
+          return;
         }
-    }
-  else
-    last = true;
-
-  if (!last || data[pos] != L']')
-    raise_error< InvalidCharacter >("List ended with an invalid character", pos);
 
-  return Value(list);
+      std::wstring data;
+      get_codec().decode(data, std::string(json, length));
+      Parser< wchar_t >(data.data(), data.size(), max_depth).parse(builder);
+    }
+  catch (...)
+    {
+      dest.clear();
+      throw;
+    }
 }
 
-Value
-JsonHandler::decode_object(const wchar_t *data, int &pos)
+bool
+JsonHandler::query(Value &dest, const char *json, size_t length, const Path &path)
 {
-  assert(data[pos] == L'{');
-  ++pos;
+  Value::List matches;
 
-  Value::Object object;
-  bool last = false;
+  query(matches, json, length, path, 1);
 
-  skip_spaces(data, pos);
-  if (data[pos] != L'}')
-    {
-      while (data[pos] && !last && data[pos] != L'}')
-        {
-          skip_spaces(data, pos);
-          if (data[pos] != L'"')
-            raise_error< InvalidCharacter >("Expected string for key", pos);
-          Value key = decode_string(data, pos);
+  if (matches.empty())
+    return false;
 
-          skip_spaces(data, pos);
-          if (data[pos] != L':')
-            raise_error< InvalidCharacter >("Expected ':'", pos);
-          ++pos;
-
-          skip_spaces(data, pos);
-          Value value = decode_value(data, pos);
-
-          object.insert(std::make_pair((const std::wstring &)key, value));
+  dest = std::move(matches[0]);
+  return true;
+}
 
-          skip_spaces(data, pos);
-          if (data[pos] == L',')
-            {
-              ++pos;
-              last = false;
-            }
-          else
-            {
-              last = true;
-            }
+Value
+JsonHandler::query(const std::string &json, const Path &path)
+{
+  Value result;
 
-          skip_spaces(data, pos);
-        }
-    }
-  else
-    last = true;
+  query(result, json, path);
+  return result;
+}
 
-  if (!last || data[pos] != L'}')
-    raise_error< InvalidCharacter >("Object ended with invalid character", pos);
+size_t
+JsonHandler::query_all(Value::List &dest, const char *json, size_t length, const Path &path)
+{
+  size_t count = dest.size();
 
-  return Value(object);
+  query(dest, json, length, path, (size_t)-1);
+  return dest.size() - count;
 }
 
 void
-JsonHandler::encode(std::wstringstream &dest, const Value &value)
+JsonHandler::query(Value::List &dest, const char *json, size_t length, const Path &path, size_t limit)
 {
-  switch (value.get_type())
+  StatsScope scope(stats_hook, false, length);
+
+  if (utf8)
     {
-    case Value::JSON_TYPE_NULL:
-      dest << "null";
-      break;
-
-    case Value::JSON_TYPE_BOOLEAN:
-      dest << ((bool)value ? "true" : "false");
-      break;
-
-    case Value::JSON_TYPE_INTEGER:
-      dest << (int)value;
-      break;
-
-    case Value::JSON_TYPE_FLOAT:
-      dest << (double)value;
-      break;
-
-    case Value::JSON_TYPE_STRING:
-      dest << L'\"';
-      escape(dest, value);
-      dest << L'\"';
-      break;
-
-    case Value::JSON_TYPE_LIST:
-      {
-        const Value::List &list = value;
-        bool first = true;
-
-        dest << "[";
-        for (Value::List::const_iterator it = list.begin(); it != list.end(); ++it)
-          {
-            if (first)
-              first = false;
-            else
-              dest << ", ";
-
-            encode(dest, *it);
-          }
-        dest << "]";
-      }
-      break;
-
-    case Value::JSON_TYPE_OBJECT:
-      {
-        const Value::Object &obj = value;
-        bool first = true;
-
-        dest << "{";
-        for (Value::Object::const_iterator it = obj.begin(); it != obj.end(); ++it)
-          {
-            if (first)
-              first = false;
-            else
-              dest << ", ";
-
-            dest << L'"' << it->first << L'"' << ":";
-            encode(dest, it->second);
-          }
-        dest << "}";
-      }
-      break;
+      Parser< char >(json, length, max_depth).query(path, dest, limit, pool);
+      return;
     }
+
+  std::wstring data;
+  get_codec().decode(data, std::string(json, length));
+  Parser< wchar_t >(data.data(), data.size(), max_depth).query(path, dest, limit, pool);
 }
 
-wchar_t
-JsonHandler::unescape(const wchar_t *data, int &pos)
+void
+JsonHandler::parse(const std::string &json, Handler &handler)
 {
-  switch (data[pos])
-    {
-    case L'b':
-      ++pos;
-      return L'\b';
-
-    case L'f':
-      ++pos;
-      return L'\f';
-
-    case L'n':
-      ++pos;
-      return L'\n';
-
-    case L'r':
-      ++pos;
-      return L'\r';
-
-    case L't':
-      ++pos;
-      return L'\t';
-
-    case L'"':
-    case L'\\':
-    case L'/':
-      ++pos;
-      return data[pos - 1];
-
-    case L'u':
-      ++pos;
-      break;
-
-    default:
-      raise_error< InvalidCharacter >("Invalid escape character found", pos);
-    }
+  StatsScope scope(stats_hook, false, json.size());
 
-  unsigned code = 0;
-  for (int i = 0; i < 4; ++i)
+  if (utf8)
     {
-      code <<= 4;
-
-      if (!iswxdigit(data[pos + i]))
-        raise_error< InvalidCharacter >("Invalid hex code", pos + i);
-
-      if (iswdigit(data[pos + i]))
-        code += data[pos + i] - '0';
-      else if (isupper(data[pos + i]))
-        code += data[pos + i] - 'A' + 10;
-      else
-        code += data[pos + i] - 'a' + 10;
+      Parser< char >(json.data(), json.size(), max_depth).parse(handler);
+      return;
     }
 
-  pos += 4;
-  return (wchar_t)code;
+  std::wstring data;
+  get_codec().decode(data, json);
+  parse(data, handler);
 }
 
 void
-JsonHandler::escape(std::wstringstream &dest, const std::wstring &value)
+JsonHandler::parse(const std::wstring &json, Handler &handler)
 {
-  for (std::wstring::const_iterator it = value.begin(); it != value.end(); ++it)
-    {
-      switch (*it)
-        {
-        case L'\\':
-          dest << L"\\\\";
-          break;
-
-        case L'"':
-          dest << L"\\\"";
-          break;
-
-        case L'/':
-          dest << L"\\/";
-          break;
-
-        case L'\b':
-          dest << L"\\b";
-          break;
-
-        case L'\f':
-          dest << L"\\f";
-          break;
-
-        case L'\n':
-          dest << L"\\n";
-          break;
+  StatsScope scope(stats_hook, false, json.size() * sizeof(wchar_t));
+  Parser< wchar_t >(json.data(), json.size(), max_depth).parse(handler);
+}
 
-        case L'\r':
-          dest << L"\\r";
-          break;
+void
+JsonHandler::encode(std::wstring &dest, const Value &value, int flags)
+{
+  StatsScope scope(stats_hook, true, 0);
+  std::string result;
+  StringSink sink(result);
+  Encoder encoder(sink, true);
 
-        case L'\t':
-          dest << L"\\t";
-          break;
+  if (flags & ENCODE_PARALLEL)
+    encoder.set_parallel(get_threads(), range_items);
 
-        default:
-          if (!iswprint(*it))
-            {
-              dest << L"\\u";
-              hex(dest, (short)(*it & 0xFFFF));
-            }
-          else
-            dest << *it;
+  encoder.value(value);
+  encoder.flush();
 
-          break;
-        }
-    }
+  // The output is pure ASCII
+  dest.assign(result.begin(), result.end());
+  scope.set_bytes_out(dest.size() * sizeof(wchar_t));
 }
 
-int
-JsonHandler::decode_integer(const wchar_t *data, int &pos)
+void
+JsonHandler::encode(std::string &dest, const Value &value, int flags)
 {
-  int res = 0;
+  StatsScope scope(stats_hook, true, 0);
 
-  while (data[pos] && iswdigit(data[pos]))
+  dest.clear();
+
+  if (utf8)
     {
-      res = res * 10 + data[pos] - '0';
-      ++pos;
+      StringSink sink(dest);
+      Encoder encoder(sink, false);
+
+      if (flags & ENCODE_PARALLEL)
+        encoder.set_parallel(get_threads(), range_items);
+
+      encoder.value(value);
+      encoder.flush();
+      scope.set_bytes_out(dest.size());
+      return;
     }
 
-  return res;
+  std::wstring result;
+  encode(result, value, flags);
+  get_codec().encode(dest, result);
+  scope.set_bytes_out(dest.size());
 }
 
-bool
-JsonHandler::compare_forward(const wchar_t *data, int &pos, const wchar_t *expected)
+void
+JsonHandler::encode(Sink &dest, const Value &value, int flags)
 {
-  int datapos = pos;
-  int exppos = 0;
-
-  while (data[datapos] && expected[exppos] && data[datapos] == expected[exppos])
-    {
-      datapos++;
-      exppos++;
-    }
+  StatsScope scope(stats_hook, true, 0);
+  Encoder encoder(dest, !utf8);
 
-  if (expected[exppos] == L'\0')
-    {
-      pos = datapos;
-      return true;
-    }
+  if (flags & ENCODE_PARALLEL)
+    encoder.set_parallel(get_threads(), range_items);
 
-  return false;
+  encoder.value(value);
+  encoder.flush();
+  scope.set_bytes_out(encoder.get_written());
 }
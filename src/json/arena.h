@@ -0,0 +1,216 @@
+/**
+ * @file
+ */
+#ifndef JSON_ARENA_H_INCLUDE
+#define JSON_ARENA_H_INCLUDE
+
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+
+#include <stddef.h>
+
+#include <json/stats.h>
+
+namespace Json
+{
+
+  /**
+   * Source of the memory of strings and containers. This is the standard
+   * polymorphic memory resource, so that the standard pools can be used as
+   * well as custom ones: std::pmr::unsynchronized_pool_resource for a
+   * thread, or a resource per request, avoid the contention of the global
+   * heap in threaded programs.
+   */
+  typedef std::pmr::memory_resource MemoryResource;
+
+  /**
+   * Bump allocator. Memory is carved sequentially out of large blocks and is
+   * only given back all at once, when the arena is cleared or destroyed.
+   * Deallocating a single allocation is a no-op.
+   *
+   * An arena is not thread safe.
+   */
+  class Arena : public MemoryResource
+  {
+  public:
+    /**
+     * Create an empty arena.
+     *
+     * @param block_size Size of the blocks requested from upstream.
+     * @param upstream Resource the blocks are allocated from, the heap if
+     *        it is NULL.
+     */
+    Arena(size_t block_size = 65536, MemoryResource *upstream = NULL);
+
+    /**
+     * Destroy the arena and release all of its memory.
+     */
+    ~Arena();
+
+    /**
+     * Allocate memory from the arena.
+     *
+     * @param size Number of bytes to allocate.
+     * @param align Alignment of the allocation, must be a power of two.
+     * @return Pointer to the allocated memory, never NULL.
+     */
+    inline void *allocate(size_t size, size_t align = sizeof(void *))
+    {
+      char *ptr = (char *)(((size_t)current + align - 1) & ~(align - 1));
+
+      this->size += size;
+
+      if (current && ptr + size <= end)
+        {
+          current = ptr + size;
+          return ptr;
+        }
+
+      return allocate_block(size, align);
+    }
+
+    /**
+     * Release all memory allocated from the arena. Objects living in the
+     * arena are not destroyed.
+     */
+    void clear();
+
+    /**
+     * Get the number of bytes handed out since the last clear.
+     */
+    inline size_t get_size() const
+    { return size; }
+
+    /**
+     * Get the size of the blocks requested from upstream.
+     */
+    inline size_t get_block_size() const
+    { return block_size; }
+
+    /**
+     * Get the resource blocks are allocated from, NULL for the heap.
+     */
+    inline MemoryResource *get_upstream() const
+    { return upstream; }
+
+  protected:
+    void *do_allocate(size_t size, size_t align) override;
+    void do_deallocate(void *ptr, size_t size, size_t align) override;
+    bool do_is_equal(const MemoryResource &other) const noexcept override;
+
+  private:
+    struct Block
+    {
+      Block *next;
+      size_t size;
+    };
+
+    void *allocate_block(size_t size, size_t align);
+    Block *new_block(size_t size);
+
+  private:
+    Arena(const Arena &);
+    Arena &operator=(const Arena &);
+
+  private:
+    MemoryResource *upstream;
+    size_t block_size;
+    size_t size;
+    Block *blocks;
+    char *current;
+    char *end;
+  };
+
+  /**
+   * STL allocator drawing its memory from a MemoryResource, usually an
+   * Arena. A default constructed allocator uses the heap. Containers copied
+   * from a resource container get a heap allocator, so that copies do not
+   * depend on the resource lifetime.
+   *
+   * @tparam _Type Allocated type.
+   */
+  template < class _Type >
+    class Allocator
+    {
+    public:
+      typedef _Type value_type;
+
+      typedef std::true_type propagate_on_container_move_assignment;
+      typedef std::true_type propagate_on_container_swap;
+
+    public:
+      /**
+       * Create an allocator using the heap.
+       */
+      Allocator() throw()
+        : resource(NULL)
+      {
+      }
+
+      /**
+       * Create an allocator using the given resource, or the heap if it is
+       * NULL.
+       */
+      Allocator(MemoryResource *resource) throw()
+        : resource(resource)
+      {
+      }
+
+      template < class _Other >
+        Allocator(const Allocator< _Other > &other) throw()
+          : resource(other.get_resource())
+        {
+        }
+
+      _Type *allocate(size_t count)
+      {
+        Stats::count_allocation(count * sizeof(_Type));
+
+        if (resource)
+          return (_Type *)resource->allocate(count * sizeof(_Type), alignof(_Type));
+
+        return (_Type *)::operator new(count * sizeof(_Type));
+      }
+
+      void deallocate(_Type *ptr, size_t count)
+      {
+        if (resource)
+          resource->deallocate(ptr, count * sizeof(_Type), alignof(_Type));
+        else
+          ::operator delete(ptr);
+      }
+
+      /**
+       * Copies of resource containers are allocated from the heap.
+       */
+      Allocator select_on_container_copy_construction() const
+      {
+        return Allocator();
+      }
+
+      /**
+       * Get the resource, or NULL if the allocator uses the heap.
+       */
+      inline MemoryResource *get_resource() const
+      { return resource; }
+
+    private:
+      MemoryResource *resource;
+    };
+
+  template < class _Type1, class _Type2 >
+    inline bool operator==(const Allocator< _Type1 > &a1, const Allocator< _Type2 > &a2)
+    {
+      return a1.get_resource() == a2.get_resource();
+    }
+
+  template < class _Type1, class _Type2 >
+    inline bool operator!=(const Allocator< _Type1 > &a1, const Allocator< _Type2 > &a2)
+    {
+      return a1.get_resource() != a2.get_resource();
+    }
+
+} // namespace Json
+
+#endif // JSON_ARENA_H_INCLUDE
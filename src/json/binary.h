@@ -0,0 +1,156 @@
+/**
+ * @file
+ */
+#ifndef JSON_BINARY_H_INCLUDE
+#define JSON_BINARY_H_INCLUDE
+
+#include <string>
+
+#include <stddef.h>
+
+#include <json/json.h>
+#include <json/document.h>
+#include <json/sink.h>
+
+namespace Json
+{
+
+  /**
+   * Decoder/encoder of a compact binary form of Value, for the exchanges
+   * between programs which both use this library. Strings are length
+   * prefixed UTF-8 and lists and objects are prefixed with their number of
+   * items, so that decoding copies strings as they are and allocates
+   * containers once. Numbers are not converted to and from text.
+   *
+   * A value is a type byte followed by its contents, with lengths and
+   * counts written as unsigned LEB128 variable length integers:
+   * <ul>
+   *   <li>0x00: null</li>
+   *   <li>0x01: false</li>
+   *   <li>0x02: true</li>
+   *   <li>0x03: integer, zigzag encoded as a variable length integer</li>
+   *   <li>0x04: integer above INT64_MAX, 8 bytes little endian</li>
+   *   <li>0x05: float, IEEE 754 double, 8 bytes little endian</li>
+   *   <li>0x06: string, byte length then UTF-8 bytes</li>
+   *   <li>0x07: list, number of items then the items</li>
+   *   <li>0x08: object, number of members then for every member the byte
+   *       length of the key, the UTF-8 key and the value</li>
+   * </ul>
+   *
+   * The first byte of a value is below any character starting a JSON text,
+   * so that a receiver can tell both forms apart, see is_binary().
+   *
+   * Like JsonHandler, a handler holds no state but its key pool, it can be
+   * shared by several threads if it has none.
+   */
+  class BinaryHandler
+  {
+  public:
+    /**
+     * Create a handler.
+     */
+    BinaryHandler();
+
+    /**
+     * Intern the object keys of decoded values in a pool, see
+     * JsonHandler::set_key_pool().
+     *
+     * @param pool Pool to use, NULL to stop interning keys.
+     */
+    inline void set_key_pool(KeyPool *pool)
+    { this->pool = pool; }
+
+    /**
+     * Get the pool object keys are interned in, NULL if there is none.
+     */
+    inline KeyPool *get_key_pool() const
+    { return pool; }
+
+    /**
+     * Limit the nesting of lists and objects in decoded data, see
+     * JsonHandler::set_max_depth(). Deeper data is rejected with
+     * NestingTooDeep.
+     *
+     * @param depth Maximum depth, 1024 by default, 0 for no limit.
+     */
+    inline void set_max_depth(size_t depth)
+    { this->max_depth = depth; }
+
+    /**
+     * Get the maximum nesting of lists and objects, 0 if there is no limit.
+     */
+    inline size_t get_max_depth() const
+    { return max_depth; }
+
+    /**
+     * Check if a buffer holds a binary value rather than JSON text.
+     */
+    static bool is_binary(const char *data, size_t length);
+
+    /**
+     * Decode a binary value.
+     *
+     * @param data The encoded data.
+     * @param length Length of the data.
+     * @return The decoded value.
+     * @throw ParseError if the data is invalid or truncated, or if it is
+     *        followed by more data.
+     */
+    Value decode(const char *data, size_t length);
+
+    inline Value decode(const std::string &data)
+    { return decode(data.data(), data.size()); }
+
+    /**
+     * Decode a binary value, allocating its strings and containers from the
+     * given memory resource, see JsonHandler::decode().
+     *
+     * @param dest Destination value.
+     * @param resource Resource to allocate from, the heap if it is NULL.
+     * @param data The encoded data.
+     * @param length Length of the data.
+     * @param flags JsonHandler::BORROW_STRINGS lets the strings reference
+     *        the data, which must then outlive the value. The other flags
+     *        are ignored.
+     * @throw ParseError if the data is invalid or truncated, or if it is
+     *        followed by more data.
+     */
+    void decode(Value &dest, MemoryResource *resource, const char *data, size_t length, int flags = 0);
+
+    /**
+     * Decode a binary value into a document. The previous contents of the
+     * document are released.
+     *
+     * @param dest Destination document, its root is set to the decoded value.
+     * @param data The encoded data.
+     * @param length Length of the data.
+     * @param flags JsonHandler::BORROW_STRINGS, see decode().
+     * @throw ParseError if the data is invalid or truncated, or if it is
+     *        followed by more data.
+     */
+    void decode(Document &dest, const char *data, size_t length, int flags = 0);
+
+    /**
+     * Encode a value.
+     *
+     * @param dest Destination string, its previous contents are replaced.
+     * @param value Value object to be encoded.
+     */
+    void encode(std::string &dest, const Value &value);
+
+    /**
+     * Encode a value into a sink, chunk by chunk.
+     *
+     * @param dest Destination of the output.
+     * @param value Value object to be encoded.
+     */
+    void encode(Sink &dest, const Value &value);
+
+  private:
+    KeyPool *pool;
+    size_t max_depth;
+  };
+
+} // namespace Json
+
+#endif // JSON_BINARY_H_INCLUDE
@@ -0,0 +1,642 @@
+/**
+ * @file
+ */
+#ifndef JSON_BINDING_H_INCLUDE
+#define JSON_BINDING_H_INCLUDE
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <json/json.h>
+#include <json/handler.h>
+#include <json/writer.h>
+
+namespace Json
+{
+
+  DEFINE_EXCEPTION_WITH_BASE(BindingError, ParseError);
+
+  /**
+   * Conversions of a C++ type from and to JSON, without going through a
+   * Value. Bindings of the arithmetic types, std::string (UTF-8),
+   * std::wstring, std::vector and Value are built in, structs are bound
+   * with JSON_FIELDS():
+   *
+   * @code
+   * struct Point
+   * {
+   *   int x;
+   *   int y;
+   *   std::string label;
+   *   std::vector< double > weights;
+   * };
+   *
+   * JSON_FIELDS(Point, x, y, label, weights)
+   *
+   * Point point;
+   * Json::decode_struct(point, json.data(), json.size());
+   * Json::encode_struct(json, point);
+   * @endcode
+   *
+   * The decoder stores the parsed values straight into the struct members.
+   * Members are found by a perfect hash of their names, built once per
+   * struct. Unknown keys are skipped, members missing from the input are
+   * left unchanged, and null resets a member to its default value. A
+   * member given twice keeps the last value.
+   *
+   * Decoding a value which does not fit its member type throws a
+   * BindingError.
+   */
+  struct Binding
+  {
+    /**
+     * Member of a bound struct.
+     */
+    struct Field
+    {
+      const char *name;
+      size_t length;
+      // Address of the member within an object of the struct
+      void *(*member)(void *object);
+      const void *(*const_member)(const void *object);
+      const Binding &(*type)();
+    };
+
+    /**
+     * Set an object to its default value, for null and before filling a
+     * list.
+     */
+    void (*reset)(void *dest);
+
+    // Scalar events, NULL if the type cannot take them
+    void (*boolean)(void *dest, bool value);
+    void (*integer)(void *dest, int64_t value);
+    void (*unsigned_integer)(void *dest, uint64_t value);
+    void (*number)(void *dest, double value);
+    void (*string)(void *dest, const std::wstring &value);
+    void (*utf8_string)(void *dest, const char *data, size_t length);
+
+    /**
+     * Add an item to a list and return it, NULL if the type is not a list.
+     */
+    void *(*append)(void *dest);
+    const Binding &(*item)();
+
+    /**
+     * Write an object of the type.
+     */
+    void (*write)(Writer &writer, const void *src);
+
+    /**
+     * The type is a Value and takes any JSON value.
+     */
+    bool any;
+
+    /**
+     * Members of a struct, empty if the type is not a struct.
+     */
+    std::vector< Field > fields;
+
+    /**
+     * Find a member of a struct by its key.
+     *
+     * @return The member, NULL if there is none with that key.
+     */
+    const Field *find(const wchar_t *key, size_t length) const;
+
+    /**
+     * Create the binding of a struct and the perfect hash of its members.
+     *
+     * @throw BindingError if two members have the same name.
+     */
+    static Binding structure(const Field *fields, size_t count, void (*reset)(void *),
+                             void (*write)(Writer &, const void *));
+
+    /**
+     * Binding without any conversion, to be filled in.
+     */
+    static Binding empty();
+
+    /**
+     * Transcoding of the strings of the bindings.
+     */
+    static void assign(std::string &dest, const std::wstring &value);
+    static void assign(std::wstring &dest, const char *data, size_t length);
+
+  private:
+    // Perfect hash of the member names: slot of a key, 0 if there is no
+    // member with that hash, member index + 1 otherwise
+    std::vector< uint32_t > slots;
+    uint32_t seed;
+  };
+
+  /**
+   * Binding of a type, see Binding. Structs are bound with JSON_FIELDS(),
+   * which defines the function found here by argument dependent lookup.
+   *
+   * @tparam _Type Bound type.
+   */
+  template < class _Type, class = void >
+    struct BindingOf
+    {
+      static const Binding &get()
+      {
+        return json_binding((const _Type *)NULL);
+      }
+    };
+
+  template < class _Type >
+    inline void binding_reset(void *dest)
+    {
+      *(_Type *)dest = _Type();
+    }
+
+  template < class _Type >
+    inline void binding_write(Writer &writer, const void *src)
+    {
+      const _Type &object = *(const _Type *)src;
+      const Binding &type = BindingOf< _Type >::get();
+
+      writer.begin_object();
+
+      for (size_t i = 0; i < type.fields.size(); ++i)
+        {
+          const Binding::Field &field = type.fields[i];
+
+          writer.key(field.name, field.length);
+          field.type().write(writer, field.const_member(&object));
+        }
+
+      writer.end_object();
+    }
+
+  template < class _Type, class _Member, _Member _Type::*_Pointer >
+    inline Binding::Field binding_field(const char *name)
+    {
+      Binding::Field field = {
+        name,
+        std::char_traits< char >::length(name),
+        [](void *object) -> void * { return &(((_Type *)object)->*_Pointer); },
+        [](const void *object) -> const void * { return &(((const _Type *)object)->*_Pointer); },
+        &BindingOf< _Member >::get,
+      };
+
+      return field;
+    }
+
+  template <>
+    struct BindingOf< bool >
+    {
+      static const Binding &get()
+      {
+        static const Binding binding = make();
+        return binding;
+      }
+
+    private:
+      static Binding make()
+      {
+        Binding binding = Binding::empty();
+
+        binding.reset = binding_reset< bool >;
+        binding.boolean = [](void *dest, bool value) { *(bool *)dest = value; };
+        binding.write = [](Writer &writer, const void *src) { writer.value(*(const bool *)src); };
+        return binding;
+      }
+    };
+
+  /**
+   * Integers out of the range of the member throw a BindingError, floats
+   * are rounded down as by the Value casts.
+   */
+  template < class _Type >
+    struct BindingOf< _Type, typename std::enable_if< std::is_integral< _Type >::value
+                                                      && !std::is_same< _Type, bool >::value >::type >
+    {
+      static const Binding &get()
+      {
+        static const Binding binding = make();
+        return binding;
+      }
+
+    private:
+      typedef std::numeric_limits< _Type > Limits;
+
+      static Binding make()
+      {
+        Binding binding = Binding::empty();
+
+        binding.reset = binding_reset< _Type >;
+
+        binding.integer = [](void *dest, int64_t value)
+          {
+            if (value < 0 ? !Limits::is_signed || value < (int64_t)Limits::min()
+                          : (uint64_t)value > (uint64_t)Limits::max())
+              throw BindingError("Integer out of range");
+
+            *(_Type *)dest = (_Type)value;
+          };
+
+        binding.unsigned_integer = [](void *dest, uint64_t value)
+          {
+            if (value > (uint64_t)Limits::max())
+              throw BindingError("Integer out of range");
+
+            *(_Type *)dest = (_Type)value;
+          };
+
+        binding.number = [](void *dest, double value)
+          {
+            if (!(value >= (double)Limits::min() && value < (double)Limits::max() + 1.0))
+              throw BindingError("Integer out of range");
+
+            *(_Type *)dest = (_Type)value;
+          };
+
+        binding.write = [](Writer &writer, const void *src)
+          {
+            if (Limits::is_signed)
+              writer.value((int64_t)*(const _Type *)src);
+            else
+              writer.value((uint64_t)*(const _Type *)src);
+          };
+
+        return binding;
+      }
+    };
+
+  template < class _Type >
+    struct BindingOf< _Type, typename std::enable_if< std::is_floating_point< _Type >::value >::type >
+    {
+      static const Binding &get()
+      {
+        static const Binding binding = make();
+        return binding;
+      }
+
+    private:
+      static Binding make()
+      {
+        Binding binding = Binding::empty();
+
+        binding.reset = binding_reset< _Type >;
+        binding.integer = [](void *dest, int64_t value) { *(_Type *)dest = (_Type)value; };
+        binding.unsigned_integer = [](void *dest, uint64_t value) { *(_Type *)dest = (_Type)value; };
+        binding.number = [](void *dest, double value) { *(_Type *)dest = (_Type)value; };
+        binding.write = [](Writer &writer, const void *src) { writer.value((double)*(const _Type *)src); };
+        return binding;
+      }
+    };
+
+  template <>
+    struct BindingOf< std::string >
+    {
+      static const Binding &get()
+      {
+        static const Binding binding = make();
+        return binding;
+      }
+
+    private:
+      static Binding make()
+      {
+        Binding binding = Binding::empty();
+
+        binding.reset = binding_reset< std::string >;
+
+        binding.string = [](void *dest, const std::wstring &value)
+          {
+            Binding::assign(*(std::string *)dest, value);
+          };
+
+        binding.utf8_string = [](void *dest, const char *data, size_t length)
+          {
+            ((std::string *)dest)->assign(data, length);
+          };
+
+        binding.write = [](Writer &writer, const void *src)
+          {
+            const std::string &value = *(const std::string *)src;
+            writer.value(value.data(), value.size());
+          };
+
+        return binding;
+      }
+    };
+
+  template <>
+    struct BindingOf< std::wstring >
+    {
+      static const Binding &get()
+      {
+        static const Binding binding = make();
+        return binding;
+      }
+
+    private:
+      static Binding make()
+      {
+        Binding binding = Binding::empty();
+
+        binding.reset = binding_reset< std::wstring >;
+
+        binding.string = [](void *dest, const std::wstring &value)
+          {
+            *(std::wstring *)dest = value;
+          };
+
+        binding.utf8_string = [](void *dest, const char *data, size_t length)
+          {
+            Binding::assign(*(std::wstring *)dest, data, length);
+          };
+
+        binding.write = [](Writer &writer, const void *src) { writer.value(*(const std::wstring *)src); };
+        return binding;
+      }
+    };
+
+  template < class _Item, class _Allocator >
+    struct BindingOf< std::vector< _Item, _Allocator > >
+    {
+      static const Binding &get()
+      {
+        static const Binding binding = make();
+        return binding;
+      }
+
+    private:
+      typedef std::vector< _Item, _Allocator > List;
+
+      static Binding make()
+      {
+        Binding binding = Binding::empty();
+
+        binding.reset = [](void *dest) { ((List *)dest)->clear(); };
+
+        binding.append = [](void *dest) -> void *
+          {
+            List &list = *(List *)dest;
+
+            list.emplace_back();
+            return &list.back();
+          };
+
+        binding.item = &BindingOf< _Item >::get;
+
+        binding.write = [](Writer &writer, const void *src)
+          {
+            const List &list = *(const List *)src;
+            const Binding &item = BindingOf< _Item >::get();
+
+            writer.begin_array();
+
+            for (typename List::const_iterator it = list.begin(); it != list.end(); ++it)
+              item.write(writer, &*it);
+
+            writer.end_array();
+          };
+
+        return binding;
+      }
+    };
+
+  /**
+   * A Value member takes any JSON value, it is decoded as by
+   * JsonHandler::decode().
+   */
+  template <>
+    struct BindingOf< Value >
+    {
+      static const Binding &get()
+      {
+        static const Binding binding = make();
+        return binding;
+      }
+
+    private:
+      static Binding make()
+      {
+        Binding binding = Binding::empty();
+
+        binding.reset = [](void *dest) { ((Value *)dest)->set(); };
+        binding.write = [](Writer &writer, const void *src) { writer.value(*(const Value *)src); };
+        binding.any = true;
+        return binding;
+      }
+    };
+
+  /**
+   * Handler storing the parse events into an object of a bound type.
+   */
+  class BindingReader final : public Handler
+  {
+  public:
+    /**
+     * Create a reader.
+     *
+     * @param dest Destination object.
+     * @param type Binding of the destination type.
+     */
+    BindingReader(void *dest, const Binding &type);
+
+    ~BindingReader();
+
+    /**
+     * Parse UTF-8 JSON into the destination object. Strings without
+     * escape sequences are stored in std::string members without being
+     * transcoded.
+     *
+     * @param json The JSON data.
+     * @param length Length of the data.
+     * @param max_depth Maximum nesting of lists and objects, 0 for no
+     * limit.
+     * @throw ParseError if the input is invalid.
+     * @throw BindingError if a value does not fit its member.
+     */
+    void parse(const char *json, size_t length, size_t max_depth = 1024);
+
+    void null() override;
+    void boolean(bool value) override;
+    void integer(int value) override;
+    void integer64(int64_t value) override;
+    void unsigned_integer64(uint64_t value) override;
+    void number(double value) override;
+    void string(const std::wstring &value) override;
+    void borrowed_string(const char *data, size_t length) override;
+    void key(const std::wstring &key) override;
+    void begin_object() override;
+    void end_object() override;
+    void begin_array() override;
+    void end_array() override;
+
+  private:
+    struct Frame
+    {
+      void *object;
+      const Binding *type;
+    };
+
+    // Get the object the next value is to be stored in, false if the value
+    // is skipped
+    bool slot(void *&dest, const Binding *&type);
+
+    // Start decoding a Value member
+    void begin_value(void *dest);
+
+    static void mismatch() JSON_NORETURN;
+
+  private:
+    BindingReader(const BindingReader &);
+    BindingReader &operator=(const BindingReader &);
+
+  private:
+    void *pending;
+    const Binding *pending_type;
+    // Depth of the skipped value being parsed, 0 if there is none
+    int skipping;
+    std::vector< Frame > stack;
+    // Builder of the Value member being parsed
+    std::unique_ptr< ValueBuilder > builder;
+  };
+
+  /**
+   * Decode UTF-8 JSON into an object of a bound type, see Binding.
+   *
+   * @param dest Destination object.
+   * @param json The JSON data.
+   * @param length Length of the data.
+   * @param max_depth Maximum nesting of lists and objects, including
+   * skipped values, 1024 by default like JsonHandler, 0 for no limit.
+   * @throw ParseError if the input is invalid, NestingTooDeep if it is
+   * nested deeper than max_depth.
+   * @throw BindingError if a value does not fit its member.
+   */
+  template < class _Type >
+    inline void decode_struct(_Type &dest, const char *json, size_t length,
+                              size_t max_depth = 1024)
+    {
+      BindingReader reader(&dest, BindingOf< _Type >::get());
+      reader.parse(json, length, max_depth);
+    }
+
+  template < class _Type >
+    inline void decode_struct(_Type &dest, const std::string &json,
+                              size_t max_depth = 1024)
+    {
+      decode_struct(dest, json.data(), json.size(), max_depth);
+    }
+
+  /**
+   * Write an object of a bound type, see Binding.
+   */
+  template < class _Type >
+    inline void write_struct(Writer &writer, const _Type &src)
+    {
+      BindingOf< _Type >::get().write(writer, &src);
+    }
+
+  /**
+   * Encode an object of a bound type into a sink, see Binding.
+   *
+   * @param dest Destination of the output.
+   * @param src Object to encode.
+   * @param flags Writer::Flags.
+   */
+  template < class _Type >
+    inline void encode_struct(Sink &dest, const _Type &src, int flags = 0)
+    {
+      Writer writer(dest, flags);
+
+      write_struct(writer, src);
+      writer.finish();
+    }
+
+  /**
+   * Encode an object of a bound type as UTF-8, see Binding.
+   *
+   * @param dest Destination string, its previous contents are replaced.
+   * @param src Object to encode.
+   * @param flags Writer::Flags.
+   */
+  template < class _Type >
+    inline void encode_struct(std::string &dest, const _Type &src, int flags = 0)
+    {
+      dest.clear();
+
+      StringSink sink(dest);
+      encode_struct(sink, src, flags);
+    }
+
+} // namespace Json
+
+#define JSON_FIELDS_FIELD(_Type, _Name) \
+  ::Json::binding_field< _Type, decltype(_Type::_Name), &_Type::_Name >(#_Name),
+
+#define JSON_FIELDS_1(m, t, a) m(t, a)
+#define JSON_FIELDS_2(m, t, a, ...) m(t, a) JSON_FIELDS_1(m, t, __VA_ARGS__)
+#define JSON_FIELDS_3(m, t, a, ...) m(t, a) JSON_FIELDS_2(m, t, __VA_ARGS__)
+#define JSON_FIELDS_4(m, t, a, ...) m(t, a) JSON_FIELDS_3(m, t, __VA_ARGS__)
+#define JSON_FIELDS_5(m, t, a, ...) m(t, a) JSON_FIELDS_4(m, t, __VA_ARGS__)
+#define JSON_FIELDS_6(m, t, a, ...) m(t, a) JSON_FIELDS_5(m, t, __VA_ARGS__)
+#define JSON_FIELDS_7(m, t, a, ...) m(t, a) JSON_FIELDS_6(m, t, __VA_ARGS__)
+#define JSON_FIELDS_8(m, t, a, ...) m(t, a) JSON_FIELDS_7(m, t, __VA_ARGS__)
+#define JSON_FIELDS_9(m, t, a, ...) m(t, a) JSON_FIELDS_8(m, t, __VA_ARGS__)
+#define JSON_FIELDS_10(m, t, a, ...) m(t, a) JSON_FIELDS_9(m, t, __VA_ARGS__)
+#define JSON_FIELDS_11(m, t, a, ...) m(t, a) JSON_FIELDS_10(m, t, __VA_ARGS__)
+#define JSON_FIELDS_12(m, t, a, ...) m(t, a) JSON_FIELDS_11(m, t, __VA_ARGS__)
+#define JSON_FIELDS_13(m, t, a, ...) m(t, a) JSON_FIELDS_12(m, t, __VA_ARGS__)
+#define JSON_FIELDS_14(m, t, a, ...) m(t, a) JSON_FIELDS_13(m, t, __VA_ARGS__)
+#define JSON_FIELDS_15(m, t, a, ...) m(t, a) JSON_FIELDS_14(m, t, __VA_ARGS__)
+#define JSON_FIELDS_16(m, t, a, ...) m(t, a) JSON_FIELDS_15(m, t, __VA_ARGS__)
+#define JSON_FIELDS_17(m, t, a, ...) m(t, a) JSON_FIELDS_16(m, t, __VA_ARGS__)
+#define JSON_FIELDS_18(m, t, a, ...) m(t, a) JSON_FIELDS_17(m, t, __VA_ARGS__)
+#define JSON_FIELDS_19(m, t, a, ...) m(t, a) JSON_FIELDS_18(m, t, __VA_ARGS__)
+#define JSON_FIELDS_20(m, t, a, ...) m(t, a) JSON_FIELDS_19(m, t, __VA_ARGS__)
+#define JSON_FIELDS_21(m, t, a, ...) m(t, a) JSON_FIELDS_20(m, t, __VA_ARGS__)
+#define JSON_FIELDS_22(m, t, a, ...) m(t, a) JSON_FIELDS_21(m, t, __VA_ARGS__)
+#define JSON_FIELDS_23(m, t, a, ...) m(t, a) JSON_FIELDS_22(m, t, __VA_ARGS__)
+#define JSON_FIELDS_24(m, t, a, ...) m(t, a) JSON_FIELDS_23(m, t, __VA_ARGS__)
+#define JSON_FIELDS_25(m, t, a, ...) m(t, a) JSON_FIELDS_24(m, t, __VA_ARGS__)
+#define JSON_FIELDS_26(m, t, a, ...) m(t, a) JSON_FIELDS_25(m, t, __VA_ARGS__)
+#define JSON_FIELDS_27(m, t, a, ...) m(t, a) JSON_FIELDS_26(m, t, __VA_ARGS__)
+#define JSON_FIELDS_28(m, t, a, ...) m(t, a) JSON_FIELDS_27(m, t, __VA_ARGS__)
+#define JSON_FIELDS_29(m, t, a, ...) m(t, a) JSON_FIELDS_28(m, t, __VA_ARGS__)
+#define JSON_FIELDS_30(m, t, a, ...) m(t, a) JSON_FIELDS_29(m, t, __VA_ARGS__)
+#define JSON_FIELDS_31(m, t, a, ...) m(t, a) JSON_FIELDS_30(m, t, __VA_ARGS__)
+#define JSON_FIELDS_32(m, t, a, ...) m(t, a) JSON_FIELDS_31(m, t, __VA_ARGS__)
+
+#define JSON_FIELDS_COUNT(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, \
+                          _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, \
+                          _31, _32, count, ...) JSON_FIELDS_ ## count
+#define JSON_FIELDS_EACH(m, t, ...) \
+  JSON_FIELDS_COUNT(__VA_ARGS__, 32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, \
+                    16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1)(m, t, __VA_ARGS__)
+
+/**
+ * Bind the members of a struct to the keys of a JSON object of the same
+ * names, in that order when encoding, see Json::Binding. It must be used in
+ * the namespace of the struct, which must be default constructible and
+ * assignable. Up to 32 members are supported.
+ *
+ * @param _Type Struct type.
+ * @param ... Names of the members.
+ */
+#define JSON_FIELDS(_Type, ...) \
+  inline const ::Json::Binding &json_binding(const _Type *) \
+  { \
+    static const ::Json::Binding::Field fields[] = { \
+      JSON_FIELDS_EACH(JSON_FIELDS_FIELD, _Type, __VA_ARGS__) \
+    }; \
+    static const ::Json::Binding binding = \
+      ::Json::Binding::structure(fields, sizeof(fields) / sizeof(fields[0]), \
+                                 ::Json::binding_reset< _Type >, ::Json::binding_write< _Type >); \
+    return binding; \
+  }
+
+#endif // JSON_BINDING_H_INCLUDE
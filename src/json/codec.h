@@ -10,16 +10,59 @@ namespace Json
 
   DEFINE_EXCEPTION(CodecException);
 
+  /**
+   * Converter between an encoding and wide strings. UTF-8, UTF-16LE,
+   * UTF-16BE, UTF-32LE and UTF-32BE are converted natively, other encodings
+   * go through iconv. A codec keeps conversion state and must not be used by
+   * several threads at the same time.
+   */
   class Codec
   {
   public:
+    /**
+     * Create a codec.
+     *
+     * @throw CodecException if the encoding is not supported.
+     */
     Codec(const char *encoding);
     ~Codec();
 
+    /**
+     * Get the codec of the calling thread for the given encoding. It is
+     * created on first use and kept until the thread exits, so that
+     * converting does not open a new codec every time.
+     *
+     * @throw CodecException if the encoding is not supported.
+     */
+    static Codec &get(const char *encoding);
+
+    /**
+     * Append the conversion of src to dest.
+     *
+     * @throw CodecException if src is invalid, dest is then left unchanged.
+     */
     void decode(std::wstring &dest, const std::string &src);
     void encode(std::string &dest, const std::wstring &src);
 
   private:
+    enum Encoding
+    {
+      ENCODING_ICONV,
+      ENCODING_UTF8,
+      ENCODING_UTF16LE,
+      ENCODING_UTF16BE,
+      ENCODING_UTF32LE,
+      ENCODING_UTF32BE,
+    };
+
+    void convert(std::wstring &dest, const std::string &src);
+    void convert(std::string &dest, const std::wstring &src);
+
+    Codec(const Codec &);
+    Codec &operator=(const Codec &);
+
+  private:
+    Encoding encoding;
     void *internal_decode;
     void *internal_encode;
   };
@@ -0,0 +1,102 @@
+/**
+ * @file
+ */
+#ifndef JSON_DOCUMENT_H_INCLUDE
+#define JSON_DOCUMENT_H_INCLUDE
+
+#include <vector>
+
+#include <json/value.h>
+#include <json/arena.h>
+#include <json/file.h>
+
+namespace Json
+{
+
+  /**
+   * Owner of a decoded JSON value tree. All strings and containers decoded
+   * into a document are allocated from its arena, so that building the tree
+   * does not go through the heap and tearing it down releases the memory in
+   * a few large blocks.
+   *
+   * Values of the tree must not outlive the document. Copying a value out of
+   * the document produces an independent, heap allocated copy.
+   */
+  class Document
+  {
+  public:
+    /**
+     * Create an empty document, its root value is null.
+     *
+     * @param block_size Size of the arena blocks.
+     * @param upstream Resource the arena blocks are allocated from, the heap
+     *        if it is NULL.
+     */
+    Document(size_t block_size = 65536, MemoryResource *upstream = NULL);
+
+    /**
+     * Destroy the document along with its value tree.
+     */
+    ~Document();
+
+    /**
+     * Get the root value of the document.
+     */
+    inline Value &get_root()
+    { return root; }
+
+    /**
+     * Get the root value of the document.
+     */
+    inline const Value &get_root() const
+    { return root; }
+
+    /**
+     * Get the arena values of the document are allocated from.
+     */
+    inline Arena &get_arena()
+    { return arena; }
+
+    /**
+     * Create another arena owned by the document, like the first one, for
+     * values built by another thread while the first arena is in use. The
+     * arena is released by clear().
+     */
+    Arena &add_arena();
+
+    /**
+     * Give the document the ownership of the file its values were decoded
+     * from, so that the file stays mapped as long as the values exist. The
+     * file is released by clear().
+     *
+     * @param file Mapped file, or NULL.
+     */
+    void set_source(MappedFile *file);
+
+    /**
+     * Get the file owned by the document, NULL if there is none.
+     */
+    inline const MappedFile *get_source() const
+    { return source; }
+
+    /**
+     * Destroy the value tree and release the arena memory, so that the
+     * document can be reused.
+     */
+    void clear();
+
+  private:
+    Document(const Document &);
+    Document &operator=(const Document &);
+
+  private:
+    Arena arena;
+    // Arenas of the other threads, see add_arena()
+    std::vector< Arena * > arenas;
+    Value root;
+    MappedFile *source;
+  };
+
+} // namespace Json
+
+#endif // JSON_DOCUMENT_H_INCLUDE
@@ -0,0 +1,70 @@
+/**
+ * @file
+ */
+#ifndef JSON_FILE_H_INCLUDE
+#define JSON_FILE_H_INCLUDE
+
+#include <stddef.h>
+
+#include <json/exception.h>
+
+namespace Json
+{
+
+  DEFINE_EXCEPTION(IOError);
+
+  /**
+   * Read only view of the contents of a file. Regular files are mapped in
+   * memory, other files (pipes, character devices) are read into a buffer.
+   */
+  class MappedFile
+  {
+  public:
+    /**
+     * Map a file.
+     *
+     * @param path Path of the file.
+     * @throw IOError if the file can not be opened or read.
+     */
+    MappedFile(const char *path);
+
+    /**
+     * Unmap the file.
+     */
+    ~MappedFile();
+
+    /**
+     * Get the contents of the file, they are not NUL terminated.
+     */
+    inline const char *get_data() const
+    { return data; }
+
+    /**
+     * Get the size of the file.
+     */
+    inline size_t get_size() const
+    { return size; }
+
+    /**
+     * Check if the contents are mapped rather than copied in a buffer.
+     */
+    inline bool is_mapped() const
+    { return mapped; }
+
+  private:
+    // Read the whole file in a buffer, returns 0 or the error number
+    int read(int fd);
+
+  private:
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+
+  private:
+    char *data;
+    size_t size;
+    bool mapped;
+  };
+
+} // namespace Json
+
+#endif // JSON_FILE_H_INCLUDE
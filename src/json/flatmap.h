@@ -0,0 +1,317 @@
+/**
+ * @file
+ */
+#ifndef JSON_FLATMAP_H_INCLUDE
+#define JSON_FLATMAP_H_INCLUDE
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Json
+{
+
+  /**
+   * Associative container keeping its entries in insertion order in a single
+   * vector. Small maps are searched linearly, which beats a tree or a hash
+   * table below a few dozen keys; above index_threshold entries an open
+   * addressing hash index is built next to the vector.
+   *
+   * The interface is the subset of std::map used for JSON objects. Unlike
+   * std::map, iteration follows insertion order, any insertion may
+   * invalidate iterators and erasing is linear in the size of the map.
+   * Keys must not be modified through iterators.
+   *
+   * Lookups take anything the keys can be compared with and _Hash accepts,
+   * to find entries without building a key.
+   *
+   * @tparam _Key Key type.
+   * @tparam _Mapped Mapped type.
+   * @tparam _Alloc Allocator of the entries, rebound for the index.
+   * @tparam _Hash Hash function of the keys.
+   */
+  template < class _Key, class _Mapped,
+             class _Alloc = std::allocator< std::pair< _Key, _Mapped > >,
+             class _Hash = std::hash< _Key > >
+    class FlatMap
+    {
+    public:
+      typedef _Key key_type;
+      typedef _Mapped mapped_type;
+      typedef std::pair< _Key, _Mapped > value_type;
+      typedef _Alloc allocator_type;
+      typedef size_t size_type;
+
+    private:
+      typedef std::vector< value_type, allocator_type > Entries;
+      typedef typename std::allocator_traits< _Alloc >::template rebind_alloc< uint32_t > IndexAllocator;
+      typedef std::vector< uint32_t, IndexAllocator > Index;
+
+    public:
+      typedef typename Entries::iterator iterator;
+      typedef typename Entries::const_iterator const_iterator;
+
+      /**
+       * Number of entries above which lookups go through a hash index.
+       */
+      static const size_t index_threshold = 16;
+
+    public:
+      FlatMap()
+      {
+      }
+
+      explicit FlatMap(const allocator_type &allocator)
+        : entries(allocator), index(IndexAllocator(allocator))
+      {
+      }
+
+      FlatMap(const FlatMap &other) = default;
+      FlatMap(FlatMap &&other) = default;
+      FlatMap &operator=(const FlatMap &other) = default;
+      FlatMap &operator=(FlatMap &&other) = default;
+
+      inline iterator begin()
+      { return entries.begin(); }
+
+      inline iterator end()
+      { return entries.end(); }
+
+      inline const_iterator begin() const
+      { return entries.begin(); }
+
+      inline const_iterator end() const
+      { return entries.end(); }
+
+      inline size_t size() const
+      { return entries.size(); }
+
+      inline bool empty() const
+      { return entries.empty(); }
+
+      inline allocator_type get_allocator() const
+      { return entries.get_allocator(); }
+
+      /**
+       * Find the entry of a key.
+       *
+       * @return Iterator to the entry, or end() if there is none.
+       */
+      template < class _Other >
+        iterator find(const _Other &key)
+        {
+          return entries.begin() + position(key);
+        }
+
+      template < class _Other >
+        const_iterator find(const _Other &key) const
+        {
+          return entries.begin() + position(key);
+        }
+
+      template < class _Other >
+        inline size_t count(const _Other &key) const
+        { return position(key) != entries.size(); }
+
+      /**
+       * Insert an entry, unless the key is already present.
+       *
+       * @return Iterator to the entry of the key, and true if it was inserted.
+       */
+      std::pair< iterator, bool > insert(value_type &&entry)
+      {
+        size_t pos = position(entry.first);
+
+        if (pos != entries.size())
+          return std::make_pair(entries.begin() + pos, false);
+
+        entries.push_back(std::move(entry));
+        indexed();
+        return std::make_pair(entries.end() - 1, true);
+      }
+
+      std::pair< iterator, bool > insert(const value_type &entry)
+      {
+        return insert(value_type(entry));
+      }
+
+      /**
+       * Get the value of a key, inserting a default value if it is missing.
+       */
+      mapped_type &operator[](const key_type &key)
+      {
+        size_t pos = position(key);
+
+        if (pos != entries.size())
+          return entries[pos].second;
+
+        entries.push_back(value_type(key, mapped_type()));
+        indexed();
+        return entries.back().second;
+      }
+
+      /**
+       * Remove an entry, keeping the order of the others.
+       *
+       * @return Iterator to the entry following the erased one.
+       */
+      iterator erase(const_iterator pos)
+      {
+        size_t offset = pos - entries.begin();
+
+        entries.erase(entries.begin() + offset);
+
+        if (!index.empty())
+          rebuild();
+
+        return entries.begin() + offset;
+      }
+
+      size_t erase(const key_type &key)
+      {
+        size_t pos = position(key);
+
+        if (pos == entries.size())
+          return 0;
+
+        erase(entries.begin() + pos);
+        return 1;
+      }
+
+      /**
+       * Reserve room for count entries.
+       */
+      inline void reserve(size_t count)
+      { entries.reserve(count); }
+
+      void clear()
+      {
+        entries.clear();
+        index.clear();
+      }
+
+      void swap(FlatMap &other)
+      {
+        entries.swap(other.entries);
+        index.swap(other.index);
+      }
+
+    private:
+      // Position of the entry of key, size() if there is none
+      template < class _Other >
+        size_t position(const _Other &key) const
+        {
+          size_t count = entries.size();
+
+          if (index.empty())
+            {
+              for (size_t i = 0; i < count; ++i)
+                if (entries[i].first == key)
+                  return i;
+
+              return count;
+            }
+
+          size_t mask = index.size() - 1;
+
+          for (size_t slot = hash(key) & mask; index[slot]; slot = (slot + 1) & mask)
+            if (entries[index[slot] - 1].first == key)
+              return index[slot] - 1;
+
+          return count;
+        }
+
+      // Add the last entry to the index, building or growing it if needed
+      void indexed()
+      {
+        size_t count = entries.size();
+
+        if (count <= index_threshold)
+          return;
+
+        // The index is kept at most half full
+        if (count * 2 > index.size())
+          {
+            rebuild();
+            return;
+          }
+
+        add(count - 1);
+      }
+
+      void rebuild()
+      {
+        size_t count = entries.size();
+
+        if (count <= index_threshold)
+          {
+            index.clear();
+            return;
+          }
+
+        size_t capacity = 64;
+
+        while (capacity < count * 4)
+          capacity *= 2;
+
+        index.assign(capacity, 0);
+
+        for (size_t i = 0; i < count; ++i)
+          add(i);
+      }
+
+      inline void add(size_t pos)
+      {
+        size_t mask = index.size() - 1;
+        size_t slot = hash(entries[pos].first) & mask;
+
+        while (index[slot])
+          slot = (slot + 1) & mask;
+
+        index[slot] = pos + 1;
+      }
+
+      template < class _Other >
+        static inline size_t hash(const _Other &key)
+        {
+          return _Hash()(key);
+        }
+
+    private:
+      Entries entries;
+      Index index;
+    };
+
+  /**
+   * Maps are equal if they hold the same entries, in any order.
+   */
+  template < class _Key, class _Mapped, class _Alloc, class _Hash >
+    bool operator==(const FlatMap< _Key, _Mapped, _Alloc, _Hash > &m1, const FlatMap< _Key, _Mapped, _Alloc, _Hash > &m2)
+    {
+      if (m1.size() != m2.size())
+        return false;
+
+      for (typename FlatMap< _Key, _Mapped, _Alloc, _Hash >::const_iterator it = m1.begin(); it != m1.end(); ++it)
+        {
+          typename FlatMap< _Key, _Mapped, _Alloc, _Hash >::const_iterator other = m2.find(it->first);
+
+          if (other == m2.end() || !(other->second == it->second))
+            return false;
+        }
+
+      return true;
+    }
+
+  template < class _Key, class _Mapped, class _Alloc, class _Hash >
+    inline bool operator!=(const FlatMap< _Key, _Mapped, _Alloc, _Hash > &m1, const FlatMap< _Key, _Mapped, _Alloc, _Hash > &m2)
+    {
+      return !(m1 == m2);
+    }
+
+} // namespace Json
+
+#endif // JSON_FLATMAP_H_INCLUDE
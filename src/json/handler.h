@@ -0,0 +1,347 @@
+/**
+ * @file
+ */
+#ifndef JSON_HANDLER_H_INCLUDE
+#define JSON_HANDLER_H_INCLUDE
+
+#include <string>
+#include <vector>
+
+#include <json/value.h>
+#include <json/arena.h>
+
+namespace Json
+{
+
+  /**
+   * Receiver of parse events. JsonHandler::parse() reports the JSON values
+   * of the input in document order, without building any Value. The string
+   * references passed to the handler are only valid during the call.
+   *
+   * All events are ignored by default, so that a handler only needs to
+   * override the events it is interested in.
+   */
+  class Handler
+  {
+  public:
+    virtual ~Handler();
+
+    /**
+     * A null value was found.
+     */
+    virtual void null();
+
+    /**
+     * A boolean value was found.
+     */
+    virtual void boolean(bool value);
+
+    /**
+     * An integer number was found.
+     */
+    virtual void integer(int value);
+
+    /**
+     * An integer number out of the int range was found. The default
+     * implementation reports it with number().
+     */
+    virtual void integer64(int64_t value);
+
+    /**
+     * An integer number above INT64_MAX was found. The default
+     * implementation reports it with number().
+     */
+    virtual void unsigned_integer64(uint64_t value);
+
+    /**
+     * A number with a fraction or an exponent was found.
+     */
+    virtual void number(double value);
+
+    /**
+     * A number was found, when the parser keeps numbers as text. The default
+     * implementation converts the text and reports it with the other number
+     * events.
+     *
+     * @param text Text of the number, pointing into the input.
+     * @param length Length of the text.
+     * @param type Type of the converted number, Value::JSON_TYPE_INTEGER or
+     *        Value::JSON_TYPE_FLOAT.
+     */
+    virtual void raw_number(const char *text, size_t length, Value::Type type);
+
+    /**
+     * A string value was found.
+     */
+    virtual void string(const std::wstring &value);
+
+    /**
+     * A string value without escape sequences was found, when the parser
+     * lets strings reference the input. The default implementation
+     * transcodes the string and reports it with string().
+     *
+     * @param data UTF-8 contents of the string, pointing into the input.
+     * @param length Length of the contents in bytes.
+     */
+    virtual void borrowed_string(const char *data, size_t length);
+
+    /**
+     * A nested list or object was found, when the parser leaves them
+     * unparsed. The default implementation parses the text and reports its
+     * contents.
+     *
+     * @param text JSON text of the container, pointing into the input. Only
+     *        its brackets and strings have been checked.
+     * @param length Length of the text.
+     * @param type Value::JSON_TYPE_LIST or Value::JSON_TYPE_OBJECT.
+     * @param offset Position of the text in the input, which the positions
+     *        of its parse errors are relative to.
+     * @param max_depth Maximum nesting of lists and objects in the text,
+     *        counting the container itself, 0 for no limit.
+     */
+    virtual void lazy_container(const char *text, size_t length, Value::Type type, size_t offset,
+                                size_t max_depth);
+
+    /**
+     * The key of an object member was found, the member value follows.
+     */
+    virtual void key(const std::wstring &key);
+
+    /**
+     * An object begins, its members follow as pairs of key and value events.
+     */
+    virtual void begin_object();
+
+    /**
+     * The current object ends.
+     */
+    virtual void end_object();
+
+    /**
+     * A list begins, its items follow.
+     */
+    virtual void begin_array();
+
+    /**
+     * The current list ends.
+     */
+    virtual void end_array();
+  };
+
+  /**
+   * Handler building a Value tree out of the parse events. This is what
+   * JsonHandler::decode() uses.
+   *
+   * As with decode(), the first occurrence of a key in an object wins and
+   * the values of duplicate keys are dropped.
+   */
+  class ValueBuilder final : public Handler
+  {
+  public:
+    /**
+     * Create a builder.
+     *
+     * @param root Value to be set to the parsed value.
+     * @param resource Resource to allocate strings and containers from, the
+     *        heap is used if it is NULL.
+     * @param pool Pool to intern object keys in. If it is NULL, keys are
+     *        only shared within the document.
+     * @param flags JsonHandler::DecodeFlags lazy containers are parsed with.
+     */
+    ValueBuilder(Value &root, MemoryResource *resource = NULL, KeyPool *pool = NULL, int flags = 0)
+      : resource(resource), pool(pool ? pool : &keys), pending(&root), skipping(0), flags(flags)
+    {
+    }
+
+    /**
+     * Create a builder appending every parsed value to a list.
+     *
+     * @param items List the values are appended to.
+     * @param resource Resource to allocate strings and containers from, the
+     *        heap is used if it is NULL.
+     * @param pool Pool to intern object keys in. If it is NULL, keys are
+     *        only shared within the values of the builder.
+     * @param flags JsonHandler::DecodeFlags lazy containers are parsed with.
+     */
+    ValueBuilder(Value::List &items, MemoryResource *resource = NULL, KeyPool *pool = NULL, int flags = 0)
+      : resource(resource), pool(pool ? pool : &keys), pending(NULL), skipping(0), flags(flags)
+    {
+      Frame frame = { &items, NULL };
+      stack.push_back(frame);
+    }
+
+    void null() override
+    {
+      if (Value *dest = slot())
+        dest->set();
+    }
+
+    void boolean(bool value) override
+    {
+      if (Value *dest = slot())
+        dest->set(value);
+    }
+
+    void integer(int value) override
+    {
+      if (Value *dest = slot())
+        dest->set(value);
+    }
+
+    void integer64(int64_t value) override
+    {
+      if (Value *dest = slot())
+        dest->set(value);
+    }
+
+    void unsigned_integer64(uint64_t value) override
+    {
+      if (Value *dest = slot())
+        dest->set(value);
+    }
+
+    void number(double value) override
+    {
+      if (Value *dest = slot())
+        dest->set(value);
+    }
+
+    void raw_number(const char *text, size_t length, Value::Type type) override
+    {
+      if (Value *dest = slot())
+        dest->set_raw_number(text, length, type);
+    }
+
+    void string(const std::wstring &value) override
+    {
+      if (Value *dest = slot())
+        dest->set_string(value.data(), value.size(), resource);
+    }
+
+    void borrowed_string(const char *data, size_t length) override
+    {
+      if (Value *dest = slot())
+        dest->set_borrowed(data, length);
+    }
+
+    void lazy_container(const char *text, size_t length, Value::Type type, size_t offset,
+                        size_t max_depth) override
+    {
+      if (Value *dest = slot())
+        dest->set_lazy(text, length, type, flags, offset, max_depth, resource);
+    }
+
+    void key(const std::wstring &key) override
+    {
+      if (skipping)
+        return;
+
+      Key name = pool->intern(key);
+      std::pair< Value::Object::iterator, bool > inserted =
+        stack.back().object->insert(std::make_pair(std::move(name), Value()));
+
+      pending = (inserted.second ? &inserted.first->second : NULL);
+    }
+
+    void begin_object() override
+    {
+      if (Value *dest = slot())
+        {
+          Frame frame = { NULL, &dest->set_object(resource) };
+          stack.push_back(frame);
+        }
+      else
+        ++skipping;
+    }
+
+    void end_object() override
+    {
+      end();
+    }
+
+    void begin_array() override
+    {
+      if (Value *dest = slot())
+        {
+          Frame frame = { &dest->set_list(resource), NULL };
+          stack.push_back(frame);
+        }
+      else
+        ++skipping;
+    }
+
+    void end_array() override
+    {
+      end();
+    }
+
+    /**
+     * Reserve room for the items or members of the list or object which
+     * just began, when their number is known in advance.
+     */
+    inline void reserve(size_t count)
+    {
+      if (skipping || stack.empty())
+        return;
+
+      if (stack.back().list)
+        stack.back().list->reserve(count);
+#if JSON_FLAT_OBJECTS
+      else
+        stack.back().object->reserve(count);
+#endif
+    }
+
+    /**
+     * Check if a complete value has been built.
+     */
+    inline bool is_complete() const
+    { return stack.empty() && !pending; }
+
+  private:
+    struct Frame
+    {
+      Value::List *list;
+      Value::Object *object;
+    };
+
+    // Get the value the next event is to be stored in, NULL if the event
+    // belongs to a dropped duplicate
+    inline Value *slot()
+    {
+      if (skipping)
+        return NULL;
+
+      if (!stack.empty() && stack.back().list)
+        {
+          Value::List *list = stack.back().list;
+          list->push_back(Value());
+          return &list->back();
+        }
+
+      Value *dest = pending;
+      pending = NULL;
+      return dest;
+    }
+
+    inline void end()
+    {
+      if (skipping)
+        --skipping;
+      else
+        stack.pop_back();
+    }
+
+  private:
+    MemoryResource *resource;
+    KeyPool keys;
+    KeyPool *pool;
+    Value *pending;
+    int skipping;
+    int flags;
+    std::vector< Frame > stack;
+  };
+
+} // namespace Json
+
+#endif // JSON_HANDLER_H_INCLUDE
@@ -4,11 +4,16 @@
 #ifndef JSON_JSON_H_INCLUDE
 #define JSON_JSON_H_INCLUDE
 
-#include <sstream>
-
 #include <json/value.h>
+#include <json/document.h>
+#include <json/handler.h>
+#include <json/file.h>
+#include <json/sink.h>
 #include <json/common.h>
 #include <json/codec.h>
+#include <json/path.h>
+#include <json/tape.h>
+#include <json/stats.h>
 
 namespace Json
 {
@@ -16,19 +21,136 @@ namespace Json
   DEFINE_EXCEPTION(ParseError);
   DEFINE_EXCEPTION_WITH_BASE(InvalidCharacter, ParseError);
   DEFINE_EXCEPTION_WITH_BASE(UnexpectedEof, ParseError);
+  DEFINE_EXCEPTION_WITH_BASE(NestingTooDeep, ParseError);
+
+  /**
+   * Outcome of the decoding functions which report invalid input instead of
+   * throwing it, see JsonHandler::try_decode(). Reporting an error allocates
+   * nothing.
+   */
+  struct ParseResult
+  {
+    enum Code
+    {
+      OK,
+      UNEXPECTED_EOF,
+      INVALID_TOKEN,
+      INVALID_CHARACTER,
+      INVALID_UTF8,
+      INVALID_DIGIT,
+      INVALID_ESCAPE,
+      INVALID_HEX,
+      EXPECTED_KEY,
+      EXPECTED_COLON,
+      INVALID_LIST_END,
+      INVALID_OBJECT_END,
+      // Lists and objects nested deeper than the maximum depth
+      TOO_DEEP,
+      // The input could not be transcoded from the handler encoding
+      INVALID_ENCODING,
+    };
+
+    Code code;
+    // Position of the error in the parsed text, in characters of the
+    // transcoded text for encodings other than UTF-8
+    size_t position;
+
+    ParseResult(Code code = OK, size_t position = 0)
+      : code(code), position(position)
+    {
+    }
+
+    /**
+     * Check if the input was decoded.
+     */
+    inline explicit operator bool() const
+    { return code == OK; }
+
+    /**
+     * Get the message of the error, the one of the exception the throwing
+     * functions raise, without the position.
+     */
+    const char *get_message() const;
+  };
 
   /**
-   * JSON decoder/encoder. While the Value object only stores wide strings, the
-   * JsonHandler object can handle normal strings. These strings will be transcoded
-   * to the proper charsets prior to decoding and after encoding a Value object.
+   * JSON decoder/encoder. The JsonHandler object can handle normal strings,
+   * which are transcoded to the proper charsets prior to decoding and after
+   * encoding a Value object.
+   *
+   * A Value stores a string in one of several forms: a wide string on the
+   * heap, a wide string allocated from a memory resource, borrowed UTF-8
+   * referencing the decoded input (see BORROW_STRINGS), or UTF-8 of up to
+   * 12 bytes stored inline in the value. UTF-8 strings are encoded without
+   * going through wide strings, and only become wide heap strings on their
+   * first access as wide strings. Copying a borrowed string transcodes it to
+   * a wide heap string, so that the copy does not reference the input, while
+   * inline strings are copied as they are.
+   *
+   * A handler holds no conversion state: transcoding goes through the codec
+   * of the calling thread, see Codec::get(). The same handler can thus be
+   * created once and used by several threads at the same time, as long as
+   * its key pool, if any, is not shared.
    */
   class JsonHandler
   {
+  public:
+    /**
+     * Options of the decoding functions working on a buffer. Values may
+     * reference the buffer, which must then outlive them.
+     */
+    enum DecodeFlags
+    {
+      /**
+       * Strings without escape sequences reference the buffer instead of
+       * being copied.
+       */
+      BORROW_STRINGS = 1,
+
+      /**
+       * Numbers are kept as references to their text, which is only
+       * converted when they are accessed and is encoded unchanged, see
+       * Value::set_raw_number().
+       */
+      RAW_NUMBERS = 2,
+
+      /**
+       * Lists and objects nested in the root value are kept as references
+       * to their text, which is only parsed when they are cast to a list or
+       * an object, see Value::set_lazy(). Containers which are never
+       * accessed cost a bracket scan.
+       */
+      LAZY_CONTAINERS = 4,
+
+      /**
+       * A root list is decoded on several threads, see set_parallel(). The
+       * items are split into ranges by a scan of their brackets and strings,
+       * the ranges are decoded into arenas of their threads and the items
+       * are then moved into the root list, in order. Only decoding into a
+       * Document supports it.
+       */
+      PARALLEL = 8,
+    };
+
+    /**
+     * Options of the encoding functions.
+     */
+    enum EncodeFlags
+    {
+      /**
+       * Lists and objects with many items are encoded on several threads,
+       * see set_parallel(). Ranges of items are encoded into separate
+       * buffers, which are written out in order as they are ready.
+       */
+      ENCODE_PARALLEL = 1,
+    };
+
   public:
     /**
      * Create and initialize a JsonHandler.
      *
      * @param encoding Encoding of non-multi byte strings.
+     * @throw CodecException if the encoding is not supported.
      */
     JsonHandler(const char *encoding = "UTF-8");
 
@@ -37,6 +159,73 @@ namespace Json
      */
     ~JsonHandler();
 
+    /**
+     * Intern the object keys of decoded values in a pool, so that documents
+     * with the same keys share them. The pool must not be used by another
+     * thread at the same time, a handler with a pool is therefore not thread
+     * safe.
+     *
+     * @param pool Pool to use, NULL to stop interning keys.
+     */
+    inline void set_key_pool(KeyPool *pool)
+    { this->pool = pool; }
+
+    /**
+     * Get the pool object keys are interned in, NULL if there is none.
+     */
+    inline KeyPool *get_key_pool() const
+    { return pool; }
+
+    /**
+     * Set up the decoding of lists with the PARALLEL flag and the encoding
+     * of lists and objects with the ENCODE_PARALLEL flag. The decoding
+     * threads do not use the key pool, keys are only shared within the items
+     * a thread decodes at once.
+     *
+     * @param threads Number of threads, 0 for one per processor.
+     * @param range_size Number of bytes from which a decoding thread is
+     *        given a range of items. Smaller lists are decoded by the
+     *        calling thread.
+     * @param range_items Number of items of the ranges given to encoding
+     *        threads. Lists and objects with fewer than two ranges of items
+     *        are encoded by the calling thread.
+     */
+    void set_parallel(unsigned threads, size_t range_size = 1 << 20, size_t range_items = 4096);
+
+    /**
+     * Limit the nesting of lists and objects in decoded and parsed input.
+     * Deeper input is rejected with NestingTooDeep, or TOO_DEEP by
+     * try_decode(), at the bracket going over the limit. The parser does
+     * not recurse, but destroying, copying and encoding values does.
+     *
+     * @param depth Maximum depth, 1024 by default, 0 for no limit.
+     */
+    inline void set_max_depth(size_t depth)
+    { this->max_depth = depth; }
+
+    /**
+     * Get the maximum nesting of lists and objects, 0 if there is no limit.
+     */
+    inline size_t get_max_depth() const
+    { return max_depth; }
+
+    /**
+     * Report the statistics of every decoding, parsing, query and encoding
+     * call to a hook, see Stats. Nothing is reported unless the library is
+     * configured with --enable-stats, and calls without a hook cost a
+     * pointer check.
+     *
+     * @param hook Hook to report to, NULL to stop reporting.
+     */
+    inline void set_stats_hook(StatsHook *hook)
+    { this->stats_hook = hook; }
+
+    /**
+     * Get the hook statistics are reported to, NULL if there is none.
+     */
+    inline StatsHook *get_stats_hook() const
+    { return stats_hook; }
+
     /**
      * Decode a JSON string. The string will be decoded with the given encoding.
      *
@@ -45,6 +234,17 @@ namespace Json
      */
     Value decode(const std::string &json);
 
+    /**
+     * Decode a C-style JSON string. The string will be decoded with the given
+     * encoding. UTF-8 input is parsed directly without being transcoded to a
+     * wide string first.
+     *
+     * @param json The JSON data in the encoding given previously to JsonHandler.
+     * @param len Length of the data, or -1 if it is NUL terminated.
+     * @return The decoded JSON value.
+     */
+    Value decode(const char *json, int len = -1);
+
     /**
      * Decode a JSON string.
      *
@@ -53,54 +253,237 @@ namespace Json
      */
     Value decode(const std::wstring &json);
 
+    /**
+     * Decode a JSON string into a document. The string will be decoded with
+     * the given encoding. The previous contents of the document are released.
+     *
+     * @param dest Destination document, its root is set to the decoded value.
+     * @param json The JSON data in the encoding given previously to JsonHandler.
+     */
+    void decode(Document &dest, const std::string &json);
+
+    /**
+     * Decode a JSON string into a document. The previous contents of the
+     * document are released.
+     *
+     * @param dest Destination document, its root is set to the decoded value.
+     * @param json The JSON data.
+     */
+    void decode(Document &dest, const std::wstring &json);
+
+    /**
+     * Decode a JSON buffer into a document. The buffer will be decoded with
+     * the given encoding. The previous contents of the document are released.
+     *
+     * With UTF-8 input, strings without escape sequences and numbers can
+     * reference the buffer instead of being copied or converted, see
+     * DecodeFlags. Most strings of a typical document are then decoded
+     * without any allocation. The buffer must outlive the document values in
+     * that case.
+     *
+     * @param dest Destination document, its root is set to the decoded value.
+     * @param json The JSON data in the encoding given previously to JsonHandler.
+     * @param length Length of the data.
+     * @param flags Combination of DecodeFlags.
+     */
+    void decode(Document &dest, const char *json, size_t length, int flags = 0);
+
+    /**
+     * Decode a JSON buffer into a value, allocating its strings and
+     * containers from the given memory resource: an Arena, a pool of the
+     * standard library like std::pmr::unsynchronized_pool_resource kept by
+     * the calling thread, or a custom one. The previous contents of dest are
+     * released.
+     *
+     * The resource must outlive the decoded values. Moving them keeps them
+     * in the resource, copying them gives heap allocated copies.
+     *
+     * @param dest Destination value.
+     * @param resource Resource to allocate from, the heap if it is NULL.
+     * @param json The JSON data in the encoding given previously to JsonHandler.
+     * @param length Length of the data.
+     * @param flags Combination of DecodeFlags.
+     */
+    void decode(Value &dest, MemoryResource *resource, const char *json, size_t length, int flags = 0);
+
+    /**
+     * Decode a JSON buffer into a document, reporting invalid input instead
+     * of throwing it. Rejecting a payload costs no more than parsing it up to
+     * the error, which suits untrusted input of which a good part is
+     * invalid. The previous contents of the document are released.
+     *
+     * Only running out of memory, and the errors of the Codec for encodings
+     * other than UTF-8, which are caught and reported as INVALID_ENCODING,
+     * throw. The PARALLEL flag is ignored.
+     *
+     * @param dest Destination document, its root is null if the data is
+     *        invalid.
+     * @param json The JSON data in the encoding given previously to JsonHandler.
+     * @param length Length of the data.
+     * @param flags Combination of DecodeFlags.
+     * @return The error, which converts to false, or OK.
+     */
+    ParseResult try_decode(Document &dest, const char *json, size_t length, int flags = 0);
+
+    /**
+     * Decode a JSON buffer into a value, reporting invalid input instead of
+     * throwing it, see try_decode(Document &, const char *, size_t, int)
+     * and decode(Value &, MemoryResource *, const char *, size_t, int).
+     *
+     * @param dest Destination value, null if the data is invalid.
+     */
+    ParseResult try_decode(Value &dest, MemoryResource *resource, const char *json, size_t length,
+                           int flags = 0);
+
+    /**
+     * Decode a JSON buffer into a read-only tape, which is cheaper to build,
+     * to hold and to traverse than a Value tree, see Tape. The buffer will be
+     * decoded with the given encoding. The previous contents of the tape are
+     * released, and its memory reused.
+     *
+     * @param dest Destination tape, it holds null if the data is invalid.
+     * @param json The JSON data in the encoding given previously to JsonHandler.
+     * @param length Length of the data.
+     */
+    void decode(Tape &dest, const char *json, size_t length);
+
+    inline void decode(Tape &dest, const std::string &json)
+    { decode(dest, json.data(), json.size()); }
+
+    /**
+     * Decode a JSON file. The file is mapped in memory and parsed directly
+     * from the mapping. The file will be decoded with the given encoding.
+     *
+     * @param path Path of the file.
+     * @return The decoded JSON value.
+     * @throw IOError if the file can not be read.
+     */
+    Value decode_file(const char *path);
+
+    /**
+     * Decode a JSON file into a document. The previous contents of the
+     * document are released.
+     *
+     * @param dest Destination document, its root is set to the decoded value.
+     * @param path Path of the file.
+     * @param flags Combination of DecodeFlags. If values may reference the
+     *        file, it stays mapped for the lifetime of the document instead
+     *        of being unmapped once decoded.
+     * @throw IOError if the file can not be read.
+     */
+    void decode_file(Document &dest, const char *path, int flags = 0);
+
+    /**
+     * Find the first value matching a path in a JSON buffer, decoding only
+     * that value. The input is scanned up to the match, the values on the
+     * way are skipped after only checking their brackets and strings.
+     *
+     * @param dest Destination value, only set if a value matches.
+     * @param json The JSON data in the encoding given previously to JsonHandler.
+     * @param length Length of the data.
+     * @param path JSON Pointer or JSONPath of the value, see Json::Path.
+     * @return true if a value matches.
+     */
+    bool query(Value &dest, const char *json, size_t length, const Path &path);
+
+    inline bool query(Value &dest, const std::string &json, const Path &path)
+    { return query(dest, json.data(), json.size(), path); }
+
+    /**
+     * Find the first value matching a path in a JSON string.
+     *
+     * @return The matching value, null if there is none.
+     */
+    Value query(const std::string &json, const Path &path);
+
+    /**
+     * Find all the values matching a path in a JSON buffer, decoding only
+     * them.
+     *
+     * @param dest List the matching values are appended to, in document
+     *        order.
+     * @param json The JSON data in the encoding given previously to JsonHandler.
+     * @param length Length of the data.
+     * @param path JSON Pointer or JSONPath of the values, see Json::Path.
+     * @return Number of matching values.
+     */
+    size_t query_all(Value::List &dest, const char *json, size_t length, const Path &path);
+
+    inline size_t query_all(Value::List &dest, const std::string &json, const Path &path)
+    { return query_all(dest, json.data(), json.size(), path); }
+
+    /**
+     * Parse a JSON string without building a value tree. The values found
+     * are reported to the handler in document order, with strings only
+     * existing for the duration of the event. The string will be decoded
+     * with the given encoding.
+     *
+     * @param json The JSON data in the encoding given previously to JsonHandler.
+     * @param handler Receiver of the parse events.
+     */
+    void parse(const std::string &json, Handler &handler);
+
+    /**
+     * Parse a JSON string without building a value tree.
+     *
+     * @param json The JSON data.
+     * @param handler Receiver of the parse events.
+     */
+    void parse(const std::wstring &json, Handler &handler);
+
     /**
      * Encode a JSON string. The string will be encoded with the given encoding.
+     * Infinite and NaN numbers, such as the ones decoded from numbers out of
+     * the double range, are encoded as null.
      *
      * @param dest Destination string.
      * @param value Value object to be encoded.
+     * @param flags Combination of EncodeFlags.
      */
-    void encode(std::string &dest, const Value &value);
+    void encode(std::string &dest, const Value &value, int flags = 0);
 
     /**
      * Encode a JSON string.
      *
      * @param dest Destination string.
      * @param value Value object to be encoded.
+     * @param flags Combination of EncodeFlags.
      */
-    void encode(std::wstring &dest, const Value &value);
+    void encode(std::wstring &dest, const Value &value, int flags = 0);
 
-  private:
-    Value decode_value(const wchar_t *data, int &pos);
-    Value decode_string(const wchar_t *data, int &pos);
-    Value decode_number(const wchar_t *data, int &pos);
-    Value decode_array(const wchar_t *data, int &pos);
-    Value decode_object(const wchar_t *data, int &pos);
+    /**
+     * Encode a JSON string into a sink, chunk by chunk. The output is UTF-8
+     * if the handler encoding is UTF-8, pure ASCII with \\u escapes
+     * otherwise.
+     *
+     * @param dest Destination of the output.
+     * @param value Value object to be encoded.
+     * @param flags Combination of EncodeFlags.
+     */
+    void encode(Sink &dest, const Value &value, int flags = 0);
 
-    void encode(std::wstringstream &dest, const Value &value);
+  private:
+    void query(Value::List &dest, const char *json, size_t length, const Path &path, size_t limit);
 
-    wchar_t unescape(const wchar_t *data, int &pos);
-    void escape(std::wstringstream &dest, const std::wstring &value);
-    int decode_integer(const wchar_t *data, int &pos);
+    void decode_parallel(Document &dest, const char *json, size_t length, int flags);
 
-    bool compare_forward(const wchar_t *data, int &pos, const wchar_t *expect);
+    inline Codec &get_codec() const
+    { return Codec::get(encoding.c_str()); }
 
-  private:
-    template < class _Exception >
-      void raise_error(const char *message, int position) JSON_NORETURN;
+    // Number of threads of the parallel modes
+    unsigned get_threads() const;
 
   private:
-    Codec codec;
+    std::string encoding;
+    bool utf8;
+    KeyPool *pool;
+    unsigned threads;
+    size_t range_size;
+    size_t range_items;
+    size_t max_depth;
+    StatsHook *stats_hook;
   };
 
-  template < class _Exception >
-    void JsonHandler::raise_error(const char *message, int position)
-    {
-      std::stringstream str;
-      str << message << " at " << position;
-
-      throw _Exception(str.str().c_str());
-    }
-
 } // namespace Json
 
 #endif // JSON_H_INCLUDE
@@ -0,0 +1,251 @@
+/**
+ * @file
+ */
+#ifndef JSON_KEY_H_INCLUDE
+#define JSON_KEY_H_INCLUDE
+
+#include <atomic>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <stddef.h>
+#include <wchar.h>
+
+namespace Json
+{
+
+  /**
+   * Hash of a wide string, the same as std::hash< std::wstring >.
+   */
+  size_t hash_key(const wchar_t *data, size_t length);
+
+  /**
+   * Immutable string used as object key. Copies share the characters, and
+   * keys interned by a KeyPool share them across objects and documents, so
+   * that comparing two such keys is a pointer comparison.
+   *
+   * A key converts to a const std::wstring reference and can be compared and
+   * ordered against wide strings.
+   */
+  class Key
+  {
+  public:
+    /**
+     * Create an empty key.
+     */
+    Key();
+
+    Key(const std::wstring &text);
+    Key(std::wstring &&text);
+    Key(const wchar_t *text);
+
+    Key(const Key &other) noexcept
+      : symbol(other.symbol)
+    {
+      ++symbol->references;
+    }
+
+    /**
+     * Take over the characters of other, which can then only be assigned to
+     * or destroyed.
+     */
+    Key(Key &&other) noexcept
+      : symbol(other.symbol)
+    {
+      other.symbol = NULL;
+    }
+
+    ~Key()
+    {
+      if (symbol && --symbol->references == 0)
+        delete symbol;
+    }
+
+    Key &operator=(const Key &other) noexcept
+    {
+      Key temp(other);
+      std::swap(symbol, temp.symbol);
+      return *this;
+    }
+
+    Key &operator=(Key &&other) noexcept
+    {
+      std::swap(symbol, other.symbol);
+      return *this;
+    }
+
+    inline const std::wstring &str() const
+    { return symbol->text; }
+
+    inline operator const std::wstring &() const
+    { return symbol->text; }
+
+    inline const wchar_t *data() const
+    { return symbol->text.data(); }
+
+    inline const wchar_t *c_str() const
+    { return symbol->text.c_str(); }
+
+    inline size_t size() const
+    { return symbol->text.size(); }
+
+    inline bool empty() const
+    { return symbol->text.empty(); }
+
+    /**
+     * Get the hash of the key, computed once when it is created.
+     */
+    inline size_t hash() const
+    { return symbol->hash; }
+
+    /**
+     * Check if both keys share their characters.
+     */
+    inline bool same(const Key &other) const
+    { return symbol == other.symbol; }
+
+  private:
+    friend class KeyPool;
+
+    struct Symbol
+    {
+      Symbol(std::wstring &&text);
+
+      std::atomic< size_t > references;
+      size_t hash;
+      std::wstring text;
+    };
+
+    Key(Symbol *symbol)
+      : symbol(symbol)
+    {
+      ++symbol->references;
+    }
+
+  private:
+    Symbol *symbol;
+  };
+
+  inline bool operator==(const Key &k1, const Key &k2)
+  { return k1.same(k2) || (k1.hash() == k2.hash() && k1.str() == k2.str()); }
+
+  inline bool operator==(const Key &k1, const std::wstring &k2)
+  { return k1.str() == k2; }
+
+  inline bool operator==(const std::wstring &k1, const Key &k2)
+  { return k1 == k2.str(); }
+
+  inline bool operator==(const Key &k1, const wchar_t *k2)
+  { return k1.str() == k2; }
+
+  inline bool operator==(const wchar_t *k1, const Key &k2)
+  { return k1 == k2.str(); }
+
+  template < class _Other >
+    inline bool operator!=(const Key &k1, const _Other &k2)
+    { return !(k1 == k2); }
+
+  inline bool operator!=(const std::wstring &k1, const Key &k2)
+  { return !(k1 == k2); }
+
+  inline bool operator!=(const wchar_t *k1, const Key &k2)
+  { return !(k1 == k2); }
+
+  inline bool operator<(const Key &k1, const Key &k2)
+  { return !k1.same(k2) && k1.str() < k2.str(); }
+
+  inline bool operator<(const Key &k1, const std::wstring &k2)
+  { return k1.str() < k2; }
+
+  inline bool operator<(const std::wstring &k1, const Key &k2)
+  { return k1 < k2.str(); }
+
+  inline bool operator<(const Key &k1, const wchar_t *k2)
+  { return k1.str().compare(k2) < 0; }
+
+  inline bool operator<(const wchar_t *k1, const Key &k2)
+  { return k2.str().compare(k1) > 0; }
+
+  inline std::wostream &operator<<(std::wostream &stream, const Key &key)
+  { return stream << key.str(); }
+
+  /**
+   * Hash function for keys and the strings they are looked up with.
+   */
+  struct KeyHash
+  {
+    inline size_t operator()(const Key &key) const
+    { return key.hash(); }
+
+    inline size_t operator()(const std::wstring &key) const
+    { return hash_key(key.data(), key.size()); }
+
+    inline size_t operator()(const wchar_t *key) const
+    { return hash_key(key, wcslen(key)); }
+  };
+
+  /**
+   * Table of interned keys. Interning the same text twice gives keys sharing
+   * their characters, so that documents with the same keys only store them
+   * once and key comparisons between them are pointer comparisons.
+   *
+   * The pool is bounded: long keys, and new keys once the pool is full, are
+   * not interned but still returned as ordinary keys. Keys stay valid when
+   * the pool is cleared or destroyed.
+   *
+   * A pool is not thread safe, the keys it hands out are.
+   */
+  class KeyPool
+  {
+  public:
+    /**
+     * Create an empty pool.
+     *
+     * @param max_keys Maximum number of keys in the pool.
+     * @param max_length Length of the longest key which is interned.
+     */
+    KeyPool(size_t max_keys = 65536, size_t max_length = 128);
+
+    /**
+     * Destroy the pool.
+     */
+    ~KeyPool();
+
+    /**
+     * Get the key of the given text.
+     */
+    Key intern(const wchar_t *data, size_t length);
+
+    inline Key intern(const std::wstring &text)
+    { return intern(text.data(), text.size()); }
+
+    /**
+     * Get the number of keys in the pool.
+     */
+    inline size_t size() const
+    { return count; }
+
+    /**
+     * Drop all keys from the pool.
+     */
+    void clear();
+
+  private:
+    void grow();
+
+  private:
+    KeyPool(const KeyPool &);
+    KeyPool &operator=(const KeyPool &);
+
+  private:
+    size_t max_keys;
+    size_t max_length;
+    size_t count;
+    std::vector< Key::Symbol * > slots;
+  };
+
+} // namespace Json
+
+#endif // JSON_KEY_H_INCLUDE
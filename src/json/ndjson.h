@@ -0,0 +1,127 @@
+/**
+ * @file
+ */
+#ifndef JSON_NDJSON_H_INCLUDE
+#define JSON_NDJSON_H_INCLUDE
+
+#include <string>
+#include <vector>
+
+#include <json/json.h>
+
+namespace Json
+{
+
+  /**
+   * Reader for newline delimited JSON, one value per line. Lines are decoded
+   * in batches by a set of worker threads, each with its own JsonHandler, and
+   * the records are reported in input order from the calling thread. Blank
+   * lines are skipped.
+   *
+   * A reader is not thread safe, but it can be reused for several inputs.
+   */
+  class NdjsonReader
+  {
+  public:
+    /**
+     * Receiver of the decoded records.
+     */
+    class Callback
+    {
+    public:
+      virtual ~Callback();
+
+      /**
+       * A record was decoded. The value may be moved or swapped out.
+       *
+       * @param line Line number of the record, starting at 1.
+       * @param value Decoded value.
+       */
+      virtual void record(size_t line, Value &value) = 0;
+
+      /**
+       * A line could not be decoded. The default implementation stops the
+       * reader, which then throws the parse error.
+       *
+       * @param line Line number of the record, starting at 1.
+       * @param error Parse error of the line.
+       * @return true to skip the line and go on with the next ones.
+       */
+      virtual bool error(size_t line, const ParseError &error);
+    };
+
+  public:
+    /**
+     * Create a reader.
+     *
+     * @param encoding Encoding of the input.
+     * @param threads Number of decoding threads, 0 for one per processor.
+     * @param batch_size Number of lines a thread decodes at once.
+     */
+    NdjsonReader(const char *encoding = "UTF-8", unsigned threads = 0, size_t batch_size = 256);
+
+    /**
+     * Destroy the reader.
+     */
+    ~NdjsonReader();
+
+    /**
+     * Decode the records of a memory range.
+     *
+     * @param data Input data.
+     * @param length Length of the input.
+     * @param callback Receiver of the records.
+     */
+    void read(const char *data, size_t length, Callback &callback);
+
+    /**
+     * Decode the records read from a file descriptor until the end of file.
+     *
+     * @param fd File descriptor, it is not closed.
+     * @param callback Receiver of the records.
+     * @throw IOError if reading fails.
+     */
+    void read(int fd, Callback &callback);
+
+    /**
+     * Decode the records of a memory range into a list.
+     *
+     * @param dest Destination, the records are appended in input order.
+     * @param data Input data.
+     * @param length Length of the input.
+     */
+    void decode(std::vector< Value > &dest, const char *data, size_t length);
+
+    /**
+     * Get the number of decoding threads.
+     */
+    inline size_t get_threads() const
+    { return handlers.size(); }
+
+  private:
+    struct Line
+    {
+      const char *data;
+      size_t length;
+      size_t number;
+    };
+
+    void read_lines(const char *data, size_t length, size_t &line, Callback &callback);
+    void flush(Callback &callback);
+
+  private:
+    NdjsonReader(const NdjsonReader &);
+    NdjsonReader &operator=(const NdjsonReader &);
+
+  private:
+    // One handler per thread, the first one is used by the calling thread
+    std::vector< JsonHandler * > handlers;
+    size_t batch_size;
+
+    // Lines waiting to be decoded
+    std::vector< Line > lines;
+  };
+
+} // namespace Json
+
+#endif // JSON_NDJSON_H_INCLUDE
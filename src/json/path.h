@@ -0,0 +1,96 @@
+/**
+ * @file
+ */
+#ifndef JSON_PATH_H_INCLUDE
+#define JSON_PATH_H_INCLUDE
+
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+
+#include <json/exception.h>
+
+namespace Json
+{
+
+  DEFINE_EXCEPTION(PathException);
+
+  /**
+   * Location of values in a document, evaluated on JSON text by
+   * JsonHandler::query() without decoding the values around it. A path is
+   * parsed once and can be used for any number of queries.
+   *
+   * Two syntaxes are supported:
+   * <ul>
+   *   <li>JSON Pointer (RFC 6901), like "/events/3/host", "" being the
+   *       whole document. A token made of digits matches both the item of
+   *       a list at that index and the member of an object with that key.</li>
+   *   <li>A subset of JSONPath, like "$.events[3].host": the root "$" followed
+   *       by members ".name" or "['name']", items "[3]" and wildcards ".*"
+   *       or "[*]" matching all members or items.</li>
+   * </ul>
+   */
+  class Path
+  {
+  public:
+    /**
+     * Level of a path.
+     */
+    struct Step
+    {
+      // Matches all members and items
+      bool wildcard;
+
+      // Key of the matched member, if has_key is set
+      bool has_key;
+      std::wstring key;
+
+      // Index of the matched item, npos if the step matches no item
+      size_t index;
+    };
+
+    static const size_t npos = (size_t)-1;
+
+  public:
+    /**
+     * Parse a path.
+     *
+     * @throw PathException if the path is invalid.
+     */
+    Path(const std::wstring &path);
+
+    /**
+     * Parse a UTF-8 path.
+     *
+     * @throw PathException if the path is invalid.
+     */
+    Path(const std::string &path);
+    Path(const char *path);
+
+    /**
+     * Get the levels of the path, from the root.
+     */
+    inline const std::vector< Step > &get_steps() const
+    { return steps; }
+
+    /**
+     * Check if the path has wildcards, otherwise it matches one value at
+     * most.
+     */
+    inline bool has_wildcards() const
+    { return wildcards; }
+
+  private:
+    void parse(const std::wstring &path);
+    void parse_pointer(const std::wstring &path);
+    void parse_jsonpath(const std::wstring &path);
+
+  private:
+    std::vector< Step > steps;
+    bool wildcards;
+  };
+
+} // namespace Json
+
+#endif // JSON_PATH_H_INCLUDE
@@ -0,0 +1,132 @@
+/**
+ * @file
+ */
+#ifndef JSON_SINK_H_INCLUDE
+#define JSON_SINK_H_INCLUDE
+
+#include <functional>
+#include <string>
+
+#include <stddef.h>
+#include <stdio.h>
+
+namespace Json
+{
+
+  /**
+   * Destination of encoded JSON. The encoder buffers its output and hands it
+   * over to the sink in chunks of bounded size.
+   */
+  class Sink
+  {
+  public:
+    virtual ~Sink();
+
+    /**
+     * Write a chunk of output.
+     *
+     * @param data Encoded data.
+     * @param length Length of the data.
+     */
+    virtual void write(const char *data, size_t length) = 0;
+  };
+
+  /**
+   * Sink appending the output to a string.
+   */
+  class StringSink final : public Sink
+  {
+  public:
+    /**
+     * Create a sink appending to dest.
+     */
+    StringSink(std::string &dest)
+      : dest(dest)
+    {
+    }
+
+    void write(const char *data, size_t length) override
+    {
+      dest.append(data, length);
+    }
+
+  private:
+    std::string &dest;
+  };
+
+  /**
+   * Sink writing the output to a file descriptor. Partial writes are
+   * retried until the whole chunk is written.
+   */
+  class FdSink final : public Sink
+  {
+  public:
+    /**
+     * Create a sink writing to fd. The descriptor is not closed.
+     */
+    FdSink(int fd)
+      : fd(fd)
+    {
+    }
+
+    /**
+     * @throw IOError if the descriptor cannot be written to.
+     */
+    void write(const char *data, size_t length) override;
+
+  private:
+    int fd;
+  };
+
+  /**
+   * Sink writing the output to a stdio stream.
+   */
+  class FileSink final : public Sink
+  {
+  public:
+    /**
+     * Create a sink writing to file. The stream is neither flushed nor
+     * closed.
+     */
+    FileSink(FILE *file)
+      : file(file)
+    {
+    }
+
+    /**
+     * @throw IOError if the stream cannot be written to.
+     */
+    void write(const char *data, size_t length) override;
+
+  private:
+    FILE *file;
+  };
+
+  /**
+   * Sink passing the output to a function.
+   */
+  class CallbackSink final : public Sink
+  {
+  public:
+    typedef std::function< void (const char *data, size_t length) > Callback;
+
+    /**
+     * Create a sink calling callback with every chunk of output.
+     */
+    CallbackSink(const Callback &callback)
+      : callback(callback)
+    {
+    }
+
+    void write(const char *data, size_t length) override
+    {
+      callback(data, length);
+    }
+
+  private:
+    Callback callback;
+  };
+
+} // namespace Json
+
+#endif // JSON_SINK_H_INCLUDE
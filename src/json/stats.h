@@ -0,0 +1,166 @@
+/**
+ * @file
+ */
+#ifndef JSON_STATS_H_INCLUDE
+#define JSON_STATS_H_INCLUDE
+
+#include <json/options.h>
+
+#include <mutex>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Json
+{
+
+  /**
+   * Statistics of JsonHandler calls. They are only collected when the
+   * library is configured with --enable-stats (JSON_STATS), the counting
+   * is compiled out otherwise and costs nothing.
+   *
+   * Values are counted as the parser finds them: the contents of the
+   * containers kept lazily by JsonHandler::LAZY_CONTAINERS, and of the
+   * values skipped by a query, are not counted. Allocations are the strings,
+   * containers and keys allocated from the heap or from a memory resource;
+   * the blocks an Arena takes from upstream are not counted again.
+   */
+  struct Stats
+  {
+    /**
+     * True if the library collects statistics.
+     */
+    static constexpr bool enabled = JSON_STATS;
+
+    // Number of decoding (including parse and query) and encoding calls
+    uint64_t decodes;
+    uint64_t encodes;
+    // Number of calls which failed
+    uint64_t errors;
+
+    // Size of the input and of the output in bytes, wide strings count
+    // sizeof(wchar_t) per character
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+
+    // Values found by the parser
+    uint64_t strings;
+    uint64_t numbers;
+    uint64_t lists;
+    uint64_t objects;
+    uint64_t keys;
+    // Deepest nesting of lists and objects
+    size_t max_depth;
+
+    uint64_t allocations;
+    uint64_t allocated_bytes;
+
+    // Time spent in nanoseconds converting the input or the output with
+    // the Codec, in parsing and building the values, and in encoding them
+    uint64_t transcode_ns;
+    uint64_t parse_ns;
+    uint64_t encode_ns;
+
+    Stats()
+    { clear(); }
+
+    /**
+     * Reset all counters to 0.
+     */
+    void clear();
+
+    /**
+     * Add the counters of other, keeping the deepest nesting of both.
+     */
+    Stats &operator+=(const Stats &other);
+
+#if JSON_STATS
+    /**
+     * Get the statistics being collected by the calling thread, NULL if
+     * there are none.
+     */
+    static inline Stats *get_current()
+    { return current; }
+
+    /**
+     * Collect the statistics of the calling thread into stats, or stop
+     * collecting them if it is NULL.
+     */
+    static inline void set_current(Stats *stats)
+    { current = stats; }
+
+    /**
+     * Count an allocation of the calling thread.
+     */
+    static inline void count_allocation(size_t size)
+    {
+      if (current)
+        {
+          ++current->allocations;
+          current->allocated_bytes += size;
+        }
+    }
+
+  private:
+    static thread_local Stats *current;
+#else
+    static inline Stats *get_current()
+    { return NULL; }
+
+    static inline void set_current(Stats *)
+    {
+    }
+
+    static inline void count_allocation(size_t)
+    {
+    }
+#endif
+  };
+
+  /**
+   * Receiver of the statistics of every decoding and encoding call of a
+   * JsonHandler, to push them into a metrics system. See
+   * JsonHandler::set_stats_hook().
+   */
+  class StatsHook
+  {
+  public:
+    virtual ~StatsHook();
+
+    /**
+     * Called by the thread of a JsonHandler call once it is done, even if
+     * it failed. A handler shared by threads calls it concurrently. It must
+     * not throw.
+     *
+     * @param stats Statistics of the call.
+     */
+    virtual void report(const Stats &stats) = 0;
+  };
+
+  /**
+   * Hook summing up the statistics of all the calls, safe to share between
+   * threads.
+   */
+  class StatsCollector final : public StatsHook
+  {
+  public:
+    void report(const Stats &stats) override;
+
+    /**
+     * Get the sums of the statistics reported so far.
+     */
+    Stats get() const;
+
+    /**
+     * Reset the sums.
+     */
+    void clear();
+
+  private:
+    mutable std::mutex mutex;
+    Stats total;
+  };
+
+} // namespace Json
+
+#endif // JSON_STATS_H_INCLUDE
@@ -0,0 +1,155 @@
+/**
+ * @file
+ */
+#ifndef JSON_STREAM_H_INCLUDE
+#define JSON_STREAM_H_INCLUDE
+
+#include <string>
+#include <vector>
+
+#include <json/handler.h>
+#include <json/common.h>
+
+namespace Json
+{
+
+  /**
+   * Incremental parser for UTF-8 input arriving in chunks, for instance from
+   * a socket. The input can be split anywhere, including in the middle of
+   * strings, escape sequences, multi-byte sequences, numbers and literals;
+   * the parser keeps its state between chunks and reports the values to the
+   * handler as soon as they are complete.
+   *
+   * Memory use is bounded by the nesting depth and the longest string of the
+   * document, independently of the chunk size. Use a ValueBuilder as the
+   * handler to get a Value tree.
+   *
+   * @code
+   * Json::Value value;
+   * Json::ValueBuilder builder(value);
+   * Json::StreamParser parser(builder);
+   *
+   * while ((len = read(fd, buf, sizeof(buf))) > 0)
+   *   parser.feed(buf, len);
+   * parser.finish();
+   * @endcode
+   */
+  class StreamParser
+  {
+  public:
+    /**
+     * Create a parser reporting to the given handler.
+     */
+    StreamParser(Handler &handler);
+
+    /**
+     * Destroy the parser.
+     */
+    ~StreamParser();
+
+    /**
+     * Parse the next chunk of input.
+     *
+     * @param buf Chunk of UTF-8 data.
+     * @param len Length of the chunk.
+     */
+    void feed(const char *buf, size_t len);
+
+    /**
+     * Signal the end of the input. A number at the very end of the input is
+     * only reported at this point.
+     *
+     * @throw UnexpectedEof if the value is incomplete.
+     */
+    void finish();
+
+    /**
+     * Reset the parser so that it can parse another document.
+     */
+    void reset();
+
+    /**
+     * Check if a complete value has been parsed.
+     */
+    inline bool is_complete() const
+    { return state == STATE_DONE; }
+
+    /**
+     * Limit the nesting of lists and objects, see
+     * JsonHandler::set_max_depth(). Deeper input is rejected with
+     * NestingTooDeep.
+     *
+     * @param depth Maximum depth, 1024 by default, 0 for no limit.
+     */
+    inline void set_max_depth(size_t depth)
+    { this->max_depth = depth; }
+
+    /**
+     * Get the maximum nesting of lists and objects, 0 if there is no limit.
+     */
+    inline size_t get_max_depth() const
+    { return max_depth; }
+
+  private:
+    enum State
+    {
+      STATE_VALUE,
+      STATE_ARRAY_FIRST,
+      STATE_OBJECT_FIRST,
+      STATE_OBJECT_KEY,
+      STATE_COLON,
+      STATE_AFTER_VALUE,
+      STATE_STRING,
+      STATE_ESCAPE,
+      STATE_UNICODE,
+      STATE_UTF8,
+      STATE_NUMBER,
+      STATE_LITERAL,
+      STATE_DONE,
+    };
+
+    size_t begin_value(const char *buf, size_t pos);
+    void end_value();
+    void end_string();
+    void flush_number(size_t position);
+
+    template < class _Exception >
+      void raise_error(const char *message, size_t position) JSON_NORETURN;
+
+  private:
+    StreamParser(const StreamParser &);
+    StreamParser &operator=(const StreamParser &);
+
+  private:
+    Handler &handler;
+    State state;
+    size_t offset;
+    size_t max_depth;
+
+    // Open containers, '[' or '{'
+    std::vector< char > stack;
+
+    // Current string or key
+    std::wstring buffer;
+    bool is_key;
+
+    // Pending \u escape
+    unsigned code;
+    int code_digits;
+
+    // Pending UTF-8 sequence
+    char utf8[4];
+    size_t utf8_count;
+    size_t utf8_length;
+
+    // Text of the current number
+    std::string number;
+
+    // Current literal and the number of characters matched so far
+    const char *literal;
+    size_t literal_pos;
+  };
+
+} // namespace Json
+
+#endif // JSON_STREAM_H_INCLUDE
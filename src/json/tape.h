@@ -0,0 +1,625 @@
+/**
+ * @file
+ */
+#ifndef JSON_TAPE_H_INCLUDE
+#define JSON_TAPE_H_INCLUDE
+
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <json/value.h>
+#include <json/handler.h>
+
+namespace Json
+{
+
+  class TapeValue;
+
+  /**
+   * Read-only form of a decoded JSON value, for documents which are parsed
+   * once and then only read, see JsonHandler::decode(Tape &, const char *, size_t).
+   *
+   * The values are laid out in document order on a tape of 64-bit words,
+   * the top byte of a word being the type of the value and the other bytes
+   * its payload:
+   * <ul>
+   *   <li>null, true and false take one word;</li>
+   *   <li>numbers take one word followed by the integer or the bits of the
+   *       double;</li>
+   *   <li>strings take one word holding the offset of the string in a side
+   *       buffer, where the 32-bit length of the string is followed by its
+   *       UTF-8 contents;</li>
+   *   <li>lists and objects take one word holding the index following their
+   *       end word, then their items, or their members as a key string
+   *       followed by a value, then an end word holding their number of
+   *       items.</li>
+   * </ul>
+   *
+   * Skipping a value, a whole list or object included, is thus a single
+   * step, and a tape takes two allocations whatever the size of the
+   * document. The values are read through TapeValue, and converted to Value
+   * trees with TapeValue::to_value() when they need to be modified.
+   */
+  class Tape
+  {
+  public:
+    /**
+     * Create a tape holding a null value.
+     */
+    Tape();
+
+    /**
+     * Get the root value of the tape. It is valid until the tape is
+     * modified or destroyed.
+     */
+    TapeValue get_root() const;
+
+    /**
+     * Get the number of bytes taken by the words and the strings.
+     */
+    inline size_t get_size() const
+    { return words.size() * sizeof(uint64_t) + strings.size(); }
+
+    /**
+     * Reset the tape to a null value, keeping its memory for reuse.
+     */
+    void clear();
+
+    /**
+     * Release the memory kept for reuse.
+     */
+    void shrink_to_fit();
+
+  private:
+    Tape(const Tape &);
+    Tape &operator=(const Tape &);
+
+  private:
+    friend class TapeValue;
+    friend class TapeBuilder;
+
+    enum Tag
+    {
+      TAG_NULL = 'n',
+      TAG_TRUE = 't',
+      TAG_FALSE = 'f',
+      TAG_INTEGER = 'l',
+      TAG_UNSIGNED = 'u',
+      TAG_FLOAT = 'd',
+      TAG_STRING = '"',
+      TAG_LIST = '[',
+      TAG_LIST_END = ']',
+      TAG_OBJECT = '{',
+      TAG_OBJECT_END = '}',
+    };
+
+    static const unsigned tag_shift = 56;
+    static const uint64_t payload_mask = ((uint64_t)1 << tag_shift) - 1;
+
+    static inline uint64_t word(Tag tag, uint64_t payload)
+    { return ((uint64_t)tag << tag_shift) | payload; }
+
+    static inline Tag tag_of(uint64_t word)
+    { return (Tag)(word >> tag_shift); }
+
+    static inline uint64_t payload_of(uint64_t word)
+    { return word & payload_mask; }
+
+    std::vector< uint64_t > words;
+    std::string strings;
+  };
+
+  /**
+   * Reference to a value on a Tape. Its accessors behave like the casts of
+   * Value, with lists and objects read through the TapeValue::List and
+   * TapeValue::Object ranges. A reference is only valid as long as its
+   * tape is not modified or destroyed.
+   */
+  class TapeValue
+  {
+  public:
+    class List;
+    class Object;
+
+    /**
+     * Create a null value, attached to no tape.
+     */
+    TapeValue();
+
+    /**
+     * Get value type.
+     */
+    inline Value::Type get_type() const
+    {
+      switch (Tape::tag_of(*word))
+        {
+        case Tape::TAG_TRUE:
+        case Tape::TAG_FALSE:
+          return Value::JSON_TYPE_BOOLEAN;
+
+        case Tape::TAG_INTEGER:
+        case Tape::TAG_UNSIGNED:
+          return Value::JSON_TYPE_INTEGER;
+
+        case Tape::TAG_FLOAT:
+          return Value::JSON_TYPE_FLOAT;
+
+        case Tape::TAG_STRING:
+          return Value::JSON_TYPE_STRING;
+
+        case Tape::TAG_LIST:
+          return Value::JSON_TYPE_LIST;
+
+        case Tape::TAG_OBJECT:
+          return Value::JSON_TYPE_OBJECT;
+
+        default:
+          return Value::JSON_TYPE_NULL;
+        }
+    }
+
+    /**
+     * Check if value is null.
+     */
+    inline bool is_null() const
+    { return Tape::tag_of(*word) == Tape::TAG_NULL; }
+
+    /**
+     * Check if value is an integer above INT64_MAX, which can only be cast
+     * to uint64_t.
+     */
+    inline bool is_uint64() const
+    { return Tape::tag_of(*word) == Tape::TAG_UNSIGNED; }
+
+    /**
+     * Get the value following this one on the tape, skipping its items if
+     * it is a list or an object. The value following the last item of a
+     * list or object is its end, which must not be accessed.
+     */
+    inline TapeValue next() const
+    {
+      switch (Tape::tag_of(*word))
+        {
+        case Tape::TAG_LIST:
+        case Tape::TAG_OBJECT:
+          return TapeValue(tape, tape->words.data() + Tape::payload_of(*word));
+
+        case Tape::TAG_INTEGER:
+        case Tape::TAG_UNSIGNED:
+        case Tape::TAG_FLOAT:
+          return TapeValue(tape, word + 2);
+
+        default:
+          return TapeValue(tape, word + 1);
+        }
+    }
+
+    /**
+     * Get the number of items of a list or members of an object.
+     *
+     * @throw ValueException if the value is not a list or an object.
+     */
+    size_t size() const;
+
+    /**
+     * Get value as a bool.
+     */
+    operator bool() const;
+
+    /**
+     * Get value as an integer.
+     */
+    operator int() const;
+
+    /**
+     * Get value as a 64-bit integer.
+     */
+    operator int64_t() const;
+
+    /**
+     * Get value as an unsigned 64-bit integer.
+     */
+    operator uint64_t() const;
+
+    /**
+     * Get value as a floating point number.
+     */
+    operator double() const;
+
+    /**
+     * Get the UTF-8 contents of a string, which live in the tape.
+     *
+     * @throw ValueException if the value is not a string.
+     */
+    void get_utf8_string(const char *&text, size_t &len) const;
+
+    /**
+     * Get value as a UTF-8 string.
+     */
+    operator std::string() const;
+
+    /**
+     * Get value as a wide string.
+     */
+    operator std::wstring() const;
+
+    /**
+     * Get value as a list of values.
+     */
+    operator List() const;
+
+    /**
+     * Get value as a map of values.
+     */
+    operator Object() const;
+
+    /**
+     * Build a Value tree holding a copy of this value, see
+     * JsonHandler::decode().
+     *
+     * @param dest Destination value.
+     * @param resource Resource to allocate from, the heap if it is NULL.
+     * @param pool Pool to intern object keys in, or NULL.
+     * @param flags JsonHandler::BORROW_STRINGS lets the strings reference
+     *        the tape, which must then outlive the value. The other flags
+     *        are ignored.
+     */
+    void to_value(Value &dest, MemoryResource *resource = NULL, KeyPool *pool = NULL, int flags = 0) const;
+
+    /**
+     * Build a heap allocated Value tree holding a copy of this value.
+     */
+    Value to_value() const;
+
+    /**
+     * Check if both refer to the same value of the same tape.
+     */
+    inline bool operator==(const TapeValue &other) const
+    { return word == other.word; }
+
+    inline bool operator!=(const TapeValue &other) const
+    { return word != other.word; }
+
+  private:
+    friend class Tape;
+
+    TapeValue(const Tape *tape, const uint64_t *word)
+      : tape(tape), word(word)
+    {
+    }
+
+    void check_tag(Tape::Tag tag) const;
+    void build(ValueBuilder &builder, bool borrow) const;
+
+    inline const char *string_data(size_t &len) const
+    {
+      const char *data = tape->strings.data() + Tape::payload_of(*word);
+      uint32_t length;
+
+      memcpy(&length, data, sizeof(length));
+      len = length;
+      return data + sizeof(length);
+    }
+
+  private:
+    const Tape *tape;
+    const uint64_t *word;
+
+    // Word of the values attached to no tape
+    static const uint64_t null_word;
+  };
+
+  /**
+   * Items of a list on a tape, iterated in order.
+   */
+  class TapeValue::List
+  {
+  public:
+    class const_iterator
+    {
+    public:
+      typedef std::forward_iterator_tag iterator_category;
+      typedef TapeValue value_type;
+      typedef ptrdiff_t difference_type;
+      typedef const TapeValue *pointer;
+      typedef const TapeValue &reference;
+
+      const_iterator()
+      {
+      }
+
+      explicit const_iterator(const TapeValue &value)
+        : value(value)
+      {
+      }
+
+      inline reference operator*() const
+      { return value; }
+
+      inline pointer operator->() const
+      { return &value; }
+
+      inline const_iterator &operator++()
+      {
+        value = value.next();
+        return *this;
+      }
+
+      inline const_iterator operator++(int)
+      {
+        const_iterator result(*this);
+        value = value.next();
+        return result;
+      }
+
+      inline bool operator==(const const_iterator &other) const
+      { return value == other.value; }
+
+      inline bool operator!=(const const_iterator &other) const
+      { return value != other.value; }
+
+    private:
+      TapeValue value;
+    };
+
+    typedef const_iterator iterator;
+
+    inline const_iterator begin() const
+    { return const_iterator(first); }
+
+    inline const_iterator end() const
+    { return const_iterator(last); }
+
+    inline size_t size() const
+    { return items; }
+
+    inline bool empty() const
+    { return !items; }
+
+    /**
+     * Get an item by position. Items are skipped one step each, the cost
+     * is linear in pos.
+     *
+     * @throw ValueException if pos is out of range.
+     */
+    TapeValue operator[](size_t pos) const;
+
+  private:
+    friend class TapeValue;
+
+    List(const TapeValue &first, const TapeValue &last, size_t items)
+      : first(first), last(last), items(items)
+    {
+    }
+
+  private:
+    TapeValue first;
+    TapeValue last;
+    size_t items;
+  };
+
+  /**
+   * Members of an object on a tape, iterated in document order as pairs of
+   * a string key and a value.
+   */
+  class TapeValue::Object
+  {
+  public:
+    typedef std::pair< TapeValue, TapeValue > value_type;
+
+    class const_iterator
+    {
+    public:
+      typedef std::forward_iterator_tag iterator_category;
+      typedef Object::value_type value_type;
+      typedef ptrdiff_t difference_type;
+      typedef const value_type *pointer;
+      typedef const value_type &reference;
+
+      const_iterator()
+      {
+      }
+
+      explicit const_iterator(const TapeValue &key)
+        : member(key, key.next())
+      {
+      }
+
+      inline reference operator*() const
+      { return member; }
+
+      inline pointer operator->() const
+      { return &member; }
+
+      inline const_iterator &operator++()
+      {
+        member.first = member.second.next();
+        member.second = member.first.next();
+        return *this;
+      }
+
+      inline const_iterator operator++(int)
+      {
+        const_iterator result(*this);
+        ++*this;
+        return result;
+      }
+
+      inline bool operator==(const const_iterator &other) const
+      { return member.first == other.member.first; }
+
+      inline bool operator!=(const const_iterator &other) const
+      { return member.first != other.member.first; }
+
+    private:
+      friend class Object;
+
+      value_type member;
+    };
+
+    typedef const_iterator iterator;
+
+    inline const_iterator begin() const
+    { return const_iterator(first); }
+
+    inline const_iterator end() const
+    {
+      const_iterator it;
+      it.member.first = last;
+      return it;
+    }
+
+    inline size_t size() const
+    { return items; }
+
+    inline bool empty() const
+    { return !items; }
+
+    /**
+     * Find the first member of a key, comparing the UTF-8 contents of the
+     * keys.
+     *
+     * @return Iterator to the member, or end() if there is none.
+     */
+    const_iterator find(const char *key, size_t length) const;
+
+    inline const_iterator find(const std::string &key) const
+    { return find(key.data(), key.size()); }
+
+    const_iterator find(const std::wstring &key) const;
+
+    template < class _Key >
+      inline size_t count(const _Key &key) const
+      { return find(key) != end(); }
+
+  private:
+    friend class TapeValue;
+
+    Object(const TapeValue &first, const TapeValue &last, size_t items)
+      : first(first), last(last), items(items)
+    {
+    }
+
+  private:
+    TapeValue first;
+    TapeValue last;
+    size_t items;
+  };
+
+  /**
+   * Handler writing the parse events to a tape, this is what
+   * JsonHandler::decode() uses for tapes.
+   */
+  class TapeBuilder final : public Handler
+  {
+  public:
+    /**
+     * Create a builder, the previous contents of the tape are dropped.
+     */
+    TapeBuilder(Tape &tape);
+
+    void null() override
+    { value(Tape::word(Tape::TAG_NULL, 0)); }
+
+    void boolean(bool value) override
+    { this->value(Tape::word(value ? Tape::TAG_TRUE : Tape::TAG_FALSE, 0)); }
+
+    void integer(int value) override
+    { integer64(value); }
+
+    void integer64(int64_t value) override
+    {
+      this->value(Tape::word(Tape::TAG_INTEGER, 0));
+      tape.words.push_back((uint64_t)value);
+    }
+
+    void unsigned_integer64(uint64_t value) override
+    {
+      this->value(Tape::word(Tape::TAG_UNSIGNED, 0));
+      tape.words.push_back(value);
+    }
+
+    void number(double value) override
+    {
+      uint64_t bits;
+
+      memcpy(&bits, &value, sizeof(bits));
+      this->value(Tape::word(Tape::TAG_FLOAT, 0));
+      tape.words.push_back(bits);
+    }
+
+    void string(const std::wstring &value) override;
+
+    void borrowed_string(const char *data, size_t length) override
+    {
+      value(Tape::word(Tape::TAG_STRING, tape.strings.size()));
+      append(data, length);
+    }
+
+    void key(const std::wstring &key) override;
+
+    void begin_object() override
+    { begin(Tape::TAG_OBJECT); }
+
+    void end_object() override
+    { end(Tape::TAG_OBJECT_END); }
+
+    void begin_array() override
+    { begin(Tape::TAG_LIST); }
+
+    void end_array() override
+    { end(Tape::TAG_LIST_END); }
+
+  private:
+    struct Frame
+    {
+      size_t start;
+      size_t count;
+    };
+
+    // Write the first word of a value, counting it as an item of the
+    // current list
+    inline void value(uint64_t word)
+    {
+      if (!stack.empty() && Tape::tag_of(tape.words[stack.back().start]) == Tape::TAG_LIST)
+        ++stack.back().count;
+
+      tape.words.push_back(word);
+    }
+
+    inline void begin(Tape::Tag tag)
+    {
+      Frame frame = { tape.words.size(), 0 };
+
+      value(Tape::word(tag, 0));
+      stack.push_back(frame);
+    }
+
+    inline void end(Tape::Tag tag)
+    {
+      Frame frame = stack.back();
+
+      stack.pop_back();
+      tape.words.push_back(Tape::word(tag, frame.count));
+      tape.words[frame.start] |= tape.words.size();
+    }
+
+    // Append a string of the side buffer
+    void append(const char *data, size_t length);
+
+  private:
+    Tape &tape;
+    std::vector< Frame > stack;
+    // UTF-8 form of the wide strings
+    std::string text;
+  };
+
+} // namespace Json
+
+#endif // JSON_TAPE_H_INCLUDE
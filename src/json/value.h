@@ -5,7 +5,13 @@
 #include <map>
 #include <string>
 
+#include <stdint.h>
+
+#include <json/options.h>
 #include <json/exception.h>
+#include <json/arena.h>
+#include <json/flatmap.h>
+#include <json/key.h>
 
 namespace Json
 {
@@ -17,11 +23,22 @@ namespace Json
    *
    * The list of implicit casts is the following:
    * <ul>
-   *   <li>A NULL can be cast to bool (false) and int (0)</li>
-   *   <li>A boolean can be cast to bool and int (0 for false, 1 for true)</li>
-   *   <li>An integer can be cast to bool (false if integer is 0, true otherwise) and int</li>
-   *   <li>A float can be converted to float and int (its value rounded down)</li>
+   *   <li>A NULL can be cast to bool (false) and integers (0)</li>
+   *   <li>A boolean can be cast to bool and integers (0 for false, 1 for true)</li>
+   *   <li>An integer can be cast to bool (false if integer is 0, true otherwise) and
+   *       integers, a ValueException is thrown if it does not fit</li>
+   *   <li>A float can be converted to float and integers (its value rounded down)</li>
    * </ul>
+   *
+   * Integers are stored on 64 bits, values up to UINT64_MAX are supported.
+   *
+   * A value takes 16 bytes. Strings of up to 12 bytes in UTF-8 are stored
+   * in the value itself, they are only transcoded to a heap string when
+   * they are cast to a wide string.
+   *
+   * Borrowed strings, short strings and lazy containers are converted in
+   * place the first time they are accessed, so that a value must not be
+   * accessed by several threads at once before that, even if it is const.
    */
   class Value
   {
@@ -43,12 +60,21 @@ namespace Json
     /**
      * List of values. JSON lists are decoded to this type.
      */
-    typedef std::vector< Value > List;
+    typedef std::vector< Value, Allocator< Value > > List;
 
+#if JSON_FLAT_OBJECTS
+    /**
+     * Map of key-value pairs, in insertion order. JSON objects are decoded
+     * to this type.
+     */
+    typedef FlatMap< Key, Value, Allocator< std::pair< Key, Value > >, KeyHash > Object;
+#else
     /**
      * Map of key-value pairs. JSON objects are decoded to this type.
      */
-    typedef std::map< std::wstring, Value > Object;
+    typedef std::map< Key, Value, std::less<>,
+                      Allocator< std::pair< const Key, Value > > > Object;
+#endif
 
   public:
     /**
@@ -64,6 +90,7 @@ namespace Json
      */
     template < class _Type >
       Value(const _Type &value)
+        : type(JSON_TYPE_NULL), storage(STORAGE_HEAP), length(0)
       {
         set(value);
       }
@@ -73,6 +100,28 @@ namespace Json
      */
     Value(const Value &other);
 
+    /**
+     * Take over the contents of the given value, which is left null. This lets
+     * lists relocate their items without copying them, and keeps items of
+     * resource lists in their resource.
+     */
+    Value(Value &&other) noexcept;
+
+    /**
+     * Initialize value with a string, taking over its contents.
+     */
+    Value(std::wstring &&value);
+
+    /**
+     * Initialize value with a list, taking over its items.
+     */
+    Value(List &&value);
+
+    /**
+     * Initialize value with an object, taking over its items.
+     */
+    Value(Object &&value);
+
     /**
      * Destroy the Value and the contained JSON value.
      */
@@ -93,6 +142,16 @@ namespace Json
      */
     void set(int value);
 
+    /**
+     * Set the value to a 64-bit number value.
+     */
+    void set(int64_t value);
+
+    /**
+     * Set the value to an unsigned 64-bit number value.
+     */
+    void set(uint64_t value);
+
     /**
      * Set the value to a number value.
      */
@@ -103,6 +162,11 @@ namespace Json
      */
     void set(const std::wstring &value);
 
+    /**
+     * Set the value to a string value, taking over the contents of the string.
+     */
+    void set(std::wstring &&value);
+
     /**
      * Set the value to a C-style string value.
      */
@@ -130,6 +194,95 @@ namespace Json
      */
     void set(const Object &value);
 
+    /**
+     * Set the value to a JSON list, taking over its items. The list keeps
+     * its allocator, the items of a resource list stay in the resource.
+     */
+    void set(List &&value);
+
+    /**
+     * Set the value to a JSON object, taking over its items. The object keeps
+     * its allocator, the items of a resource object stay in the resource.
+     */
+    void set(Object &&value);
+
+    /**
+     * Set the value to a string value allocated from the given resource,
+     * usually an Arena, or from the heap if it is NULL. The string is given
+     * back to the resource when the value is cleared, and stays valid as
+     * long as the resource is.
+     */
+    void set_string(const wchar_t *value, size_t len, MemoryResource *resource);
+
+    /**
+     * Set the value to a UTF-8 string referencing the given buffer instead
+     * of copying it. The buffer must outlive the value and its moves, copies
+     * of the value get their own string. The string is only transcoded when
+     * it is accessed.
+     *
+     * @param value Valid UTF-8 data, without escape sequences.
+     * @param len Length of the data in bytes.
+     */
+    void set_borrowed(const char *value, size_t len);
+
+    /**
+     * Set the value to a number kept as its JSON text, referencing the given
+     * buffer instead of converting it. The text is converted every time the
+     * value is cast to a number, and the encoder writes it back unchanged, so
+     * that numbers beyond the double precision survive a round trip. The
+     * buffer must outlive the value and its moves, copies of the value hold
+     * the converted number.
+     *
+     * @param text Valid JSON number.
+     * @param len Length of the text.
+     * @param type JSON_TYPE_INTEGER or JSON_TYPE_FLOAT, the type of the
+     *        converted number.
+     */
+    void set_raw_number(const char *text, size_t len, Type type);
+
+    /**
+     * Set the value to a list or an object kept as its JSON text,
+     * referencing the given buffer instead of parsing it. The text is parsed
+     * the first time the value is cast to a list or an object, which then
+     * throws the parse errors. The buffer must outlive the value and its
+     * moves, copies of the value hold the parsed container.
+     *
+     * @param text JSON text of the list or object.
+     * @param len Length of the text.
+     * @param type JSON_TYPE_LIST or JSON_TYPE_OBJECT, the type of the text.
+     * @param flags JsonHandler::DecodeFlags to parse the text with. With
+     *        JsonHandler::LAZY_CONTAINERS, the nested containers are lazy in
+     *        turn.
+     * @param offset Position of the text in the input it was taken from,
+     *        which the positions of the parse errors are relative to.
+     * @param max_depth Maximum nesting of lists and objects in the text,
+     *        counting the container itself, 0 for no limit. Deeper text
+     *        throws NestingTooDeep when it is parsed.
+     * @param resource Resource to allocate the reference to the text from,
+     *        the heap is used if it is NULL. The parsed container is on the
+     *        heap.
+     */
+    void set_lazy(const char *text, size_t len, Type type, int flags = 0, size_t offset = 0,
+                  size_t max_depth = 0, MemoryResource *resource = NULL);
+
+    /**
+     * Set the value to an empty JSON list allocated from the given resource,
+     * or from the heap if it is NULL. The list can then be filled in place,
+     * its items are allocated from the same resource.
+     *
+     * @return The new list.
+     */
+    List &set_list(MemoryResource *resource);
+
+    /**
+     * Set the value to an empty JSON object allocated from the given
+     * resource, or from the heap if it is NULL. The object can then be
+     * filled in place, its members are allocated from the same resource.
+     *
+     * @return The new object.
+     */
+    Object &set_object(MemoryResource *resource);
+
     /**
      * Swap values with other.
      */
@@ -140,6 +293,11 @@ namespace Json
      */
     Value &operator=(const Value &other);
 
+    /**
+     * Move another JSON value into this one, the other value is left null.
+     */
+    Value &operator=(Value &&other) noexcept;
+
     /**
      * Compare another JSON value with this one.
      */
@@ -175,6 +333,20 @@ namespace Json
     inline bool is_null() const
     { return type == JSON_TYPE_NULL; }
 
+    /**
+     * Check if value is an integer above INT64_MAX, which can only be cast
+     * to uint64_t.
+     */
+    inline bool is_uint64() const
+    { return type == JSON_TYPE_INTEGER && storage == STORAGE_UNSIGNED; }
+
+    /**
+     * Check if value is a list or an object set with set_lazy() which has
+     * not been parsed yet.
+     */
+    inline bool is_lazy() const
+    { return storage == STORAGE_LAZY; }
+
     /**
      * Get object value as a bool.
      */
@@ -185,11 +357,51 @@ namespace Json
      */
     operator int() const;
 
+    /**
+     * Get object value as a 64-bit integer.
+     */
+    operator int64_t() const;
+
+    /**
+     * Get object value as an unsigned 64-bit integer.
+     */
+    operator uint64_t() const;
+
     /**
      * Get object value as a floating point number.
      */
     operator double() const;
 
+    /**
+     * Get the text of a number set with set_raw_number().
+     *
+     * @return false if the value is not a number kept as text.
+     */
+    bool get_raw_number(const char *&text, size_t &len) const;
+
+    /**
+     * Get the UTF-8 text of a string set with set_borrowed(), without
+     * decoding it.
+     *
+     * @return false if the value is not a borrowed string.
+     */
+    bool get_borrowed_string(const char *&text, size_t &len) const;
+
+    /**
+     * Get the UTF-8 text of a string kept as UTF-8, a borrowed or a short
+     * string, without decoding it. The text of a short string lives in the
+     * value and is only valid until the value is modified.
+     *
+     * @return false if the value is not a string kept as UTF-8.
+     */
+    bool get_utf8_string(const char *&text, size_t &len) const;
+
+    /**
+     * Get the characters of a string value. Unlike the cast to a wide
+     * string, resource strings are not copied.
+     */
+    void get_string(const wchar_t *&data, size_t &len) const;
+
     /**
      * Get object value as a wide string.
      */
@@ -207,6 +419,10 @@ namespace Json
 
   private:
     void clear();
+    void copy(const Value &other);
+    void materialize() const;
+    bool set_short(const wchar_t *value, size_t len);
+    Value convert_number() const;
 
     inline void check_type(Type type) const
     {
@@ -215,13 +431,80 @@ namespace Json
     }
 
   private:
-    Type type;
-    union Values
+    /**
+     * String allocated from a memory resource.
+     */
+    struct ResourceString
+    {
+      MemoryResource *resource;
+      size_t length;
+      wchar_t data[1];
+    };
+
+    static void release_string(const ResourceString *str);
+
+    /**
+     * Text of a lazy container, see set_lazy().
+     */
+    struct LazyText
+    {
+      MemoryResource *resource;
+      const char *text;
+      size_t offset;
+      // Nesting limit of the text, 0 for none
+      size_t max_depth;
+    };
+
+    static void release_lazy(const LazyText *lazy);
+
+    /**
+     * Storage of string and number values.
+     */
+    enum Storage
+    {
+      STORAGE_HEAP,
+      STORAGE_RESOURCE,
+      // Strings and numbers referencing the input
+      STORAGE_BORROWED,
+      // Integers above INT64_MAX
+      STORAGE_UNSIGNED,
+      // UTF-8 strings stored in place of length and value
+      STORAGE_SHORT,
+      // Lists and objects referencing their text in the input
+      STORAGE_LAZY,
+    };
+
+    /**
+     * Maximum size of a short string in bytes.
+     */
+    static const size_t short_capacity = 12;
+
+    inline char *short_text() const
+    { return (char *)&length; }
+
+    Type type : 8;
+    mutable Storage storage : 8;
+
+    // Length of short strings
+    mutable uint8_t short_length;
+
+    // Decoding flags of lazy containers
+    uint8_t lazy_flags;
+
+    // Length of borrowed strings and numbers, it fits in the padding before
+    // the union
+    mutable uint32_t length;
+
+    mutable union Values
     {
       bool v_boolean;
-      int v_integer;
+      int64_t v_integer;
+      uint64_t v_unsigned;
       double v_float;
       std::wstring *v_string;
+      const ResourceString *v_resource_string;
+      const char *v_borrowed_string;
+      const LazyText *v_lazy;
       List *v_list;
       Object *v_object;
     } value;
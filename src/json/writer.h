@@ -0,0 +1,189 @@
+/**
+ * @file
+ */
+#ifndef JSON_WRITER_H_INCLUDE
+#define JSON_WRITER_H_INCLUDE
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include <json/value.h>
+#include <json/sink.h>
+#include <json/exception.h>
+
+namespace Json
+{
+
+  DEFINE_EXCEPTION(WriterException);
+
+  class Encoder;
+
+  /**
+   * Incremental JSON encoder. The document is written value by value into a
+   * sink, through a buffer of fixed size, so that memory use only depends on
+   * the nesting depth and not on the size of the output. Strings and numbers
+   * are formatted as by JsonHandler::encode(), and without PRETTY the output
+   * is the same.
+   *
+   * @code
+   * Json::FdSink sink(fd);
+   * Json::Writer writer(sink);
+   *
+   * writer.begin_array();
+   * for (...)
+   *   {
+   *     writer.begin_object();
+   *     writer.key("id");
+   *     writer.value(id);
+   *     writer.end_object();
+   *   }
+   * writer.end_array();
+   * writer.finish();
+   * @endcode
+   *
+   * Calls which would make the document invalid, such as a value inside an
+   * object without a key, throw a WriterException.
+   */
+  class Writer
+  {
+  public:
+    enum Flags
+    {
+      /**
+       * Put every member and element on its own line, indented by two
+       * spaces per level.
+       */
+      PRETTY = 1,
+
+      /**
+       * Escape all non-ASCII characters instead of writing UTF-8.
+       */
+      ASCII = 2
+    };
+
+    /**
+     * Create a writer.
+     *
+     * @param sink Destination of the output.
+     * @param flags Combination of Flags.
+     */
+    Writer(Sink &sink, int flags = 0);
+
+    /**
+     * Destroy the writer. Output not handed over to the sink by flush() or
+     * finish() is lost.
+     */
+    ~Writer();
+
+    /**
+     * Start an object. Members are written as a key() followed by a value.
+     */
+    void begin_object();
+
+    /**
+     * Terminate the current object.
+     */
+    void end_object();
+
+    /**
+     * Start an array.
+     */
+    void begin_array();
+
+    /**
+     * Terminate the current array.
+     */
+    void end_array();
+
+    /**
+     * Write the key of the next object member.
+     */
+    void key(const std::wstring &name);
+
+    /**
+     * Write the key of the next object member, given as UTF-8.
+     */
+    void key(const char *name);
+
+    /**
+     * Write the key of the next object member, given as UTF-8.
+     */
+    void key(const char *name, size_t length);
+
+    /**
+     * Write a null value.
+     */
+    void null();
+
+    /**
+     * Write a value and all of its children.
+     */
+    void value(const Value &value);
+
+    void value(bool value);
+    void value(int value);
+    void value(int64_t value);
+    void value(uint64_t value);
+    void value(double value);
+    void value(const std::wstring &value);
+
+    /**
+     * Write a string given as UTF-8.
+     */
+    void value(const char *value);
+
+    /**
+     * Write a string given as UTF-8.
+     */
+    void value(const char *value, size_t length);
+
+    /**
+     * Hand the buffered output over to the sink.
+     */
+    void flush();
+
+    /**
+     * Check that the document is complete and flush the output.
+     *
+     * @throw WriterException if an object or an array is still open.
+     */
+    void finish();
+
+    /**
+     * Check if a complete value has been written.
+     */
+    inline bool is_complete() const
+    { return complete; }
+
+  private:
+    struct Frame
+    {
+      bool object;
+      bool empty;
+      bool has_key;
+    };
+
+    Frame &before_key();
+    void after_key(Frame &frame);
+    void before_value();
+    void after_value();
+    void separator(Frame &frame);
+    void close(bool object, char c);
+    void newline();
+
+  private:
+    Writer(const Writer &);
+    Writer &operator=(const Writer &);
+
+  private:
+    Encoder *encoder;
+    bool pretty;
+    bool complete;
+    std::vector< Frame > frames;
+  };
+
+} // namespace Json
+
+#endif // JSON_WRITER_H_INCLUDE
@@ -0,0 +1,149 @@
+#include "json/key.h"
+#include "json/stats.h"
+
+#include <functional>
+#include <string_view>
+
+using namespace Json;
+
+namespace
+{
+
+  // Number of slots of the pool when the first key is interned
+  const size_t initial_slots = 256;
+
+} // namespace
+
+size_t
+Json::hash_key(const wchar_t *data, size_t length)
+{
+  return std::hash< std::wstring_view >()(std::wstring_view(data, length));
+}
+
+Key::Symbol::Symbol(std::wstring &&text)
+  : references(0), hash(hash_key(text.data(), text.size())), text(std::move(text))
+{
+}
+
+Key::Key()
+{
+  // Shared by all empty keys, the extra reference keeps it alive
+  static Symbol *empty = []
+    {
+      Symbol *symbol = new Symbol(std::wstring());
+      symbol->references = 1;
+      return symbol;
+    }();
+
+  symbol = empty;
+  ++symbol->references;
+}
+
+Key::Key(const std::wstring &text)
+  : Key(new Symbol(std::wstring(text)))
+{
+  Stats::count_allocation(sizeof(Symbol) + text.size() * sizeof(wchar_t));
+}
+
+Key::Key(std::wstring &&text)
+  : Key(new Symbol(std::move(text)))
+{
+  Stats::count_allocation(sizeof(Symbol) + symbol->text.size() * sizeof(wchar_t));
+}
+
+Key::Key(const wchar_t *text)
+  : Key(new Symbol(std::wstring(text)))
+{
+  Stats::count_allocation(sizeof(Symbol) + symbol->text.size() * sizeof(wchar_t));
+}
+
+KeyPool::KeyPool(size_t max_keys, size_t max_length)
+  : max_keys(max_keys), max_length(max_length), count(0)
+{
+}
+
+KeyPool::~KeyPool()
+{
+  clear();
+}
+
+Key
+KeyPool::intern(const wchar_t *data, size_t length)
+{
+  if (length > max_length)
+    return Key(std::wstring(data, length));
+
+  size_t hash = hash_key(data, length);
+
+  if (!slots.empty())
+    {
+      size_t mask = slots.size() - 1;
+
+      for (size_t slot = hash & mask; slots[slot]; slot = (slot + 1) & mask)
+        {
+          Key::Symbol *symbol = slots[slot];
+
+          if (symbol->hash == hash && symbol->text.size() == length
+              && wmemcmp(symbol->text.data(), data, length) == 0)
+            return Key(symbol);
+        }
+    }
+
+  if (count >= max_keys)
+    return Key(std::wstring(data, length));
+
+  // The table is kept at most half full
+  if ((count + 1) * 2 > slots.size())
+    grow();
+
+  Stats::count_allocation(sizeof(Key::Symbol) + length * sizeof(wchar_t));
+
+  Key::Symbol *symbol = new Key::Symbol(std::wstring(data, length));
+  size_t mask = slots.size() - 1;
+  size_t slot = hash & mask;
+
+  while (slots[slot])
+    slot = (slot + 1) & mask;
+
+  // The pool holds a reference of its own
+  ++symbol->references;
+  slots[slot] = symbol;
+  ++count;
+
+  return Key(symbol);
+}
+
+void
+KeyPool::clear()
+{
+  for (size_t i = 0; i < slots.size(); ++i)
+    if (slots[i] && --slots[i]->references == 0)
+      delete slots[i];
+
+  slots.clear();
+  count = 0;
+}
+
+void
+KeyPool::grow()
+{
+  std::vector< Key::Symbol * > old;
+  old.swap(slots);
+
+  slots.assign(old.empty() ? initial_slots : old.size() * 2, NULL);
+
+  size_t mask = slots.size() - 1;
+
+  for (size_t i = 0; i < old.size(); ++i)
+    {
+      if (!old[i])
+        continue;
+
+      size_t slot = old[i]->hash & mask;
+
+      while (slots[slot])
+        slot = (slot + 1) & mask;
+
+      slots[slot] = old[i];
+    }
+}
@@ -0,0 +1,255 @@
+#include "json/ndjson.h"
+
+#include <atomic>
+#include <exception>
+#include <system_error>
+#include <thread>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace Json;
+
+namespace
+{
+
+  // Size of the reads from a file descriptor
+  const size_t read_size = 1 << 20;
+
+  inline bool is_blank(const char *data, size_t length)
+  {
+    for (size_t i = 0; i < length; ++i)
+      if (data[i] != ' ' && (data[i] < '\t' || data[i] > '\r'))
+        return false;
+
+    return true;
+  }
+
+} // namespace
+
+NdjsonReader::Callback::~Callback()
+{
+}
+
+bool
+NdjsonReader::Callback::error(size_t, const ParseError &)
+{
+  return false;
+}
+
+NdjsonReader::NdjsonReader(const char *encoding, unsigned threads, size_t batch_size)
+  : batch_size(batch_size ? batch_size : 1)
+{
+  if (!threads)
+    threads = std::thread::hardware_concurrency();
+
+  if (!threads)
+    threads = 1;
+
+  for (unsigned i = 0; i < threads; ++i)
+    handlers.push_back(new JsonHandler(encoding));
+}
+
+NdjsonReader::~NdjsonReader()
+{
+  for (size_t i = 0; i < handlers.size(); ++i)
+    delete handlers[i];
+}
+
+void
+NdjsonReader::read(const char *data, size_t length, Callback &callback)
+{
+  size_t line = 1;
+
+  read_lines(data, length, line, callback);
+  flush(callback);
+}
+
+void
+NdjsonReader::read(int fd, Callback &callback)
+{
+  std::vector< char > buffer(read_size);
+  size_t used = 0;
+  size_t line = 1;
+
+  lines.clear();
+
+  for (;;)
+    {
+      // A line longer than the buffer makes it grow
+      if (buffer.size() - used < read_size / 2)
+        buffer.resize(buffer.size() * 2);
+
+      ssize_t count = ::read(fd, &buffer[used], buffer.size() - used);
+
+      if (count < 0)
+        {
+          if (errno == EINTR)
+            continue;
+
+          throw IOError(strerror(errno));
+        }
+
+      if (count == 0)
+        break;
+
+      // Only decode up to the last complete line, the rest is kept for the
+      // next read
+      size_t complete = used + count;
+      used = complete;
+
+      while (complete > 0 && buffer[complete - 1] != '\n')
+        --complete;
+
+      if (!complete)
+        continue;
+
+      read_lines(&buffer[0], complete, line, callback);
+      flush(callback);
+
+      memmove(&buffer[0], &buffer[complete], used - complete);
+      used -= complete;
+    }
+
+  read_lines(&buffer[0], used, line, callback);
+  flush(callback);
+}
+
+namespace
+{
+
+  class Collector : public NdjsonReader::Callback
+  {
+  public:
+    Collector(std::vector< Value > &dest)
+      : dest(dest)
+    {
+    }
+
+    void record(size_t, Value &value)
+    {
+      dest.push_back(std::move(value));
+    }
+
+  private:
+    std::vector< Value > &dest;
+  };
+
+} // namespace
+
+void
+NdjsonReader::decode(std::vector< Value > &dest, const char *data, size_t length)
+{
+  Collector collector(dest);
+  read(data, length, collector);
+}
+
+void
+NdjsonReader::read_lines(const char *data, size_t length, size_t &line, Callback &callback)
+{
+  const char *end = data + length;
+
+  // Enough batches for every thread to get a few, so that a slow batch does
+  // not hold the others back
+  size_t round = handlers.size() * batch_size * 4;
+
+  while (data < end)
+    {
+      const char *next = (const char *)memchr(data, '\n', end - data);
+
+      if (!next)
+        next = end;
+
+      if (!is_blank(data, next - data))
+        {
+          Line current = { data, (size_t)(next - data), line };
+          lines.push_back(current);
+
+          if (lines.size() >= round)
+            flush(callback);
+        }
+
+      ++line;
+      data = next + 1;
+    }
+}
+
+void
+NdjsonReader::flush(Callback &callback)
+{
+  std::vector< Line > pending;
+  pending.swap(lines);
+
+  size_t count = pending.size();
+
+  if (!count)
+    return;
+
+  std::vector< Value > values(count);
+  std::vector< std::exception_ptr > errors(count);
+
+  size_t batches = (count + batch_size - 1) / batch_size;
+  std::atomic< size_t > next(0);
+
+  auto work = [&](JsonHandler *handler)
+    {
+      for (size_t batch; (batch = next++) < batches; )
+        {
+          size_t end = std::min(count, (batch + 1) * batch_size);
+
+          for (size_t i = batch * batch_size; i < end; ++i)
+            {
+              try
+                {
+                  handler->decode(values[i], NULL, pending[i].data, pending[i].length);
+                }
+              catch (...)
+                {
+                  errors[i] = std::current_exception();
+                }
+            }
+        }
+    };
+
+  std::vector< std::thread > threads;
+
+  for (size_t i = 1; i < handlers.size() && i < batches; ++i)
+    {
+      try
+        {
+          threads.push_back(std::thread(work, handlers[i]));
+        }
+      catch (const std::system_error &)
+        {
+          // The batches are shared out dynamically, the threads already
+          // running take over
+          break;
+        }
+    }
+
+  work(handlers[0]);
+
+  for (size_t i = 0; i < threads.size(); ++i)
+    threads[i].join();
+
+  for (size_t i = 0; i < count; ++i)
+    {
+      if (errors[i])
+        {
+          try
+            {
+              std::rethrow_exception(errors[i]);
+            }
+          catch (const ParseError &e)
+            {
+              if (!callback.error(pending[i].number, e))
+                throw;
+            }
+
+          continue;
+        }
+
+      callback.record(pending[i].number, values[i]);
+    }
+}
@@ -0,0 +1,144 @@
+#include "number.h"
+
+#ifdef HAVE_CONFIG_H
+#include "json/config.h"
+#endif
+
+#include <string>
+
+#include <locale.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if HAVE_CHARCONV_DOUBLE
+#include <charconv>
+#include <system_error>
+#endif
+
+using namespace Json;
+
+#if HAVE_CHARCONV_DOUBLE
+
+namespace
+{
+
+  // Value of a number out of the double range, depending on the sign of its
+  // mantissa and exponent
+  double out_of_range(const char *begin, const char *end)
+  {
+    const char *exponent = begin;
+
+    while (exponent < end && *exponent != 'e' && *exponent != 'E')
+      ++exponent;
+
+    double result = (exponent + 1 < end && exponent[1] == '-' ? 0.0 : HUGE_VAL);
+    return (*begin == '-' ? -result : result);
+  }
+
+} // namespace
+
+#endif
+
+double
+Number::parse_double(const char *begin, const char *end)
+{
+#if HAVE_CHARCONV_DOUBLE
+  double result = 0;
+  std::from_chars_result status = std::from_chars(begin, end, result);
+
+  if (status.ec == std::errc::result_out_of_range)
+    return out_of_range(begin, end);
+
+  return result;
+#else
+  // strtod depends on the locale for the decimal point, replace it by the
+  // expected one
+  std::string text(begin, end);
+  const char *point = localeconv()->decimal_point;
+  size_t dot = text.find('.');
+
+  if (dot != std::string::npos && strcmp(point, ".") != 0)
+    text.replace(dot, 1, point);
+
+  return strtod(text.c_str(), NULL);
+#endif
+}
+
+size_t
+Number::format_double(char *dest, double value)
+{
+  if (!isfinite(value))
+    {
+      memcpy(dest, "null", 4);
+      return 4;
+    }
+
+#if HAVE_CHARCONV_DOUBLE
+  std::to_chars_result status = std::to_chars(dest, dest + max_length, value);
+  return status.ptr - dest;
+#else
+  char buffer[max_length];
+  int length = 0;
+
+  // Look for the shortest precision giving the value back
+  for (int precision = 15; precision <= 17; ++precision)
+    {
+      length = snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+
+      if (precision == 17 || strtod(buffer, NULL) == value)
+        break;
+    }
+
+  // Put back the expected decimal point
+  for (int i = 0; i < length; ++i)
+    dest[i] = (buffer[i] == ',' ? '.' : buffer[i]);
+
+  return length;
+#endif
+}
+
+size_t
+Number::format_unsigned(char *dest, uint64_t value)
+{
+  static const char pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+  // Written backwards, two digits at a time
+  char buffer[max_length];
+  char *end = buffer + sizeof(buffer);
+  char *ptr = end;
+
+  while (value >= 100)
+    {
+      unsigned pair = (unsigned)(value % 100) * 2;
+      value /= 100;
+
+      *--ptr = pairs[pair + 1];
+      *--ptr = pairs[pair];
+    }
+
+  if (value >= 10)
+    {
+      *--ptr = pairs[value * 2 + 1];
+      *--ptr = pairs[value * 2];
+    }
+  else
+    *--ptr = '0' + value;
+
+  memcpy(dest, ptr, end - ptr);
+  return end - ptr;
+}
+
+size_t
+Number::format_integer(char *dest, int64_t value)
+{
+  if (value >= 0)
+    return format_unsigned(dest, value);
+
+  *dest = '-';
+  return format_unsigned(dest + 1, 0 - (uint64_t)value) + 1;
+}
@@ -0,0 +1,64 @@
+#ifndef JSON_NUMBER_H_INCLUDE
+#define JSON_NUMBER_H_INCLUDE
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Json
+{
+
+  /**
+   * Locale independent conversions between doubles and their JSON text.
+   * Parsing is correctly rounded and formatting produces the shortest text
+   * which parses back to the same double.
+   */
+  namespace Number
+  {
+
+    /**
+     * Size of a buffer large enough for any formatted double.
+     */
+    const size_t max_length = 32;
+
+    /**
+     * Convert the text of a JSON number. Numbers too large for a double give
+     * an infinity, numbers too small give zero.
+     *
+     * @param begin Start of the text, it must be a valid JSON number.
+     * @param end End of the text.
+     */
+    double parse_double(const char *begin, const char *end);
+
+    /**
+     * Format a double with as few digits as possible. Infinities and NaN,
+     * which JSON has no number for, are written as null.
+     *
+     * @param dest Destination buffer of at least max_length bytes, the result
+     *        is not NUL terminated.
+     * @return Length of the result.
+     */
+    size_t format_double(char *dest, double value);
+
+    /**
+     * Format a signed integer.
+     *
+     * @param dest Destination buffer of at least max_length bytes, the result
+     *        is not NUL terminated.
+     * @return Length of the result.
+     */
+    size_t format_integer(char *dest, int64_t value);
+
+    /**
+     * Format an unsigned integer.
+     *
+     * @param dest Destination buffer of at least max_length bytes, the result
+     *        is not NUL terminated.
+     * @return Length of the result.
+     */
+    size_t format_unsigned(char *dest, uint64_t value);
+
+  } // namespace Number
+
+} // namespace Json
+
+#endif // JSON_NUMBER_H_INCLUDE
@@ -0,0 +1,1360 @@
+#ifndef JSON_PARSER_H_INCLUDE
+#define JSON_PARSER_H_INCLUDE
+
+#include <sstream>
+
+#include <wctype.h>
+#include <float.h>
+#include <limits.h>
+#include <stdint.h>
+
+#include "json/json.h"
+#include "json/handler.h"
+#include "utf8.h"
+#include "simd.h"
+#include "number.h"
+
+namespace Json
+{
+
+  /**
+   * JSON parser. The parser either works on wide characters or directly on
+   * UTF-8 encoded bytes, in which case only the contents of string literals
+   * are transcoded. Lists and objects are parsed with an explicit stack
+   * instead of by recursion, so that deeply nested input can not overflow
+   * the call stack.
+   *
+   * Errors are recorded as a ParseResult and passed up as a false return
+   * value. The throwing functions turn the error into an exception once
+   * parsing has stopped, the try_ functions leave it to the caller.
+   *
+   * The parser reports the values it finds to a handler, see Json::Handler
+   * for the interface. The handler type is a template parameter so that the
+   * events of a concrete final handler, like ValueBuilder, get inlined.
+   *
+   * @tparam _Char Input character type, char (UTF-8) or wchar_t.
+   */
+  template < class _Char >
+    class Parser
+    {
+    public:
+      /**
+       * Create a parser for the given input buffer.
+       *
+       * @param data Input data, it is not required to be NUL terminated.
+       * @param length Length of the input in characters.
+       * @param max_depth Maximum nesting of lists and objects, 0 for no
+       *        limit.
+       */
+      Parser(const _Char *data, size_t length, size_t max_depth = 0)
+        : data(data), length(length), pos(0), depth(0), max_depth(max_depth ? max_depth : SIZE_MAX),
+          borrow(false), raw_numbers(false), lazy(false)
+      {
+#if JSON_STATS
+        stats = Stats::get_current();
+#endif
+      }
+
+      /**
+       * Let the strings without escape sequences reference the input, they
+       * are then reported with Handler::borrowed_string(). Only UTF-8 input
+       * supports it.
+       */
+      inline void set_borrow(bool borrow)
+      { this->borrow = borrow; }
+
+      /**
+       * Report numbers with Handler::raw_number(), as references to their
+       * text in the input. Only UTF-8 input supports it.
+       */
+      inline void set_raw_numbers(bool raw_numbers)
+      { this->raw_numbers = raw_numbers && sizeof(_Char) == 1; }
+
+      /**
+       * Report the lists and objects nested in the root value with
+       * Handler::lazy_container(), as references to their text in the input.
+       * Only UTF-8 input supports it.
+       */
+      inline void set_lazy(bool lazy)
+      { this->lazy = lazy && sizeof(_Char) == 1; }
+
+      /**
+       * Parse the first JSON value of the input, reporting it to handler.
+       *
+       * @throw ParseError if the input is invalid.
+       */
+      template < class _Handler >
+        void parse(_Handler &handler)
+        {
+          if (!parse_value(handler))
+            raise_error();
+        }
+
+      /**
+       * Parse the first JSON value of the input, see parse().
+       *
+       * @return false if the input is invalid, see get_error().
+       */
+      template < class _Handler >
+        bool try_parse(_Handler &handler)
+        {
+          return parse_value(handler);
+        }
+
+      /**
+       * Throw the exception of a parse error: UnexpectedEof, NestingTooDeep
+       * or InvalidCharacter.
+       */
+      static void raise_error(const ParseResult &error) JSON_NORETURN;
+
+      /**
+       * Get the error which stopped parsing.
+       */
+      inline const ParseResult &get_error() const
+      { return error; }
+
+      /**
+       * Get the position following the last parsed value.
+       */
+      inline size_t get_position() const
+      { return pos; }
+
+      /**
+       * Start parsing at a position of the input rather than at its start,
+       * the positions of the errors and of the lazy containers are then the
+       * ones in the whole input.
+       */
+      inline void set_position(size_t position)
+      { pos = position; }
+
+      /**
+       * Decode the first JSON value of the input into dest.
+       *
+       * @param dest Destination value.
+       * @param resource Resource to allocate strings and containers from,
+       *        the heap is used if it is NULL.
+       * @param flags JsonHandler::DecodeFlags, see set_borrow(),
+       *        set_raw_numbers() and set_lazy().
+       * @param pool Pool to intern object keys in, or NULL.
+       * @throw ParseError if the input is invalid.
+       */
+      void decode(Value &dest, MemoryResource *resource = NULL, int flags = 0, KeyPool *pool = NULL)
+      {
+        if (!try_decode(dest, resource, flags, pool))
+          raise_error();
+      }
+
+      /**
+       * Decode the first JSON value of the input into dest, see decode().
+       *
+       * @return false if the input is invalid, see get_error(). The values
+       *         decoded up to the error are left in dest.
+       */
+      bool try_decode(Value &dest, MemoryResource *resource = NULL, int flags = 0, KeyPool *pool = NULL)
+      {
+        set_borrow(flags & JsonHandler::BORROW_STRINGS);
+        set_raw_numbers(flags & JsonHandler::RAW_NUMBERS);
+        set_lazy(flags & JsonHandler::LAZY_CONTAINERS);
+
+        ValueBuilder builder(dest, resource, pool, flags);
+        return parse_value(builder);
+      }
+
+      /**
+       * Decode the first JSON value of the input.
+       */
+      Value decode()
+      {
+        Value result;
+        decode(result);
+        return result;
+      }
+
+      /**
+       * Decode the parts of the first JSON value of the input which match
+       * a path. The other parts are skipped and only checked for their
+       * brackets and strings, and the input is not read past the last match.
+       *
+       * @param path Path of the values.
+       * @param matches Matching values, appended in document order.
+       * @param limit Number of matches after which parsing stops.
+       * @param pool Pool to intern object keys in, or NULL.
+       */
+      void query(const Path &path, Value::List &matches, size_t limit, KeyPool *pool = NULL)
+      {
+        if (limit)
+          select(path.get_steps(), 0, matches, limit, pool);
+      }
+
+      /**
+       * Split the items of a list at the start of the input into ranges,
+       * which can then be decoded independently with decode_items(). The
+       * items are only checked for their brackets and strings.
+       *
+       * @param ranges Start and end positions of the ranges, each holding
+       *        one or more items separated by commas. The commas between
+       *        ranges are left out.
+       * @param range_size Size from which a range is ended at the next item.
+       * @return false if the input is not a list, the position is then left
+       *         at its first value.
+       */
+      bool split_list(std::vector< std::pair< size_t, size_t > > &ranges, size_t range_size);
+
+      /**
+       * Decode the comma separated items of a range found by split_list(),
+       * appending them to a list. Positions of the parse errors are the
+       * positions in the whole input.
+       *
+       * @param dest Destination list.
+       * @param start Start of the range.
+       * @param end End of the range.
+       * @param resource Resource to allocate strings and containers from,
+       *        the heap is used if it is NULL.
+       * @param flags JsonHandler::DecodeFlags, see decode().
+       * @param pool Pool to intern object keys in, or NULL.
+       */
+      void decode_items(Value::List &dest, size_t start, size_t end,
+                        MemoryResource *resource = NULL, int flags = 0, KeyPool *pool = NULL);
+
+    private:
+      template < class _Handler >
+        bool parse_value(_Handler &handler);
+      template < class _Handler >
+        bool parse_number(_Handler &handler);
+      template < class _Handler >
+        bool parse_key(_Handler &handler);
+
+      // Enter a list or an object
+      inline bool open(char type)
+      {
+        if (depth >= max_depth)
+          return fail(ParseResult::TOO_DEEP, pos);
+
+        ++pos;
+        ++depth;
+        count_depth();
+        stack.push_back(type);
+        return true;
+      }
+
+      // Leave the innermost list or object
+      template < class _Handler >
+        inline void close(_Handler &handler)
+        {
+          char type = stack.back();
+
+          ++pos;
+          --depth;
+          stack.pop_back();
+
+          if (type == '[')
+            handler.end_array();
+          else
+            handler.end_object();
+        }
+
+      template < class _Handler >
+        bool parse_borrowed(_Handler &handler, const char *);
+      template < class _Handler >
+        bool parse_borrowed(_Handler &, const wchar_t *)
+        { return false; }
+
+      bool read_string();
+
+      bool append_raw(std::wstring &dest);
+      bool unescape(wchar_t &dest);
+
+      size_t read_digits(uint64_t &mantissa, bool &overflow);
+
+      template < class _Handler >
+        bool report_raw(_Handler &handler, const char *, size_t start, Value::Type type)
+        {
+          handler.raw_number(data + start, pos - start, type);
+          return true;
+        }
+      template < class _Handler >
+        bool report_raw(_Handler &, const wchar_t *, size_t, Value::Type)
+        { return false; }
+
+      template < class _Handler >
+        bool report_lazy(_Handler &handler, const char *, Value::Type type)
+        {
+          size_t start = pos;
+
+          if (!skip_container())
+            return false;
+
+          // The container and its contents get the depth left under it
+          handler.lazy_container(data + start, pos - start, type, start,
+                                 max_depth == SIZE_MAX ? 0 : max_depth - depth);
+          return true;
+        }
+      // Not reached, see set_lazy()
+      template < class _Handler >
+        bool report_lazy(_Handler &, const wchar_t *, Value::Type)
+        { return false; }
+
+      bool skip_container(char inside = 0);
+      bool skip_string();
+      bool skip_value();
+
+      inline size_t scan_structure(size_t from) const;
+      inline size_t scan_string(size_t from) const;
+
+      bool select(const std::vector< Path::Step > &steps, size_t step,
+                  Value::List &matches, size_t limit, KeyPool *pool);
+
+      inline static double parse_double(const char *data, size_t start, size_t end)
+      { return Number::parse_double(data + start, data + end); }
+      static double parse_double(const wchar_t *data, size_t start, size_t end);
+
+      bool compare_forward(const char *expected);
+
+      inline _Char current() const
+      {
+        return pos < length ? data[pos] : 0;
+      }
+
+      inline _Char at(size_t offset) const
+      {
+        return pos + offset < length ? data[pos + offset] : 0;
+      }
+
+      inline static bool is_digit(_Char c)
+      {
+        return c >= '0' && c <= '9';
+      }
+
+      inline static bool is_space(_Char c);
+
+      inline void skip_spaces();
+
+      // Record an error, the return value is passed up to stop parsing
+      inline bool fail(ParseResult::Code code, size_t position)
+      {
+        error = ParseResult(code, position);
+        return false;
+      }
+
+      // Throw the recorded error
+      void raise_error() JSON_NORETURN;
+
+      inline void raise_error(ParseResult::Code code, size_t position)
+      {
+        fail(code, position);
+        raise_error();
+      }
+
+#if JSON_STATS
+      inline void count(uint64_t Stats::*counter)
+      {
+        if (stats)
+          ++(stats->*counter);
+      }
+
+      inline void count_depth()
+      {
+        if (stats && depth > stats->max_depth)
+          stats->max_depth = depth;
+      }
+#else
+      inline void count(uint64_t Stats::*)
+      {
+      }
+
+      inline void count_depth()
+      {
+      }
+#endif
+
+    private:
+      const _Char *data;
+      size_t length;
+      size_t pos;
+      // Number of lists and objects being parsed
+      size_t depth;
+      size_t max_depth;
+      // Lists and objects being parsed, '[' or '{'
+      std::vector< char > stack;
+      ParseResult error;
+      bool borrow;
+      bool raw_numbers;
+      bool lazy;
+#if JSON_STATS
+      // Statistics of the calling thread, or NULL
+      Stats *stats;
+#endif
+
+      // Scratch buffer reused by every string literal
+      std::wstring buffer;
+    };
+
+  template <>
+    inline bool Parser< char >::is_space(char c)
+    {
+      return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+  template <>
+    inline bool Parser< wchar_t >::is_space(wchar_t c)
+    {
+      return iswspace(c);
+    }
+
+  template < class _Char >
+    inline void Parser< _Char >::skip_spaces()
+    {
+      while (pos < length && is_space(data[pos]))
+        pos++;
+    }
+
+  template <>
+    inline void Parser< char >::skip_spaces()
+    {
+      // Most separators are a single character, only go for the vector scan
+      // when there is a longer run (indentation, line breaks)
+      if (pos < length && is_space(data[pos]))
+        {
+          ++pos;
+
+          if (pos < length && is_space(data[pos]))
+            pos = Simd::skip_spaces(data, pos, length);
+        }
+    }
+
+  template < class _Char >
+    template < class _Handler >
+      bool Parser< _Char >::parse_value(_Handler &handler)
+      {
+        // Containers opened by this call. Each turn parses a value, then
+        // closes the containers it ends and moves on to the next item.
+        size_t bottom = stack.size();
+
+        for (;;)
+          {
+            skip_spaces();
+
+            switch (current())
+              {
+              case 't':
+                if (!compare_forward("true"))
+                  return fail(ParseResult::INVALID_TOKEN, pos);
+
+                handler.boolean(true);
+                break;
+
+              case 'f':
+                if (!compare_forward("false"))
+                  return fail(ParseResult::INVALID_TOKEN, pos);
+
+                handler.boolean(false);
+                break;
+
+              case 'n':
+                if (!compare_forward("null"))
+                  return fail(ParseResult::INVALID_TOKEN, pos);
+
+                handler.null();
+                break;
+
+              case '"':
+                count(&Stats::strings);
+
+                if (!borrow || !parse_borrowed(handler, data))
+                  {
+                    if (!read_string())
+                      return false;
+
+                    handler.string(buffer);
+                  }
+                break;
+
+              case '{':
+                count(&Stats::objects);
+
+                if (lazy && depth)
+                  {
+                    if (!report_lazy(handler, data, Value::JSON_TYPE_OBJECT))
+                      return false;
+                    break;
+                  }
+
+                if (!open('{'))
+                  return false;
+
+                handler.begin_object();
+                skip_spaces();
+
+                if (current() == '}')
+                  {
+                    close(handler);
+                    break;
+                  }
+
+                if (!parse_key(handler))
+                  return false;
+                continue;
+
+              case '[':
+                count(&Stats::lists);
+
+                if (lazy && depth)
+                  {
+                    if (!report_lazy(handler, data, Value::JSON_TYPE_LIST))
+                      return false;
+                    break;
+                  }
+
+                if (!open('['))
+                  return false;
+
+                handler.begin_array();
+                skip_spaces();
+
+                if (current() == ']')
+                  {
+                    close(handler);
+                    break;
+                  }
+
+                if (!current())
+                  return fail(ParseResult::INVALID_LIST_END, pos);
+                continue;
+
+              default:
+                if (!is_digit(current()) && current() != '-')
+                  return fail(ParseResult::INVALID_CHARACTER, pos);
+
+                count(&Stats::numbers);
+
+                if (!parse_number(handler))
+                  return false;
+                break;
+              }
+
+            // The value is complete, close the containers it ends
+            for (;;)
+              {
+                if (stack.size() == bottom)
+                  return true;
+
+                skip_spaces();
+
+                if (stack.back() == '[')
+                  {
+                    if (current() == ',')
+                      {
+                        ++pos;
+                        skip_spaces();
+
+                        if (!current() || current() == ']')
+                          return fail(ParseResult::INVALID_LIST_END, pos);
+                        break;
+                      }
+
+                    if (current() != ']')
+                      return fail(ParseResult::INVALID_LIST_END, pos);
+                  }
+                else
+                  {
+                    if (current() == ',')
+                      {
+                        ++pos;
+
+                        if (!parse_key(handler))
+                          return false;
+                        break;
+                      }
+
+                    if (current() != '}')
+                      return fail(ParseResult::INVALID_OBJECT_END, pos);
+                  }
+
+                close(handler);
+              }
+          }
+      }
+
+  template < class _Char >
+    template < class _Handler >
+      bool Parser< _Char >::parse_key(_Handler &handler)
+      {
+        skip_spaces();
+
+        if (!current() || current() == '}')
+          return fail(ParseResult::INVALID_OBJECT_END, pos);
+
+        if (current() != '"')
+          return fail(ParseResult::EXPECTED_KEY, pos);
+
+        if (!read_string())
+          return false;
+
+        count(&Stats::keys);
+        handler.key(buffer);
+
+        skip_spaces();
+        if (current() != ':')
+          return fail(ParseResult::EXPECTED_COLON, pos);
+
+        ++pos;
+        return true;
+      }
+  template < class _Char >
+    bool Parser< _Char >::read_string()
+    {
+      std::wstring &str = buffer;
+      bool escape = false;
+
+      str.clear();
+
+      assert(current() == '"');
+      ++pos;
+
+      while (pos < length && (escape || data[pos] != '"'))
+        {
+          if (escape)
+            {
+              wchar_t c;
+
+              if (!unescape(c))
+                return false;
+
+              str.push_back(c);
+              escape = false;
+              continue;
+            }
+
+          if (data[pos] == '\\')
+            {
+              escape = true;
+              ++pos;
+              continue;
+            }
+
+          if (!append_raw(str))
+            return false;
+        }
+
+      if (pos >= length)
+        return fail(ParseResult::UNEXPECTED_EOF, pos);
+
+      assert(data[pos] == '"');
+      ++pos;
+      return true;
+    }
+
+  template < class _Char >
+    template < class _Handler >
+      bool Parser< _Char >::parse_borrowed(_Handler &handler, const char *)
+      {
+        size_t start = pos + 1;
+        size_t end = start;
+        unsigned code;
+
+        for (;;)
+          {
+            end = Simd::scan_string(data, end, length);
+
+            // Strings with escapes, unterminated strings and invalid UTF-8
+            // are left for read_string(), which reports the errors
+            if (end >= length || data[end] == '\\')
+              return false;
+
+            if (data[end] == '"')
+              break;
+
+            size_t next = end;
+
+            if (!utf8_decode(data, length, next, code))
+              return false;
+
+            end = next;
+          }
+
+        pos = end + 1;
+        handler.borrowed_string(data + start, end - start);
+        return true;
+      }
+
+  template < class _Char >
+    inline size_t Parser< _Char >::scan_structure(size_t from) const
+    {
+      while (from < length && data[from] != '"' && data[from] != '\\'
+             && data[from] != '[' && data[from] != ']' && data[from] != '{' && data[from] != '}')
+        ++from;
+
+      return from;
+    }
+
+  template <>
+    inline size_t Parser< char >::scan_structure(size_t from) const
+    {
+      return Simd::scan_structure(data, from, length);
+    }
+
+  template < class _Char >
+    inline size_t Parser< _Char >::scan_string(size_t from) const
+    {
+      while (from < length && data[from] != '"' && data[from] != '\\')
+        ++from;
+
+      return from;
+    }
+
+  template <>
+    inline size_t Parser< char >::scan_string(size_t from) const
+    {
+      return Simd::scan_string(data, from, length);
+    }
+
+  template < class _Char >
+    bool Parser< _Char >::skip_container(char inside)
+    {
+      bool in_string = false;
+      size_t base = stack.size();
+      size_t top;
+
+      // Only brackets outside of strings count, the contents are checked
+      // when the container is parsed. With inside, the parser is inside a
+      // container of that type, '[' or '{', between two values, which depth
+      // already counts. The skipped containers count for the nesting limit
+      // like the parsed ones.
+      if (inside)
+        stack.push_back(inside);
+
+      top = stack.size();
+
+      for (;;)
+        {
+          pos = scan_structure(pos);
+
+          if (pos >= length)
+            {
+              stack.resize(base);
+              return fail(ParseResult::UNEXPECTED_EOF, length);
+            }
+
+          char c = data[pos++];
+
+          if (c == '"')
+            in_string = !in_string;
+          else if (c == '\\')
+            ++pos;
+          else if (in_string)
+            continue;
+          else if (c == '[' || c == '{')
+            {
+              if (depth + (stack.size() - top) >= max_depth)
+                {
+                  stack.resize(base);
+                  return fail(ParseResult::TOO_DEEP, pos - 1);
+                }
+
+              stack.push_back(c);
+            }
+          else if ((c == ']') != (stack.back() == '['))
+            {
+              // Closed by the bracket of the other type
+              ParseResult::Code code = (stack.back() == '[' ? ParseResult::INVALID_LIST_END
+                                        : ParseResult::INVALID_OBJECT_END);
+
+              stack.resize(base);
+              return fail(code, pos - 1);
+            }
+          else
+            {
+              stack.pop_back();
+
+              if (stack.size() == base)
+                return true;
+            }
+        }
+    }
+
+  template < class _Char >
+    bool Parser< _Char >::skip_string()
+    {
+      assert(current() == '"');
+      ++pos;
+
+      // The run scan also stops at multi-byte sequences, which are skipped
+      // like any other character
+      for (;;)
+        {
+          pos = scan_string(pos);
+
+          if (pos >= length)
+            return fail(ParseResult::UNEXPECTED_EOF, length);
+
+          _Char c = data[pos++];
+
+          if (c == '"')
+            return true;
+
+          if (c == '\\')
+            ++pos;
+        }
+    }
+
+  template < class _Char >
+    bool Parser< _Char >::skip_value()
+    {
+      skip_spaces();
+
+      switch (current())
+        {
+        case '{':
+        case '[':
+          return skip_container();
+
+        case '"':
+          return skip_string();
+
+        default:
+          {
+            // Literals and numbers run up to the next separator
+            size_t start = pos;
+
+            while (pos < length && data[pos] != ',' && data[pos] != ']' && data[pos] != '}'
+                   && !is_space(data[pos]))
+              ++pos;
+
+            if (pos == start)
+              return fail(ParseResult::INVALID_CHARACTER, pos);
+
+            return true;
+          }
+        }
+    }
+
+  template < class _Char >
+    bool Parser< _Char >::select(const std::vector< Path::Step > &steps, size_t step,
+                                 Value::List &matches, size_t limit, KeyPool *pool)
+    {
+      skip_spaces();
+
+      if (step == steps.size())
+        {
+          matches.push_back(Value());
+
+          ValueBuilder builder(matches.back(), NULL, pool);
+
+          if (!parse_value(builder))
+            raise_error();
+
+          return matches.size() >= limit;
+        }
+
+      const Path::Step &current_step = steps[step];
+
+      if (current() == '{')
+        {
+          if (depth >= max_depth)
+            raise_error(ParseResult::TOO_DEEP, pos);
+
+          ++pos;
+          ++depth;
+          skip_spaces();
+
+          if (current() == '}')
+            {
+              ++pos;
+              --depth;
+              return false;
+            }
+
+          for (;;)
+            {
+              skip_spaces();
+              if (current() != '"')
+                raise_error(ParseResult::EXPECTED_KEY, pos);
+              if (!read_string())
+                raise_error();
+
+              bool match = current_step.wildcard || (current_step.has_key && buffer == current_step.key);
+
+              skip_spaces();
+              if (current() != ':')
+                raise_error(ParseResult::EXPECTED_COLON, pos);
+              ++pos;
+
+              if (!match)
+                {
+                  if (!skip_value())
+                    raise_error();
+                }
+              else if (select(steps, step + 1, matches, limit, pool))
+                return true;
+              else if (!current_step.wildcard)
+                {
+                  // The first member of a key is the one kept
+                  if (!skip_container('{'))
+                    raise_error();
+                  --depth;
+                  return false;
+                }
+
+              skip_spaces();
+              if (current() == ',')
+                {
+                  ++pos;
+                  continue;
+                }
+
+              if (current() != '}')
+                raise_error(ParseResult::INVALID_OBJECT_END, pos);
+
+              ++pos;
+              --depth;
+              return false;
+            }
+        }
+
+      if (current() == '[')
+        {
+          if (depth >= max_depth)
+            raise_error(ParseResult::TOO_DEEP, pos);
+
+          ++pos;
+          ++depth;
+          skip_spaces();
+
+          if (current() == ']')
+            {
+              ++pos;
+              --depth;
+              return false;
+            }
+
+          for (size_t index = 0;; ++index)
+            {
+              if (!current_step.wildcard && index != current_step.index)
+                {
+                  if (!skip_value())
+                    raise_error();
+                }
+              else if (select(steps, step + 1, matches, limit, pool))
+                return true;
+              else if (!current_step.wildcard)
+                {
+                  if (!skip_container('['))
+                    raise_error();
+                  --depth;
+                  return false;
+                }
+
+              skip_spaces();
+              if (current() == ',')
+                {
+                  ++pos;
+                  continue;
+                }
+
+              if (current() != ']')
+                raise_error(ParseResult::INVALID_LIST_END, pos);
+
+              ++pos;
+              --depth;
+              return false;
+            }
+        }
+
+      if (!skip_value())
+        raise_error();
+
+      return false;
+    }
+
+  template < class _Char >
+    bool Parser< _Char >::split_list(std::vector< std::pair< size_t, size_t > > &ranges, size_t range_size)
+    {
+      skip_spaces();
+
+      if (current() != '[')
+        return false;
+
+      // The items are inside the list, as far as the nesting limit goes
+      ++pos;
+      depth = 1;
+      skip_spaces();
+
+      if (current() == ']')
+        {
+          ++pos;
+          return true;
+        }
+
+      size_t start = pos;
+
+      for (;;)
+        {
+          if (!skip_value())
+            raise_error();
+
+          skip_spaces();
+
+          if (current() == ']')
+            {
+              ranges.push_back(std::make_pair(start, pos));
+              ++pos;
+              return true;
+            }
+
+          if (current() != ',')
+            raise_error(ParseResult::INVALID_LIST_END, pos);
+
+          if (pos - start >= range_size)
+            {
+              ranges.push_back(std::make_pair(start, pos));
+              start = pos + 1;
+            }
+
+          ++pos;
+        }
+    }
+
+  template < class _Char >
+    void Parser< _Char >::decode_items(Value::List &dest, size_t start, size_t end,
+                                       MemoryResource *resource, int flags, KeyPool *pool)
+    {
+      set_borrow(flags & JsonHandler::BORROW_STRINGS);
+      set_raw_numbers(flags & JsonHandler::RAW_NUMBERS);
+      set_lazy(flags & JsonHandler::LAZY_CONTAINERS);
+
+      // The items are inside the list, as far as lazy containers go
+      pos = start;
+      length = end;
+      depth = 1;
+
+      ValueBuilder builder(dest, resource, pool, flags);
+
+      for (;;)
+        {
+          if (!parse_value(builder))
+            raise_error();
+
+          skip_spaces();
+
+          if (pos >= length)
+            break;
+
+          if (current() != ',')
+            raise_error(ParseResult::INVALID_LIST_END, pos);
+
+          ++pos;
+        }
+    }
+
+  template <>
+    inline bool Parser< wchar_t >::append_raw(std::wstring &dest)
+    {
+      dest.push_back(data[pos]);
+      ++pos;
+      return true;
+    }
+
+  template <>
+    inline bool Parser< char >::append_raw(std::wstring &dest)
+    {
+      unsigned code;
+
+      if ((unsigned char)data[pos] < 0x80)
+        {
+          // Copy the whole run of plain characters up to the next quote,
+          // backslash or multi-byte sequence
+          size_t end = Simd::scan_string(data, pos + 1, length);
+
+          dest.append(data + pos, data + end);
+          pos = end;
+          return true;
+        }
+
+      if (!utf8_decode(data, length, pos, code))
+        return fail(ParseResult::INVALID_UTF8, pos);
+
+      append_code_point(dest, code);
+      return true;
+    }
+
+  template < class _Char >
+    template < class _Handler >
+      bool Parser< _Char >::parse_number(_Handler &handler)
+      {
+        size_t start = pos;
+        bool negative = false;
+
+        // Digits of the integer and fraction parts, exact unless they
+        // overflow 64 bits
+        uint64_t mantissa = 0;
+        bool overflow = false;
+        size_t fraction = 0;
+        int exponent = 0;
+        bool is_float = false;
+
+        // See if there is a signature
+        if (current() == '-')
+          {
+            negative = true;
+            ++pos;
+          }
+
+        if (!is_digit(current()))
+          return fail(ParseResult::INVALID_DIGIT, pos);
+
+        // Zero is a separate case
+        if (current() != '0')
+          read_digits(mantissa, overflow);
+        else
+          ++pos;
+
+        if (current() == '.')
+          {
+            ++pos;
+
+            if (!is_digit(current()))
+              return fail(ParseResult::INVALID_DIGIT, pos);
+
+            fraction = read_digits(mantissa, overflow);
+            is_float = true;
+          }
+
+        if (current() == 'e' || current() == 'E')
+          {
+            bool neg_exponent = false;
+            ++pos;
+
+            if (current() == '+')
+              {
+                ++pos;
+              }
+            else if (current() == '-')
+              {
+                neg_exponent = true;
+                ++pos;
+              }
+
+            if (!is_digit(current()))
+              return fail(ParseResult::INVALID_DIGIT, pos);
+
+            // Larger exponents overflow or underflow anyway
+            while (is_digit(current()))
+              {
+                if (exponent < 100000)
+                  exponent = exponent * 10 + current() - '0';
+                ++pos;
+              }
+
+            if (neg_exponent)
+              exponent = -exponent;
+
+            is_float = true;
+          }
+
+        // Integers too large for 64 bits, or below INT64_MIN, are parsed as
+        // floats
+        if (raw_numbers
+            && report_raw(handler, data, start,
+                          (is_float || overflow || (negative && mantissa > (uint64_t)INT64_MAX + 1)
+                           ? Value::JSON_TYPE_FLOAT : Value::JSON_TYPE_INTEGER)))
+          return true;
+
+        if (!is_float && !overflow)
+          {
+            if (mantissa <= (uint64_t)INT_MAX + negative)
+              {
+                handler.integer(negative ? (int)-(int64_t)mantissa : (int)mantissa);
+                return true;
+              }
+
+            if (!negative && mantissa > (uint64_t)INT64_MAX)
+              {
+                handler.unsigned_integer64(mantissa);
+                return true;
+              }
+
+            if (mantissa <= (uint64_t)INT64_MAX + negative)
+              {
+                handler.integer64(negative ? (int64_t)(0 - mantissa) : (int64_t)mantissa);
+                return true;
+              }
+          }
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+        // Both the mantissa and the power of ten are exact doubles, so that a
+        // single rounded operation gives the correctly rounded result
+        static const double powers[] = {
+          1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+          1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+        };
+
+        int scale = exponent - (int)fraction;
+
+        if (!overflow && mantissa <= ((uint64_t)1 << 53) && scale >= -22 && scale <= 22)
+          {
+            double value = (double)mantissa;
+            value = (scale < 0 ? value / powers[-scale] : value * powers[scale]);
+
+            handler.number(negative ? -value : value);
+            return true;
+          }
+#endif
+
+        handler.number(parse_double(data, start, pos));
+        return true;
+      }
+
+  template < class _Char >
+    size_t Parser< _Char >::read_digits(uint64_t &mantissa, bool &overflow)
+    {
+      // Largest mantissa which can take another digit
+      const uint64_t limit = UINT64_MAX / 10;
+      size_t start = pos;
+
+      while (is_digit(current()))
+        {
+          unsigned digit = current() - '0';
+
+          if (mantissa < limit || (mantissa == limit && digit <= UINT64_MAX % 10))
+            mantissa = mantissa * 10 + digit;
+          else
+            overflow = true;
+
+          ++pos;
+        }
+
+      return pos - start;
+    }
+
+  template < class _Char >
+    double Parser< _Char >::parse_double(const wchar_t *data, size_t start, size_t end)
+    {
+      // Number characters are all ASCII
+      char text[64];
+      std::string long_text;
+      char *dest = text;
+
+      if (end - start > sizeof(text))
+        {
+          long_text.resize(end - start);
+          dest = &long_text[0];
+        }
+
+      for (size_t i = start; i < end; ++i)
+        dest[i - start] = (char)data[i];
+
+      return Number::parse_double(dest, dest + (end - start));
+    }
+
+  template < class _Char >
+    bool Parser< _Char >::unescape(wchar_t &dest)
+    {
+      switch (current())
+        {
+        case 'b':
+          dest = L'\b';
+          break;
+
+        case 'f':
+          dest = L'\f';
+          break;
+
+        case 'n':
+          dest = L'\n';
+          break;
+
+        case 'r':
+          dest = L'\r';
+          break;
+
+        case 't':
+          dest = L'\t';
+          break;
+
+        case '"':
+        case '\\':
+        case '/':
+          dest = data[pos];
+          break;
+
+        case 'u':
+          {
+            unsigned code = 0;
+
+            for (int i = 1; i <= 4; ++i)
+              {
+                _Char c = at(i);
+                code <<= 4;
+
+                if (is_digit(c))
+                  code += c - '0';
+                else if (c >= 'A' && c <= 'F')
+                  code += c - 'A' + 10;
+                else if (c >= 'a' && c <= 'f')
+                  code += c - 'a' + 10;
+                else
+                  return fail(ParseResult::INVALID_HEX, pos + i);
+              }
+
+            pos += 4;
+            dest = (wchar_t)code;
+            break;
+          }
+
+        default:
+          return fail(ParseResult::INVALID_ESCAPE, pos);
+        }
+
+      ++pos;
+      return true;
+    }
+
+  template < class _Char >
+    bool Parser< _Char >::compare_forward(const char *expected)
+    {
+      size_t datapos = pos;
+      int exppos = 0;
+
+      while (datapos < length && expected[exppos] && data[datapos] == expected[exppos])
+        {
+          datapos++;
+          exppos++;
+        }
+
+      if (expected[exppos] == '\0')
+        {
+          pos = datapos;
+          return true;
+        }
+
+      return false;
+    }
+
+  template < class _Char >
+    void Parser< _Char >::raise_error()
+    {
+      raise_error(error);
+    }
+
+  template < class _Char >
+    void Parser< _Char >::raise_error(const ParseResult &error)
+    {
+      std::stringstream str;
+      str << error.get_message() << " at " << error.position;
+
+      switch (error.code)
+        {
+        case ParseResult::UNEXPECTED_EOF:
+          throw UnexpectedEof(str.str().c_str());
+
+        case ParseResult::TOO_DEEP:
+          throw NestingTooDeep(str.str().c_str());
+
+        default:
+          throw InvalidCharacter(str.str().c_str());
+        }
+    }
+
+} // namespace Json
+
+#endif // JSON_PARSER_H_INCLUDE
@@ -0,0 +1,205 @@
+#include "json/path.h"
+#include "utf8.h"
+
+using namespace Json;
+
+namespace
+{
+
+  Path::Step make_step(bool wildcard, bool has_key, const std::wstring &key, size_t index)
+  {
+    Path::Step step;
+
+    step.wildcard = wildcard;
+    step.has_key = has_key;
+    step.key = key;
+    step.index = index;
+    return step;
+  }
+
+  // Index written as digits without leading zeros, or npos
+  size_t parse_index(const std::wstring &text)
+  {
+    size_t index = 0;
+
+    if (text.empty() || (text[0] == L'0' && text.size() > 1))
+      return Path::npos;
+
+    for (size_t i = 0; i < text.size(); ++i)
+      {
+        if (text[i] < L'0' || text[i] > L'9')
+          return Path::npos;
+
+        size_t digit = text[i] - L'0';
+
+        if (index > (Path::npos - 1 - digit) / 10)
+          return Path::npos;
+
+        index = index * 10 + digit;
+      }
+
+    return index;
+  }
+
+  std::wstring decode_path(const std::string &path)
+  {
+    std::wstring result;
+    size_t pos = 0;
+    unsigned code;
+
+    while (pos < path.size())
+      {
+        if (!utf8_decode(path.data(), path.size(), pos, code))
+          throw PathException("Invalid UTF-8 in path");
+
+        append_code_point(result, code);
+      }
+
+    return result;
+  }
+
+} // namespace
+
+Path::Path(const std::wstring &path)
+  : wildcards(false)
+{
+  parse(path);
+}
+
+Path::Path(const std::string &path)
+  : wildcards(false)
+{
+  parse(decode_path(path));
+}
+
+Path::Path(const char *path)
+  : wildcards(false)
+{
+  parse(decode_path(path));
+}
+
+void
+Path::parse(const std::wstring &path)
+{
+  if (path.empty() || path[0] == L'/')
+    parse_pointer(path);
+  else if (path[0] == L'$')
+    parse_jsonpath(path);
+  else
+    throw PathException("Path is neither a JSON Pointer nor a JSONPath");
+}
+
+void
+Path::parse_pointer(const std::wstring &path)
+{
+  size_t pos = 0;
+
+  while (pos < path.size())
+    {
+      std::wstring token;
+
+      // Skip the slash
+      ++pos;
+
+      while (pos < path.size() && path[pos] != L'/')
+        {
+          if (path[pos] != L'~')
+            {
+              token.push_back(path[pos++]);
+              continue;
+            }
+
+          if (pos + 1 < path.size() && path[pos + 1] == L'0')
+            token.push_back(L'~');
+          else if (pos + 1 < path.size() && path[pos + 1] == L'1')
+            token.push_back(L'/');
+          else
+            throw PathException("Invalid escape sequence in JSON Pointer");
+
+          pos += 2;
+        }
+
+      steps.push_back(make_step(false, true, token, parse_index(token)));
+    }
+}
+
+void
+Path::parse_jsonpath(const std::wstring &path)
+{
+  size_t pos = 1;
+
+  while (pos < path.size())
+    {
+      if (path[pos] == L'.')
+        {
+          size_t start = ++pos;
+
+          if (pos < path.size() && path[pos] == L'*')
+            {
+              steps.push_back(make_step(true, false, std::wstring(), npos));
+              wildcards = true;
+              ++pos;
+              continue;
+            }
+
+          while (pos < path.size() && path[pos] != L'.' && path[pos] != L'[')
+            ++pos;
+
+          if (pos == start)
+            throw PathException("Empty member name in JSONPath");
+
+          steps.push_back(make_step(false, true, path.substr(start, pos - start), npos));
+        }
+      else if (path[pos] == L'[')
+        {
+          size_t end;
+          ++pos;
+
+          if (pos < path.size() && path[pos] == L'*')
+            {
+              steps.push_back(make_step(true, false, std::wstring(), npos));
+              wildcards = true;
+              end = pos + 1;
+            }
+          else if (pos < path.size() && (path[pos] == L'\'' || path[pos] == L'"'))
+            {
+              wchar_t quote = path[pos++];
+              std::wstring key;
+
+              // A backslash escapes the next character
+              while (pos < path.size() && path[pos] != quote)
+                {
+                  if (path[pos] == L'\\')
+                    ++pos;
+
+                  if (pos < path.size())
+                    key.push_back(path[pos++]);
+                }
+
+              if (pos >= path.size())
+                throw PathException("Unterminated member name in JSONPath");
+
+              steps.push_back(make_step(false, true, key, npos));
+              end = pos + 1;
+            }
+          else
+            {
+              end = path.find(L']', pos);
+
+              size_t index = (end == std::wstring::npos ? npos : parse_index(path.substr(pos, end - pos)));
+
+              if (index == npos)
+                throw PathException("Invalid index in JSONPath");
+
+              steps.push_back(make_step(false, false, std::wstring(), index));
+            }
+
+          if (end >= path.size() || path[end] != L']')
+            throw PathException("Expected ']' in JSONPath");
+
+          pos = end + 1;
+        }
+      else
+        throw PathException("Invalid character in JSONPath");
+    }
+}
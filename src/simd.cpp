@@ -0,0 +1,689 @@
+#include "simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define JSON_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define JSON_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+using namespace Json;
+
+namespace
+{
+
+  inline bool is_space(unsigned char c)
+  {
+    return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+  }
+
+  inline bool is_string_special(unsigned char c)
+  {
+    return c == '"' || c == '\\' || c >= 0x80;
+  }
+
+  // Brackets and braces only differ in bit 5: '[' and '{', ']' and '}'
+  inline bool is_structure(unsigned char c)
+  {
+    return c == '"' || c == '\\' || (c | 0x20) == '{' || (c | 0x20) == '}';
+  }
+
+  inline bool needs_escape(unsigned c)
+  {
+    return c < 0x20 || c == '"' || c == '\\' || c == '/' || c == 0x7F;
+  }
+
+  size_t skip_spaces_scalar(const char *data, size_t pos, size_t length)
+  {
+    while (pos < length && is_space(data[pos]))
+      ++pos;
+
+    return pos;
+  }
+
+  size_t scan_string_scalar(const char *data, size_t pos, size_t length)
+  {
+    while (pos < length && !is_string_special(data[pos]))
+      ++pos;
+
+    return pos;
+  }
+
+  size_t scan_structure_scalar(const char *data, size_t pos, size_t length)
+  {
+    while (pos < length && !is_structure(data[pos]))
+      ++pos;
+
+    return pos;
+  }
+
+  size_t scan_escape_scalar(const char *data, size_t pos, size_t length, bool ascii)
+  {
+    unsigned char high = ascii ? 0x80 : 0;
+
+    while (pos < length && !needs_escape((unsigned char)data[pos])
+           && !((unsigned char)data[pos] & high))
+      ++pos;
+
+    return pos;
+  }
+
+  size_t copy_plain_scalar(char *dest, const wchar_t *src, size_t length)
+  {
+    size_t i = 0;
+
+    while (i < length && (unsigned)src[i] < 0x80 && !needs_escape(src[i]))
+      {
+        dest[i] = (char)src[i];
+        ++i;
+      }
+
+    return i;
+  }
+
+  size_t widen_ascii_scalar(wchar_t *dest, const char *src, size_t length)
+  {
+    size_t i = 0;
+
+    while (i < length && (unsigned char)src[i] < 0x80)
+      {
+        dest[i] = src[i];
+        ++i;
+      }
+
+    return i;
+  }
+
+  size_t narrow_ascii_scalar(char *dest, const wchar_t *src, size_t length)
+  {
+    size_t i = 0;
+
+    while (i < length && (unsigned)src[i] < 0x80)
+      {
+        dest[i] = (char)src[i];
+        ++i;
+      }
+
+    return i;
+  }
+
+#if JSON_SIMD_X86
+
+  inline __m128i space_mask_sse2(__m128i chunk)
+  {
+    __m128i space = _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' '));
+    __m128i control = _mm_subs_epu8(_mm_sub_epi8(chunk, _mm_set1_epi8('\t')),
+                                    _mm_set1_epi8('\r' - '\t'));
+
+    return _mm_or_si128(space, _mm_cmpeq_epi8(control, _mm_setzero_si128()));
+  }
+
+  size_t skip_spaces_sse2(const char *data, size_t pos, size_t length)
+  {
+    while (pos + 16 <= length)
+      {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(data + pos));
+        unsigned mask = ~_mm_movemask_epi8(space_mask_sse2(chunk)) & 0xFFFF;
+
+        if (mask)
+          return pos + __builtin_ctz(mask);
+
+        pos += 16;
+      }
+
+    return skip_spaces_scalar(data, pos, length);
+  }
+
+  size_t scan_string_sse2(const char *data, size_t pos, size_t length)
+  {
+    while (pos + 16 <= length)
+      {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(data + pos));
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')),
+                                       _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\')));
+        unsigned mask = _mm_movemask_epi8(_mm_or_si128(special, chunk));
+
+        if (mask)
+          return pos + __builtin_ctz(mask);
+
+        pos += 16;
+      }
+
+    return scan_string_scalar(data, pos, length);
+  }
+
+  size_t scan_structure_sse2(const char *data, size_t pos, size_t length)
+  {
+    while (pos + 16 <= length)
+      {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(data + pos));
+        __m128i folded = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')),
+                                       _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\')));
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(folded, _mm_set1_epi8('{')));
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(folded, _mm_set1_epi8('}')));
+        unsigned mask = _mm_movemask_epi8(special);
+
+        if (mask)
+          return pos + __builtin_ctz(mask);
+
+        pos += 16;
+      }
+
+    return scan_structure_scalar(data, pos, length);
+  }
+
+  inline __m128i escape_mask_sse2(__m128i chunk)
+  {
+    __m128i mask = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')),
+                                _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\')));
+    mask = _mm_or_si128(mask, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('/')));
+    mask = _mm_or_si128(mask, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(0x7F)));
+
+    // Control characters are the bytes which do not exceed 0x1F
+    __m128i control = _mm_subs_epu8(chunk, _mm_set1_epi8(0x1F));
+    return _mm_or_si128(mask, _mm_cmpeq_epi8(control, _mm_setzero_si128()));
+  }
+
+  size_t scan_escape_sse2(const char *data, size_t pos, size_t length, bool ascii)
+  {
+    __m128i high = _mm_set1_epi8(ascii ? (char)0x80 : 0);
+
+    while (pos + 16 <= length)
+      {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(data + pos));
+        __m128i special = _mm_or_si128(escape_mask_sse2(chunk), _mm_and_si128(chunk, high));
+        unsigned mask = _mm_movemask_epi8(special);
+
+        if (mask)
+          return pos + __builtin_ctz(mask);
+
+        pos += 16;
+      }
+
+    return scan_escape_scalar(data, pos, length, ascii);
+  }
+
+#if __SIZEOF_WCHAR_T__ == 4
+
+  // Mask of the characters of a block of four which cannot be copied
+  inline __m128i escape_mask_wide_sse2(__m128i chunk)
+  {
+    // Printable ASCII is the range 0x20 to 0x7E, compared unsigned
+    __m128i offset = _mm_xor_si128(_mm_sub_epi32(chunk, _mm_set1_epi32(0x20)),
+                                   _mm_set1_epi32((int)0x80000000));
+    __m128i printable = _mm_cmplt_epi32(offset, _mm_set1_epi32((int)0x8000005F));
+    __m128i mask = _mm_or_si128(_mm_cmpeq_epi32(chunk, _mm_set1_epi32('"')),
+                                _mm_cmpeq_epi32(chunk, _mm_set1_epi32('\\')));
+    mask = _mm_or_si128(mask, _mm_cmpeq_epi32(chunk, _mm_set1_epi32('/')));
+
+    return _mm_or_si128(mask, _mm_andnot_si128(printable, _mm_set1_epi32(-1)));
+  }
+
+  size_t copy_plain_sse2(char *dest, const wchar_t *src, size_t length)
+  {
+    size_t i = 0;
+
+    while (i + 8 <= length)
+      {
+        __m128i low = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i high = _mm_loadu_si128((const __m128i *)(src + i + 4));
+        __m128i mask = _mm_or_si128(escape_mask_wide_sse2(low), escape_mask_wide_sse2(high));
+
+        if (_mm_movemask_epi8(mask))
+          break;
+
+        // All characters are below 0x7F, so the saturating packs are exact
+        __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(low, high), _mm_setzero_si128());
+        _mm_storel_epi64((__m128i *)(dest + i), bytes);
+        i += 8;
+      }
+
+    return i + copy_plain_scalar(dest + i, src + i, length - i);
+  }
+
+  size_t widen_ascii_sse2(wchar_t *dest, const char *src, size_t length)
+  {
+    __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+
+    while (i + 16 <= length)
+      {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(src + i));
+
+        if (_mm_movemask_epi8(chunk))
+          break;
+
+        __m128i low = _mm_unpacklo_epi8(chunk, zero);
+        __m128i high = _mm_unpackhi_epi8(chunk, zero);
+        _mm_storeu_si128((__m128i *)(dest + i), _mm_unpacklo_epi16(low, zero));
+        _mm_storeu_si128((__m128i *)(dest + i + 4), _mm_unpackhi_epi16(low, zero));
+        _mm_storeu_si128((__m128i *)(dest + i + 8), _mm_unpacklo_epi16(high, zero));
+        _mm_storeu_si128((__m128i *)(dest + i + 12), _mm_unpackhi_epi16(high, zero));
+        i += 16;
+      }
+
+    return i + widen_ascii_scalar(dest + i, src + i, length - i);
+  }
+
+  size_t narrow_ascii_sse2(char *dest, const wchar_t *src, size_t length)
+  {
+    __m128i high_bits = _mm_set1_epi32(~0x7F);
+    size_t i = 0;
+
+    while (i + 8 <= length)
+      {
+        __m128i low = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i high = _mm_loadu_si128((const __m128i *)(src + i + 4));
+        __m128i rest = _mm_and_si128(_mm_or_si128(low, high), high_bits);
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(rest, _mm_setzero_si128())) != 0xFFFF)
+          break;
+
+        __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(low, high), _mm_setzero_si128());
+        _mm_storel_epi64((__m128i *)(dest + i), bytes);
+        i += 8;
+      }
+
+    return i + narrow_ascii_scalar(dest + i, src + i, length - i);
+  }
+
+#else
+
+  size_t copy_plain_sse2(char *dest, const wchar_t *src, size_t length)
+  {
+    return copy_plain_scalar(dest, src, length);
+  }
+
+  size_t widen_ascii_sse2(wchar_t *dest, const char *src, size_t length)
+  {
+    return widen_ascii_scalar(dest, src, length);
+  }
+
+  size_t narrow_ascii_sse2(char *dest, const wchar_t *src, size_t length)
+  {
+    return narrow_ascii_scalar(dest, src, length);
+  }
+
+#endif // __SIZEOF_WCHAR_T__ == 4
+
+  __attribute__ ((target ("avx2")))
+  size_t skip_spaces_avx2(const char *data, size_t pos, size_t length)
+  {
+    while (pos + 32 <= length)
+      {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(data + pos));
+        __m256i space = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' '));
+        __m256i control = _mm256_subs_epu8(_mm256_sub_epi8(chunk, _mm256_set1_epi8('\t')),
+                                           _mm256_set1_epi8('\r' - '\t'));
+        space = _mm256_or_si256(space, _mm256_cmpeq_epi8(control, _mm256_setzero_si256()));
+        unsigned mask = ~(unsigned)_mm256_movemask_epi8(space);
+
+        if (mask)
+          return pos + __builtin_ctz(mask);
+
+        pos += 32;
+      }
+
+    // The SSE2 code handling the end stalls if the upper halves are left
+    // dirty, the compiler does not clear them before a tail call
+    _mm256_zeroupper();
+    return skip_spaces_sse2(data, pos, length);
+  }
+
+  __attribute__ ((target ("avx2")))
+  size_t scan_string_avx2(const char *data, size_t pos, size_t length)
+  {
+    while (pos + 32 <= length)
+      {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(data + pos));
+        __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')),
+                                          _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\')));
+        unsigned mask = _mm256_movemask_epi8(_mm256_or_si256(special, chunk));
+
+        if (mask)
+          return pos + __builtin_ctz(mask);
+
+        pos += 32;
+      }
+
+    _mm256_zeroupper();
+    return scan_string_sse2(data, pos, length);
+  }
+
+  __attribute__ ((target ("avx2")))
+  size_t scan_structure_avx2(const char *data, size_t pos, size_t length)
+  {
+    while (pos + 32 <= length)
+      {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(data + pos));
+        __m256i folded = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+        __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')),
+                                          _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\')));
+        special = _mm256_or_si256(special, _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')));
+        special = _mm256_or_si256(special, _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}')));
+        unsigned mask = _mm256_movemask_epi8(special);
+
+        if (mask)
+          return pos + __builtin_ctz(mask);
+
+        pos += 32;
+      }
+
+    _mm256_zeroupper();
+    return scan_structure_sse2(data, pos, length);
+  }
+
+  __attribute__ ((target ("avx2")))
+  size_t scan_escape_avx2(const char *data, size_t pos, size_t length, bool ascii)
+  {
+    __m256i high = _mm256_set1_epi8(ascii ? (char)0x80 : 0);
+
+    while (pos + 32 <= length)
+      {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(data + pos));
+        __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')),
+                                          _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\')));
+        special = _mm256_or_si256(special, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('/')));
+        special = _mm256_or_si256(special, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(0x7F)));
+
+        __m256i control = _mm256_subs_epu8(chunk, _mm256_set1_epi8(0x1F));
+        special = _mm256_or_si256(special, _mm256_cmpeq_epi8(control, _mm256_setzero_si256()));
+        special = _mm256_or_si256(special, _mm256_and_si256(chunk, high));
+
+        unsigned mask = _mm256_movemask_epi8(special);
+
+        if (mask)
+          return pos + __builtin_ctz(mask);
+
+        pos += 32;
+      }
+
+    _mm256_zeroupper();
+    return scan_escape_sse2(data, pos, length, ascii);
+  }
+
+#endif // JSON_SIMD_X86
+
+#if JSON_SIMD_NEON
+
+  inline bool any_neon(uint8x16_t mask)
+  {
+    uint64x2_t wide = vreinterpretq_u64_u8(mask);
+    return (vgetq_lane_u64(wide, 0) | vgetq_lane_u64(wide, 1)) != 0;
+  }
+
+  size_t skip_spaces_neon(const char *data, size_t pos, size_t length)
+  {
+    while (pos + 16 <= length)
+      {
+        uint8x16_t chunk = vld1q_u8((const uint8_t *)(data + pos));
+        uint8x16_t space = vorrq_u8(vceqq_u8(chunk, vdupq_n_u8(' ')),
+                                    vcleq_u8(vsubq_u8(chunk, vdupq_n_u8('\t')),
+                                             vdupq_n_u8('\r' - '\t')));
+
+        if (any_neon(vmvnq_u8(space)))
+          break;
+
+        pos += 16;
+      }
+
+    return skip_spaces_scalar(data, pos, length);
+  }
+
+  size_t scan_string_neon(const char *data, size_t pos, size_t length)
+  {
+    while (pos + 16 <= length)
+      {
+        uint8x16_t chunk = vld1q_u8((const uint8_t *)(data + pos));
+        uint8x16_t special = vorrq_u8(vorrq_u8(vceqq_u8(chunk, vdupq_n_u8('"')),
+                                               vceqq_u8(chunk, vdupq_n_u8('\\'))),
+                                      vcgeq_u8(chunk, vdupq_n_u8(0x80)));
+
+        if (any_neon(special))
+          break;
+
+        pos += 16;
+      }
+
+    return scan_string_scalar(data, pos, length);
+  }
+
+  size_t scan_structure_neon(const char *data, size_t pos, size_t length)
+  {
+    while (pos + 16 <= length)
+      {
+        uint8x16_t chunk = vld1q_u8((const uint8_t *)(data + pos));
+        uint8x16_t folded = vorrq_u8(chunk, vdupq_n_u8(0x20));
+        uint8x16_t special = vorrq_u8(vceqq_u8(chunk, vdupq_n_u8('"')),
+                                      vceqq_u8(chunk, vdupq_n_u8('\\')));
+        special = vorrq_u8(special, vceqq_u8(folded, vdupq_n_u8('{')));
+        special = vorrq_u8(special, vceqq_u8(folded, vdupq_n_u8('}')));
+
+        if (any_neon(special))
+          break;
+
+        pos += 16;
+      }
+
+    return scan_structure_scalar(data, pos, length);
+  }
+
+  size_t scan_escape_neon(const char *data, size_t pos, size_t length, bool ascii)
+  {
+    uint8x16_t high = vdupq_n_u8(ascii ? 0x80 : 0);
+
+    while (pos + 16 <= length)
+      {
+        uint8x16_t chunk = vld1q_u8((const uint8_t *)(data + pos));
+        uint8x16_t special = vorrq_u8(vceqq_u8(chunk, vdupq_n_u8('"')),
+                                      vceqq_u8(chunk, vdupq_n_u8('\\')));
+        special = vorrq_u8(special, vceqq_u8(chunk, vdupq_n_u8('/')));
+        special = vorrq_u8(special, vceqq_u8(chunk, vdupq_n_u8(0x7F)));
+        special = vorrq_u8(special, vcltq_u8(chunk, vdupq_n_u8(0x20)));
+        special = vorrq_u8(special, vtstq_u8(chunk, high));
+
+        if (any_neon(special))
+          break;
+
+        pos += 16;
+      }
+
+    return scan_escape_scalar(data, pos, length, ascii);
+  }
+
+#if __SIZEOF_WCHAR_T__ == 4
+
+  inline uint32x4_t escape_mask_wide_neon(uint32x4_t chunk)
+  {
+    uint32x4_t printable = vcltq_u32(vsubq_u32(chunk, vdupq_n_u32(0x20)), vdupq_n_u32(0x5F));
+    uint32x4_t mask = vorrq_u32(vceqq_u32(chunk, vdupq_n_u32('"')),
+                                vceqq_u32(chunk, vdupq_n_u32('\\')));
+    mask = vorrq_u32(mask, vceqq_u32(chunk, vdupq_n_u32('/')));
+
+    return vorrq_u32(mask, vmvnq_u32(printable));
+  }
+
+  size_t copy_plain_neon(char *dest, const wchar_t *src, size_t length)
+  {
+    size_t i = 0;
+
+    while (i + 8 <= length)
+      {
+        uint32x4_t low = vld1q_u32((const uint32_t *)(src + i));
+        uint32x4_t high = vld1q_u32((const uint32_t *)(src + i + 4));
+        uint32x4_t mask = vorrq_u32(escape_mask_wide_neon(low), escape_mask_wide_neon(high));
+
+        if (any_neon(vreinterpretq_u8_u32(mask)))
+          break;
+
+        uint16x8_t words = vcombine_u16(vmovn_u32(low), vmovn_u32(high));
+        vst1_u8((uint8_t *)(dest + i), vmovn_u16(words));
+        i += 8;
+      }
+
+    return i + copy_plain_scalar(dest + i, src + i, length - i);
+  }
+
+  size_t widen_ascii_neon(wchar_t *dest, const char *src, size_t length)
+  {
+    size_t i = 0;
+
+    while (i + 16 <= length)
+      {
+        uint8x16_t chunk = vld1q_u8((const uint8_t *)(src + i));
+
+        if (any_neon(vcgeq_u8(chunk, vdupq_n_u8(0x80))))
+          break;
+
+        uint16x8_t low = vmovl_u8(vget_low_u8(chunk));
+        uint16x8_t high = vmovl_u8(vget_high_u8(chunk));
+        vst1q_u32((uint32_t *)(dest + i), vmovl_u16(vget_low_u16(low)));
+        vst1q_u32((uint32_t *)(dest + i + 4), vmovl_u16(vget_high_u16(low)));
+        vst1q_u32((uint32_t *)(dest + i + 8), vmovl_u16(vget_low_u16(high)));
+        vst1q_u32((uint32_t *)(dest + i + 12), vmovl_u16(vget_high_u16(high)));
+        i += 16;
+      }
+
+    return i + widen_ascii_scalar(dest + i, src + i, length - i);
+  }
+
+  size_t narrow_ascii_neon(char *dest, const wchar_t *src, size_t length)
+  {
+    size_t i = 0;
+
+    while (i + 8 <= length)
+      {
+        uint32x4_t low = vld1q_u32((const uint32_t *)(src + i));
+        uint32x4_t high = vld1q_u32((const uint32_t *)(src + i + 4));
+
+        if (any_neon(vreinterpretq_u8_u32(vcgtq_u32(vorrq_u32(low, high), vdupq_n_u32(0x7F)))))
+          break;
+
+        uint16x8_t words = vcombine_u16(vmovn_u32(low), vmovn_u32(high));
+        vst1_u8((uint8_t *)(dest + i), vmovn_u16(words));
+        i += 8;
+      }
+
+    return i + narrow_ascii_scalar(dest + i, src + i, length - i);
+  }
+
+#else
+
+  size_t copy_plain_neon(char *dest, const wchar_t *src, size_t length)
+  {
+    return copy_plain_scalar(dest, src, length);
+  }
+
+  size_t widen_ascii_neon(wchar_t *dest, const char *src, size_t length)
+  {
+    return widen_ascii_scalar(dest, src, length);
+  }
+
+  size_t narrow_ascii_neon(char *dest, const wchar_t *src, size_t length)
+  {
+    return narrow_ascii_scalar(dest, src, length);
+  }
+
+#endif // __SIZEOF_WCHAR_T__ == 4
+
+#endif // JSON_SIMD_NEON
+
+  struct Implementation
+  {
+    const char *name;
+    size_t (*skip_spaces)(const char *data, size_t pos, size_t length);
+    size_t (*scan_string)(const char *data, size_t pos, size_t length);
+    size_t (*scan_structure)(const char *data, size_t pos, size_t length);
+    size_t (*scan_escape)(const char *data, size_t pos, size_t length, bool ascii);
+    size_t (*copy_plain)(char *dest, const wchar_t *src, size_t length);
+    size_t (*widen_ascii)(wchar_t *dest, const char *src, size_t length);
+    size_t (*narrow_ascii)(char *dest, const wchar_t *src, size_t length);
+  };
+
+  Implementation select_implementation()
+  {
+#if JSON_SIMD_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+      {
+        Implementation avx2 = { "avx2", skip_spaces_avx2, scan_string_avx2,
+                                scan_structure_avx2, scan_escape_avx2, copy_plain_sse2,
+                                widen_ascii_sse2, narrow_ascii_sse2 };
+        return avx2;
+      }
+
+    Implementation sse2 = { "sse2", skip_spaces_sse2, scan_string_sse2,
+                            scan_structure_sse2, scan_escape_sse2, copy_plain_sse2,
+                            widen_ascii_sse2, narrow_ascii_sse2 };
+    return sse2;
+#elif JSON_SIMD_NEON
+    Implementation neon = { "neon", skip_spaces_neon, scan_string_neon,
+                            scan_structure_neon, scan_escape_neon, copy_plain_neon,
+                            widen_ascii_neon, narrow_ascii_neon };
+    return neon;
+#else
+    Implementation scalar = { "scalar", skip_spaces_scalar, scan_string_scalar,
+                              scan_structure_scalar, scan_escape_scalar, copy_plain_scalar,
+                              widen_ascii_scalar, narrow_ascii_scalar };
+    return scalar;
+#endif
+  }
+
+  const Implementation &implementation()
+  {
+    static const Implementation selected = select_implementation();
+    return selected;
+  }
+
+} // namespace
+
+size_t
+Simd::skip_spaces(const char *data, size_t pos, size_t length)
+{
+  return ::implementation().skip_spaces(data, pos, length);
+}
+
+size_t
+Simd::scan_string(const char *data, size_t pos, size_t length)
+{
+  return ::implementation().scan_string(data, pos, length);
+}
+
+size_t
+Simd::scan_structure(const char *data, size_t pos, size_t length)
+{
+  return ::implementation().scan_structure(data, pos, length);
+}
+
+size_t
+Simd::scan_escape(const char *data, size_t pos, size_t length, bool ascii)
+{
+  return ::implementation().scan_escape(data, pos, length, ascii);
+}
+
+size_t
+Simd::copy_plain(char *dest, const wchar_t *src, size_t length)
+{
+  return ::implementation().copy_plain(dest, src, length);
+}
+
+size_t
+Simd::widen_ascii(wchar_t *dest, const char *src, size_t length)
+{
+  return ::implementation().widen_ascii(dest, src, length);
+}
+
+size_t
+Simd::narrow_ascii(char *dest, const wchar_t *src, size_t length)
+{
+  return ::implementation().narrow_ascii(dest, src, length);
+}
+
+const char *
+Simd::implementation()
+{
+  return ::implementation().name;
+}
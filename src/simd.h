@@ -0,0 +1,88 @@
+#ifndef JSON_SIMD_H_INCLUDE
+#define JSON_SIMD_H_INCLUDE
+
+#include <stddef.h>
+
+namespace Json
+{
+
+  /**
+   * Vectorized scanning primitives for UTF-8 input. The implementation is
+   * selected once at runtime depending on the instruction sets supported by
+   * the CPU (AVX2 or SSE2 on x86, NEON on ARM), with a portable fallback.
+   *
+   * All functions are bounded by length and never read past the input.
+   */
+  namespace Simd
+  {
+
+    /**
+     * Find the first byte at or after pos which is not whitespace
+     * (space, \\t, \\n, \\v, \\f or \\r).
+     *
+     * @return Position of the byte, or length if there is none.
+     */
+    size_t skip_spaces(const char *data, size_t pos, size_t length);
+
+    /**
+     * Find the first byte at or after pos which terminates a run of plain
+     * string characters, i.e. a quote, a backslash or a non-ASCII byte.
+     *
+     * @return Position of the byte, or length if there is none.
+     */
+    size_t scan_string(const char *data, size_t pos, size_t length);
+
+    /**
+     * Find the first byte at or after pos which matters when skipping over
+     * a list or an object, i.e. a quote, a backslash, a bracket or a brace.
+     *
+     * @return Position of the byte, or length if there is none.
+     */
+    size_t scan_structure(const char *data, size_t pos, size_t length);
+
+    /**
+     * Find the first byte at or after pos which cannot be copied as is into
+     * an encoded string, i.e. a quote, a backslash, a slash, a control
+     * character or DEL, and any non-ASCII byte if ascii is set.
+     *
+     * @return Position of the byte, or length if there is none.
+     */
+    size_t scan_escape(const char *data, size_t pos, size_t length, bool ascii);
+
+    /**
+     * Narrow the leading wide characters of src which can be copied as is
+     * into an encoded string, i.e. printable ASCII other than a quote, a
+     * backslash or a slash.
+     *
+     * @param dest Destination of the characters, with room for length bytes.
+     * @return Number of characters copied.
+     */
+    size_t copy_plain(char *dest, const wchar_t *src, size_t length);
+
+    /**
+     * Widen the leading ASCII bytes of src.
+     *
+     * @param dest Destination of the characters, with room for length
+     *        characters.
+     * @return Number of bytes copied.
+     */
+    size_t widen_ascii(wchar_t *dest, const char *src, size_t length);
+
+    /**
+     * Narrow the leading ASCII characters of src.
+     *
+     * @param dest Destination of the characters, with room for length bytes.
+     * @return Number of characters copied.
+     */
+    size_t narrow_ascii(char *dest, const wchar_t *src, size_t length);
+
+    /**
+     * Name of the selected implementation ("avx2", "sse2", "neon" or "scalar").
+     */
+    const char *implementation();
+
+  } // namespace Simd
+
+} // namespace Json
+
+#endif // JSON_SIMD_H_INCLUDE
@@ -0,0 +1,41 @@
+#include "json/sink.h"
+#include "json/file.h"
+
+#include <string>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace Json;
+
+Sink::~Sink()
+{
+}
+
+void
+FdSink::write(const char *data, size_t length)
+{
+  while (length)
+    {
+      ssize_t count = ::write(fd, data, length);
+
+      if (count < 0)
+        {
+          if (errno == EINTR)
+            continue;
+
+          throw IOError((std::string("Cannot write: ") + strerror(errno)).c_str());
+        }
+
+      data += count;
+      length -= count;
+    }
+}
+
+void
+FileSink::write(const char *data, size_t length)
+{
+  if (fwrite(data, 1, length, file) != length)
+    throw IOError((std::string("Cannot write: ") + strerror(errno)).c_str());
+}
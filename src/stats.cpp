@@ -0,0 +1,67 @@
+#include "json/stats.h"
+
+#include <algorithm>
+
+using namespace Json;
+
+#if JSON_STATS
+thread_local Stats *Stats::current = NULL;
+#endif
+
+void
+Stats::clear()
+{
+  decodes = encodes = errors = 0;
+  bytes_in = bytes_out = 0;
+  strings = numbers = lists = objects = keys = 0;
+  max_depth = 0;
+  allocations = allocated_bytes = 0;
+  transcode_ns = parse_ns = encode_ns = 0;
+}
+
+Stats &
+Stats::operator+=(const Stats &other)
+{
+  decodes += other.decodes;
+  encodes += other.encodes;
+  errors += other.errors;
+  bytes_in += other.bytes_in;
+  bytes_out += other.bytes_out;
+  strings += other.strings;
+  numbers += other.numbers;
+  lists += other.lists;
+  objects += other.objects;
+  keys += other.keys;
+  max_depth = std::max(max_depth, other.max_depth);
+  allocations += other.allocations;
+  allocated_bytes += other.allocated_bytes;
+  transcode_ns += other.transcode_ns;
+  parse_ns += other.parse_ns;
+  encode_ns += other.encode_ns;
+  return *this;
+}
+
+StatsHook::~StatsHook()
+{
+}
+
+void
+StatsCollector::report(const Stats &stats)
+{
+  std::lock_guard< std::mutex > lock(mutex);
+  total += stats;
+}
+
+Stats
+StatsCollector::get() const
+{
+  std::lock_guard< std::mutex > lock(mutex);
+  return total;
+}
+
+void
+StatsCollector::clear()
+{
+  std::lock_guard< std::mutex > lock(mutex);
+  total.clear();
+}
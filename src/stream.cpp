@@ -0,0 +1,429 @@
+#include "json/stream.h"
+#include "json/json.h"
+
+#include <sstream>
+
+#include "parser.h"
+#include "utf8.h"
+#include "simd.h"
+
+using namespace Json;
+
+namespace
+{
+
+  inline bool is_space(char c)
+  {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+  }
+
+  inline bool is_number_char(char c)
+  {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+  }
+
+  // Length of the UTF-8 sequence starting with the given lead byte, 0 if it
+  // can not start a sequence
+  inline size_t utf8_sequence_length(unsigned char c)
+  {
+    if (c >= 0xC2 && c <= 0xDF)
+      return 2;
+    if (c >= 0xE0 && c <= 0xEF)
+      return 3;
+    if (c >= 0xF0 && c <= 0xF4)
+      return 4;
+
+    return 0;
+  }
+
+} // namespace
+
+StreamParser::StreamParser(Handler &handler)
+  : handler(handler), max_depth(1024)
+{
+  reset();
+}
+
+StreamParser::~StreamParser()
+{
+}
+
+void
+StreamParser::reset()
+{
+  state = STATE_VALUE;
+  offset = 0;
+  stack.clear();
+  buffer.clear();
+  is_key = false;
+  code = 0;
+  code_digits = 0;
+  utf8_count = 0;
+  utf8_length = 0;
+  number.clear();
+  literal = NULL;
+  literal_pos = 0;
+}
+
+void
+StreamParser::feed(const char *buf, size_t len)
+{
+  size_t pos = 0;
+
+  while (pos < len)
+    {
+      char c = buf[pos];
+
+      switch (state)
+        {
+        case STATE_STRING:
+          {
+            // Copy the whole run of plain characters available in this chunk
+            size_t end = Simd::scan_string(buf, pos, len);
+
+            buffer.append(buf + pos, buf + end);
+            pos = end;
+
+            if (pos == len)
+              break;
+
+            c = buf[pos++];
+
+            if (c == '"')
+              end_string();
+            else if (c == '\\')
+              state = STATE_ESCAPE;
+            else
+              {
+                utf8_length = utf8_sequence_length(c);
+
+                if (!utf8_length)
+                  raise_error< InvalidCharacter >("Invalid UTF-8 sequence", offset + pos - 1);
+
+                utf8[0] = c;
+                utf8_count = 1;
+                state = STATE_UTF8;
+              }
+          }
+          break;
+
+        case STATE_UTF8:
+          {
+            utf8[utf8_count++] = c;
+            ++pos;
+
+            if (utf8_count == utf8_length)
+              {
+                size_t decoded = 0;
+                unsigned code_point;
+
+                if (!utf8_decode(utf8, utf8_length, decoded, code_point))
+                  raise_error< InvalidCharacter >("Invalid UTF-8 sequence", offset + pos - utf8_length);
+
+                append_code_point(buffer, code_point);
+                state = STATE_STRING;
+              }
+          }
+          break;
+
+        case STATE_ESCAPE:
+          ++pos;
+          state = STATE_STRING;
+
+          switch (c)
+            {
+            case 'b':
+              buffer.push_back(L'\b');
+              break;
+
+            case 'f':
+              buffer.push_back(L'\f');
+              break;
+
+            case 'n':
+              buffer.push_back(L'\n');
+              break;
+
+            case 'r':
+              buffer.push_back(L'\r');
+              break;
+
+            case 't':
+              buffer.push_back(L'\t');
+              break;
+
+            case '"':
+            case '\\':
+            case '/':
+              buffer.push_back(c);
+              break;
+
+            case 'u':
+              code = 0;
+              code_digits = 0;
+              state = STATE_UNICODE;
+              break;
+
+            default:
+              raise_error< InvalidCharacter >("Invalid escape character found", offset + pos - 1);
+            }
+          break;
+
+        case STATE_UNICODE:
+          code <<= 4;
+
+          if (c >= '0' && c <= '9')
+            code += c - '0';
+          else if (c >= 'A' && c <= 'F')
+            code += c - 'A' + 10;
+          else if (c >= 'a' && c <= 'f')
+            code += c - 'a' + 10;
+          else
+            raise_error< InvalidCharacter >("Invalid hex code", offset + pos);
+
+          ++pos;
+
+          if (++code_digits == 4)
+            {
+              buffer.push_back((wchar_t)code);
+              state = STATE_STRING;
+            }
+          break;
+
+        case STATE_NUMBER:
+          if (is_number_char(c))
+            {
+              number.push_back(c);
+              ++pos;
+            }
+          else
+            {
+              // The character ending the number is parsed again in the next
+              // state
+              flush_number(offset + pos);
+            }
+          break;
+
+        case STATE_LITERAL:
+          if (c != literal[literal_pos])
+            raise_error< InvalidCharacter >("Invalid token found", offset + pos);
+
+          ++pos;
+
+          if (!literal[++literal_pos])
+            {
+              if (literal[0] == 'n')
+                handler.null();
+              else
+                handler.boolean(literal[0] == 't');
+
+              end_value();
+            }
+          break;
+
+        default:
+          if (is_space(c))
+            {
+              pos = Simd::skip_spaces(buf, pos + 1, len);
+              break;
+            }
+
+          pos = begin_value(buf, pos);
+          break;
+        }
+    }
+
+  offset += len;
+}
+
+size_t
+StreamParser::begin_value(const char *buf, size_t pos)
+{
+  char c = buf[pos];
+
+  switch (state)
+    {
+    case STATE_ARRAY_FIRST:
+      if (c == ']')
+        {
+          stack.pop_back();
+          handler.end_array();
+          end_value();
+          return pos + 1;
+        }
+      // A value follows
+      break;
+
+    case STATE_OBJECT_FIRST:
+      if (c == '}')
+        {
+          stack.pop_back();
+          handler.end_object();
+          end_value();
+          return pos + 1;
+        }
+      // A key follows
+      // fall through
+
+    case STATE_OBJECT_KEY:
+      if (c != '"')
+        raise_error< InvalidCharacter >("Expected string for key", offset + pos);
+
+      buffer.clear();
+      is_key = true;
+      state = STATE_STRING;
+      return pos + 1;
+
+    case STATE_COLON:
+      if (c != ':')
+        raise_error< InvalidCharacter >("Expected ':'", offset + pos);
+
+      state = STATE_VALUE;
+      return pos + 1;
+
+    case STATE_AFTER_VALUE:
+      if (c == ',')
+        state = (stack.back() == '[' ? STATE_VALUE : STATE_OBJECT_KEY);
+      else if (c == ']' && stack.back() == '[')
+        {
+          stack.pop_back();
+          handler.end_array();
+          end_value();
+        }
+      else if (c == '}' && stack.back() == '{')
+        {
+          stack.pop_back();
+          handler.end_object();
+          end_value();
+        }
+      else if (stack.back() == '[')
+        raise_error< InvalidCharacter >("List ended with an invalid character", offset + pos);
+      else
+        raise_error< InvalidCharacter >("Object ended with invalid character", offset + pos);
+
+      return pos + 1;
+
+    case STATE_DONE:
+      raise_error< InvalidCharacter >("Unexpected data after the value", offset + pos);
+
+    default:
+      break;
+    }
+
+  if ((c == '{' || c == '[') && max_depth && stack.size() >= max_depth)
+    raise_error< NestingTooDeep >("Maximum nesting depth exceeded", offset + pos);
+
+  switch (c)
+    {
+    case '{':
+      stack.push_back('{');
+      state = STATE_OBJECT_FIRST;
+      handler.begin_object();
+      break;
+
+    case '[':
+      stack.push_back('[');
+      state = STATE_ARRAY_FIRST;
+      handler.begin_array();
+      break;
+
+    case '"':
+      buffer.clear();
+      is_key = false;
+      state = STATE_STRING;
+      break;
+
+    case 't':
+      literal = "true";
+      literal_pos = 1;
+      state = STATE_LITERAL;
+      break;
+
+    case 'f':
+      literal = "false";
+      literal_pos = 1;
+      state = STATE_LITERAL;
+      break;
+
+    case 'n':
+      literal = "null";
+      literal_pos = 1;
+      state = STATE_LITERAL;
+      break;
+
+    default:
+      if ((c < '0' || c > '9') && c != '-')
+        raise_error< InvalidCharacter >("Invalid character found", offset + pos);
+
+      number.assign(1, c);
+      state = STATE_NUMBER;
+      break;
+    }
+
+  return pos + 1;
+}
+
+void
+StreamParser::end_value()
+{
+  state = (stack.empty() ? STATE_DONE : STATE_AFTER_VALUE);
+}
+
+void
+StreamParser::end_string()
+{
+  if (is_key)
+    {
+      handler.key(buffer);
+      state = STATE_COLON;
+    }
+  else
+    {
+      handler.string(buffer);
+      end_value();
+    }
+}
+
+void
+StreamParser::flush_number(size_t position)
+{
+  // The number is complete, so that the regular parser can convert it
+  Parser< char > parser(number.data(), number.size());
+  size_t start = position - number.size();
+
+  if (!parser.try_parse(handler))
+    {
+      // Its errors are positioned in the number, not in the stream
+      ParseResult error = parser.get_error();
+
+      error.position += start;
+      Parser< char >::raise_error(error);
+    }
+
+  if (parser.get_position() != number.size())
+    raise_error< InvalidCharacter >("Invalid number", start);
+
+  number.clear();
+  end_value();
+}
+
+void
+StreamParser::finish()
+{
+  // A top level number has no terminating character
+  if (state == STATE_NUMBER)
+    flush_number(offset);
+
+  if (state != STATE_DONE)
+    raise_error< UnexpectedEof >("Unexpected end of input", offset);
+}
+
+template < class _Exception >
+void
+StreamParser::raise_error(const char *message, size_t position)
+{
+  std::stringstream str;
+  str << message << " at " << position;
+
+  throw _Exception(str.str().c_str());
+}
@@ -0,0 +1,364 @@
+#include "json/tape.h"
+#include "json/json.h"
+#include "utf8.h"
+
+#include <limits.h>
+
+using namespace Json;
+
+const uint64_t TapeValue::null_word = (uint64_t)Tape::TAG_NULL << Tape::tag_shift;
+
+Tape::Tape()
+{
+  clear();
+}
+
+TapeValue
+Tape::get_root() const
+{
+  return TapeValue(this, words.data());
+}
+
+void
+Tape::clear()
+{
+  words.assign(1, word(TAG_NULL, 0));
+  strings.clear();
+}
+
+void
+Tape::shrink_to_fit()
+{
+  words.shrink_to_fit();
+  strings.shrink_to_fit();
+}
+
+TapeValue::TapeValue()
+  : tape(NULL), word(&null_word)
+{
+}
+
+void
+TapeValue::check_tag(Tape::Tag tag) const
+{
+  if (Tape::tag_of(*word) != tag)
+    throw ValueException("Invalid value type");
+}
+
+size_t
+TapeValue::size() const
+{
+  Tape::Tag tag = Tape::tag_of(*word);
+
+  if (tag != Tape::TAG_LIST && tag != Tape::TAG_OBJECT)
+    throw ValueException("Invalid value type");
+
+  // The end word holds the number of items
+  return Tape::payload_of(tape->words[Tape::payload_of(*word) - 1]);
+}
+
+TapeValue::operator bool() const
+{
+  switch (Tape::tag_of(*word))
+    {
+    case Tape::TAG_NULL:
+    case Tape::TAG_FALSE:
+      return false;
+
+    case Tape::TAG_TRUE:
+      return true;
+
+    case Tape::TAG_INTEGER:
+    case Tape::TAG_UNSIGNED:
+      return word[1] != 0;
+
+    default:
+      throw ValueException("Invalid value type");
+    }
+}
+
+TapeValue::operator int() const
+{
+  int64_t result = (int64_t)*this;
+
+  if (result < INT_MIN || result > INT_MAX)
+    throw ValueException("Integer out of range");
+
+  return (int)result;
+}
+
+TapeValue::operator int64_t() const
+{
+  switch (Tape::tag_of(*word))
+    {
+    case Tape::TAG_NULL:
+    case Tape::TAG_FALSE:
+      return 0;
+
+    case Tape::TAG_TRUE:
+      return 1;
+
+    case Tape::TAG_INTEGER:
+      return (int64_t)word[1];
+
+    case Tape::TAG_UNSIGNED:
+      throw ValueException("Integer out of range");
+
+    case Tape::TAG_FLOAT:
+      return (int64_t)(double)*this;
+
+    default:
+      throw ValueException("Invalid value type");
+    }
+}
+
+TapeValue::operator uint64_t() const
+{
+  switch (Tape::tag_of(*word))
+    {
+    case Tape::TAG_INTEGER:
+      if ((int64_t)word[1] < 0)
+        throw ValueException("Integer out of range");
+
+      return word[1];
+
+    case Tape::TAG_UNSIGNED:
+      return word[1];
+
+    case Tape::TAG_FLOAT:
+      return (uint64_t)(double)*this;
+
+    default:
+      return (int64_t)*this;
+    }
+}
+
+TapeValue::operator double() const
+{
+  double result;
+
+  check_tag(Tape::TAG_FLOAT);
+  memcpy(&result, word + 1, sizeof(result));
+  return result;
+}
+
+void
+TapeValue::get_utf8_string(const char *&text, size_t &len) const
+{
+  check_tag(Tape::TAG_STRING);
+  text = string_data(len);
+}
+
+TapeValue::operator std::string() const
+{
+  const char *text;
+  size_t len;
+
+  get_utf8_string(text, len);
+  return std::string(text, len);
+}
+
+TapeValue::operator std::wstring() const
+{
+  const char *text;
+  size_t len;
+  std::wstring result;
+
+  get_utf8_string(text, len);
+  utf8_widen(result, text, len);
+  return result;
+}
+
+TapeValue::operator List() const
+{
+  check_tag(Tape::TAG_LIST);
+
+  const uint64_t *end = tape->words.data() + Tape::payload_of(*word) - 1;
+  return List(TapeValue(tape, word + 1), TapeValue(tape, end), Tape::payload_of(*end));
+}
+
+TapeValue::operator Object() const
+{
+  check_tag(Tape::TAG_OBJECT);
+
+  const uint64_t *end = tape->words.data() + Tape::payload_of(*word) - 1;
+  return Object(TapeValue(tape, word + 1), TapeValue(tape, end), Tape::payload_of(*end));
+}
+
+void
+TapeValue::to_value(Value &dest, MemoryResource *resource, KeyPool *pool, int flags) const
+{
+  ValueBuilder builder(dest, resource, pool);
+
+  build(builder, flags & JsonHandler::BORROW_STRINGS);
+}
+
+Value
+TapeValue::to_value() const
+{
+  Value result;
+
+  to_value(result);
+  return result;
+}
+
+void
+TapeValue::build(ValueBuilder &builder, bool borrow) const
+{
+  const char *text;
+  size_t len;
+
+  switch (Tape::tag_of(*word))
+    {
+    case Tape::TAG_TRUE:
+      return builder.boolean(true);
+
+    case Tape::TAG_FALSE:
+      return builder.boolean(false);
+
+    case Tape::TAG_INTEGER:
+      {
+        int64_t value = (int64_t)word[1];
+
+        if (value >= INT_MIN && value <= INT_MAX)
+          return builder.integer((int)value);
+
+        return builder.integer64(value);
+      }
+
+    case Tape::TAG_UNSIGNED:
+      return builder.unsigned_integer64(word[1]);
+
+    case Tape::TAG_FLOAT:
+      return builder.number((double)*this);
+
+    case Tape::TAG_STRING:
+      text = string_data(len);
+
+      if (borrow)
+        return builder.borrowed_string(text, len);
+      else
+        {
+          std::wstring value;
+
+          utf8_widen(value, text, len);
+          return builder.string(value);
+        }
+
+    case Tape::TAG_LIST:
+      {
+        List list = *this;
+
+        builder.begin_array();
+        builder.reserve(list.size());
+
+        for (List::const_iterator it = list.begin(); it != list.end(); ++it)
+          it->build(builder, borrow);
+
+        return builder.end_array();
+      }
+
+    case Tape::TAG_OBJECT:
+      {
+        Object obj = *this;
+        std::wstring key;
+
+        builder.begin_object();
+        builder.reserve(obj.size());
+
+        for (Object::const_iterator it = obj.begin(); it != obj.end(); ++it)
+          {
+            text = it->first.string_data(len);
+            key.clear();
+            utf8_widen(key, text, len);
+
+            builder.key(key);
+            it->second.build(builder, borrow);
+          }
+
+        return builder.end_object();
+      }
+
+    default:
+      return builder.null();
+    }
+}
+
+TapeValue
+TapeValue::List::operator[](size_t pos) const
+{
+  if (pos >= items)
+    throw ValueException("Index out of range");
+
+  TapeValue value = first;
+
+  while (pos--)
+    value = value.next();
+
+  return value;
+}
+
+TapeValue::Object::const_iterator
+TapeValue::Object::find(const char *key, size_t length) const
+{
+  const_iterator it = begin();
+
+  for (; it != end(); ++it)
+    {
+      size_t len;
+      const char *text = it->first.string_data(len);
+
+      if (len == length && !memcmp(text, key, length))
+        break;
+    }
+
+  return it;
+}
+
+TapeValue::Object::const_iterator
+TapeValue::Object::find(const std::wstring &key) const
+{
+  std::string text;
+
+  utf8_append(text, key.data(), key.size());
+  return find(text.data(), text.size());
+}
+
+TapeBuilder::TapeBuilder(Tape &tape)
+  : tape(tape)
+{
+  tape.words.clear();
+  tape.strings.clear();
+}
+
+void
+TapeBuilder::string(const std::wstring &value)
+{
+  text.clear();
+  utf8_append(text, value.data(), value.size());
+  borrowed_string(text.data(), text.size());
+}
+
+void
+TapeBuilder::key(const std::wstring &key)
+{
+  ++stack.back().count;
+
+  text.clear();
+  utf8_append(text, key.data(), key.size());
+
+  tape.words.push_back(Tape::word(Tape::TAG_STRING, tape.strings.size()));
+  append(text.data(), text.size());
+}
+
+void
+TapeBuilder::append(const char *data, size_t length)
+{
+  if (length > UINT32_MAX)
+    throw ValueException("String too long");
+
+  uint32_t size = length;
+
+  tape.strings.append((const char *)&size, sizeof(size));
+  tape.strings.append(data, length);
+}
@@ -0,0 +1,155 @@
+#ifndef JSON_UTF8_H_INCLUDE
+#define JSON_UTF8_H_INCLUDE
+
+#include <string>
+
+#include <stddef.h>
+
+namespace Json
+{
+
+  /**
+   * Decode a single UTF-8 sequence starting at data[pos]. Overlong forms,
+   * surrogates and code points above U+10FFFF are rejected.
+   *
+   * @param data Input buffer.
+   * @param length Length of the input buffer.
+   * @param pos Position of the lead byte, advanced past the sequence on success.
+   * @param code Decoded code point.
+   * @return false if the sequence is invalid or truncated.
+   */
+  inline bool utf8_decode(const char *data, size_t length, size_t &pos, unsigned &code)
+  {
+    const unsigned char *bytes = (const unsigned char *)data;
+    unsigned lead = bytes[pos];
+    unsigned min;
+    size_t count;
+
+    if (lead < 0x80)
+      {
+        code = lead;
+        ++pos;
+        return true;
+      }
+    else if ((lead & 0xE0) == 0xC0)
+      {
+        code = lead & 0x1F;
+        count = 1;
+        min = 0x80;
+      }
+    else if ((lead & 0xF0) == 0xE0)
+      {
+        code = lead & 0x0F;
+        count = 2;
+        min = 0x800;
+      }
+    else if ((lead & 0xF8) == 0xF0)
+      {
+        code = lead & 0x07;
+        count = 3;
+        min = 0x10000;
+      }
+    else
+      return false;
+
+    if (length - pos <= count)
+      return false;
+
+    for (size_t i = 1; i <= count; ++i)
+      {
+        if ((bytes[pos + i] & 0xC0) != 0x80)
+          return false;
+
+        code = (code << 6) | (bytes[pos + i] & 0x3F);
+      }
+
+    if (code < min || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF))
+      return false;
+
+    pos += count + 1;
+    return true;
+  }
+
+  /**
+   * Append a code point to a wide string. Code points outside the BMP are
+   * stored as surrogate pairs where wchar_t is 16 bits wide.
+   */
+  inline void append_code_point(std::wstring &dest, unsigned code)
+  {
+    if (sizeof(wchar_t) == 2 && code >= 0x10000)
+      {
+        code -= 0x10000;
+        dest.push_back((wchar_t)(0xD800 + (code >> 10)));
+        dest.push_back((wchar_t)(0xDC00 + (code & 0x3FF)));
+      }
+    else
+      dest.push_back((wchar_t)code);
+  }
+
+  /**
+   * Append the UTF-8 form of wide characters to a string. Surrogate pairs
+   * are combined, whatever the width of wchar_t, as the parser keeps the
+   * pairs of \u escapes. Lone surrogates and values above U+10FFFF, which
+   * have no UTF-8 form, are replaced with U+FFFD.
+   */
+  inline void utf8_append(std::string &dest, const wchar_t *data, size_t length)
+  {
+    for (size_t i = 0; i < length; ++i)
+      {
+        unsigned code = data[i];
+
+        if (code < 0x80)
+          {
+            dest.push_back((char)code);
+            continue;
+          }
+
+        if (code >= 0xD800 && code <= 0xDBFF && i + 1 < length
+            && (unsigned)data[i + 1] >= 0xDC00 && (unsigned)data[i + 1] <= 0xDFFF)
+          code = 0x10000 + ((code - 0xD800) << 10) + ((unsigned)data[++i] - 0xDC00);
+        else if (code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF))
+          code = 0xFFFD;
+
+        if (code < 0x800)
+          {
+            dest.push_back((char)(0xC0 | (code >> 6)));
+          }
+        else
+          {
+            if (code < 0x10000)
+              dest.push_back((char)(0xE0 | (code >> 12)));
+            else
+              {
+                dest.push_back((char)(0xF0 | (code >> 18)));
+                dest.push_back((char)(0x80 | ((code >> 12) & 0x3F)));
+              }
+
+            dest.push_back((char)(0x80 | ((code >> 6) & 0x3F)));
+          }
+
+        dest.push_back((char)(0x80 | (code & 0x3F)));
+      }
+  }
+
+  /**
+   * Append UTF-8 text, already checked, to a wide string.
+   */
+  inline void utf8_widen(std::wstring &dest, const char *data, size_t length)
+  {
+    size_t pos = 0;
+    unsigned code;
+
+    while (pos < length)
+      {
+        if ((unsigned char)data[pos] < 0x80)
+          dest.push_back(data[pos++]);
+        else if (utf8_decode(data, length, pos, code))
+          append_code_point(dest, code);
+        else
+          ++pos;
+      }
+  }
+
+} // namespace Json
+
+#endif // JSON_UTF8_H_INCLUDE
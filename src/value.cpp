@@ -1,6 +1,12 @@
 #include "json/value.h"
 #include "json/codec.h"
+#include "utf8.h"
+#include "parser.h"
 
+#include <utility>
+
+#include <limits.h>
+#include <stddef.h>
 #include <wchar.h>
 #include <string.h>
 
@@ -32,17 +38,140 @@ namespace
     {
       memswap(&v1, &v2, sizeof(_T));
     }
+
+  void decode_utf8(std::wstring &dest, const char *data, size_t len)
+  {
+    size_t pos = 0;
+    unsigned code;
+
+    dest.reserve(len);
+
+    while (pos < len)
+      {
+        if ((unsigned char)data[pos] < 0x80)
+          {
+            dest.push_back(data[pos++]);
+            continue;
+          }
+
+        if (!utf8_decode(data, len, pos, code))
+          throw ValueException("Invalid UTF-8 string");
+
+        append_code_point(dest, code);
+      }
+  }
+
+  // Parse the text of a lazy container as part of the input it was taken
+  // from, for the positions of the errors and of the nested containers
+  void parse_lazy(Value &dest, const char *text, size_t len, size_t offset, size_t max_depth, int flags)
+  {
+    Parser< char > parser(text - offset, offset + len, max_depth);
+
+    parser.set_position(offset);
+    parser.decode(dest, NULL, flags);
+  }
+
+  // Encode a string to UTF-8 in a buffer of capacity bytes, false if it does
+  // not fit or is not valid Unicode
+  bool encode_utf8(char *dest, size_t capacity, size_t &size, const wchar_t *data, size_t len)
+  {
+    unsigned char *bytes = (unsigned char *)dest;
+    size_t pos = 0;
+
+    if (len > capacity)
+      return false;
+
+    for (size_t i = 0; i < len; ++i)
+      {
+        unsigned code = (unsigned)data[i];
+
+        if (sizeof(wchar_t) == 2 && code >= 0xD800 && code < 0xDC00 && i + 1 < len
+            && (unsigned)data[i + 1] >= 0xDC00 && (unsigned)data[i + 1] <= 0xDFFF)
+          {
+            code = 0x10000 + ((code - 0xD800) << 10) + ((unsigned)data[i + 1] - 0xDC00);
+            ++i;
+          }
+
+        if (code < 0x80)
+          {
+            if (pos + 1 > capacity)
+              return false;
+
+            bytes[pos++] = code;
+          }
+        else if (code < 0x800)
+          {
+            if (pos + 2 > capacity)
+              return false;
+
+            bytes[pos++] = 0xC0 | (code >> 6);
+            bytes[pos++] = 0x80 | (code & 0x3F);
+          }
+        else if (code < 0x10000)
+          {
+            if (pos + 3 > capacity || (code >= 0xD800 && code <= 0xDFFF))
+              return false;
+
+            bytes[pos++] = 0xE0 | (code >> 12);
+            bytes[pos++] = 0x80 | ((code >> 6) & 0x3F);
+            bytes[pos++] = 0x80 | (code & 0x3F);
+          }
+        else
+          {
+            if (pos + 4 > capacity || code > 0x10FFFF)
+              return false;
+
+            bytes[pos++] = 0xF0 | (code >> 18);
+            bytes[pos++] = 0x80 | ((code >> 12) & 0x3F);
+            bytes[pos++] = 0x80 | ((code >> 6) & 0x3F);
+            bytes[pos++] = 0x80 | (code & 0x3F);
+          }
+      }
+
+    size = pos;
+    return true;
+  }
 }
 
 Value::Value()
-  : type(JSON_TYPE_NULL)
+  : type(JSON_TYPE_NULL), storage(STORAGE_HEAP), length(0)
 {
+  static_assert(sizeof(Value) == 16 || sizeof(void *) != 8, "Value does not fit 16 bytes");
+  static_assert(offsetof(Value, value) == offsetof(Value, length) + sizeof(uint32_t)
+                && sizeof(uint32_t) + sizeof(Values) == short_capacity,
+                "Short strings do not fit in place of length and value");
 }
 
 Value::Value(const Value &other)
-  : type(JSON_TYPE_NULL)
+  : type(JSON_TYPE_NULL), storage(STORAGE_HEAP), length(0)
+{
+  copy(other);
+}
+
+Value::Value(Value &&other) noexcept
+  : type(other.type), storage(other.storage), short_length(other.short_length),
+    lazy_flags(other.lazy_flags), length(other.length), value(other.value)
+{
+  other.type = JSON_TYPE_NULL;
+  other.storage = STORAGE_HEAP;
+}
+
+Value::Value(std::wstring &&value)
+  : type(JSON_TYPE_NULL), storage(STORAGE_HEAP), length(0)
+{
+  set(std::move(value));
+}
+
+Value::Value(List &&value)
+  : type(JSON_TYPE_NULL), storage(STORAGE_HEAP), length(0)
 {
-  (*this) = other;
+  set(std::move(value));
+}
+
+Value::Value(Object &&value)
+  : type(JSON_TYPE_NULL), storage(STORAGE_HEAP), length(0)
+{
+  set(std::move(value));
 }
 
 void
@@ -68,6 +197,26 @@ Value::set(int value)
   this->value.v_integer = value;
 }
 
+void
+Value::set(int64_t value)
+{
+  clear();
+  type = JSON_TYPE_INTEGER;
+  this->value.v_integer = value;
+}
+
+void
+Value::set(uint64_t value)
+{
+  clear();
+  type = JSON_TYPE_INTEGER;
+
+  if (value > (uint64_t)INT64_MAX)
+    storage = STORAGE_UNSIGNED;
+
+  this->value.v_unsigned = value;
+}
+
 void
 Value::set(double value)
 {
@@ -79,25 +228,43 @@ Value::set(double value)
 void
 Value::set(const std::wstring &value)
 {
+  if (set_short(value.data(), value.size()))
+    return;
+
+  Stats::count_allocation(sizeof(std::wstring) + value.size() * sizeof(wchar_t));
+
   clear();
   type = JSON_TYPE_STRING;
   this->value.v_string = new std::wstring(value);
 }
 
+void
+Value::set(std::wstring &&value)
+{
+  if (set_short(value.data(), value.size()))
+    return;
+
+  Stats::count_allocation(sizeof(std::wstring));
+  std::wstring *str = new std::wstring(std::move(value));
+
+  clear();
+  type = JSON_TYPE_STRING;
+  this->value.v_string = str;
+}
+
 void
 Value::set(const wchar_t *value, int len)
 {
-  std::wstring temp(value, (len < 0 ? wcslen(value) : len));
-  set(temp);
+  set_string(value, (len < 0 ? wcslen(value) : len), NULL);
 }
 
 void
 Value::set(const std::string &value, const char *encoding)
 {
-  Codec codec(encoding);
+  Codec &codec = Codec::get(encoding);
   std::wstring temp;
   codec.decode(temp, value);
-  set(temp);
+  set(std::move(temp));
 }
 
 void
@@ -107,6 +274,165 @@ Value::set(const char *value, int len, const char *encoding)
   set(temp, encoding);
 }
 
+void
+Value::set_string(const wchar_t *value, size_t len, MemoryResource *resource)
+{
+  if (set_short(value, len))
+    return;
+
+  if (!resource)
+    {
+      Stats::count_allocation(sizeof(std::wstring) + len * sizeof(wchar_t));
+
+      clear();
+      type = JSON_TYPE_STRING;
+      this->value.v_string = new std::wstring(value, len);
+      return;
+    }
+
+  Stats::count_allocation(sizeof(ResourceString) + len * sizeof(wchar_t));
+
+  ResourceString *str = (ResourceString *)resource->allocate(sizeof(ResourceString) + len * sizeof(wchar_t),
+                                                            alignof(ResourceString));
+  str->resource = resource;
+  str->length = len;
+  wmemcpy(str->data, value, len);
+  str->data[len] = L'\0';
+
+  clear();
+  type = JSON_TYPE_STRING;
+  storage = STORAGE_RESOURCE;
+  this->value.v_resource_string = str;
+}
+
+void
+Value::set_borrowed(const char *value, size_t len)
+{
+  // Longer strings do not fit the length field, they are copied
+  if (len > UINT32_MAX)
+    {
+      std::wstring temp;
+      decode_utf8(temp, value, len);
+      set(std::move(temp));
+      return;
+    }
+
+  clear();
+  type = JSON_TYPE_STRING;
+  storage = STORAGE_BORROWED;
+  length = len;
+  this->value.v_borrowed_string = value;
+}
+
+void
+Value::set_raw_number(const char *text, size_t len, Type type)
+{
+  if (type != JSON_TYPE_INTEGER && type != JSON_TYPE_FLOAT)
+    throw ValueException("Invalid value type");
+
+  // Longer texts do not fit the length field, they are converted
+  if (len > UINT32_MAX)
+    {
+      Value temp;
+      Parser< char >(text, len).decode(temp);
+      swap(temp);
+      return;
+    }
+
+  clear();
+  this->type = type;
+  storage = STORAGE_BORROWED;
+  length = len;
+  this->value.v_borrowed_string = text;
+}
+
+bool
+Value::set_short(const wchar_t *value, size_t len)
+{
+  // Encode first, value may be part of this value
+  char text[short_capacity];
+  size_t size;
+
+  if (!encode_utf8(text, short_capacity, size, value, len))
+    return false;
+
+  clear();
+  type = JSON_TYPE_STRING;
+  storage = STORAGE_SHORT;
+  short_length = size;
+  memcpy(short_text(), text, size);
+  return true;
+}
+
+void
+Value::set_lazy(const char *text, size_t len, Type type, int flags, size_t offset, size_t max_depth,
+                MemoryResource *resource)
+{
+  if (type != JSON_TYPE_LIST && type != JSON_TYPE_OBJECT)
+    throw ValueException("Invalid value type");
+
+  // Longer texts do not fit the length field, they are parsed
+  if (len > UINT32_MAX || flags > UINT8_MAX)
+    {
+      Value temp;
+      parse_lazy(temp, text, len, offset, max_depth, flags);
+      swap(temp);
+      return;
+    }
+
+  Stats::count_allocation(sizeof(LazyText));
+
+  LazyText *lazy;
+
+  if (resource)
+    lazy = (LazyText *)resource->allocate(sizeof(LazyText), alignof(LazyText));
+  else
+    lazy = new LazyText;
+
+  lazy->resource = resource;
+  lazy->text = text;
+  lazy->offset = offset;
+  lazy->max_depth = max_depth;
+
+  clear();
+  this->type = type;
+  storage = STORAGE_LAZY;
+  lazy_flags = flags;
+  length = len;
+  this->value.v_lazy = lazy;
+}
+
+Value::List &
+Value::set_list(MemoryResource *resource)
+{
+  clear();
+  type = JSON_TYPE_LIST;
+  Stats::count_allocation(sizeof(List));
+
+  if (resource)
+    value.v_list = new(resource->allocate(sizeof(List), alignof(List))) List(Allocator< Value >(resource));
+  else
+    value.v_list = new List();
+
+  return *value.v_list;
+}
+
+Value::Object &
+Value::set_object(MemoryResource *resource)
+{
+  clear();
+  type = JSON_TYPE_OBJECT;
+  Stats::count_allocation(sizeof(Object));
+
+  if (resource)
+    value.v_object = new(resource->allocate(sizeof(Object), alignof(Object)))
+      Object(Object::allocator_type(resource));
+  else
+    value.v_object = new Object();
+
+  return *value.v_object;
+}
+
 void
 Value::set(const List &value)
 {
@@ -123,17 +449,63 @@ Value::set(const Object &value)
   this->value.v_object = new Object(value);
 }
 
+void
+Value::set(List &&value)
+{
+  MemoryResource *resource = value.get_allocator().get_resource();
+  List *list;
+
+  if (resource)
+    list = new(resource->allocate(sizeof(List), alignof(List))) List(std::move(value));
+  else
+    list = new List(std::move(value));
+
+  clear();
+  type = JSON_TYPE_LIST;
+  this->value.v_list = list;
+}
+
+void
+Value::set(Object &&value)
+{
+  MemoryResource *resource = value.get_allocator().get_resource();
+  Object *object;
+
+  if (resource)
+    object = new(resource->allocate(sizeof(Object), alignof(Object))) Object(std::move(value));
+  else
+    object = new Object(std::move(value));
+
+  clear();
+  type = JSON_TYPE_OBJECT;
+  this->value.v_object = object;
+}
+
 void Value::swap(Value &other)
 {
-  ::swap(type, other.type);
-  ::swap(value, other.value);
+  ::swap(*this, other);
 }
 
 Value &
 Value::operator=(const Value &other)
 {
-  clear();
+  // Copy first, other may be part of this value
+  Value temp(other);
+  swap(temp);
+  return *this;
+}
+
+Value &
+Value::operator=(Value &&other) noexcept
+{
+  Value temp(std::move(other));
+  swap(temp);
+  return *this;
+}
 
+void
+Value::copy(const Value &other)
+{
   type = other.type;
   switch (type)
     {
@@ -145,27 +517,55 @@ Value::operator=(const Value &other)
       break;
 
     case JSON_TYPE_INTEGER:
-      value.v_integer = other.value.v_integer;
-      break;
-
     case JSON_TYPE_FLOAT:
-      value.v_float = other.value.v_float;
+      if (other.storage == STORAGE_BORROWED)
+        {
+          // Copies do not reference the input, and take the type the
+          // text converts to
+          Value temp = other.convert_number();
+          type = temp.type;
+          storage = temp.storage;
+          value = temp.value;
+        }
+      else
+        {
+          storage = other.storage;
+          value = other.value;
+        }
       break;
 
     case JSON_TYPE_STRING:
-      value.v_string = new std::wstring(*other.value.v_string);
+      if (other.storage == STORAGE_SHORT)
+        {
+          storage = STORAGE_SHORT;
+          short_length = other.short_length;
+          memcpy(short_text(), other.short_text(), short_length);
+        }
+      else if (other.storage == STORAGE_BORROWED)
+        {
+          // Leave the original borrowed
+          std::wstring temp;
+          decode_utf8(temp, other.value.v_borrowed_string, other.length);
+          value.v_string = new std::wstring(std::move(temp));
+        }
+      else
+        {
+          const wchar_t *data;
+          size_t len;
+
+          other.get_string(data, len);
+          value.v_string = new std::wstring(data, len);
+        }
       break;
 
     case JSON_TYPE_LIST:
-      value.v_list = new List(*other.value.v_list);
+      value.v_list = new List((const List &)other);
       break;
 
     case JSON_TYPE_OBJECT:
-      value.v_object = new Object(*other.value.v_object);
+      value.v_object = new Object((const Object &)other);
       break;
     }
-
-  return *this;
 }
 
 bool
@@ -183,19 +583,38 @@ Value::operator==(const Value &other) const
       return value.v_boolean == other.value.v_boolean;
 
     case JSON_TYPE_INTEGER:
-      return value.v_integer == other.value.v_integer;
+      if (storage == STORAGE_BORROWED || other.storage == STORAGE_BORROWED)
+        return convert_number() == other.convert_number();
+
+      return storage == other.storage && value.v_integer == other.value.v_integer;
 
     case JSON_TYPE_FLOAT:
+      if (storage == STORAGE_BORROWED || other.storage == STORAGE_BORROWED)
+        return convert_number() == other.convert_number();
+
       return value.v_float == other.value.v_float;
 
     case JSON_TYPE_STRING:
-      return *value.v_string == *other.value.v_string;
+      {
+        const char *text, *other_text;
+        size_t size, other_size;
+
+        if (get_utf8_string(text, size) && other.get_utf8_string(other_text, other_size))
+          return size == other_size && memcmp(text, other_text, size) == 0;
+
+        const wchar_t *data, *other_data;
+        size_t len, other_len;
+
+        get_string(data, len);
+        other.get_string(other_data, other_len);
+        return len == other_len && wmemcmp(data, other_data, len) == 0;
+      }
 
     case JSON_TYPE_LIST:
-      return *value.v_list == *other.value.v_list;
+      return (const List &)*this == (const List &)other;
 
     case JSON_TYPE_OBJECT:
-      return *value.v_object == *other.value.v_object;
+      return (const Object &)*this == (const Object &)other;
     }
 }
 
@@ -216,19 +635,85 @@ Value::clear()
       break;
 
     case JSON_TYPE_STRING:
-      delete value.v_string;
+      if (storage == STORAGE_HEAP)
+        delete value.v_string;
+      else if (storage == STORAGE_RESOURCE)
+        release_string(value.v_resource_string);
       break;
 
+    // Containers living in a resource are given back to it, an arena only
+    // releases their memory when it is cleared
     case JSON_TYPE_LIST:
-      delete value.v_list;
+      if (storage == STORAGE_LAZY)
+        {
+          release_lazy(value.v_lazy);
+          break;
+        }
+
+      if (MemoryResource *resource = value.v_list->get_allocator().get_resource())
+        {
+          value.v_list->~List();
+          resource->deallocate(value.v_list, sizeof(List), alignof(List));
+        }
+      else
+        delete value.v_list;
       break;
 
     case JSON_TYPE_OBJECT:
-      delete value.v_object;
+      if (storage == STORAGE_LAZY)
+        {
+          release_lazy(value.v_lazy);
+          break;
+        }
+
+      if (MemoryResource *resource = value.v_object->get_allocator().get_resource())
+        {
+          value.v_object->~Object();
+          resource->deallocate(value.v_object, sizeof(Object), alignof(Object));
+        }
+      else
+        delete value.v_object;
       break;
     }
 
   type = JSON_TYPE_NULL;
+  storage = STORAGE_HEAP;
+}
+
+void
+Value::release_string(const ResourceString *str)
+{
+  str->resource->deallocate((void *)str, sizeof(ResourceString) + str->length * sizeof(wchar_t),
+                            alignof(ResourceString));
+}
+
+void
+Value::release_lazy(const LazyText *lazy)
+{
+  if (lazy->resource)
+    lazy->resource->deallocate((void *)lazy, sizeof(LazyText), alignof(LazyText));
+  else
+    delete lazy;
+}
+
+void
+Value::get_string(const wchar_t *&data, size_t &len) const
+{
+  check_type(JSON_TYPE_STRING);
+
+  if (storage == STORAGE_BORROWED || storage == STORAGE_SHORT)
+    materialize();
+
+  if (storage == STORAGE_RESOURCE)
+    {
+      data = value.v_resource_string->data;
+      len = value.v_resource_string->length;
+    }
+  else
+    {
+      data = value.v_string->data();
+      len = value.v_string->size();
+    }
 }
 
 Value::operator bool() const
@@ -242,6 +727,9 @@ Value::operator bool() const
       return value.v_boolean;
 
     case JSON_TYPE_INTEGER:
+      if (storage == STORAGE_BORROWED)
+        return (bool)convert_number();
+
       return (bool)value.v_integer;
 
     default:
@@ -250,6 +738,16 @@ Value::operator bool() const
 }
 
 Value::operator int() const
+{
+  int64_t result = (int64_t)*this;
+
+  if (result < INT_MIN || result > INT_MAX)
+    throw ValueException("Integer out of range");
+
+  return (int)result;
+}
+
+Value::operator int64_t() const
 {
   switch (type)
     {
@@ -260,9 +758,18 @@ Value::operator int() const
       return (value.v_boolean ? 1 : 0);
 
     case JSON_TYPE_INTEGER:
+      if (storage == STORAGE_BORROWED)
+        return (int64_t)convert_number();
+
+      if (storage == STORAGE_UNSIGNED)
+        throw ValueException("Integer out of range");
+
       return value.v_integer;
 
     case JSON_TYPE_FLOAT:
+      if (storage == STORAGE_BORROWED)
+        return (int64_t)convert_number();
+
       return value.v_float;
 
     default:
@@ -270,26 +777,163 @@ Value::operator int() const
     }
 }
 
+Value::operator uint64_t() const
+{
+  switch (type)
+    {
+    case JSON_TYPE_INTEGER:
+      if (storage == STORAGE_BORROWED)
+        return (uint64_t)convert_number();
+
+      if (storage != STORAGE_UNSIGNED && value.v_integer < 0)
+        throw ValueException("Integer out of range");
+
+      return value.v_unsigned;
+
+    case JSON_TYPE_FLOAT:
+      if (storage == STORAGE_BORROWED)
+        return (uint64_t)convert_number();
+
+      return value.v_float;
+
+    default:
+      return (int64_t)*this;
+    }
+}
+
 Value::operator double() const
 {
   check_type(JSON_TYPE_FLOAT);
+
+  if (storage == STORAGE_BORROWED)
+    return (double)convert_number();
+
   return value.v_float;
 }
 
+bool
+Value::get_raw_number(const char *&text, size_t &len) const
+{
+  if ((type != JSON_TYPE_INTEGER && type != JSON_TYPE_FLOAT) || storage != STORAGE_BORROWED)
+    return false;
+
+  text = value.v_borrowed_string;
+  len = length;
+  return true;
+}
+
+bool
+Value::get_borrowed_string(const char *&text, size_t &len) const
+{
+  if (type != JSON_TYPE_STRING || storage != STORAGE_BORROWED)
+    return false;
+
+  text = value.v_borrowed_string;
+  len = length;
+  return true;
+}
+
+bool
+Value::get_utf8_string(const char *&text, size_t &len) const
+{
+  if (type != JSON_TYPE_STRING)
+    return false;
+
+  if (storage == STORAGE_SHORT)
+    {
+      text = short_text();
+      len = short_length;
+      return true;
+    }
+
+  return get_borrowed_string(text, len);
+}
+
+Value
+Value::convert_number() const
+{
+  if (storage != STORAGE_BORROWED)
+    return *this;
+
+  Value result;
+  Parser< char >(value.v_borrowed_string, length).decode(result);
+  return result;
+}
+
 Value::operator const std::wstring &() const
 {
   check_type(JSON_TYPE_STRING);
+  materialize();
   return *value.v_string;
 }
 
+void
+Value::materialize() const
+{
+  // Resource, borrowed and short strings become heap strings on first access
+  if (storage == STORAGE_RESOURCE)
+    {
+      const ResourceString *str = value.v_resource_string;
+      value.v_string = new std::wstring(str->data, str->length);
+      storage = STORAGE_HEAP;
+      release_string(str);
+    }
+  else if (storage == STORAGE_BORROWED || storage == STORAGE_SHORT)
+    {
+      std::wstring *str = new std::wstring();
+      const char *text;
+      size_t len;
+
+      get_utf8_string(text, len);
+
+      try
+        {
+          decode_utf8(*str, text, len);
+        }
+      catch (...)
+        {
+          delete str;
+          throw;
+        }
+
+      value.v_string = str;
+      storage = STORAGE_HEAP;
+    }
+  else if (storage == STORAGE_LAZY)
+    {
+      // Lazy containers are parsed on the heap, the value only takes over
+      // the container
+      const LazyText *lazy = value.v_lazy;
+      Value temp;
+
+      parse_lazy(temp, lazy->text, length, lazy->offset, lazy->max_depth, lazy_flags);
+
+      if (temp.type != type)
+        throw ValueException("Invalid lazy container");
+
+      value = temp.value;
+      storage = temp.storage;
+      temp.type = JSON_TYPE_NULL;
+      release_lazy(lazy);
+    }
+}
+
 Value::operator const List &() const
 {
   check_type(JSON_TYPE_LIST);
+
+  if (storage == STORAGE_LAZY)
+    materialize();
+
   return *value.v_list;
 }
 
 Value::operator const Object &() const
 {
   check_type(JSON_TYPE_OBJECT);
+
+  if (storage == STORAGE_LAZY)
+    materialize();
+
   return *value.v_object;
 }
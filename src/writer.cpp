@@ -0,0 +1,302 @@
+#include "json/writer.h"
+#include "encoder.h"
+
+using namespace Json;
+
+Writer::Writer(Sink &sink, int flags)
+  : encoder(new Encoder(sink, flags & ASCII)), pretty(flags & PRETTY), complete(false)
+{
+}
+
+Writer::~Writer()
+{
+  delete encoder;
+}
+
+void
+Writer::begin_object()
+{
+  before_value();
+
+  Frame frame = { true, true, false };
+  frames.push_back(frame);
+  encoder->put('{');
+}
+
+void
+Writer::end_object()
+{
+  close(true, '}');
+}
+
+void
+Writer::begin_array()
+{
+  before_value();
+
+  Frame frame = { false, true, false };
+  frames.push_back(frame);
+  encoder->put('[');
+}
+
+void
+Writer::end_array()
+{
+  close(false, ']');
+}
+
+void
+Writer::key(const std::wstring &name)
+{
+  Frame &frame = before_key();
+  encoder->string(name.data(), name.size());
+  after_key(frame);
+}
+
+void
+Writer::key(const char *name)
+{
+  key(name, strlen(name));
+}
+
+void
+Writer::key(const char *name, size_t length)
+{
+  Frame &frame = before_key();
+  encoder->utf8_string(name, length);
+  after_key(frame);
+}
+
+void
+Writer::null()
+{
+  before_value();
+  encoder->raw("null", 4);
+  after_value();
+}
+
+void
+Writer::value(const Value &value)
+{
+  // Without pretty printing, the encoder writes the whole tree at once
+  if (!pretty)
+    {
+      before_value();
+      encoder->value(value);
+      after_value();
+      return;
+    }
+
+  switch (value.get_type())
+    {
+    case Value::JSON_TYPE_LIST:
+      {
+        const Value::List &list = value;
+
+        begin_array();
+        for (Value::List::const_iterator it = list.begin(); it != list.end(); ++it)
+          this->value(*it);
+        end_array();
+      }
+      break;
+
+    case Value::JSON_TYPE_OBJECT:
+      {
+        const Value::Object &obj = value;
+
+        begin_object();
+        for (Value::Object::const_iterator it = obj.begin(); it != obj.end(); ++it)
+          {
+            key(it->first);
+            this->value(it->second);
+          }
+        end_object();
+      }
+      break;
+
+    default:
+      before_value();
+      encoder->value(value);
+      after_value();
+      break;
+    }
+}
+
+void
+Writer::value(bool value)
+{
+  before_value();
+
+  if (value)
+    encoder->raw("true", 4);
+  else
+    encoder->raw("false", 5);
+
+  after_value();
+}
+
+void
+Writer::value(int value)
+{
+  this->value((int64_t)value);
+}
+
+void
+Writer::value(int64_t value)
+{
+  before_value();
+  encoder->integer(value);
+  after_value();
+}
+
+void
+Writer::value(uint64_t value)
+{
+  before_value();
+  encoder->unsigned_integer(value);
+  after_value();
+}
+
+void
+Writer::value(double value)
+{
+  before_value();
+  encoder->number(value);
+  after_value();
+}
+
+void
+Writer::value(const std::wstring &value)
+{
+  before_value();
+  encoder->string(value.data(), value.size());
+  after_value();
+}
+
+void
+Writer::value(const char *value)
+{
+  this->value(value, strlen(value));
+}
+
+void
+Writer::value(const char *value, size_t length)
+{
+  before_value();
+  encoder->utf8_string(value, length);
+  after_value();
+}
+
+void
+Writer::flush()
+{
+  encoder->flush();
+}
+
+void
+Writer::finish()
+{
+  if (!complete)
+    throw WriterException("Incomplete document");
+
+  encoder->flush();
+}
+
+Writer::Frame &
+Writer::before_key()
+{
+  if (frames.empty() || !frames.back().object || frames.back().has_key)
+    throw WriterException("Key outside of an object");
+
+  Frame &frame = frames.back();
+  separator(frame);
+  return frame;
+}
+
+void
+Writer::after_key(Frame &frame)
+{
+  if (pretty)
+    encoder->raw(": ", 2);
+  else
+    encoder->put(':');
+
+  frame.has_key = true;
+}
+
+void
+Writer::before_value()
+{
+  if (frames.empty())
+    {
+      if (complete)
+        throw WriterException("Only one value can be written");
+
+      return;
+    }
+
+  Frame &frame = frames.back();
+
+  if (frame.object)
+    {
+      if (!frame.has_key)
+        throw WriterException("Missing object key");
+
+      frame.has_key = false;
+      return;
+    }
+
+  separator(frame);
+}
+
+void
+Writer::after_value()
+{
+  if (frames.empty())
+    complete = true;
+}
+
+void
+Writer::separator(Frame &frame)
+{
+  if (!frame.empty)
+    {
+      if (pretty)
+        encoder->put(',');
+      else
+        encoder->raw(", ", 2);
+    }
+
+  frame.empty = false;
+
+  if (pretty)
+    newline();
+}
+
+void
+Writer::close(bool object, char c)
+{
+  if (frames.empty() || frames.back().object != object)
+    throw WriterException(object ? "No object to terminate" : "No array to terminate");
+
+  if (frames.back().has_key)
+    throw WriterException("Missing object value");
+
+  bool empty = frames.back().empty;
+  frames.pop_back();
+
+  if (pretty && !empty)
+    newline();
+
+  encoder->put(c);
+  after_value();
+}
+
+void
+Writer::newline()
+{
+  encoder->put('\n');
+
+  for (size_t i = 0; i < frames.size(); ++i)
+    encoder->raw("  ", 2);
+}
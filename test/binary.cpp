@@ -0,0 +1,175 @@
+#include <json/json.h>
+#include <json/binary.h>
+
+#include "common.h"
+
+#include <iostream>
+#include <string>
+
+using namespace Json;
+
+void
+test_round_trip()
+{
+  JsonHandler json;
+  BinaryHandler binary;
+
+  Value value = json.decode(
+    "{ \"null\" : null, \"t\" : true, \"f\" : false, \"small\" : -3, \"int\" : 2147483648,"
+    " \"min\" : -9223372036854775808, \"max\" : 18446744073709551615, \"float\" : -0.125,"
+    " \"text\" : \"caf\\u00e9 \\u20ac \xf0\x9f\x98\x80\", \"empty\" : \"\", \"list\" : [ 1, [ ], { } ],"
+    " \"nested\" : { \"k\\u00e9y\" : [ \"a long string of plain ASCII text\" ] } }");
+
+  std::string data;
+  GUARD(binary.encode(data, value));
+  ASSERT(BinaryHandler::is_binary(data.data(), data.size()));
+
+  Value copy;
+  GUARD(copy = binary.decode(data));
+  ASSERT_EQ(copy, value);
+  const Value::Object &obj = copy;
+  ASSERT(obj.find(L"max")->second.is_uint64());
+  ASSERT_EQ((int64_t)obj.find(L"min")->second, INT64_MIN);
+
+  std::string text1, text2;
+  json.encode(text1, value);
+  json.encode(text2, copy);
+  ASSERT_EQ(text2, text1);
+
+  // Scalars are values too
+  GUARD(binary.encode(data, Value(1.5)));
+  ASSERT_EQ(data.size(), 9);
+  ASSERT_EQ(binary.decode(data), 1.5);
+
+  GUARD(binary.encode(data, Value(-1)));
+  ASSERT_EQ(data, std::string("\x03\x01", 2));
+  ASSERT_EQ(binary.decode(data), -1);
+}
+
+void
+test_borrow()
+{
+  JsonHandler json;
+  BinaryHandler binary;
+
+  std::string data;
+  binary.encode(data, json.decode("[ \"abc\", \"d\\u00e9f\" ]"));
+
+  Document doc;
+  GUARD(binary.decode(doc, data.data(), data.size(), JsonHandler::BORROW_STRINGS));
+
+  const Value::List &list = doc.get_root();
+  ASSERT_EQ(list.size(), 2);
+  ASSERT_EQ(list.get_allocator().get_resource(), &doc.get_arena());
+
+  const char *text;
+  size_t length;
+  ASSERT(list[1].get_utf8_string(text, length));
+  ASSERT(text >= data.data() && text < data.data() + data.size());
+  ASSERT_EQ(list[1], std::wstring(L"d\u00e9f"));
+}
+
+void
+test_errors()
+{
+  BinaryHandler binary;
+
+  ASSERT_THROW(binary.decode(std::string()), UnexpectedEof);
+  ASSERT_THROW(binary.decode(std::string("\x09", 1)), InvalidCharacter);
+  ASSERT_THROW(binary.decode(std::string("\x05\x00\x00", 3)), UnexpectedEof);
+  ASSERT_THROW(binary.decode(std::string("\x06\x05" "abc", 5)), UnexpectedEof);
+  ASSERT_THROW(binary.decode(std::string("\x06\x02\xc3\x28", 4)), InvalidCharacter);
+  ASSERT_THROW(binary.decode(std::string("\x07\xff\xff\xff\xff\x0f\x00", 7)), UnexpectedEof);
+  ASSERT_THROW(binary.decode(std::string("\x03\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\x01", 12)),
+               InvalidCharacter);
+
+  try
+    {
+      binary.decode(std::string("\x07\x02\x00\x0a", 4));
+      ASSERT(false);
+    }
+  catch (const InvalidCharacter &e)
+    {
+      ASSERT_EQ(std::string(e.what()), "Invalid type at 3");
+    }
+
+  // Nothing may follow the value
+  try
+    {
+      binary.decode(std::string("\x02junk", 5));
+      ASSERT(false);
+    }
+  catch (const InvalidCharacter &e)
+    {
+      ASSERT_EQ(std::string(e.what()), "Unexpected data after the value at 1");
+    }
+
+  ASSERT_THROW(binary.decode(std::string("\x07\x00\x00", 3)), InvalidCharacter);
+
+  // JSON text is not taken for binary data
+  ASSERT(!BinaryHandler::is_binary("[ 1 ]", 5));
+  ASSERT(!BinaryHandler::is_binary(" 1", 2));
+  ASSERT(!BinaryHandler::is_binary("", 0));
+}
+
+void
+test_max_depth()
+{
+  BinaryHandler binary;
+  std::string data;
+
+  ASSERT_EQ(binary.get_max_depth(), 1024);
+
+  // Lists of a single list, then the innermost empty one
+  for (int i = 0; i < 3; ++i)
+    data += std::string("\x07\x01", 2);
+  data += std::string("\x07\x00", 2);
+
+  binary.set_max_depth(4);
+  GUARD(binary.decode(data));
+
+  binary.set_max_depth(3);
+  try
+    {
+      binary.decode(data);
+      ASSERT(false);
+    }
+  catch (const NestingTooDeep &e)
+    {
+      ASSERT_EQ(std::string(e.what()), "Maximum nesting depth exceeded at 6");
+    }
+
+  binary.set_max_depth(1);
+  GUARD(binary.decode(std::string("\x08\x01\x01" "a" "\x00", 5)));
+  try
+    {
+      binary.decode(std::string("\x08\x01\x01" "a" "\x08\x00", 6));
+      ASSERT(false);
+    }
+  catch (const NestingTooDeep &e)
+    {
+      ASSERT_EQ(std::string(e.what()), "Maximum nesting depth exceeded at 4");
+    }
+
+  // Deep data fails before the decoder runs out of stack
+  data.clear();
+  for (int i = 0; i < 2000000; ++i)
+    data += std::string("\x07\x01", 2);
+
+  binary.set_max_depth(1024);
+  ASSERT_THROW(binary.decode(data), NestingTooDeep);
+
+  binary.set_max_depth(0);
+  ASSERT_EQ(binary.get_max_depth(), 0);
+  GUARD(binary.decode(std::string("\x07\x01\x07\x00", 4)));
+}
+
+int
+main()
+{
+  RUN0(test_round_trip);
+  RUN0(test_borrow);
+  RUN0(test_errors);
+  RUN0(test_max_depth);
+  return 0;
+}
@@ -0,0 +1,163 @@
+#include <json/json.h>
+#include <json/binding.h>
+
+#include "common.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace Json;
+
+namespace Records
+{
+
+  struct Point
+  {
+    int x;
+    int y;
+  };
+
+  JSON_FIELDS(Point, x, y)
+
+  struct Record
+  {
+    Record()
+      : id(0), ok(false), ratio(0), small(0)
+    {
+    }
+
+    int64_t id;
+    bool ok;
+    double ratio;
+    uint8_t small;
+    std::string name;
+    std::wstring title;
+    std::vector< Point > points;
+    std::vector< std::vector< int > > grid;
+    Value extra;
+    std::vector< Record > children;
+  };
+
+  JSON_FIELDS(Record, id, ok, ratio, small, name, title, points, grid, extra, children)
+
+} // namespace Records
+
+using namespace Records;
+
+void
+test_decode()
+{
+  const char *input =
+    "{ \"id\" : 12345678901, \"ok\" : true, \"ratio\" : 2, \"small\" : 255,"
+    " \"name\" : \"caf\xc3\xa9\", \"title\" : \"a\\\"b\\u20ac\","
+    " \"unknown\" : { \"x\" : [ 1, { \"id\" : 5 } ] },"
+    " \"points\" : [ { \"x\" : 1, \"y\" : -2, \"z\" : 0 }, { \"y\" : 4 } ],"
+    " \"grid\" : [ [ 1, 2 ], [ ], [ 3 ] ],"
+    " \"extra\" : { \"list\" : [ null, \"text\", 1.5 ] },"
+    " \"children\" : [ { \"id\" : 7, \"name\" : \"child\" } ] }";
+
+  Record record;
+  GUARD(decode_struct(record, input, strlen(input)));
+
+  ASSERT_EQ(record.id, 12345678901LL);
+  ASSERT_EQ(record.ok, true);
+  ASSERT_EQ(record.ratio, 2.0);
+  ASSERT_EQ(record.small, 255);
+  ASSERT_EQ(record.name, "caf\xc3\xa9");
+  ASSERT(record.title == L"a\"b\u20ac");
+  ASSERT_EQ(record.points.size(), 2);
+  ASSERT_EQ(record.points[0].x, 1);
+  ASSERT_EQ(record.points[0].y, -2);
+  ASSERT_EQ(record.points[1].x, 0);
+  ASSERT_EQ(record.points[1].y, 4);
+  ASSERT_EQ(record.grid.size(), 3);
+  ASSERT_EQ(record.grid[0][1], 2);
+  ASSERT_EQ(record.grid[1].size(), 0);
+  ASSERT_EQ(record.grid[2][0], 3);
+  ASSERT_EQ(record.children.size(), 1);
+  ASSERT_EQ(record.children[0].id, 7);
+  ASSERT_EQ(record.children[0].name, "child");
+
+  JsonHandler handler;
+  ASSERT_EQ(record.extra, handler.decode("{ \"list\" : [ null, \"text\", 1.5 ] }"));
+
+  // Missing members are kept, null resets them and lists are replaced
+  GUARD(decode_struct(record, std::string("{ \"name\" : null, \"grid\" : [ [ 9 ] ], \"extra\" : 3 }")));
+  ASSERT_EQ(record.id, 12345678901LL);
+  ASSERT_EQ(record.name, "");
+  ASSERT_EQ(record.grid.size(), 1);
+  ASSERT_EQ(record.extra, 3);
+
+  std::vector< Point > points;
+  GUARD(decode_struct(points, std::string("[ { \"x\" : 1, \"y\" : 2 } ]")));
+  ASSERT_EQ(points.size(), 1);
+  ASSERT_EQ(points[0].y, 2);
+}
+
+void
+test_errors()
+{
+  Record record;
+
+  ASSERT_THROW(decode_struct(record, std::string("{ \"id\" : \"text\" }")), BindingError);
+  ASSERT_THROW(decode_struct(record, std::string("{ \"small\" : 256 }")), BindingError);
+  ASSERT_THROW(decode_struct(record, std::string("{ \"small\" : -1 }")), BindingError);
+  ASSERT_THROW(decode_struct(record, std::string("{ \"points\" : { } }")), BindingError);
+  ASSERT_THROW(decode_struct(record, std::string("{ \"ok\" : 1 }")), BindingError);
+  ASSERT_THROW(decode_struct(record, std::string("[ 1 ]")), BindingError);
+  ASSERT_THROW(decode_struct(record, std::string("{ \"id\" : 1 ")), ParseError);
+
+  // Skipped members count towards the nesting limit
+  std::string deep = "{ \"id\" : 1, \"body\" : " + std::string(1000000, '[')
+    + std::string(1000000, ']') + " }";
+  try
+    {
+      decode_struct(record, deep);
+      ASSERT(false);
+    }
+  catch (const NestingTooDeep &)
+    {
+    }
+  GUARD(decode_struct(record, deep, 0));
+  ASSERT_EQ(record.id, 1);
+}
+
+void
+test_encode()
+{
+  Record record;
+  record.id = -5;
+  record.ok = true;
+  record.ratio = 0.25;
+  record.name = "caf\xc3\xa9";
+  record.title = L"t\"";
+  Point point = { 1, 2 };
+  record.points.push_back(point);
+  record.extra = std::wstring(L"x");
+  record.children.push_back(Record());
+
+  std::string json;
+  GUARD(encode_struct(json, record));
+  ASSERT_EQ(json, "{\"id\":-5, \"ok\":true, \"ratio\":0.25, \"small\":0, \"name\":\"caf\xc3\xa9\","
+                  " \"title\":\"t\\\"\", \"points\":[{\"x\":1, \"y\":2}], \"grid\":[], \"extra\":\"x\","
+                  " \"children\":[{\"id\":0, \"ok\":false, \"ratio\":0, \"small\":0, \"name\":\"\","
+                  " \"title\":\"\", \"points\":[], \"grid\":[], \"extra\":null, \"children\":[]}]}");
+
+  // The output decodes to the same object
+  Record copy;
+  GUARD(decode_struct(copy, json));
+
+  std::string again;
+  encode_struct(again, copy);
+  ASSERT_EQ(again, json);
+}
+
+int
+main()
+{
+  RUN0(test_decode);
+  RUN0(test_errors);
+  RUN0(test_encode);
+  return 0;
+}
@@ -3,6 +3,7 @@
 #include "common.h"
 
 #include <iostream>
+#include <thread>
 
 using namespace Json;
 
@@ -19,9 +20,88 @@ test_utf8_decode()
   ASSERT_WSTREQ(dest.c_str(), L"xyz\u20ACxyz");
 }
 
+void
+test_native()
+{
+  // Long enough for the vectorized ASCII runs
+  std::wstring text;
+
+  for (int i = 0; i < 20; ++i)
+    text += L"plain ASCII text, caf\u00e9 \u20AC \U0001F600 ";
+
+  const char *encodings[] = { "UTF-8", "utf8", "UTF-16LE", "UTF-16BE", "UTF-32LE", "UTF-32BE" };
+
+  for (size_t i = 0; i < sizeof(encodings) / sizeof(encodings[0]); ++i)
+    {
+      Codec codec(encodings[i]);
+      std::string bytes;
+      std::wstring back;
+
+      codec.encode(bytes, text);
+      codec.decode(back, bytes);
+      ASSERT(back == text);
+    }
+
+  std::string bytes;
+  Codec("UTF-16BE").encode(bytes, L"a\U0001F600");
+  ASSERT_EQ(bytes, std::string("\0a\xd8\x3d\xde\x00", 6));
+  bytes.clear();
+  Codec("UTF-32LE").encode(bytes, L"\u20AC");
+  ASSERT_EQ(bytes, std::string("\xac\x20\0\0", 4));
+  bytes.clear();
+  Codec("UTF-8").encode(bytes, text);
+  ASSERT_EQ(bytes.size(), 20 * 33);
+
+  // Errors leave the destination unchanged
+  Codec utf8("UTF-8");
+  std::wstring dest = L"kept";
+  ASSERT_THROW(utf8.decode(dest, std::string("ab\xc3(")), CodecException);
+  ASSERT_THROW(utf8.decode(dest, std::string("ab\xed\xa0\x80")), CodecException);
+  ASSERT_THROW(utf8.decode(dest, std::string("ab\xf0\x9f")), CodecException);
+  ASSERT_THROW(Codec("UTF-16LE").decode(dest, std::string("\x3d\xd8", 2)), CodecException);
+  ASSERT_THROW(Codec("UTF-16LE").decode(dest, std::string("a", 1)), CodecException);
+  ASSERT_THROW(Codec("UTF-32BE").decode(dest, std::string("\0\x11\0\0", 4)), CodecException);
+  ASSERT(dest == L"kept");
+
+  bytes = "kept";
+  ASSERT_THROW(utf8.encode(bytes, std::wstring(1, (wchar_t)0xDC00)), CodecException);
+  ASSERT_EQ(bytes, "kept");
+
+  // Output is appended
+  utf8.decode(dest, std::string("\xc3\xa9"));
+  ASSERT(dest == L"kept\u00e9");
+}
+
+void
+test_cache()
+{
+  Codec &latin1 = Codec::get("ISO-8859-1");
+  ASSERT_EQ(&Codec::get("ISO-8859-1"), &latin1);
+  ASSERT_NE(&Codec::get("UTF-8"), &latin1);
+
+  // Other threads get their own codecs
+  Codec *other = NULL;
+  std::thread thread([&other]() { other = &Codec::get("ISO-8859-1"); });
+  thread.join();
+  ASSERT(other != NULL);
+  ASSERT_NE(other, &latin1);
+
+  // A failed conversion does not disturb the next ones
+  Codec &utf8 = Codec::get("UTF-8");
+  std::wstring dest;
+  ASSERT_THROW(utf8.decode(dest, std::string("abc\xe2\x82")), CodecException);
+  dest.clear();
+  utf8.decode(dest, std::string("\xe2\x82\xac"));
+  ASSERT_WSTREQ(dest.c_str(), L"\u20AC");
+
+  ASSERT_THROW(Codec::get("NO-SUCH-ENCODING"), CodecException);
+}
+
 int
 main()
 {
   RUN0(test_utf8_decode);
+  RUN0(test_native);
+  RUN0(test_cache);
   return 0;
 }
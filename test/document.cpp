@@ -0,0 +1,441 @@
+#include <json/json.h>
+#include <json/document.h>
+
+#include "common.h"
+
+#include <iostream>
+
+#include <unistd.h>
+
+using namespace Json;
+
+void
+test_arena()
+{
+  Arena arena(1024);
+
+  void *p1 = arena.allocate(10);
+  void *p2 = arena.allocate(8, 8);
+  ASSERT_NE(p1, p2);
+  ASSERT_EQ((size_t)p2 & 7, 0);
+
+  // Allocations larger than a block are served too
+  void *p3 = arena.allocate(4096);
+  ASSERT(p3 != NULL);
+  memset(p3, 0, 4096);
+
+  ASSERT_EQ(arena.get_size(), 10 + 8 + 4096);
+  arena.clear();
+  ASSERT_EQ(arena.get_size(), 0);
+}
+
+void
+test_decode()
+{
+  JsonHandler handler;
+  Document doc;
+
+  GUARD(handler.decode(doc, "{ \"list\" : [ 1, \"two\", [ 3.5 ] ], \"key\" : \"value\" }"));
+
+  const Value &root = doc.get_root();
+  ASSERT_EQ(root.get_type(), Value::JSON_TYPE_OBJECT);
+  ASSERT(doc.get_arena().get_size() > 0);
+
+  const Value::Object &obj = root;
+  ASSERT_EQ(obj.size(), 2);
+  ASSERT_EQ(obj.get_allocator().get_resource(), &doc.get_arena());
+
+  const Value::List &list = obj.find(L"list")->second;
+  ASSERT_EQ(list.size(), 3);
+  ASSERT_EQ(list.get_allocator().get_resource(), &doc.get_arena());
+  ASSERT_EQ(list[0], 1);
+  ASSERT_EQ(list[1], std::wstring(L"two"));
+  ASSERT_EQ(((const Value::List &)list[2])[0], 3.5);
+  ASSERT_EQ(obj.find(L"key")->second, std::wstring(L"value"));
+
+  // Decoding again replaces the previous tree
+  GUARD(handler.decode(doc, std::wstring(L"[ \"x\" ]")));
+  ASSERT_EQ(doc.get_root().get_type(), Value::JSON_TYPE_LIST);
+  ASSERT_EQ(((const Value::List &)doc.get_root())[0], std::wstring(L"x"));
+
+  ASSERT_THROW(handler.decode(doc, "[ 1, "), ParseError);
+}
+
+void
+test_copy()
+{
+  JsonHandler handler;
+  Value copy;
+
+  {
+    Document doc;
+    handler.decode(doc, "{ \"a\" : [ \"nested string\", { \"b\" : null } ] }");
+    copy = doc.get_root();
+
+    ASSERT_EQ(copy, doc.get_root());
+    ASSERT(((const Value::Object &)copy).get_allocator().get_resource() == NULL);
+  }
+
+  // The copy does not depend on the document
+  const Value::Object &obj = copy;
+  const Value::List &list = obj.find(L"a")->second;
+  ASSERT_EQ(list.get_allocator().get_resource(), (MemoryResource *)NULL);
+  ASSERT_EQ(list[0], std::wstring(L"nested string"));
+  ASSERT_EQ(((const Value::Object &)list[1]).size(), 1);
+}
+
+void
+test_borrow()
+{
+  JsonHandler handler;
+  Document doc;
+  std::string input = "{ \"plain\" : \"abc\", \"escaped\" : \"a\\nc\", \"list\" : [ \"\xc3\xa9t\xc3\xa9\" ] }";
+
+  GUARD(handler.decode(doc, input.data(), input.size(), true));
+
+  const Value::Object &obj = doc.get_root();
+  const Value &plain = obj.find(L"plain")->second;
+  const Value &escaped = obj.find(L"escaped")->second;
+
+  // Copies do not reference the input
+  Value copy = plain;
+
+  // Strings without escapes reference the input until they are accessed,
+  // the others are copied
+  input[input.find("abc")] = 'x';
+  input[input.find("a\\nc")] = 'x';
+
+  ASSERT_EQ(plain, std::wstring(L"xbc"));
+  ASSERT_EQ(escaped, std::wstring(L"a\nc"));
+  ASSERT_EQ(copy, std::wstring(L"abc"));
+  ASSERT_EQ(((const Value::List &)obj.find(L"list")->second)[0], std::wstring(L"\u00e9t\u00e9"));
+
+  // Borrowed strings compare with each other without being transcoded
+  Value first, second;
+  first.set_borrowed("same", 4);
+  second.set_borrowed("same text", 4);
+  ASSERT_EQ(first, second);
+
+  ASSERT_THROW(handler.decode(doc, "[ \"\xc3(\" ]", 8, true), InvalidCharacter);
+  ASSERT_THROW(handler.decode(doc, "[ \"abc", 7, true), UnexpectedEof);
+}
+
+void
+test_lazy()
+{
+  JsonHandler handler;
+  Document doc, eager;
+  std::string input = "{ \"meta\" : { \"id\" : 7 }, \"payload\" : [ 1, \"a]\\\"}\", { \"x\" : [ ] } ], \"empty\" : [] }";
+
+  GUARD(handler.decode(doc, input.data(), input.size(), JsonHandler::LAZY_CONTAINERS));
+  GUARD(handler.decode(eager, input.data(), input.size()));
+
+  // Only the root is parsed
+  const Value &root = doc.get_root();
+  ASSERT(!root.is_lazy());
+
+  const Value::Object &obj = root;
+  const Value &meta = obj.find(L"meta")->second;
+  const Value &payload = obj.find(L"payload")->second;
+  ASSERT(meta.is_lazy());
+  ASSERT(payload.is_lazy());
+  ASSERT_EQ(payload.get_type(), Value::JSON_TYPE_LIST);
+  ASSERT_EQ(meta.get_type(), Value::JSON_TYPE_OBJECT);
+
+  ASSERT_EQ(((const Value::Object &)meta).find(L"id")->second, 7);
+  ASSERT(!meta.is_lazy());
+  ASSERT(payload.is_lazy());
+
+  // Brackets in strings are skipped, nested containers are lazy in turn
+  const Value::List &list = payload;
+  ASSERT_EQ(list.size(), 3);
+  ASSERT_EQ(list[1], std::wstring(L"a]\"}"));
+  ASSERT(list[2].is_lazy());
+
+  ASSERT_EQ(doc.get_root(), eager.get_root());
+
+  std::string text, eager_text;
+  handler.encode(text, doc.get_root());
+  handler.encode(eager_text, eager.get_root());
+  ASSERT_STREQ(text.c_str(), eager_text.c_str());
+
+  // Copies are parsed
+  GUARD(handler.decode(doc, input.data(), input.size(), JsonHandler::LAZY_CONTAINERS));
+  Value copy = ((const Value::Object &)doc.get_root()).find(L"payload")->second;
+  ASSERT(!copy.is_lazy());
+  ASSERT_EQ(copy, ((const Value::Object &)eager.get_root()).find(L"payload")->second);
+
+  // Errors in containers show when they are accessed, at their position in
+  // the input
+  const char *invalid = "[ { \"a\" : tru }, [ 1, , 2 ], [ [ 1 2 ] ] ]";
+  GUARD(handler.decode(doc, invalid, strlen(invalid), JsonHandler::LAZY_CONTAINERS));
+  const Value::List &items = doc.get_root();
+  ASSERT_EQ(items.size(), 3);
+  ASSERT_THROW((void)(const Value::Object &)items[0], InvalidCharacter);
+  ASSERT_THROW((void)(const Value::List &)items[1], InvalidCharacter);
+  ASSERT(items[1].is_lazy());
+
+  try
+    {
+      (void)(const Value::List &)items[1];
+      ASSERT(false);
+    }
+  catch (const InvalidCharacter &e)
+    {
+      ASSERT_EQ(std::string(e.what()), "Invalid character found at 22");
+    }
+
+  // Nested containers too
+  const Value::List &nested = items[2];
+  ASSERT(nested[0].is_lazy());
+  try
+    {
+      (void)(const Value::List &)nested[0];
+      ASSERT(false);
+    }
+  catch (const InvalidCharacter &e)
+    {
+      ASSERT_EQ(std::string(e.what()), "List ended with an invalid character at 35");
+    }
+
+  ASSERT_THROW(handler.decode(doc, "[ [ 1 ", 6, JsonHandler::LAZY_CONTAINERS), UnexpectedEof);
+  ASSERT_THROW(handler.decode(doc, "[ [ \"]", 6, JsonHandler::LAZY_CONTAINERS), UnexpectedEof);
+
+  // Brackets must match even in the containers which are not parsed
+  try
+    {
+      const char *mismatched = "{ \"a\" : [ 1 } }";
+      handler.decode(doc, mismatched, strlen(mismatched), JsonHandler::LAZY_CONTAINERS);
+      ASSERT(false);
+    }
+  catch (const InvalidCharacter &e)
+    {
+      ASSERT_EQ(std::string(e.what()), "List ended with an invalid character at 12");
+    }
+
+  ASSERT_THROW(handler.decode(doc, "[ { \"a\" : [ ] ] ]", 17, JsonHandler::LAZY_CONTAINERS),
+               InvalidCharacter);
+  ASSERT(!handler.try_decode(doc, "[ [ { ] } ]", 11, JsonHandler::LAZY_CONTAINERS));
+
+  Value value;
+  ASSERT_THROW(value.set_lazy("1", 1, Value::JSON_TYPE_INTEGER), ValueException);
+  value.set_lazy("[ 1, [ 2 ] ]", 12, Value::JSON_TYPE_LIST);
+  ASSERT_EQ(((const Value::List &)value).size(), 2);
+  ASSERT(!((const Value::List &)value)[1].is_lazy());
+
+  // The nesting limit applies to the containers as they are skipped and
+  // to what is left of it when they are parsed
+  handler.set_max_depth(3);
+  const char *deep = "[ [ [ 1 ] ], [ [ 2 ] ] ]";
+  GUARD(handler.decode(doc, deep, strlen(deep), JsonHandler::LAZY_CONTAINERS));
+  const Value::List &outer = doc.get_root();
+  ASSERT_EQ(((const Value::List &)((const Value::List &)outer[1])[0])[0], 2);
+  ASSERT_THROW(handler.decode(doc, "[ [ [ [ ] ] ] ]", 15, JsonHandler::LAZY_CONTAINERS), NestingTooDeep);
+
+  value.set_lazy("[ [ 1 ] ]", 9, Value::JSON_TYPE_LIST, JsonHandler::LAZY_CONTAINERS, 0, 2);
+  ASSERT_EQ(((const Value::List &)((const Value::List &)value)[0])[0], 1);
+  value.set_lazy("[ [ 1 ] ]", 9, Value::JSON_TYPE_LIST, JsonHandler::LAZY_CONTAINERS, 0, 1);
+  ASSERT_THROW((void)(const Value::List &)value, NestingTooDeep);
+  value.set_lazy("[ [ 1 ] ]", 9, Value::JSON_TYPE_LIST, 0, 0, 1);
+  ASSERT_THROW((void)(const Value::List &)value, NestingTooDeep);
+}
+
+// Write the data to a temporary file and return its path
+std::string
+write_file(const char *data)
+{
+  char path[] = "/tmp/json-test-XXXXXX";
+  int fd = mkstemp(path);
+
+  ASSERT(fd >= 0);
+  ASSERT_EQ(write(fd, data, strlen(data)), (ssize_t)strlen(data));
+  close(fd);
+
+  return path;
+}
+
+// Resource counting the memory in use
+class CountingResource : public MemoryResource
+{
+public:
+  CountingResource()
+    : used(0), allocations(0)
+  {
+  }
+
+  size_t used;
+  size_t allocations;
+
+protected:
+  void *do_allocate(size_t size, size_t align) override
+  {
+    used += size;
+    ++allocations;
+    return std::pmr::new_delete_resource()->allocate(size, align);
+  }
+
+  void do_deallocate(void *ptr, size_t size, size_t align) override
+  {
+    used -= size;
+    std::pmr::new_delete_resource()->deallocate(ptr, size, align);
+  }
+
+  bool do_is_equal(const MemoryResource &other) const noexcept override
+  {
+    return this == &other;
+  }
+};
+
+void
+test_resource()
+{
+  JsonHandler handler;
+  CountingResource resource;
+  const char *input = "{ \"list\" : [ 1, \"a string longer than a short one\", [ ] ], \"key\" : \"value\" }";
+
+  {
+    Value value;
+    handler.decode(value, &resource, input, strlen(input));
+    ASSERT(resource.used > 0);
+
+    const Value::Object &obj = value;
+    const Value::List &list = obj.find(L"list")->second;
+    ASSERT_EQ(list.get_allocator().get_resource(), &resource);
+    ASSERT_EQ(list[1], std::wstring(L"a string longer than a short one"));
+    ASSERT_EQ(value, handler.decode(input));
+
+    // Moves stay in the resource
+    Value moved(std::move(value));
+    ASSERT_EQ(((const Value::Object &)moved).get_allocator().get_resource(), &resource);
+  }
+
+  // Everything is given back
+  ASSERT_EQ(resource.used, 0);
+  ASSERT(resource.allocations > 0);
+
+  // Standard pools
+  std::pmr::unsynchronized_pool_resource pool;
+  Value value;
+  handler.decode(value, &pool, input, strlen(input));
+  ASSERT_EQ(value, handler.decode(input));
+
+  // Arena blocks come from upstream
+  resource.allocations = 0;
+  {
+    Document doc(1024, &resource);
+    handler.decode(doc, input, strlen(input));
+    ASSERT_EQ(resource.allocations, 1);
+    ASSERT_EQ(doc.get_root(), value);
+  }
+  ASSERT_EQ(resource.used, 0);
+}
+
+void
+test_decode_file()
+{
+  JsonHandler handler;
+  std::string path = write_file("{ \"name\" : \"caf\xc3\xa9\", \"list\" : [ 1, 2 ] }");
+  Value value;
+
+  GUARD(value = handler.decode_file(path.c_str()));
+  ASSERT_EQ(((const Value::Object &)value).find(L"name")->second, std::wstring(L"caf\u00e9"));
+
+  {
+    MappedFile file(path.c_str());
+    ASSERT(file.is_mapped());
+    ASSERT_EQ(file.get_size(), strlen("{ \"name\" : \"caf\xc3\xa9\", \"list\" : [ 1, 2 ] }"));
+  }
+
+  Document doc;
+  GUARD(handler.decode_file(doc, path.c_str()));
+  ASSERT_EQ(doc.get_root(), value);
+  ASSERT(doc.get_source() == NULL);
+
+  GUARD(handler.decode_file(doc, path.c_str(), true));
+  ASSERT_EQ(doc.get_root(), value);
+  ASSERT(doc.get_source() != NULL);
+  ASSERT_EQ(((const Value::Object &)doc.get_root()).find(L"name")->second, std::wstring(L"caf\u00e9"));
+
+  doc.clear();
+  ASSERT(doc.get_source() == NULL);
+
+  // Other encodings are transcoded from the mapping
+  JsonHandler latin1("ISO-8859-1");
+  std::string latin1_path = write_file("[ \"caf\xe9\" ]");
+  ASSERT_EQ(((const Value::List &)latin1.decode_file(latin1_path.c_str()))[0], std::wstring(L"caf\u00e9"));
+
+  unlink(latin1_path.c_str());
+  unlink(path.c_str());
+
+  ASSERT_THROW(handler.decode_file(path.c_str()), IOError);
+  ASSERT_THROW(handler.decode_file(doc, "/"), IOError);
+}
+
+void
+test_parallel()
+{
+  // Items with brackets, commas and quotes in their strings
+  std::string input = "[";
+
+  for (int i = 0; i < 500; ++i)
+    {
+      char item[128];
+      snprintf(item, sizeof(item), "%s{ \"id\" : %d, \"text\" : \"a],[{\\\"b\", \"list\" : [ %d.5, null ] }",
+               (i ? ", " : " "), i, i);
+      input += item;
+    }
+
+  input += " ]";
+
+  JsonHandler handler;
+  handler.set_parallel(4, 256);
+
+  Value expected = handler.decode(input);
+  Document doc;
+
+  GUARD(handler.decode(doc, input.data(), input.size(), JsonHandler::PARALLEL));
+  ASSERT_EQ(doc.get_root(), expected);
+
+  const Value::List &list = doc.get_root();
+  ASSERT_EQ(list.size(), 500);
+  ASSERT_EQ(list.get_allocator().get_resource(), &doc.get_arena());
+  ASSERT_EQ(((const Value::Object &)list[499]).find(L"id")->second, 499);
+
+  GUARD(handler.decode(doc, input.data(), input.size(), JsonHandler::PARALLEL | JsonHandler::BORROW_STRINGS));
+  ASSERT_EQ(doc.get_root(), expected);
+
+  // Other roots and small lists are decoded by the calling thread
+  GUARD(handler.decode(doc, "{ \"a\" : [ 1 ] }", 15, JsonHandler::PARALLEL));
+  ASSERT_EQ(((const Value::Object &)doc.get_root()).size(), 1);
+  GUARD(handler.decode(doc, " [ ] ", 5, JsonHandler::PARALLEL));
+  ASSERT_EQ(((const Value::List &)doc.get_root()).size(), 0);
+
+  // Errors are reported at their position in the whole input
+  std::string broken = input;
+  broken.replace(broken.find("null", broken.size() / 2), 4, "nul!");
+  ASSERT_THROW(handler.decode(doc, broken.data(), broken.size(), JsonHandler::PARALLEL), InvalidCharacter);
+  broken = input.substr(0, input.size() - 2);
+  ASSERT_THROW(handler.decode(doc, broken.data(), broken.size(), JsonHandler::PARALLEL), ParseError);
+  broken = input;
+  broken.replace(broken.find("}, {", broken.size() / 2), 2, "}  ");
+  ASSERT_THROW(handler.decode(doc, broken.data(), broken.size(), JsonHandler::PARALLEL), InvalidCharacter);
+
+  JsonHandler latin1("ISO-8859-1");
+  latin1.set_parallel(3, 100);
+  GUARD(latin1.decode(doc, input.data(), input.size(), JsonHandler::PARALLEL));
+  ASSERT_EQ(doc.get_root(), expected);
+}
+
+int
+main()
+{
+  RUN0(test_arena);
+  RUN0(test_decode);
+  RUN0(test_copy);
+  RUN0(test_resource);
+  RUN0(test_decode_file);
+  RUN0(test_borrow);
+  RUN0(test_lazy);
+  RUN0(test_parallel);
+  return 0;
+}
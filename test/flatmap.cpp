@@ -0,0 +1,170 @@
+#include <json/flatmap.h>
+#include <json/json.h>
+
+#include "common.h"
+
+#include <iostream>
+#include <string>
+
+using namespace Json;
+
+typedef FlatMap< std::wstring, int > Map;
+
+std::wstring
+make_key(int i)
+{
+  return L"key" + std::to_wstring(i);
+}
+
+void
+test_small()
+{
+  Map map;
+
+  ASSERT(map.empty());
+  ASSERT(map.find(L"a") == map.end());
+
+  map[L"c"] = 1;
+  map[L"a"] = 2;
+  ASSERT(map.insert(std::make_pair(std::wstring(L"b"), 3)).second);
+
+  // The first value of a key is kept
+  std::pair< Map::iterator, bool > inserted = map.insert(std::make_pair(std::wstring(L"a"), 4));
+  ASSERT(!inserted.second);
+  ASSERT_EQ(inserted.first->second, 2);
+
+  ASSERT_EQ(map.size(), 3);
+  ASSERT_EQ(map.count(L"b"), 1);
+  ASSERT_EQ(map.count(L"d"), 0);
+
+  // Iteration follows insertion order
+  Map::const_iterator it = map.begin();
+  ASSERT(it->first == L"c");
+  ASSERT((++it)->first == L"a");
+  ASSERT((++it)->first == L"b");
+  ASSERT(++it == map.end());
+
+  ASSERT_EQ(map.erase(L"a"), 1);
+  ASSERT_EQ(map.erase(L"a"), 0);
+  ASSERT_EQ(map.size(), 2);
+  ASSERT(map.begin()->first == L"c");
+  ASSERT_EQ(map.find(L"b")->second, 3);
+}
+
+void
+test_indexed(int count)
+{
+  Map map;
+
+  for (int i = 0; i < count; ++i)
+    map[make_key(i)] = i;
+
+  ASSERT_EQ(map.size(), (size_t)count);
+
+  bool found = true;
+
+  for (int i = 0; i < count; ++i)
+    {
+      Map::const_iterator it = map.find(make_key(i));
+
+      if (it == map.end() || it->second != i || it - map.begin() != i)
+        found = false;
+    }
+
+  ASSERT(found);
+  ASSERT(map.find(L"missing") == map.end());
+
+  // Erasing keeps the index up to date
+  for (int i = 0; i < count; i += 2)
+    map.erase(make_key(i));
+
+  found = true;
+
+  for (int i = 0; i < count; ++i)
+    if ((map.find(make_key(i)) != map.end()) != (i % 2 == 1))
+      found = false;
+
+  ASSERT(found);
+  ASSERT_EQ(map.size(), (size_t)count / 2);
+}
+
+void
+test_compare()
+{
+  Map m1, m2;
+
+  for (int i = 0; i < 40; ++i)
+    {
+      m1[make_key(i)] = i;
+      m2[make_key(39 - i)] = 39 - i;
+    }
+
+  // Order does not matter
+  ASSERT(m1 == m2);
+
+  Map copy(m1);
+  ASSERT(copy == m1);
+
+  copy[L"key3"] = 0;
+  ASSERT(copy != m1);
+
+  copy.clear();
+  ASSERT(copy.empty());
+  ASSERT(copy.find(L"key3") == copy.end());
+
+  copy.swap(m1);
+  ASSERT_EQ(copy.size(), 40);
+  ASSERT(m1.empty());
+}
+
+void
+test_arena()
+{
+  typedef FlatMap< std::wstring, int, Allocator< std::pair< std::wstring, int > > > ArenaMap;
+
+  Arena arena;
+  ArenaMap map = ArenaMap(ArenaMap::allocator_type(&arena));
+
+  for (int i = 0; i < 100; ++i)
+    map[make_key(i)] = i;
+
+  ASSERT_EQ(map.get_allocator().get_resource(), &arena);
+  ASSERT(arena.get_size() > 0);
+  ASSERT_EQ(map.find(L"key42")->second, 42);
+
+  // Copies live on the heap
+  ArenaMap copy(map);
+  ASSERT(copy.get_allocator().get_resource() == NULL);
+  ASSERT(copy == map);
+}
+
+void
+test_value()
+{
+  JsonHandler handler;
+
+  Value value = handler.decode("{ \"b\" : 1, \"a\" : [ 2 ], \"b\" : 3 }");
+  const Value::Object &obj = value;
+  ASSERT_EQ(obj.size(), 2);
+  ASSERT_EQ(obj.find(L"b")->second, 1);
+
+#if JSON_FLAT_OBJECTS
+  // Objects are encoded in input order
+  std::string text;
+  handler.encode(text, value);
+  ASSERT_STREQ(text.c_str(), "{\"b\":1, \"a\":[2]}");
+#endif
+}
+
+int
+main()
+{
+  RUN0(test_small);
+  RUN1(test_indexed, 16);
+  RUN1(test_indexed, 17);
+  RUN1(test_indexed, 1000);
+  RUN0(test_compare);
+  RUN0(test_arena);
+  RUN0(test_value);
+  return 0;
+}
@@ -1,4 +1,10 @@
+#include <atomic>
 #include <iostream>
+#include <thread>
+#include <vector>
+
+#include <math.h>
+#include <stdint.h>
 
 #include <json/json.h>
 
@@ -53,6 +59,97 @@ test_decode_integer(const char *jstr, int expected)
   ASSERT_EQ(intval, expected);
 }
 
+void
+test_decode_integer64(const char *jstr, int64_t expected)
+{
+  JsonHandler handler;
+  Value intval;
+
+  intval = handler.decode(jstr);
+  ASSERT_EQ(intval.get_type(), Value::JSON_TYPE_INTEGER);
+  ASSERT_EQ((int64_t)intval, expected);
+  ASSERT(!intval.is_uint64());
+  ASSERT_THROW((int)intval, ValueException);
+
+  // Encoded back unchanged
+  std::string text;
+  handler.encode(text, intval);
+  ASSERT_STREQ(text.c_str(), jstr);
+}
+
+void
+test_decode_unsigned64(const char *jstr, uint64_t expected)
+{
+  JsonHandler handler;
+  Value intval;
+
+  intval = handler.decode(jstr);
+  ASSERT_EQ(intval.get_type(), Value::JSON_TYPE_INTEGER);
+  ASSERT_EQ((uint64_t)intval, expected);
+  ASSERT(intval.is_uint64());
+  ASSERT_THROW((int64_t)intval, ValueException);
+
+  std::string text;
+  handler.encode(text, intval);
+  ASSERT_STREQ(text.c_str(), jstr);
+}
+
+void
+test_raw_numbers()
+{
+  JsonHandler handler;
+  Document doc;
+  const char *input = "[ 12, -3.50, 123456789012345678901234567890, 1e400, 18446744073709551615 ]";
+
+  GUARD(handler.decode(doc, input, strlen(input), JsonHandler::RAW_NUMBERS));
+  const Value::List &list = doc.get_root();
+  ASSERT_EQ(list.size(), 5);
+
+  const char *text;
+  size_t length;
+  ASSERT(list[1].get_raw_number(text, length));
+  ASSERT_EQ(std::string(text, length), "-3.50");
+
+  // The text is converted on access
+  ASSERT_EQ(list[0].get_type(), Value::JSON_TYPE_INTEGER);
+  ASSERT_EQ(list[0], 12);
+  ASSERT_EQ(list[1].get_type(), Value::JSON_TYPE_FLOAT);
+  ASSERT_EQ(list[1], -3.5);
+  ASSERT_EQ(list[2].get_type(), Value::JSON_TYPE_FLOAT);
+  ASSERT_EQ((uint64_t)list[4], UINT64_MAX);
+  ASSERT_EQ(list[0], Value(12));
+
+  // And written back as it was
+  std::string encoded;
+  handler.encode(encoded, doc.get_root());
+  ASSERT_STREQ(encoded.c_str(), "[12, -3.50, 123456789012345678901234567890, 1e400, 18446744073709551615]");
+
+  // Copies hold the converted number
+  Value copy = list[1];
+  ASSERT(!copy.get_raw_number(text, length));
+  ASSERT_EQ(copy, -3.5);
+
+  // Integers below INT64_MIN are floats, like without RAW_NUMBERS
+  const char *negative = "[ -10000000000000000000, -9223372036854775808 ]";
+  GUARD(handler.decode(doc, negative, strlen(negative), JsonHandler::RAW_NUMBERS));
+  const Value::List &limits = doc.get_root();
+  ASSERT_EQ(limits[0].get_type(), Value::JSON_TYPE_FLOAT);
+  ASSERT_EQ((double)limits[0], -1e19);
+  ASSERT_EQ(limits[1].get_type(), Value::JSON_TYPE_INTEGER);
+  ASSERT_EQ((int64_t)limits[1], INT64_MIN);
+
+  Value copies = limits;
+  ASSERT_EQ(copies, handler.decode(std::string(negative)));
+  handler.encode(encoded, copies);
+  ASSERT_STREQ(encoded.c_str(), "[-1e+19, -9223372036854775808]");
+
+  // Strings are not affected
+  GUARD(handler.decode(doc, "[ \"1\" ]", 7, JsonHandler::RAW_NUMBERS));
+  ASSERT_EQ(((const Value::List &)doc.get_root())[0], std::wstring(L"1"));
+
+  ASSERT_THROW(handler.decode(doc, "[ 1. ]", 6, JsonHandler::RAW_NUMBERS), InvalidCharacter);
+}
+
 void
 test_decode_float(const char *jstr, double expected)
 {
@@ -151,6 +248,285 @@ test_decode_object()
   ASSERT_THROW(handler.decode("{,}"), ParseError);
 }
 
+void
+test_decode_utf8()
+{
+  JsonHandler handler;
+  Value strval;
+
+  // Multi byte sequences in string literals
+  GUARD(strval = handler.decode("\"x\xc3\xa9y\xe2\x82\xacz\xf0\x9f\x98\x80\""));
+  ASSERT_EQ(strval.get_type(), Value::JSON_TYPE_STRING);
+  ASSERT_EQ(strval, std::wstring(L"x\u00e9y\u20acz\U0001F600"));
+
+  // Input given with an explicit length does not need to be NUL terminated
+  GUARD(strval = handler.decode("[\"abc\"]xyz", 7));
+  ASSERT_EQ(((const Value::List &)strval)[0], std::wstring(L"abc"));
+
+  // Nested containers followed by more items
+  GUARD(strval = handler.decode("[[], {}, 1]"));
+  ASSERT_EQ(((const Value::List &)strval).size(), 3);
+  ASSERT_EQ(((const Value::List &)strval)[2], 1);
+
+  // Negative cases
+  ASSERT_THROW(handler.decode("\"\xc3\""), InvalidCharacter);
+  ASSERT_THROW(handler.decode("\"\xc0\xaf\""), InvalidCharacter);
+  ASSERT_THROW(handler.decode("\"\xed\xa0\x80\""), InvalidCharacter);
+  ASSERT_THROW(handler.decode("\"\xff\""), InvalidCharacter);
+  ASSERT_THROW(handler.decode("\"abc", 3), UnexpectedEof);
+}
+
+void
+test_decode_long_runs()
+{
+  JsonHandler handler;
+
+  // Place an escape and a multi byte sequence at every offset of a string
+  // longer than the vector width, with runs of whitespace around it
+  for (int offset = 0; offset < 70; ++offset)
+    {
+      std::string prefix(offset, 'a');
+      std::string spaces(offset, offset % 2 ? ' ' : '\n');
+      std::string json = spaces + "[" + spaces + "\"" + prefix + "\\n" + prefix + "\xc3\xa9" + prefix + "\"" + spaces + "]";
+      std::wstring wprefix(offset, L'a');
+      Value listval;
+
+      GUARD(listval = handler.decode(json));
+
+      const Value::List &list = listval;
+      ASSERT_EQ(list.size(), 1);
+      ASSERT_EQ(list[0], wprefix + L"\n" + wprefix + L"\u00e9" + wprefix);
+    }
+}
+
+void
+test_decode_latin1()
+{
+  JsonHandler handler("ISO-8859-1");
+  Value strval;
+
+  GUARD(strval = handler.decode("\"caf\xe9\""));
+  ASSERT_EQ(strval, std::wstring(L"caf\u00e9"));
+}
+
+void
+test_shared_handler()
+{
+  JsonHandler handler("ISO-8859-1");
+  std::atomic< int > failures(0);
+  std::vector< std::thread > threads;
+
+  // Threads sharing a handler do not share its codecs
+  for (int i = 0; i < 4; ++i)
+    threads.emplace_back([&handler, &failures, i]()
+      {
+        std::string input = "[ \"caf\xe9\", " + std::to_string(i) + " ]";
+
+        for (int j = 0; j < 1000; ++j)
+          {
+            Value value = handler.decode(input);
+            std::string output;
+            handler.encode(output, value);
+
+            if (((const Value::List &)value)[0] != std::wstring(L"caf\u00e9")
+                || output != "[\"caf\\u00e9\", " + std::to_string(i) + "]")
+              ++failures;
+          }
+      });
+
+  for (size_t i = 0; i < threads.size(); ++i)
+    threads[i].join();
+
+  ASSERT_EQ(failures, 0);
+  ASSERT_THROW(JsonHandler("NO-SUCH-ENCODING"), CodecException);
+}
+
+void
+test_decode_duplicate_keys()
+{
+  JsonHandler handler;
+  Value objval;
+
+  GUARD(objval = handler.decode("{ \"a\" : 1, \"a\" : { \"a\" : [ 2, { \"b\" : 3 } ] }, \"b\" : [ 4 ] }"));
+
+  const Value::Object &obj = objval;
+  ASSERT_EQ(obj.size(), 2);
+  ASSERT_EQ(obj.find(L"a")->second, 1);
+  ASSERT_EQ(((const Value::List &)obj.find(L"b")->second).size(), 1);
+}
+
+class EventRecorder : public Handler
+{
+public:
+  void null() { events << "null "; }
+  void boolean(bool value) { events << (value ? "true " : "false "); }
+  void integer(int value) { events << value << ' '; }
+  void number(double value) { events << value << ' '; }
+  void string(const std::wstring &value) { events << '"' << value.size() << "\" "; }
+  void key(const std::wstring &key) { events << "key" << key.size() << ' '; }
+  void begin_object() { events << "{ "; }
+  void end_object() { events << "} "; }
+  void begin_array() { events << "[ "; }
+  void end_array() { events << "] "; }
+
+  std::stringstream events;
+};
+
+class Counter : public Handler
+{
+public:
+  Counter() : count(0) {}
+  void begin_object() { ++count; }
+
+  int count;
+};
+
+void
+test_parse()
+{
+  JsonHandler handler;
+
+  {
+    EventRecorder recorder;
+    GUARD(handler.parse("{ \"ab\" : [ null, true, false, 12, 1.5, \"xyz\" ], \"c\" : {} }", recorder));
+    ASSERT_STREQ(recorder.events.str().c_str(), "{ key2 [ null true false 12 1.5 \"3\" ] key1 { } } ");
+  }
+
+  {
+    EventRecorder recorder;
+    GUARD(handler.parse(std::wstring(L"[ \"\u20ac\" ]"), recorder));
+    ASSERT_STREQ(recorder.events.str().c_str(), "[ \"1\" ] ");
+  }
+
+  // Handlers only implement the events they need
+  Counter counter;
+  GUARD(handler.parse("[ {}, { \"a\" : {} }, 1, \"x\" ]", counter));
+  ASSERT_EQ(counter.count, 3);
+
+  ASSERT_THROW(handler.parse("[ 1, ", counter), ParseError);
+}
+
+void
+test_try_decode()
+{
+  JsonHandler handler;
+  Document doc;
+  Value value;
+  const char *json = "{ \"a\" : [ 1, \"x\" ] }";
+
+  ASSERT(handler.try_decode(doc, json, strlen(json)));
+  ASSERT_EQ(doc.get_root(), handler.decode(json));
+
+  // Errors have the kind and position of the exceptions
+  struct
+  {
+    const char *json;
+    ParseResult::Code code;
+    size_t position;
+  } errors[] = {
+    { "@", ParseResult::INVALID_CHARACTER, 0 },
+    { "[tru]", ParseResult::INVALID_TOKEN, 1 },
+    { "\"abc", ParseResult::UNEXPECTED_EOF, 4 },
+    { "[ \"\xff\" ]", ParseResult::INVALID_UTF8, 3 },
+    { "[ 1e ]", ParseResult::INVALID_DIGIT, 4 },
+    { "[ \"\\x\" ]", ParseResult::INVALID_ESCAPE, 4 },
+    { "[ \"\\u12g4\" ]", ParseResult::INVALID_HEX, 7 },
+    { "{ 1 : 2 }", ParseResult::EXPECTED_KEY, 2 },
+    { "{ \"a\" 1 }", ParseResult::EXPECTED_COLON, 6 },
+    { "[ 1, ]", ParseResult::INVALID_LIST_END, 5 },
+    { "{ \"a\" : 1, }", ParseResult::INVALID_OBJECT_END, 11 },
+  };
+
+  for (size_t i = 0; i < sizeof(errors) / sizeof(errors[0]); ++i)
+    {
+      ParseResult result = handler.try_decode(value, NULL, errors[i].json, strlen(errors[i].json));
+
+      ASSERT(!result);
+      ASSERT_EQ(result.code, errors[i].code);
+      ASSERT_EQ(result.position, errors[i].position);
+      ASSERT(value.is_null());
+
+      try
+        {
+          handler.decode(errors[i].json);
+          ASSERT(false);
+        }
+      catch (const ParseError &e)
+        {
+          ASSERT_EQ(std::string(e.what()),
+                    std::string(result.get_message()) + " at " + std::to_string(result.position));
+        }
+    }
+
+  // The document only keeps valid input
+  ASSERT_EQ(handler.try_decode(doc, "[ 1, [ 2", 8).code, ParseResult::INVALID_LIST_END);
+  ASSERT(doc.get_root().is_null());
+
+  JsonHandler latin1("ISO-8859-1");
+  ASSERT(latin1.try_decode(value, NULL, "[ \"\xe9\" ]", 7));
+  ASSERT_EQ(((const Value::List &)value)[0], std::wstring(L"\u00e9"));
+
+  JsonHandler utf16("UTF-16LE");
+  ASSERT_EQ(utf16.try_decode(value, NULL, "[", 1).code, ParseResult::INVALID_ENCODING);
+}
+
+void
+test_max_depth()
+{
+  JsonHandler handler;
+  Value value;
+  std::string json;
+  std::string deep(100000, '[');
+
+  // Deep input is rejected at the bracket going over the limit
+  ASSERT_EQ(handler.get_max_depth(), 1024);
+  ParseResult result = handler.try_decode(value, NULL, deep.data(), deep.size());
+  ASSERT_EQ(result.code, ParseResult::TOO_DEEP);
+  ASSERT_EQ(result.position, 1024);
+  ASSERT_THROW(handler.decode(deep), NestingTooDeep);
+
+  GUARD(handler.decode(std::string(1024, '[') + std::string(1024, ']')));
+
+  // Lazy and skipped containers count too
+  Document doc;
+  std::string lazy = std::string(80000, '[') + std::string(80000, ']');
+  result = handler.try_decode(doc, lazy.data(), lazy.size(), JsonHandler::LAZY_CONTAINERS);
+  ASSERT_EQ(result.code, ParseResult::TOO_DEEP);
+  ASSERT_EQ(result.position, 1024);
+
+  lazy = std::string(1024, '[') + std::string(1024, ']');
+  GUARD(handler.decode(doc, lazy.data(), lazy.size(), JsonHandler::LAZY_CONTAINERS));
+  GUARD(handler.encode(json, doc.get_root()));
+  ASSERT(json == lazy);
+
+  std::string skipped = "[ " + std::string(2000, '[') + std::string(2000, ']') + ", 1 ]";
+  ASSERT_THROW(handler.query(value, skipped.data(), skipped.size(), "/1"), NestingTooDeep);
+
+  JsonHandler parallel;
+  parallel.set_parallel(2, 16);
+  skipped = "[ 1, 2, 3, 4, 5, 6, 7, 8, " + std::string(1024, '[') + std::string(1024, ']') + " ]";
+  ASSERT_THROW(parallel.decode(doc, skipped.data(), skipped.size(), JsonHandler::PARALLEL), NestingTooDeep);
+  skipped = "[ 1, 2, 3, 4, 5, 6, 7, 8, " + std::string(1023, '[') + std::string(1023, ']') + " ]";
+  GUARD(parallel.decode(doc, skipped.data(), skipped.size(), JsonHandler::PARALLEL));
+  ASSERT_EQ(((const Value::List &)doc.get_root()).size(), 9);
+
+  handler.set_max_depth(2);
+  ASSERT_THROW(handler.decode("[ [ [ ] ] ]"), NestingTooDeep);
+  ASSERT_THROW(handler.decode("{ \"a\" : { \"b\" : [ ] } }"), NestingTooDeep);
+  GUARD(handler.decode("[ [ ], { \"a\" : 1 } ]"));
+
+  // Without a limit, nesting is only bounded by memory, not by the stack
+  std::string objects;
+  for (int i = 0; i < 1000000; ++i)
+    objects += "{\"a\":";
+  objects += "1" + std::string(1000000, '}');
+
+  Counter counter;
+  handler.set_max_depth(0);
+  GUARD(handler.parse(objects, counter));
+  ASSERT_EQ(counter.count, 1000000);
+}
+
 template < class _T >
   std::wstring encode(const _T &value)
   {
@@ -188,6 +564,235 @@ test_encode()
   ASSERT_EQ(encode(object), L"{\"a\":null, \"b\":1, \"c\":true, \"d\":{}}");
 }
 
+void
+test_encode_float()
+{
+  JsonHandler handler;
+
+  ASSERT_EQ(encode(0.1), L"0.1");
+  ASSERT_EQ(encode(-2.5), L"-2.5");
+  ASSERT_EQ(encode(1e-7), L"1e-07");
+  ASSERT_EQ(encode(0.30000000000000004), L"0.30000000000000004");
+  ASSERT_EQ(encode(1.7976931348623157e308), L"1.7976931348623157e+308");
+
+  // JSON has no infinities and NaN
+  ASSERT_EQ(encode(HUGE_VAL), L"null");
+  ASSERT_EQ(encode(-HUGE_VAL), L"null");
+  ASSERT_EQ(encode(nan("")), L"null");
+
+  std::string json;
+  GUARD(handler.encode(json, handler.decode("[ 1e400, -1e400 ]")));
+  ASSERT_EQ(json, "[null, null]");
+
+  // Every double comes back unchanged
+  unsigned long long bits = 0x123456789ABCDEFULL;
+  bool exact = true;
+
+  for (int i = 0; i < 10000; ++i)
+    {
+      bits = bits * 6364136223846793005ULL + 1442695040888963407ULL;
+
+      double value;
+      memcpy(&value, &bits, sizeof(value));
+
+      if (value != value || value - value != 0)
+        continue;
+
+      std::string text;
+      handler.encode(text, value);
+
+      // Integral values are printed without a fraction and come back as
+      // integers
+      Value decoded = handler.decode(text);
+      double result;
+
+      if (decoded.is_uint64())
+        result = (double)(uint64_t)decoded;
+      else if (decoded.get_type() == Value::JSON_TYPE_INTEGER)
+        result = (double)(int64_t)decoded;
+      else
+        result = decoded;
+
+      if (result != value)
+        {
+          fprintf(stderr, "%s does not round trip\n", text.c_str());
+          exact = false;
+        }
+    }
+
+  ASSERT(exact);
+}
+
+void
+test_encode_utf8()
+{
+  JsonHandler handler;
+  std::string text = "previous content";
+
+  // UTF-8 output keeps the characters, only ASCII is escaped
+  handler.encode(text, std::wstring(L"\u00e9\u20ac\U0001F600\x01\x7f"));
+  ASSERT_STREQ(text.c_str(), "\"\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\\u0001\\u007f\"");
+
+  // Strings referencing the input are written in one piece
+  Document doc;
+  std::string input = "{ \"k\\u00e9y\" : [ \"\xc3\xa9t\xc3\xa9\", \"a/b\" ] }";
+  handler.decode(doc, input.data(), input.size(), JsonHandler::BORROW_STRINGS);
+  handler.encode(text, doc.get_root());
+  ASSERT_STREQ(text.c_str(), "{\"k\xc3\xa9y\":[\"\xc3\xa9t\xc3\xa9\", \"a\\/b\"]}");
+
+  // ASCII output escapes the rest, using surrogate pairs above U+FFFF
+  std::wstring wide;
+  handler.encode(wide, doc.get_root());
+  ASSERT_EQ(wide, L"{\"k\\u00e9y\":[\"\\u00e9t\\u00e9\", \"a\\/b\"]}");
+  handler.encode(wide, std::wstring(L"\U0001F600"));
+  ASSERT_EQ(wide, L"\"\\ud83d\\ude00\"");
+
+  // Object keys are escaped too
+  Value::Object object;
+  object[L"a\"b"] = Value(1);
+  handler.encode(text, object);
+  ASSERT_STREQ(text.c_str(), "{\"a\\\"b\":1}");
+
+  JsonHandler latin1("ISO-8859-1");
+  latin1.encode(text, std::wstring(L"caf\u00e9"));
+  ASSERT_STREQ(text.c_str(), "\"caf\\u00e9\"");
+}
+
+void
+test_encode_integer64()
+{
+  ASSERT_EQ(encode(Value(INT64_MIN)), L"-9223372036854775808");
+  ASSERT_EQ(encode(Value(INT64_MAX)), L"9223372036854775807");
+  ASSERT_EQ(encode(Value(UINT64_MAX)), L"18446744073709551615");
+  ASSERT_EQ(encode(Value((int64_t)1000000)), L"1000000");
+}
+
+void
+test_encode_long_runs()
+{
+  JsonHandler handler;
+
+  // Place characters to escape at every offset of a string longer than the
+  // vector width, both in wide and in borrowed strings
+  for (int offset = 0; offset < 70; ++offset)
+    {
+      std::string prefix(offset, 'a');
+      std::wstring wprefix(offset, L'a');
+      std::string expected = "[\"" + prefix + "\\n" + prefix + "\\u001f" + prefix + "\\/" + prefix
+        + "\\u007f" + prefix + "\xc3\xa9" + prefix + "\"]";
+      std::string text;
+
+      Value::List list;
+      list.push_back(Value(wprefix + L"\n" + wprefix + L"\x1f" + wprefix + L"/" + wprefix
+                           + L"\x7f" + wprefix + L"\u00e9" + wprefix));
+      handler.encode(text, list);
+      ASSERT_STREQ(text.c_str(), expected.c_str());
+
+      Document doc;
+      std::string input = "[\"" + prefix + "\x7f" + prefix + "\xc3\xa9" + prefix + "\"]";
+      handler.decode(doc, input.data(), input.size(), JsonHandler::BORROW_STRINGS);
+
+      expected = "[\"" + prefix + "\\u007f" + prefix + "\xc3\xa9" + prefix + "\"]";
+      handler.encode(text, doc.get_root());
+      ASSERT_STREQ(text.c_str(), expected.c_str());
+
+      // Wide output escapes the multi byte sequences
+      std::wstring wide;
+      expected = "[\"" + prefix + "\\u007f" + prefix + "\\u00e9" + prefix + "\"]";
+      handler.encode(wide, doc.get_root());
+      ASSERT_EQ(wide, std::wstring(expected.begin(), expected.end()));
+    }
+}
+
+// Check the size of the chunks written by the encoder
+class ChunkSink : public Sink
+{
+public:
+  ChunkSink() : chunks(0), largest(0) {}
+
+  void write(const char *data, size_t length)
+  {
+    text.append(data, length);
+    largest = std::max(largest, length);
+    ++chunks;
+  }
+
+  std::string text;
+  size_t chunks;
+  size_t largest;
+};
+
+void
+test_encode_sink()
+{
+  JsonHandler handler;
+  Value::List list;
+
+  for (int i = 0; i < 100000; ++i)
+    list.push_back(Value(std::wstring(L"item \u00e9")));
+
+  ChunkSink sink;
+  handler.encode(sink, list);
+
+  std::string expected;
+  handler.encode(expected, list);
+  ASSERT(sink.text == expected);
+  ASSERT(sink.chunks > 1);
+  ASSERT(sink.largest <= 16384);
+}
+
+void
+test_encode_parallel()
+{
+  JsonHandler handler;
+  handler.set_parallel(4, 1 << 20, 16);
+
+  Value::List list;
+  Value::Object obj;
+
+  for (int i = 0; i < 1000; ++i)
+    {
+      Value::List item;
+      item.push_back(Value(i));
+      item.push_back(Value(std::wstring(L"caf\u00e9")));
+
+      wchar_t key[16];
+      swprintf(key, 16, L"key%d", i);
+
+      list.push_back(Value(std::move(item)));
+      obj[Key(key)] = Value(i * 0.5);
+    }
+
+  list.push_back(Value(std::move(obj)));
+
+  std::string expected;
+  std::string result;
+  handler.encode(expected, list);
+  handler.encode(result, list, JsonHandler::ENCODE_PARALLEL);
+  ASSERT(result == expected);
+
+  ChunkSink sink;
+  handler.encode(sink, list, JsonHandler::ENCODE_PARALLEL);
+  ASSERT(sink.text == expected);
+
+  // Lists below two ranges and other encodings
+  Value::List small(list.begin(), list.begin() + 20);
+  handler.encode(expected, small);
+  handler.encode(result, small, JsonHandler::ENCODE_PARALLEL);
+  ASSERT(result == expected);
+
+  JsonHandler latin1("ISO-8859-1");
+  latin1.set_parallel(3, 1 << 20, 10);
+  latin1.encode(expected, list);
+  latin1.encode(result, list, JsonHandler::ENCODE_PARALLEL);
+  ASSERT(result == expected);
+
+  // Errors of the worker threads are thrown by the calling thread
+  const char *broken = "[ 1, ]";
+  list[500].set_lazy(broken, strlen(broken), Value::JSON_TYPE_LIST);
+  ASSERT_THROW(handler.encode(result, list, JsonHandler::ENCODE_PARALLEL), ParseError);
+}
+
 int
 main()
 {
@@ -214,8 +819,42 @@ main()
   RUN2(test_decode_float, "-1.6e+2", -160);
   RUN2(test_decode_float, "1.6e-2", 0.016);
   RUN2(test_decode_float, "-1.6e-2", -0.016);
+  RUN2(test_decode_float, "3.141592653589793238462643383279", 3.141592653589793);
+  RUN2(test_decode_float, "2.2250738585072014e-308", 2.2250738585072014e-308);
+  RUN2(test_decode_float, "1.7976931348623157e308", 1.7976931348623157e308);
+  RUN2(test_decode_float, "9007199254740993.0", 9007199254740992.0);
+  RUN2(test_decode_float, "0.30000000000000004", 0.30000000000000004);
+  RUN2(test_decode_float, "123456789012345678901234567890", 1.2345678901234568e29);
+  RUN2(test_decode_float, "18446744073709551616", 18446744073709551616.0);
+  RUN2(test_decode_float, "-9223372036854775809", -9223372036854775809.0);
+  RUN2(test_decode_float, "1e400", HUGE_VAL);
+  RUN2(test_decode_float, "-1e400", -HUGE_VAL);
+  RUN2(test_decode_float, "1e-400", 0.0);
+  RUN2(test_decode_integer, "2147483647", 2147483647);
+  RUN2(test_decode_integer, "-2147483648", -2147483647 - 1);
+  RUN2(test_decode_integer64, "2147483648", 2147483648LL);
+  RUN2(test_decode_integer64, "9007199254740993", 9007199254740993LL);
+  RUN2(test_decode_integer64, "-9223372036854775808", INT64_MIN);
+  RUN2(test_decode_integer64, "9223372036854775807", INT64_MAX);
+  RUN2(test_decode_unsigned64, "9223372036854775808", 9223372036854775808ULL);
+  RUN2(test_decode_unsigned64, "18446744073709551615", UINT64_MAX);
+  RUN0(test_raw_numbers);
   RUN0(test_decode_array);
   RUN0(test_decode_object);
+  RUN0(test_decode_duplicate_keys);
+  RUN0(test_parse);
+  RUN0(test_try_decode);
+  RUN0(test_max_depth);
+  RUN0(test_decode_utf8);
+  RUN0(test_decode_long_runs);
+  RUN0(test_decode_latin1);
+  RUN0(test_shared_handler);
   RUN0(test_encode);
+  RUN0(test_encode_float);
+  RUN0(test_encode_utf8);
+  RUN0(test_encode_integer64);
+  RUN0(test_encode_long_runs);
+  RUN0(test_encode_sink);
+  RUN0(test_encode_parallel);
   return 0;
 }
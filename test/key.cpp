@@ -0,0 +1,134 @@
+#include <json/json.h>
+#include <json/key.h>
+
+#include "common.h"
+
+#include <iostream>
+#include <sstream>
+
+using namespace Json;
+
+void
+test_key()
+{
+  Key empty;
+  ASSERT(empty.empty());
+  ASSERT(empty == L"");
+  ASSERT(empty.same(Key()));
+
+  Key key(L"timestamp");
+  Key copy(key);
+  ASSERT(copy.same(key));
+  ASSERT(copy == key);
+  ASSERT(key == L"timestamp");
+  ASSERT(std::wstring(L"timestamp") == key);
+  ASSERT(key != L"host");
+  ASSERT_EQ(key.size(), 9);
+  ASSERT_EQ(key.hash(), KeyHash()(std::wstring(L"timestamp")));
+  ASSERT_EQ(key.hash(), KeyHash()(L"timestamp"));
+
+  // Separately created keys compare by content
+  Key other(std::wstring(L"timestamp"));
+  ASSERT(!other.same(key));
+  ASSERT(other == key);
+  ASSERT(!(other < key) && !(key < other));
+  ASSERT(Key(L"a") < Key(L"b"));
+  ASSERT(Key(L"a") < L"b");
+  ASSERT(L"a" < Key(L"b"));
+
+  const std::wstring &text = key;
+  ASSERT(text == L"timestamp");
+
+  std::wstringstream str;
+  str << key;
+  ASSERT(str.str() == L"timestamp");
+
+  Key moved(std::move(copy));
+  copy = moved;
+  ASSERT(copy.same(key));
+}
+
+void
+test_pool()
+{
+  KeyPool pool(100, 8);
+
+  Key k1 = pool.intern(L"host");
+  Key k2 = pool.intern(std::wstring(L"host"));
+  ASSERT(k1.same(k2));
+  ASSERT_EQ(pool.size(), 1);
+
+  // Long keys are not interned
+  Key long1 = pool.intern(L"a long key");
+  Key long2 = pool.intern(L"a long key");
+  ASSERT(!long1.same(long2));
+  ASSERT(long1 == long2);
+  ASSERT_EQ(pool.size(), 1);
+
+  // Keys survive the pool
+  pool.clear();
+  ASSERT_EQ(pool.size(), 0);
+  ASSERT(k1 == L"host");
+  ASSERT(!pool.intern(L"host").same(k1));
+
+  // Neither are keys once the pool is full
+  bool interned = true;
+
+  for (int i = 0; i < 1000; ++i)
+    {
+      std::wstring text = std::to_wstring(i);
+
+      if (!pool.intern(text).same(pool.intern(text)) && i < 99)
+        interned = false;
+    }
+
+  ASSERT(interned);
+  ASSERT_EQ(pool.size(), 100);
+  ASSERT(!pool.intern(L"999").same(pool.intern(L"999")));
+}
+
+void
+test_decode()
+{
+  JsonHandler handler;
+  KeyPool pool;
+
+  handler.set_key_pool(&pool);
+  ASSERT_EQ(handler.get_key_pool(), &pool);
+
+  const char *input = "[ { \"level\" : 1, \"host\" : \"a\" }, { \"host\" : \"b\", \"level\" : 2 } ]";
+  Value v1 = handler.decode(input);
+
+  Document doc;
+  handler.decode(doc, std::string(input));
+
+  ASSERT_EQ(pool.size(), 2);
+
+  // All objects share the key of the first one
+  const Value::Object &o1 = ((const Value::List &)v1)[0];
+  const Value::Object &o2 = ((const Value::List &)v1)[1];
+  const Value::Object &o3 = ((const Value::List &)doc.get_root())[1];
+
+  ASSERT(o1.find(L"host")->first.same(o2.find(L"host")->first));
+  ASSERT(o1.find(L"host")->first.same(o3.find(L"host")->first));
+  ASSERT_EQ(o3.find(L"level")->second, 2);
+  ASSERT_EQ(v1, doc.get_root());
+
+  // Without a pool, keys are only shared within a document
+  handler.set_key_pool(NULL);
+  Value v2 = handler.decode(input);
+  const Value::Object &o4 = ((const Value::List &)v2)[0];
+  const Value::Object &o5 = ((const Value::List &)v2)[1];
+  ASSERT(!o4.find(L"host")->first.same(o1.find(L"host")->first));
+  ASSERT(o4.find(L"host")->first.same(o5.find(L"host")->first));
+  ASSERT_EQ(v1, v2);
+}
+
+int
+main()
+{
+  RUN0(test_key);
+  RUN0(test_pool);
+  RUN0(test_decode);
+  return 0;
+}
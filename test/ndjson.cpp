@@ -0,0 +1,147 @@
+#include <json/json.h>
+#include <json/ndjson.h>
+
+#include "common.h"
+
+#include <iostream>
+#include <sstream>
+
+#include <unistd.h>
+
+using namespace Json;
+
+// Build an input of count records, with a blank line every 100 lines
+std::string
+make_input(size_t count)
+{
+  std::stringstream str;
+
+  for (size_t i = 0; i < count; ++i)
+    {
+      str << "{ \"id\" : " << i << ", \"name\" : \"record " << i << "\" }\n";
+
+      if (i % 100 == 99)
+        str << "   \n";
+    }
+
+  return str.str();
+}
+
+// Check that the records come in order, on the expected lines
+class Checker : public NdjsonReader::Callback
+{
+public:
+  Checker() : count(0), last_line(0), ordered(true) {}
+
+  void record(size_t line, Value &value)
+  {
+    const Value::Object &obj = value;
+
+    if ((int)obj.find(L"id")->second != (int)count || line <= last_line)
+      ordered = false;
+
+    last_line = line;
+    ++count;
+  }
+
+  size_t count;
+  size_t last_line;
+  bool ordered;
+};
+
+// Collect the lines of the errors, skipping them
+class Skipper : public NdjsonReader::Callback
+{
+public:
+  void record(size_t, Value &)
+  {
+  }
+
+  bool error(size_t line, const ParseError &)
+  {
+    lines.push_back(line);
+    return true;
+  }
+
+  std::vector< size_t > lines;
+};
+
+void
+test_read(unsigned threads, size_t batch_size)
+{
+  NdjsonReader reader("UTF-8", threads, batch_size);
+  Checker checker;
+  std::string input = make_input(5000);
+
+  ASSERT_EQ(reader.get_threads(), threads);
+
+  reader.read(input.data(), input.size(), checker);
+  ASSERT_EQ(checker.count, 5000);
+  ASSERT(checker.ordered);
+
+  // Each blank line shifts the line numbers of the following records
+  ASSERT_EQ(checker.last_line, 5000 + 49);
+
+  // A missing final line break does not matter
+  std::vector< Value > values;
+  reader.decode(values, "[ 1 ]\n\n2", 8);
+  ASSERT_EQ(values.size(), 2);
+  ASSERT_EQ(values[1], 2);
+}
+
+void
+test_fd()
+{
+  NdjsonReader reader("UTF-8", 4, 64);
+  Checker checker;
+
+  // Large enough to span several reads
+  std::string input = make_input(60000);
+
+  FILE *file = tmpfile();
+  ASSERT(file != NULL);
+  ASSERT_EQ(fwrite(input.data(), 1, input.size(), file), input.size());
+  fflush(file);
+  lseek(fileno(file), 0, SEEK_SET);
+
+  reader.read(fileno(file), checker);
+  fclose(file);
+
+  ASSERT_EQ(checker.count, 60000);
+  ASSERT(checker.ordered);
+
+  ASSERT_THROW(reader.read(-1, checker), IOError);
+}
+
+void
+test_errors()
+{
+  NdjsonReader reader("UTF-8", 2, 2);
+  const char *input = "1\n[ 2\n3\n\"4\n5\n";
+
+  Skipper skipper;
+  reader.read(input, strlen(input), skipper);
+  ASSERT_EQ(skipper.lines.size(), 2);
+  ASSERT_EQ(skipper.lines[0], 2);
+  ASSERT_EQ(skipper.lines[1], 4);
+
+  std::vector< Value > values;
+  ASSERT_THROW(reader.decode(values, input, strlen(input)), ParseError);
+  ASSERT_EQ(values.size(), 1);
+
+  // The reader can be used again after an error
+  values.clear();
+  reader.decode(values, "1\n2\n", 4);
+  ASSERT_EQ(values.size(), 2);
+}
+
+int
+main()
+{
+  RUN2(test_read, 1, 16);
+  RUN2(test_read, 4, 16);
+  RUN2(test_read, 3, 1000);
+  RUN0(test_fd);
+  RUN0(test_errors);
+  return 0;
+}
@@ -0,0 +1,124 @@
+#include <json/json.h>
+#include <json/path.h>
+
+#include "common.h"
+
+#include <iostream>
+#include <string>
+
+using namespace Json;
+
+const char *input =
+  "{ \"version\" : 2, \"events\" : ["
+  " { \"host\" : \"a\", \"tags\" : [ \"x\", \"{[\" ] },"
+  " { \"host\" : \"b\", \"ok\" : true },"
+  " { \"host\" : \"c\", \"skipped\" : { \"deep\" : [ [ ], { } ] } },"
+  " { \"host\" : \"d\\u00e9\", \"ports\" : [ 80, 443 ] } ],"
+  " \"a/b\" : 1, \"m~n\" : 2, \"\" : 3, \"7\" : \"seven\" }";
+
+void
+test_pointer()
+{
+  JsonHandler handler;
+  Value value;
+
+  ASSERT(handler.query(value, input, strlen(input), "/events/3/host"));
+  ASSERT_EQ(value, std::wstring(L"dé"));
+
+  ASSERT_EQ(handler.query(input, "/events/1/ok"), true);
+  ASSERT_EQ(handler.query(input, "/events/3/ports/1"), 443);
+  ASSERT_EQ(handler.query(input, "/a~1b"), 1);
+  ASSERT_EQ(handler.query(input, "/m~0n"), 2);
+  ASSERT_EQ(handler.query(input, "/"), 3);
+  ASSERT_EQ(handler.query(input, "/7"), std::wstring(L"seven"));
+
+  // Matched containers are decoded whole
+  value = handler.query(input, "/events/2/skipped");
+  ASSERT_EQ(((const Value::List &)((const Value::Object &)value).find(L"deep")->second).size(), 2);
+
+  Value root = handler.query(input, "");
+  ASSERT_EQ(root, handler.decode(input));
+
+  // Missing values leave the destination alone
+  value = 5;
+  ASSERT(!handler.query(value, input, strlen(input), "/events/4"));
+  ASSERT(!handler.query(value, input, strlen(input), "/events/01"));
+  ASSERT(!handler.query(value, input, strlen(input), "/events/-"));
+  ASSERT(!handler.query(value, input, strlen(input), "/version/1"));
+  ASSERT(!handler.query(value, input, strlen(input), "/missing"));
+  ASSERT_EQ(value, 5);
+  ASSERT(handler.query(input, "/events/0/none").is_null());
+
+  ASSERT_THROW(Path("events"), PathException);
+  ASSERT_THROW(Path("/a~2"), PathException);
+}
+
+void
+test_jsonpath()
+{
+  JsonHandler handler;
+  Value::List matches;
+
+  ASSERT_EQ(handler.query(input, "$.events[3].host"), std::wstring(L"dé"));
+  ASSERT_EQ(handler.query(input, "$['a/b']"), 1);
+  ASSERT_EQ(handler.query(input, "$[\"m~n\"]"), 2);
+  ASSERT_EQ(handler.query(input, "$.events[0].tags[1]"), std::wstring(L"{["));
+
+  // Indexes only match items
+  ASSERT(handler.query(input, "$[7]").is_null());
+
+  ASSERT_EQ(handler.query_all(matches, input, "$.events[*].host"), 4);
+  ASSERT_EQ(matches.size(), 4);
+  ASSERT_EQ(matches[0], std::wstring(L"a"));
+  ASSERT_EQ(matches[3], std::wstring(L"dé"));
+
+  matches.clear();
+  ASSERT_EQ(handler.query_all(matches, input, "$.events.*.ports[*]"), 2);
+  ASSERT_EQ(matches[1], 443);
+
+  matches.clear();
+  ASSERT_EQ(handler.query_all(matches, input, "$.*"), 6);
+
+  Path path("$.events[*]['host']");
+  ASSERT(path.has_wildcards());
+  ASSERT_EQ(path.get_steps().size(), 3);
+  ASSERT(!Path("/events/0").has_wildcards());
+
+  ASSERT_THROW(Path("$..host"), PathException);
+  ASSERT_THROW(Path("$.events[x]"), PathException);
+  ASSERT_THROW(Path("$['host"), PathException);
+  ASSERT_THROW(Path("$.events[1"), PathException);
+}
+
+void
+test_errors()
+{
+  JsonHandler handler;
+  Value value;
+
+  // Skipped values are only checked for brackets and strings, and the
+  // input is not read past the match
+  const char *partial = "[ { \"a\" : tru }, 2, [ 3";
+  ASSERT(handler.query(value, partial, strlen(partial), "/1"));
+  ASSERT_EQ(value, 2);
+
+  ASSERT_THROW(handler.query(value, partial, strlen(partial), "/2/0/1"), UnexpectedEof);
+  ASSERT_THROW(handler.query(value, partial, strlen(partial), "/0/a"), InvalidCharacter);
+  ASSERT_THROW(handler.query(value, "[ , 1 ]", 7, "/1"), InvalidCharacter);
+  ASSERT_THROW(handler.query(value, "{ 1 : 2 }", 9, "/1"), InvalidCharacter);
+  ASSERT_THROW(handler.query(value, "[ [ 1 }, 2 ]", 12, "/1"), InvalidCharacter);
+  ASSERT_THROW(handler.query(value, "{ \"a\" : { ] }, \"b\" : 2 }", 24, "/b"), InvalidCharacter);
+
+  // Other encodings are transcoded first
+  JsonHandler latin1("ISO-8859-1");
+  ASSERT_EQ(latin1.query("{ \"caf\xe9\" : [ 1, 2 ] }", "/caf\xc3\xa9/1"), 2);
+}
+
+int
+main()
+{
+  RUN0(test_pointer);
+  RUN0(test_jsonpath);
+  RUN0(test_errors);
+  return 0;
+}
@@ -0,0 +1,184 @@
+#include <json/json.h>
+#include <json/stats.h>
+
+#include "common.h"
+
+#include <iostream>
+#include <string>
+
+using namespace Json;
+
+namespace
+{
+
+  class LastHook : public StatsHook
+  {
+  public:
+    LastHook()
+      : calls(0)
+    {
+    }
+
+    void report(const Stats &stats) override
+    {
+      ++calls;
+      last = stats;
+    }
+
+    size_t calls;
+    Stats last;
+  };
+
+}
+
+void
+test_disabled()
+{
+  if (Stats::enabled)
+    return;
+
+  JsonHandler handler;
+  LastHook hook;
+  std::string json;
+
+  handler.set_stats_hook(&hook);
+  ASSERT_EQ(handler.get_stats_hook(), &hook);
+
+  GUARD(handler.encode(json, handler.decode("[ 1, \"x\" ]")));
+  ASSERT_EQ(hook.calls, 0);
+}
+
+void
+test_decode()
+{
+  if (!Stats::enabled)
+    return;
+
+  JsonHandler handler;
+  LastHook hook;
+  std::string json = "{ \"a\" : [ 1, 2.5, \"x\", { \"b\" : null } ], \"c\" : \"y\" }";
+
+  handler.set_stats_hook(&hook);
+
+  GUARD(handler.decode(json));
+  ASSERT_EQ(hook.calls, 1);
+  ASSERT_EQ(hook.last.decodes, 1);
+  ASSERT_EQ(hook.last.encodes, 0);
+  ASSERT_EQ(hook.last.errors, 0);
+  ASSERT_EQ(hook.last.bytes_in, json.size());
+  ASSERT_EQ(hook.last.bytes_out, 0);
+  ASSERT_EQ(hook.last.strings, 2);
+  ASSERT_EQ(hook.last.numbers, 2);
+  ASSERT_EQ(hook.last.lists, 1);
+  ASSERT_EQ(hook.last.objects, 2);
+  ASSERT_EQ(hook.last.keys, 3);
+  ASSERT_EQ(hook.last.max_depth, 3);
+  ASSERT(hook.last.allocations >= 3);
+  ASSERT(hook.last.allocated_bytes > 0);
+
+  // Borrowed strings are not allocated
+  Document doc;
+  const char *strings = "[ \"a string which is not short\", \"another one, not short either\" ]";
+  GUARD(handler.decode(doc, strings, strlen(strings)));
+  ASSERT_EQ(hook.calls, 2);
+  ASSERT_EQ(hook.last.strings, 2);
+  uint64_t allocations = hook.last.allocations;
+
+  GUARD(handler.decode(doc, strings, strlen(strings), JsonHandler::BORROW_STRINGS));
+  ASSERT_EQ(hook.calls, 3);
+  ASSERT_EQ(hook.last.allocations, allocations - 2);
+
+  // Failed calls are reported too
+  ASSERT_THROW(handler.decode(std::string("[ 1, ")), ParseError);
+  ASSERT_EQ(hook.calls, 4);
+  ASSERT_EQ(hook.last.errors, 1);
+  ASSERT_EQ(hook.last.numbers, 1);
+
+  // Without a hook nothing is collected
+  handler.set_stats_hook(NULL);
+  GUARD(handler.decode(json));
+  ASSERT_EQ(hook.calls, 4);
+}
+
+void
+test_encode()
+{
+  if (!Stats::enabled)
+    return;
+
+  JsonHandler handler;
+  LastHook hook;
+  Value value;
+  std::string json;
+
+  GUARD(value = handler.decode("[ 1, \"x\" ]"));
+  handler.set_stats_hook(&hook);
+
+  GUARD(handler.encode(json, value));
+  ASSERT_EQ(hook.calls, 1);
+  ASSERT_EQ(hook.last.encodes, 1);
+  ASSERT_EQ(hook.last.bytes_out, json.size());
+
+  std::string output;
+  StringSink sink(output);
+  GUARD(handler.encode(sink, value));
+  ASSERT_EQ(hook.last.bytes_out, output.size());
+
+  std::wstring wide;
+  GUARD(handler.encode(wide, value));
+  ASSERT_EQ(hook.last.bytes_out, wide.size() * sizeof(wchar_t));
+}
+
+void
+test_collector()
+{
+  if (!Stats::enabled)
+    return;
+
+  // Transcoded calls are reported once, with the time of the codec
+  JsonHandler handler("ISO-8859-1");
+  StatsCollector collector;
+  std::string json;
+
+  handler.set_stats_hook(&collector);
+
+  GUARD(handler.encode(json, handler.decode(std::string("[ \"\xe9\", [ [ 3 ] ] ]"))));
+
+  Stats stats = collector.get();
+  ASSERT_EQ(stats.decodes, 1);
+  ASSERT_EQ(stats.encodes, 1);
+  ASSERT_EQ(stats.strings, 1);
+  ASSERT_EQ(stats.lists, 3);
+  ASSERT_EQ(stats.max_depth, 3);
+  ASSERT_EQ(stats.bytes_out, json.size());
+
+  // The threads decoding ranges add to the call
+  Document doc;
+  std::string list = "[";
+  for (int i = 0; i < 1000; ++i)
+    list += (i ? ", [ " : "[ ") + std::to_string(i) + " ]";
+  list += "]";
+
+  JsonHandler parallel;
+  parallel.set_stats_hook(&collector);
+  parallel.set_parallel(4, 64);
+  collector.clear();
+
+  GUARD(parallel.decode(doc, list.data(), list.size(), JsonHandler::PARALLEL));
+  ASSERT_EQ(((const Value::List &)doc.get_root()).size(), 1000);
+
+  stats = collector.get();
+  ASSERT_EQ(stats.decodes, 1);
+  ASSERT_EQ(stats.numbers, 1000);
+  ASSERT(stats.lists >= 1000);
+}
+
+int
+main()
+{
+  RUN0(test_disabled);
+  RUN0(test_decode);
+  RUN0(test_encode);
+  RUN0(test_collector);
+  return 0;
+}
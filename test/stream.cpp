@@ -0,0 +1,170 @@
+#include <json/json.h>
+#include <json/stream.h>
+
+#include "common.h"
+
+#include <iostream>
+
+using namespace Json;
+
+static const char *document =
+  "{ \"list\" : [ 1, -20, 3.25, 1e3, true, false, null, [], {} ],\n"
+  "  \"escaped\" : \"a\\\"b\\\\c\\/d\\n\\u00e9\\u20AC\",\n"
+  "  \"utf8\" : \"\xc3\xa9t\xc3\xa9 \xe2\x82\xac\",\n"
+  "  \"nested\" : { \"key\" : [ { \"x\" : 0 } ] },\n"
+  "  \"empty\" : \"\" }";
+
+// Parse the input in chunks of the given size
+Value
+parse_chunks(const std::string &input, size_t chunk)
+{
+  Value result;
+  ValueBuilder builder(result);
+  StreamParser parser(builder);
+
+  for (size_t pos = 0; pos < input.size(); pos += chunk)
+    parser.feed(input.data() + pos, std::min(chunk, input.size() - pos));
+
+  parser.finish();
+
+  ASSERT(parser.is_complete());
+  return result;
+}
+
+void
+test_chunks()
+{
+  JsonHandler handler;
+  Value expected = handler.decode(std::string(document));
+
+  // Every chunk size splits some token somewhere
+  for (size_t chunk = 1; chunk <= 17; ++chunk)
+    ASSERT_EQ(parse_chunks(document, chunk), expected);
+
+  ASSERT_EQ(parse_chunks(document, strlen(document)), expected);
+}
+
+void
+test_scalars()
+{
+  // A number at the end of the input is only complete at finish
+  ASSERT_EQ(parse_chunks("123", 1), 123);
+  ASSERT_EQ(parse_chunks(" -1.5 ", 2), -1.5);
+  ASSERT_EQ(parse_chunks("\"text\"", 3), std::wstring(L"text"));
+  ASSERT_EQ(parse_chunks("true", 1), true);
+  ASSERT_EQ(parse_chunks("null", 1).get_type(), Value::JSON_TYPE_NULL);
+}
+
+// Count the values of the input
+class Counter : public Handler
+{
+public:
+  Counter() : values(0) {}
+
+  void integer(int) { ++values; }
+  void begin_array() { ++values; }
+
+  int values;
+};
+
+void
+test_reset()
+{
+  Counter counter;
+  StreamParser parser(counter);
+
+  parser.feed("[ 1, ", 5);
+  ASSERT(!parser.is_complete());
+  parser.feed("2 ]", 3);
+  ASSERT(parser.is_complete());
+  parser.finish();
+  ASSERT_EQ(counter.values, 3);
+
+  // Another document can be parsed after a reset, even a partial one
+  parser.reset();
+  parser.feed("[ 3 ] ", 6);
+  parser.finish();
+  ASSERT_EQ(counter.values, 5);
+
+  parser.reset();
+  parser.feed("[", 1);
+  parser.reset();
+  parser.feed("4", 1);
+  parser.finish();
+  ASSERT_EQ(counter.values, 7);
+}
+
+void
+test_errors()
+{
+  ASSERT_THROW(parse_chunks("[ 1, 2", 1), UnexpectedEof);
+  ASSERT_THROW(parse_chunks("\"abc", 1), UnexpectedEof);
+  ASSERT_THROW(parse_chunks("", 1), UnexpectedEof);
+  ASSERT_THROW(parse_chunks("[ 1, ]", 1), InvalidCharacter);
+  ASSERT_THROW(parse_chunks("[ 1 }", 1), InvalidCharacter);
+  ASSERT_THROW(parse_chunks("{ 1 : 2 }", 1), InvalidCharacter);
+  ASSERT_THROW(parse_chunks("{ \"a\" 2 }", 1), InvalidCharacter);
+  ASSERT_THROW(parse_chunks("tru", 1), UnexpectedEof);
+  ASSERT_THROW(parse_chunks("trux", 1), InvalidCharacter);
+  ASSERT_THROW(parse_chunks("[ 1.e5 ]", 1), InvalidCharacter);
+  ASSERT_THROW(parse_chunks("[ 01 ]", 1), InvalidCharacter);
+  ASSERT_THROW(parse_chunks("\"\\x\"", 1), InvalidCharacter);
+  ASSERT_THROW(parse_chunks("\"\\u12g4\"", 1), InvalidCharacter);
+  ASSERT_THROW(parse_chunks("\"\xc3(\"", 1), InvalidCharacter);
+  ASSERT_THROW(parse_chunks("\"\xff\"", 1), InvalidCharacter);
+  ASSERT_THROW(parse_chunks("[] []", 1), InvalidCharacter);
+
+  // Errors in numbers are positioned in the whole input
+  try
+    {
+      parse_chunks("[ 10, 1.e5 ]", 3);
+      ASSERT(false);
+    }
+  catch (const InvalidCharacter &e)
+    {
+      ASSERT_EQ(std::string(e.what()), "Invalid digit at 8");
+    }
+}
+
+void
+test_max_depth()
+{
+  Value result;
+  ValueBuilder builder(result);
+  StreamParser parser(builder);
+
+  ASSERT_EQ(parser.get_max_depth(), 1024);
+
+  parser.set_max_depth(2);
+  GUARD(parser.feed("[ [ ], { \"a\" : 1 } ]", 20));
+  GUARD(parser.finish());
+
+  parser.reset();
+  ASSERT_EQ(parser.get_max_depth(), 2);
+
+  try
+    {
+      parser.feed("[ { \"a\" : [ ] } ]", 17);
+      ASSERT(false);
+    }
+  catch (const NestingTooDeep &e)
+    {
+      ASSERT_EQ(std::string(e.what()), "Maximum nesting depth exceeded at 10");
+    }
+
+  // Deep input fails before the values get too deep to be destroyed
+  std::string deep(1000000, '[');
+  deep.append(1000000, ']');
+  ASSERT_THROW(parse_chunks(deep, 4096), NestingTooDeep);
+}
+
+int
+main()
+{
+  RUN0(test_chunks);
+  RUN0(test_scalars);
+  RUN0(test_reset);
+  RUN0(test_errors);
+  RUN0(test_max_depth);
+  return 0;
+}
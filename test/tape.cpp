@@ -0,0 +1,118 @@
+#include <json/json.h>
+#include <json/tape.h>
+
+#include "common.h"
+
+#include <iostream>
+#include <string>
+
+using namespace Json;
+
+void
+test_decode()
+{
+  JsonHandler handler;
+  Tape tape;
+
+  ASSERT(tape.get_root().is_null());
+
+  GUARD(handler.decode(tape, std::string(
+    "{ \"list\" : [ 1, -5000000000, 18446744073709551615, 2.5, true, null, \"t\\u00e9xt\" ],"
+    " \"nested\" : { \"a\" : [ [ ], { } ], \"b\" : \"\" }, \"last\" : false }")));
+
+  TapeValue root = tape.get_root();
+  ASSERT_EQ(root.get_type(), Value::JSON_TYPE_OBJECT);
+  ASSERT_EQ(root.size(), 3);
+
+  TapeValue::Object obj = root;
+  ASSERT_EQ(obj.size(), 3);
+  ASSERT(obj.find(L"missing") == obj.end());
+  ASSERT_EQ(obj.count(std::string("last")), 1);
+  ASSERT_EQ((bool)obj.find(L"last")->second, false);
+
+  TapeValue::List list = obj.find(L"list")->second;
+  ASSERT_EQ(list.size(), 7);
+  ASSERT_EQ((int)list[0], 1);
+  ASSERT_EQ((int64_t)list[1], -5000000000LL);
+  ASSERT(list[2].is_uint64());
+  ASSERT_EQ((uint64_t)list[2], 18446744073709551615ULL);
+  ASSERT_EQ((double)list[3], 2.5);
+  ASSERT_EQ((bool)list[4], true);
+  ASSERT(list[5].is_null());
+  ASSERT((std::wstring)list[6] == L"t\u00e9xt");
+  ASSERT_EQ((std::string)list[6], "t\xc3\xa9xt");
+
+  ASSERT_THROW((int)list[1], ValueException);
+  ASSERT_THROW((double)list[0], ValueException);
+  ASSERT_THROW((std::string)list[0], ValueException);
+  ASSERT_THROW(list[7], ValueException);
+
+  // Iteration skips nested values in one step
+  size_t count = 0;
+  for (TapeValue::Object::const_iterator it = obj.begin(); it != obj.end(); ++it, ++count)
+    ASSERT((std::string)it->first == (count == 0 ? "list" : count == 1 ? "nested" : "last"));
+  ASSERT_EQ(count, 3);
+
+  TapeValue nested = obj.find(std::string("nested"))->second;
+  ASSERT_EQ(nested.next(), obj.find(L"last")->first);
+
+  TapeValue::List pair = ((TapeValue::Object)nested).find(L"a")->second;
+  ASSERT_EQ(pair.size(), 2);
+  ASSERT(((TapeValue::List)pair[0]).empty());
+  ASSERT(((TapeValue::Object)pair[1]).empty());
+  ASSERT(((TapeValue::List)pair[0]).begin() == ((TapeValue::List)pair[0]).end());
+
+  // Decoding again reuses the tape
+  GUARD(handler.decode(tape, std::string("[ \"x\" ]")));
+  ASSERT_EQ(tape.get_root().size(), 1);
+  ASSERT_EQ((std::string)((TapeValue::List)tape.get_root())[0], "x");
+
+  // A failed decoding leaves null
+  ASSERT_THROW(handler.decode(tape, std::string("[ 1, ")), ParseError);
+  ASSERT(tape.get_root().is_null());
+}
+
+void
+test_to_value()
+{
+  JsonHandler handler;
+  Tape tape;
+  const char *json =
+    "{ \"list\" : [ 1, -5000000000, 18446744073709551615, 2.5, true, null, \"t\\u00e9xt\" ],"
+    " \"nested\" : { \"k\\u00e9y\" : [ [ ], { } ], \"b\" : \"\" }, \"last\" : false }";
+
+  GUARD(handler.decode(tape, json, strlen(json)));
+
+  Value value;
+  GUARD(value = tape.get_root().to_value());
+  ASSERT_EQ(value, handler.decode(json));
+
+  // A subtree converts alone, its strings can stay in the tape
+  Document doc;
+  TapeValue::Object obj = tape.get_root();
+  GUARD(obj.find(L"list")->second.to_value(doc.get_root(), &doc.get_arena(), NULL,
+                                           JsonHandler::BORROW_STRINGS));
+
+  const Value::List &list = doc.get_root();
+  ASSERT_EQ(list.size(), 7);
+  ASSERT_EQ(list.get_allocator().get_resource(), &doc.get_arena());
+  ASSERT(list[2].is_uint64());
+
+  const char *text;
+  size_t length;
+  ASSERT(list[6].get_borrowed_string(text, length));
+  ASSERT_EQ(list[6], std::wstring(L"t\u00e9xt"));
+
+  // Other encodings go through the codec
+  JsonHandler latin1("ISO-8859-1");
+  GUARD(latin1.decode(tape, std::string("[ \"\xe9\" ]")));
+  ASSERT_EQ((std::string)((TapeValue::List)tape.get_root())[0], "\xc3\xa9");
+}
+
+int
+main()
+{
+  RUN0(test_decode);
+  RUN0(test_to_value);
+  return 0;
+}
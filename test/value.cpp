@@ -45,6 +45,28 @@ test_integer()
   ASSERT_EQ(val, false);
 }
 
+void
+test_integer64()
+{
+  Value big((int64_t)1 << 40);
+  Value huge(UINT64_MAX);
+
+  ASSERT_EQ(big.get_type(), Value::JSON_TYPE_INTEGER);
+  ASSERT_EQ((int64_t)big, (int64_t)1 << 40);
+  ASSERT_EQ((uint64_t)big, (uint64_t)1 << 40);
+  ASSERT_THROW((int)big, ValueException);
+
+  ASSERT(huge.is_uint64());
+  ASSERT_EQ((uint64_t)huge, UINT64_MAX);
+  ASSERT_THROW((int64_t)huge, ValueException);
+  ASSERT_NE(huge, Value((int64_t)-1));
+  ASSERT(Value((uint64_t)5) == Value(5));
+
+  Value negative(-5);
+  ASSERT_THROW((uint64_t)negative, ValueException);
+  ASSERT_EQ((int64_t)negative, -5);
+}
+
 void
 test_float()
 {
@@ -68,6 +90,62 @@ test_string()
   ASSERT_EQ(val, etalon);
 }
 
+void
+test_short_string()
+{
+  const char *text;
+  size_t len;
+
+  ASSERT_EQ(sizeof(Value), 16);
+
+  // Up to 12 bytes of UTF-8 are stored in the value
+  Value val(L"twelve bytes");
+  ASSERT(val.get_utf8_string(text, len));
+  ASSERT_EQ(len, 12);
+  ASSERT_EQ(std::string(text, len), "twelve bytes");
+  ASSERT(!val.get_borrowed_string(text, len));
+
+  Value multibyte(L"\u00e9t\u00e9\u20ac\U0001f600");
+  ASSERT(multibyte.get_utf8_string(text, len));
+  ASSERT_EQ(len, 12);
+
+  Value copy(multibyte);
+  ASSERT(copy.get_utf8_string(text, len));
+  ASSERT_EQ(copy, multibyte);
+  ASSERT_EQ((const std::wstring &)copy, L"\u00e9t\u00e9\u20ac\U0001f600");
+
+  // Casting to a wide string moves it to the heap
+  ASSERT(!copy.get_utf8_string(text, len));
+  ASSERT_EQ(copy, multibyte);
+
+  Value longer(L"thirteen byte");
+  ASSERT(!longer.get_utf8_string(text, len));
+  ASSERT_EQ(longer, std::wstring(L"thirteen byte"));
+
+  // Strings which are not valid Unicode are kept as they are
+  std::wstring surrogate(1, (wchar_t)0xD800);
+  Value invalid(surrogate);
+  ASSERT(!invalid.get_utf8_string(text, len));
+  ASSERT_EQ(invalid, surrogate);
+
+  Value empty(L"");
+  ASSERT(empty.get_utf8_string(text, len));
+  ASSERT_EQ(len, 0);
+  ASSERT_EQ(empty, std::wstring());
+
+  Value other(L"other");
+  other.swap(val);
+  ASSERT_EQ(val, std::wstring(L"other"));
+  ASSERT_EQ(other, std::wstring(L"twelve bytes"));
+
+  Value moved(std::move(other));
+  ASSERT_EQ(moved, std::wstring(L"twelve bytes"));
+
+  // Setting a value from its own string
+  moved.set((const std::wstring &)moved);
+  ASSERT_EQ(moved, std::wstring(L"twelve bytes"));
+}
+
 void
 test_list()
 {
@@ -97,15 +175,57 @@ test_object()
   ASSERT_EQ(val, obj);
 }
 
+void
+test_move()
+{
+  Value::List list;
+  list.push_back(Value(1));
+  list.push_back(Value(L"two"));
+  const Value *items = list.data();
+
+  // The list is taken over, not copied
+  Value val(std::move(list));
+  ASSERT_EQ(val.get_type(), Value::JSON_TYPE_LIST);
+  ASSERT_EQ(((const Value::List &)val).data(), items);
+
+  Value other(std::move(val));
+  ASSERT(val.is_null());
+  ASSERT_EQ(((const Value::List &)other).data(), items);
+
+  val = std::move(other);
+  ASSERT(other.is_null());
+  ASSERT_EQ(((const Value::List &)val).data(), items);
+
+  std::wstring str(L"a string long enough to be on the heap");
+  const wchar_t *chars = str.data();
+  Value strval(std::move(str));
+  ASSERT_EQ(((const std::wstring &)strval).data(), chars);
+
+  Value::Object obj;
+  obj[L"key"] = Value(1);
+  Value objval;
+  objval.set(std::move(obj));
+  ASSERT_EQ(((const Value::Object &)objval).size(), 1);
+
+  // Assigning a part of a value to itself
+  val = ((const Value::List &)val)[1];
+  ASSERT_EQ(val, std::wstring(L"two"));
+  objval = ((const Value::Object &)objval).find(L"key")->second;
+  ASSERT_EQ(objval, 1);
+}
+
 int
 main()
 {
   RUN0(test_null);
   RUN0(test_bool);
   RUN0(test_integer);
+  RUN0(test_integer64);
   RUN0(test_float);
   RUN0(test_string);
+  RUN0(test_short_string);
   RUN0(test_list);
   RUN0(test_object);
+  RUN0(test_move);
   return 0;
 }
@@ -0,0 +1,216 @@
+#include <json/json.h>
+#include <json/writer.h>
+
+#include "common.h"
+
+#include <iostream>
+
+#include <math.h>
+#include <stdint.h>
+#include <unistd.h>
+
+using namespace Json;
+
+void
+test_compact()
+{
+  std::string text;
+  StringSink sink(text);
+  Writer writer(sink);
+
+  writer.begin_object();
+  writer.key("list");
+  writer.begin_array();
+  writer.value(1);
+  writer.value((int64_t)-5000000000LL);
+  writer.value(UINT64_MAX);
+  writer.value(2.5);
+  writer.value(HUGE_VAL);
+  writer.value(true);
+  writer.null();
+  writer.begin_object();
+  writer.end_object();
+  writer.end_array();
+  writer.key(L"t\u00e9xt");
+  writer.value("a\"b\xe2\x82\xac");
+  writer.key("wide");
+  writer.value(std::wstring(L"\n"));
+  ASSERT(!writer.is_complete());
+  writer.end_object();
+  ASSERT(writer.is_complete());
+  writer.finish();
+
+  ASSERT_STREQ(text.c_str(), "{\"list\":[1, -5000000000, 18446744073709551615, 2.5, null, true, null, {}], "
+               "\"t\xc3\xa9xt\":\"a\\\"b\xe2\x82\xac\", \"wide\":\"\\n\"}");
+}
+
+void
+test_same_as_encode()
+{
+  JsonHandler handler;
+  Value value = handler.decode("{ \"a\" : [ 1, 2.5, \"x\", null, [ {} ] ], \"b\" : { \"c\" : false } }");
+
+  std::string expected;
+  handler.encode(expected, value);
+
+  std::string text;
+  StringSink sink(text);
+  Writer writer(sink);
+  writer.value(value);
+  writer.finish();
+
+  ASSERT_STREQ(text.c_str(), expected.c_str());
+}
+
+void
+test_pretty()
+{
+  JsonHandler handler;
+  Value value = handler.decode("{ \"a\" : [ 1, [], { \"b\" : null } ], \"c\" : {} }");
+
+  std::string text;
+  StringSink sink(text);
+  Writer writer(sink, Writer::PRETTY);
+  writer.value(value);
+  writer.finish();
+
+  ASSERT_STREQ(text.c_str(),
+               "{\n"
+               "  \"a\": [\n"
+               "    1,\n"
+               "    [],\n"
+               "    {\n"
+               "      \"b\": null\n"
+               "    }\n"
+               "  ],\n"
+               "  \"c\": {}\n"
+               "}");
+
+  // Pretty output decodes to the same value
+  ASSERT_EQ(handler.decode(text), value);
+}
+
+void
+test_ascii()
+{
+  std::string text;
+  StringSink sink(text);
+  Writer writer(sink, Writer::ASCII);
+
+  writer.begin_array();
+  writer.value("\xc3\xa9\xf0\x9f\x98\x80");
+  writer.value(std::wstring(L"\u20ac"));
+  writer.end_array();
+  writer.finish();
+
+  ASSERT_STREQ(text.c_str(), "[\"\\u00e9\\ud83d\\ude00\", \"\\u20ac\"]");
+}
+
+void
+test_errors()
+{
+  std::string text;
+  StringSink sink(text);
+
+  {
+    Writer writer(sink);
+    writer.begin_object();
+    ASSERT_THROW(writer.value(1), WriterException);
+    ASSERT_THROW(writer.end_array(), WriterException);
+    writer.key("a");
+    ASSERT_THROW(writer.key("b"), WriterException);
+    ASSERT_THROW(writer.end_object(), WriterException);
+    ASSERT_THROW(writer.finish(), WriterException);
+  }
+
+  {
+    Writer writer(sink);
+    ASSERT_THROW(writer.key("a"), WriterException);
+    ASSERT_THROW(writer.end_object(), WriterException);
+    writer.begin_array();
+    ASSERT_THROW(writer.key("a"), WriterException);
+    writer.end_array();
+    ASSERT_THROW(writer.value(1), WriterException);
+    ASSERT_THROW(writer.begin_array(), WriterException);
+  }
+}
+
+void
+test_large()
+{
+  // A large output goes through the sink in bounded chunks
+  size_t total = 0;
+  size_t largest = 0;
+  CallbackSink sink([&](const char *, size_t length)
+    {
+      total += length;
+      largest = std::max(largest, length);
+    });
+  Writer writer(sink, Writer::PRETTY);
+
+  writer.begin_array();
+  for (int i = 0; i < 1000000; ++i)
+    {
+      writer.begin_object();
+      writer.key("id");
+      writer.value(i);
+      writer.key("name");
+      writer.value("some record name");
+      writer.end_object();
+    }
+  writer.end_array();
+  writer.finish();
+
+  ASSERT(total > 50000000);
+  ASSERT(largest <= 16384);
+}
+
+void
+test_fd()
+{
+  FILE *file = tmpfile();
+  ASSERT(file != NULL);
+
+  {
+    FdSink sink(fileno(file));
+    Writer writer(sink);
+    writer.begin_array();
+    for (int i = 0; i < 10000; ++i)
+      writer.value(i);
+    writer.end_array();
+    writer.finish();
+  }
+
+  {
+    FileSink sink(file);
+    Writer writer(sink);
+    writer.value(" [ \"end\" ]");
+    writer.finish();
+  }
+
+  fflush(file);
+
+  std::string text(lseek(fileno(file), 0, SEEK_END), '\0');
+  ASSERT_EQ(pread(fileno(file), &text[0], text.size(), 0), (ssize_t)text.size());
+  fclose(file);
+
+  ASSERT_EQ(text.substr(0, 8), "[0, 1, 2");
+  std::string end = "9998, 9999]\" [ \\\"end\\\" ]\"";
+  ASSERT_EQ(text.substr(text.size() - end.size()), end);
+
+  FdSink sink(-1);
+  ASSERT_THROW(sink.write("x", 1), IOError);
+}
+
+int
+main()
+{
+  RUN0(test_compact);
+  RUN0(test_same_as_encode);
+  RUN0(test_pretty);
+  RUN0(test_ascii);
+  RUN0(test_errors);
+  RUN0(test_large);
+  RUN0(test_fd);
+  return 0;
+}